@@ -11,7 +11,7 @@
 
 //---------- Includes ----------------------------------------------------------
 #include "I2C_HAL.h"
-#include "nrf_delay.h"
+#include "power_profile.h"
 
 //==============================================================================
 void I2c_Init(void)
@@ -123,7 +123,7 @@ u8t I2c_ReadByte (etI2cAck ack)
 void DelayMicroSeconds (u32t nbrOfUs)
 //==============================================================================
 {
-	nrf_delay_us(nbrOfUs);
+	power_profile_i2c_delay_us(nbrOfUs);
 }
 
 
@@ -15,11 +15,58 @@
 //  CRC
 const u16t POLYNOMIAL = 0x131;  //P(x)=x^8+x^5+x^4+1 = 100110001
 
+#if SHT2x_CRC_IMPL == SHT2x_CRC_TABLE || defined(SHT2x_CRC_ALL)
+// CRC of every byte value, 256 bytes of flash
+static const u8t CRC_TABLE[256] = {
+  0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97,
+  0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E,
+  0x43, 0x72, 0x21, 0x10, 0x87, 0xB6, 0xE5, 0xD4,
+  0xFA, 0xCB, 0x98, 0xA9, 0x3E, 0x0F, 0x5C, 0x6D,
+  0x86, 0xB7, 0xE4, 0xD5, 0x42, 0x73, 0x20, 0x11,
+  0x3F, 0x0E, 0x5D, 0x6C, 0xFB, 0xCA, 0x99, 0xA8,
+  0xC5, 0xF4, 0xA7, 0x96, 0x01, 0x30, 0x63, 0x52,
+  0x7C, 0x4D, 0x1E, 0x2F, 0xB8, 0x89, 0xDA, 0xEB,
+  0x3D, 0x0C, 0x5F, 0x6E, 0xF9, 0xC8, 0x9B, 0xAA,
+  0x84, 0xB5, 0xE6, 0xD7, 0x40, 0x71, 0x22, 0x13,
+  0x7E, 0x4F, 0x1C, 0x2D, 0xBA, 0x8B, 0xD8, 0xE9,
+  0xC7, 0xF6, 0xA5, 0x94, 0x03, 0x32, 0x61, 0x50,
+  0xBB, 0x8A, 0xD9, 0xE8, 0x7F, 0x4E, 0x1D, 0x2C,
+  0x02, 0x33, 0x60, 0x51, 0xC6, 0xF7, 0xA4, 0x95,
+  0xF8, 0xC9, 0x9A, 0xAB, 0x3C, 0x0D, 0x5E, 0x6F,
+  0x41, 0x70, 0x23, 0x12, 0x85, 0xB4, 0xE7, 0xD6,
+  0x7A, 0x4B, 0x18, 0x29, 0xBE, 0x8F, 0xDC, 0xED,
+  0xC3, 0xF2, 0xA1, 0x90, 0x07, 0x36, 0x65, 0x54,
+  0x39, 0x08, 0x5B, 0x6A, 0xFD, 0xCC, 0x9F, 0xAE,
+  0x80, 0xB1, 0xE2, 0xD3, 0x44, 0x75, 0x26, 0x17,
+  0xFC, 0xCD, 0x9E, 0xAF, 0x38, 0x09, 0x5A, 0x6B,
+  0x45, 0x74, 0x27, 0x16, 0x81, 0xB0, 0xE3, 0xD2,
+  0xBF, 0x8E, 0xDD, 0xEC, 0x7B, 0x4A, 0x19, 0x28,
+  0x06, 0x37, 0x64, 0x55, 0xC2, 0xF3, 0xA0, 0x91,
+  0x47, 0x76, 0x25, 0x14, 0x83, 0xB2, 0xE1, 0xD0,
+  0xFE, 0xCF, 0x9C, 0xAD, 0x3A, 0x0B, 0x58, 0x69,
+  0x04, 0x35, 0x66, 0x57, 0xC0, 0xF1, 0xA2, 0x93,
+  0xBD, 0x8C, 0xDF, 0xEE, 0x79, 0x48, 0x1B, 0x2A,
+  0xC1, 0xF0, 0xA3, 0x92, 0x05, 0x34, 0x67, 0x56,
+  0x78, 0x49, 0x1A, 0x2B, 0xBC, 0x8D, 0xDE, 0xEF,
+  0x82, 0xB3, 0xE0, 0xD1, 0x46, 0x77, 0x24, 0x15,
+  0x3B, 0x0A, 0x59, 0x68, 0xFF, 0xCE, 0x9D, 0xAC
+};
+#endif
+
+#if SHT2x_CRC_IMPL == SHT2x_CRC_NIBBLE || defined(SHT2x_CRC_ALL)
+// CRC of every 4 bit value in the upper nibble, 16 bytes of flash
+static const u8t CRC_NIBBLE_TABLE[16] = {
+  0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97,
+  0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E
+};
+#endif
+
+#if SHT2x_CRC_IMPL == SHT2x_CRC_BITWISE || defined(SHT2x_CRC_ALL)
 //==============================================================================
-u8t SHT2x_CheckCrc(u8t data[], u8t nbrOfBytes, u8t checksum)
+u8t SHT2x_CalcCrcBitwise(const u8t data[], u8t nbrOfBytes)
 //==============================================================================
 {
-  u8t crc = 0;	
+  u8t crc = 0;
   u8t byteCtr;
   //calculates 8-Bit checksum with given polynomial
   for (byteCtr = 0; byteCtr < nbrOfBytes; ++byteCtr)
@@ -29,6 +76,53 @@ u8t SHT2x_CheckCrc(u8t data[], u8t nbrOfBytes, u8t checksum)
       else crc = (crc << 1);
     }
   }
+  return crc;
+}
+#endif
+
+#if SHT2x_CRC_IMPL == SHT2x_CRC_TABLE || defined(SHT2x_CRC_ALL)
+//==============================================================================
+u8t SHT2x_CalcCrcTable(const u8t data[], u8t nbrOfBytes)
+//==============================================================================
+{
+  u8t crc = 0;
+  u8t byteCtr;
+  //one table lookup per byte
+  for (byteCtr = 0; byteCtr < nbrOfBytes; ++byteCtr)
+  { crc = CRC_TABLE[crc ^ data[byteCtr]];
+  }
+  return crc;
+}
+#endif
+
+#if SHT2x_CRC_IMPL == SHT2x_CRC_NIBBLE || defined(SHT2x_CRC_ALL)
+//==============================================================================
+u8t SHT2x_CalcCrcNibble(const u8t data[], u8t nbrOfBytes)
+//==============================================================================
+{
+  u8t crc = 0;
+  u8t byteCtr;
+  //two table lookups per byte, high nibble first
+  for (byteCtr = 0; byteCtr < nbrOfBytes; ++byteCtr)
+  { crc ^= data[byteCtr];
+    crc = (u8t)(crc << 4) ^ CRC_NIBBLE_TABLE[crc >> 4];
+    crc = (u8t)(crc << 4) ^ CRC_NIBBLE_TABLE[crc >> 4];
+  }
+  return crc;
+}
+#endif
+
+//==============================================================================
+u8t SHT2x_CheckCrc(u8t data[], u8t nbrOfBytes, u8t checksum)
+//==============================================================================
+{
+#if SHT2x_CRC_IMPL == SHT2x_CRC_TABLE
+  u8t crc = SHT2x_CalcCrcTable(data, nbrOfBytes);
+#elif SHT2x_CRC_IMPL == SHT2x_CRC_NIBBLE
+  u8t crc = SHT2x_CalcCrcNibble(data, nbrOfBytes);
+#else
+  u8t crc = SHT2x_CalcCrcBitwise(data, nbrOfBytes);
+#endif
   if (crc != checksum) return CHECKSUM_ERROR;
   else return 0;
 }
@@ -37,18 +131,14 @@ u8t SHT2x_CheckCrc(u8t data[], u8t nbrOfBytes, u8t checksum)
 u8t SHT2x_ReadUserRegister(u8t *pRegisterValue)
 //===========================================================================
 {
-  u8t checksum;   //variable for checksum byte
+  u8t command = USER_REG_R;
+  u8t data[2];    //register value and checksum
   u8t error=0;    //variable for error code
+  i2c_bus_xfer_t xfer = { SHT2x_I2C_ADDRESS, &command, 1, data, 2 };
 
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_W);
-  error |= I2c_WriteByte (USER_REG_R);
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_R);
-  *pRegisterValue = I2c_ReadByte(ACK);
-  checksum=I2c_ReadByte(NO_ACK);
-  error |= SHT2x_CheckCrc (pRegisterValue,1,checksum);
-  I2c_StopCondition();
+  error |= i2c_bus_xfer_sync(&xfer);
+  *pRegisterValue = data[0];
+  if (!error) error |= SHT2x_CheckCrc (data,1,data[1]);
   return error;
 }
 
@@ -56,52 +146,33 @@ u8t SHT2x_ReadUserRegister(u8t *pRegisterValue)
 u8t SHT2x_WriteUserRegister(u8t *pRegisterValue)
 //===========================================================================
 {
-  u8t error=0;   //variable for error code
+  u8t command[2] = { USER_REG_W, *pRegisterValue };
+  i2c_bus_xfer_t xfer = { SHT2x_I2C_ADDRESS, command, 2, NULL, 0 };
 
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_W);
-  error |= I2c_WriteByte (USER_REG_W);
-  error |= I2c_WriteByte (*pRegisterValue);
-  I2c_StopCondition();
-  return error;
+  return i2c_bus_xfer_sync(&xfer);
 }
 
 //===========================================================================
 u8t SHT2x_MeasureHM(etSHT2xMeasureType eSHT2xMeasureType, nt16 *pMeasurand)
 //===========================================================================
 {
-  u8t  checksum;   //checksum
-  u8t  data[2];    //data array for checksum verification
+  u8t  command;    //trigger command
+  u8t  data[3];    //two data bytes and checksum
   u8t  error=0;    //error variable
-  u16t i;          //counting variable
+  i2c_bus_xfer_t xfer = { SHT2x_I2C_ADDRESS, &command, 1, data, 3 };
 
-  //-- write I2C sensor address and command --
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_W); // I2C Adr
   switch(eSHT2xMeasureType)
-  { case HUMIDITY: error |= I2c_WriteByte (TRIG_RH_MEASUREMENT_HM); break;
-    case TEMP    : error |= I2c_WriteByte (TRIG_T_MEASUREMENT_HM);  break;
-    default: break;
-  }
-  //-- wait until hold master is released --
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_R);
-  nrf_gpio_cfg_input(SCL_Pin, NRF_GPIO_PIN_NOPULL);                     // set SCL I/O port as input
-  for(i=0; i<1000; i++)         // wait until master hold is released or
-  { DelayMicroSeconds(1000);    // a timeout (~1s) is reached
-    if (nrf_gpio_pin_read(SCL_Pin) == 1) break;
+  { case HUMIDITY: command = TRIG_RH_MEASUREMENT_HM; break;
+    case TEMP    : command = TRIG_T_MEASUREMENT_HM;  break;
+    default: return UNIT_ERROR;
   }
-  //-- check for timeout --
-  if(nrf_gpio_pin_read(SCL_Pin)==0) error |= TIME_OUT_ERROR;
-
-  //-- read two data bytes and one checksum byte --
-  pMeasurand->s16.u8H = data[0] = I2c_ReadByte(ACK);
-  pMeasurand->s16.u8L = data[1] = I2c_ReadByte(ACK);
-  checksum=I2c_ReadByte(NO_ACK);
+  //-- the sensor stretches the clock until the measurement is ready --
+  error |= i2c_bus_xfer_sync(&xfer);
+  pMeasurand->s16.u8H = data[0];
+  pMeasurand->s16.u8L = data[1];
 
   //-- verify checksum --
-  error |= SHT2x_CheckCrc (data,2,checksum);
-  I2c_StopCondition();
+  if (!error) error |= SHT2x_CheckCrc (data,2,data[2]);
   return error;
 }
 
@@ -109,36 +180,33 @@ u8t SHT2x_MeasureHM(etSHT2xMeasureType eSHT2xMeasureType, nt16 *pMeasurand)
 u8t SHT2x_MeasurePoll(etSHT2xMeasureType eSHT2xMeasureType, nt16 *pMeasurand)
 //===========================================================================
 {
-  u8t  checksum;   //checksum
-  u8t  data[2];    //data array for checksum verification
+  u8t  command;    //trigger command
+  u8t  data[3];    //two data bytes and checksum
   u8t  error=0;    //error variable
   u16t i=0;        //counting variable
+  i2c_bus_xfer_t trigger = { SHT2x_I2C_ADDRESS, &command, 1, NULL, 0 };
+  i2c_bus_xfer_t read    = { SHT2x_I2C_ADDRESS, NULL, 0, data, 3 };
 
-  //-- write I2C sensor address and command --
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_W); // I2C Adr
   switch(eSHT2xMeasureType)
-  { case HUMIDITY: error |= I2c_WriteByte (TRIG_RH_MEASUREMENT_POLL); break;
-    case TEMP    : error |= I2c_WriteByte (TRIG_T_MEASUREMENT_POLL);  break;
-    default: break;
+  { case HUMIDITY: command = TRIG_RH_MEASUREMENT_POLL; break;
+    case TEMP    : command = TRIG_T_MEASUREMENT_POLL;  break;
+    default: return UNIT_ERROR;
   }
+  error |= i2c_bus_xfer_sync(&trigger);
+  if (error) return error;
+
   //-- poll every 10ms for measurement ready. Timeout after 20 retries (200ms)--
   do
-  { I2c_StartCondition();
-    DelayMicroSeconds(10000);  //delay 10ms
+  { DelayMicroSeconds(10000);  //delay 10ms
     if(i++ >= 20) break;
-  } while(I2c_WriteByte (I2C_ADR_R) == ACK_ERROR);
-  if (i>=20) error |= TIME_OUT_ERROR;
+  } while((error = i2c_bus_xfer_sync(&read)) == ACK_ERROR);
+  if (i>=20) return TIME_OUT_ERROR;
 
-  //-- read two data bytes and one checksum byte --
-  pMeasurand->s16.u8H = data[0] = I2c_ReadByte(ACK);
-  pMeasurand->s16.u8L = data[1] = I2c_ReadByte(ACK);
-  checksum=I2c_ReadByte(NO_ACK);
+  pMeasurand->s16.u8H = data[0];
+  pMeasurand->s16.u8L = data[1];
 
   //-- verify checksum --
-  error |= SHT2x_CheckCrc (data,2,checksum);
-  I2c_StopCondition();
-
+  if (!error) error |= SHT2x_CheckCrc (data,2,data[2]);
   return error;
 }
 
@@ -146,12 +214,11 @@ u8t SHT2x_MeasurePoll(etSHT2xMeasureType eSHT2xMeasureType, nt16 *pMeasurand)
 u8t SHT2x_SoftReset(void)
 //===========================================================================
 {
+  u8t  command = SOFT_RESET;
   u8t  error=0;           //error variable
+  i2c_bus_xfer_t xfer = { SHT2x_I2C_ADDRESS, &command, 1, NULL, 0 };
 
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_W); // I2C Adr
-  error |= I2c_WriteByte (SOFT_RESET);                            // Command
-  I2c_StopCondition();
+  error |= i2c_bus_xfer_sync(&xfer);
 
   DelayMicroSeconds(15000); // wait till sensor has restarted
 
@@ -184,43 +251,69 @@ float SHT2x_CalcTemperatureC(u16t u16sT)
   return temperatureC;
 }
 
+//==============================================================================
+i16t SHT2x_CalcRHCenti(u16t u16sRH)
+//==============================================================================
+{
+  i32t scaled;                // RH * 100 * 2^16
+
+  u16sRH &= ~0x0003;          // clear bits [1..0] (status bits)
+
+  //-- RH*100 = -600 + 12500 * SRH/2^16, rounded half away from zero --
+  scaled = (i32t)12500 * u16sRH - (i32t)600 * 65536;
+  if (scaled >= 0) return (i16t)((scaled + 32768) >> 16);
+  else return (i16t)-((-scaled + 32768) >> 16);
+}
+
+//==============================================================================
+i16t SHT2x_CalcTemperatureCentiC(u16t u16sT)
+//==============================================================================
+{
+  i32t scaled;                // T * 100 * 2^16
+
+  u16sT &= ~0x0003;           // clear bits [1..0] (status bits)
+
+  //-- T*100 = -4685 + 17572 * ST/2^16, rounded half away from zero --
+  scaled = (i32t)17572 * u16sT - (i32t)4685 * 65536;
+  if (scaled >= 0) return (i16t)((scaled + 32768) >> 16);
+  else return (i16t)-((-scaled + 32768) >> 16);
+}
+
 //==============================================================================
 u8t SHT2x_GetSerialNumber(u8t u8SerialNumber[])
 //==============================================================================
 {
+  static const u8t location1[2] = { 0xFA, 0x0F }; //Command and address for readout on-chip memory
+  static const u8t location2[2] = { 0xFC, 0xC9 }; //Command and address for readout on-chip memory
+  u8t  data[8];                          //read buffer
   u8t  error=0;                          //error variable
+  i2c_bus_xfer_t xfer = { SHT2x_I2C_ADDRESS, location1, 2, data, 8 };
 
-  //Read from memory location 1
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_W);    //I2C address
-  error |= I2c_WriteByte (0xFA);         //Command for readout on-chip memory
-  error |= I2c_WriteByte (0x0F);         //on-chip memory address
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_R);    //I2C address
-  u8SerialNumber[5] = I2c_ReadByte(ACK); //Read SNB_3
-  I2c_ReadByte(ACK);                     //Read CRC SNB_3 (CRC is not analyzed)
-  u8SerialNumber[4] = I2c_ReadByte(ACK); //Read SNB_2
-  I2c_ReadByte(ACK);                     //Read CRC SNB_2 (CRC is not analyzed)
-  u8SerialNumber[3] = I2c_ReadByte(ACK); //Read SNB_1
-  I2c_ReadByte(ACK);                     //Read CRC SNB_1 (CRC is not analyzed)
-  u8SerialNumber[2] = I2c_ReadByte(ACK); //Read SNB_0
-  I2c_ReadByte(NO_ACK);                  //Read CRC SNB_0 (CRC is not analyzed)
-  I2c_StopCondition();
-
-  //Read from memory location 2
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_W);    //I2C address
-  error |= I2c_WriteByte (0xFC);         //Command for readout on-chip memory
-  error |= I2c_WriteByte (0xC9);         //on-chip memory address
-  I2c_StartCondition();
-  error |= I2c_WriteByte (I2C_ADR_R);    //I2C address
-  u8SerialNumber[1] = I2c_ReadByte(ACK); //Read SNC_1
-  u8SerialNumber[0] = I2c_ReadByte(ACK); //Read SNC_0
-  I2c_ReadByte(ACK);                     //Read CRC SNC0/1 (CRC is not analyzed)
-  u8SerialNumber[7] = I2c_ReadByte(ACK); //Read SNA_1
-  u8SerialNumber[6] = I2c_ReadByte(ACK); //Read SNA_0
-  I2c_ReadByte(NO_ACK);                  //Read CRC SNA0/1 (CRC is not analyzed)
-  I2c_StopCondition();
+  //Read from memory location 1: SNB_3, CRC, SNB_2, CRC, SNB_1, CRC, SNB_0, CRC
+  error |= i2c_bus_xfer_sync(&xfer);
+  if (!error)
+  { error |= SHT2x_CheckCrc (&data[0],1,data[1]); //each SNB byte has its own CRC
+    error |= SHT2x_CheckCrc (&data[2],1,data[3]);
+    error |= SHT2x_CheckCrc (&data[4],1,data[5]);
+    error |= SHT2x_CheckCrc (&data[6],1,data[7]);
+  }
+  u8SerialNumber[5] = data[0];           //SNB_3
+  u8SerialNumber[4] = data[2];           //SNB_2
+  u8SerialNumber[3] = data[4];           //SNB_1
+  u8SerialNumber[2] = data[6];           //SNB_0
+
+  //Read from memory location 2: SNC_1, SNC_0, CRC, SNA_1, SNA_0, CRC
+  xfer.p_tx      = location2;
+  xfer.rx_length = 6;
+  if (!error) error |= i2c_bus_xfer_sync(&xfer);
+  if (!error)
+  { error |= SHT2x_CheckCrc (&data[0],2,data[2]); //CRC over SNC_1 and SNC_0
+    error |= SHT2x_CheckCrc (&data[3],2,data[5]); //CRC over SNA_1 and SNA_0
+  }
+  u8SerialNumber[1] = data[0];           //SNC_1
+  u8SerialNumber[0] = data[1];           //SNC_0
+  u8SerialNumber[7] = data[3];           //SNA_1
+  u8SerialNumber[6] = data[4];           //SNA_0
 
   return error;
 }
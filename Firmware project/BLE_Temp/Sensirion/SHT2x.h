@@ -13,6 +13,7 @@
 //==============================================================================
 //---------- Includes ----------------------------------------------------------
 #include "I2C_HAL.h"
+#include "i2c_bus.h"
 //---------- Defines -----------------------------------------------------------
 
 
@@ -57,8 +58,32 @@ typedef enum{
   I2C_ADR_R                = 129    // sensor I2C address + read bit
 }etI2cHeader;
 
+#define SHT2x_I2C_ADDRESS (I2C_ADR_W >> 1) // 7 bit sensor address for i2c_bus
 
+// CRC implementations, selected with SHT2x_CRC_IMPL
+#define SHT2x_CRC_BITWISE 0 // bit by bit, no table
+#define SHT2x_CRC_TABLE   1 // one lookup per byte, 256 byte table
+#define SHT2x_CRC_NIBBLE  2 // two lookups per byte, 16 byte table
 
+#ifndef SHT2x_CRC_IMPL
+#define SHT2x_CRC_IMPL SHT2x_CRC_TABLE
+#endif
+// define SHT2x_CRC_ALL to build every implementation (for comparing them)
+
+
+
+
+//==============================================================================
+u8t SHT2x_CalcCrcBitwise(const u8t data[], u8t nbrOfBytes);
+u8t SHT2x_CalcCrcTable(const u8t data[], u8t nbrOfBytes);
+u8t SHT2x_CalcCrcNibble(const u8t data[], u8t nbrOfBytes);
+//==============================================================================
+// calculates the 8-Bit checksum (polynomial 0x131, initial value 0) of n bytes.
+// Only the implementation selected with SHT2x_CRC_IMPL is built, unless
+// SHT2x_CRC_ALL is defined. All three return the same value for any input.
+// input:  data[]       checksum is built based on this data
+//         nbrOfBytes   checksum is built for n bytes of data
+// return: checksum
 
 //==============================================================================
 u8t SHT2x_CheckCrc(u8t data[], u8t nbrOfBytes, u8t checksum);
@@ -129,12 +154,29 @@ float SHT2x_CalcTemperatureC(u16t u16sT);
 // input:  sT: temperature raw value (16bit scaled)
 // return: temperature [C]
 
+//==============================================================================
+i16t SHT2x_CalcRHCenti(u16t u16sRH);
+//==============================================================================
+// calculates the relative humidity with integer arithmetic only
+// input:  sRH: humidity raw value (16bit scaled)
+// return: relative humidity [0.01 %RH], SHT2x_CalcRH rounded to the nearest
+//         hundredth
+
+//==============================================================================
+i16t SHT2x_CalcTemperatureCentiC(u16t u16sT);
+//==============================================================================
+// calculates temperature with integer arithmetic only
+// input:  sT: temperature raw value (16bit scaled)
+// return: temperature [0.01 C], SHT2x_CalcTemperatureC rounded to the nearest
+//         hundredth
+
 //==============================================================================
 u8t SHT2x_GetSerialNumber(u8t u8SerialNumber[]);
 //==============================================================================
 // gets serial number of SHT2x according application note "How To
 // Read-Out the Serial Number"
-// note:   readout of this function is not CRC checked
+// note:   every CRC byte of the readout is checked, CHECKSUM_ERROR if one
+//         does not match
 //
 // input:  -
 // output: u8SerialNumber: Array of 8 bytes (64Bits)
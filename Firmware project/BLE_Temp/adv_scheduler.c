@@ -0,0 +1,148 @@
+#include <string.h>
+#include <stdlib.h>
+#include "adv_scheduler.h"
+#include "nrf_error.h"
+
+#define ADV_SCHEDULER_TIMEOUT_MAX     0x3FFF    /**< Longest advertising timeout the SoftDevice takes, in seconds. */
+
+static const ble_advdata_t *         mp_advdata;
+static const ble_advdata_t *         mp_srdata;
+static adv_scheduler_config_t        m_config;
+static ble_advertising_evt_handler_t m_evt_handler;
+static ble_adv_evt_t                 m_mode = BLE_ADV_EVT_IDLE;     /**< Advertising mode in progress, IDLE when not advertising. */
+static bool                          m_have_reading;
+static int16_t                       m_burst_temperature;           /**< Reading of the last burst. */
+static int16_t                       m_burst_humidity;
+
+bool adv_scheduler_config_valid(const adv_scheduler_config_t * p_config)
+{
+	return (p_config->fast_interval >= BLE_GAP_ADV_INTERVAL_MIN) && (p_config->fast_interval <= BLE_GAP_ADV_INTERVAL_MAX) &&
+	       (p_config->slow_interval >= BLE_GAP_ADV_INTERVAL_MIN) && (p_config->slow_interval <= BLE_GAP_ADV_INTERVAL_MAX) &&
+	       (p_config->fast_timeout <= ADV_SCHEDULER_TIMEOUT_MAX);
+}
+
+static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
+{
+	m_mode = ble_adv_evt;
+	if (m_evt_handler != NULL)
+	{
+		m_evt_handler(ble_adv_evt);
+	}
+}
+
+/**@brief Hands the configuration to ble_advertising. The slow mode never times out. */
+static uint32_t advertising_init(void)
+{
+	ble_adv_modes_config_t options;
+
+	memset(&options, 0, sizeof(options));
+	options.ble_adv_fast_enabled  = (m_config.fast_timeout > 0) ? BLE_ADV_FAST_ENABLED : BLE_ADV_FAST_DISABLED;
+	options.ble_adv_fast_interval = m_config.fast_interval;
+	options.ble_adv_fast_timeout  = m_config.fast_timeout;
+	options.ble_adv_slow_enabled  = BLE_ADV_SLOW_ENABLED;
+	options.ble_adv_slow_interval = m_config.slow_interval;
+	options.ble_adv_slow_timeout  = 0;
+
+	return ble_advertising_init(mp_advdata, mp_srdata, &options, on_adv_evt, NULL);
+}
+
+/**@brief Stops advertising and starts again in the fast mode. */
+static uint32_t advertising_restart(void)
+{
+	uint32_t err_code = sd_ble_gap_adv_stop();
+
+	if (err_code == NRF_ERROR_INVALID_STATE)
+	{
+		// A central connected and the event is on its way: nothing to restart.
+		return NRF_SUCCESS;
+	}
+	if (err_code != NRF_SUCCESS)
+	{
+		return err_code;
+	}
+	return ble_advertising_start(BLE_ADV_MODE_FAST);
+}
+
+void adv_scheduler_config_default(adv_scheduler_config_t * p_config)
+{
+	p_config->fast_interval         = ADV_SCHEDULER_FAST_INTERVAL;
+	p_config->fast_timeout          = ADV_SCHEDULER_FAST_TIMEOUT;
+	p_config->slow_interval         = ADV_SCHEDULER_SLOW_INTERVAL;
+	p_config->temperature_threshold = ADV_SCHEDULER_TEMPERATURE_THRESHOLD;
+	p_config->humidity_threshold    = ADV_SCHEDULER_HUMIDITY_THRESHOLD;
+}
+
+uint32_t adv_scheduler_init(const ble_advdata_t * p_advdata, const ble_advdata_t * p_srdata,
+                            const adv_scheduler_config_t * p_config, ble_advertising_evt_handler_t evt_handler)
+{
+	if (!adv_scheduler_config_valid(p_config))
+	{
+		return NRF_ERROR_INVALID_PARAM;
+	}
+	mp_advdata     = p_advdata;
+	mp_srdata      = p_srdata;
+	m_config       = *p_config;
+	m_evt_handler  = evt_handler;
+	m_mode         = BLE_ADV_EVT_IDLE;
+	m_have_reading = false;
+	return advertising_init();
+}
+
+uint32_t adv_scheduler_config_set(const adv_scheduler_config_t * p_config)
+{
+	uint32_t err_code;
+
+	if (!adv_scheduler_config_valid(p_config))
+	{
+		return NRF_ERROR_INVALID_PARAM;
+	}
+	m_config = *p_config;
+	err_code = advertising_init();
+	if ((err_code != NRF_SUCCESS) || (m_mode == BLE_ADV_EVT_IDLE))
+	{
+		return err_code;
+	}
+	return advertising_restart();
+}
+
+void adv_scheduler_config_get(adv_scheduler_config_t * p_config)
+{
+	*p_config = m_config;
+}
+
+uint32_t adv_scheduler_start(void)
+{
+	return ble_advertising_start(BLE_ADV_MODE_FAST);
+}
+
+uint32_t adv_scheduler_burst(void)
+{
+	if ((m_mode != BLE_ADV_EVT_SLOW) || (m_config.fast_timeout == 0))
+	{
+		return NRF_SUCCESS; // Already bursting, connected, or bursts are off
+	}
+	return advertising_restart();
+}
+
+uint32_t adv_scheduler_on_reading(int16_t temperature, int16_t humidity)
+{
+	if (m_have_reading &&
+	    (abs(temperature - m_burst_temperature) < m_config.temperature_threshold) &&
+	    (abs(humidity - m_burst_humidity) < m_config.humidity_threshold))
+	{
+		return NRF_SUCCESS;
+	}
+	m_have_reading      = true;
+	m_burst_temperature = temperature;
+	m_burst_humidity    = humidity;
+	return adv_scheduler_burst();
+}
+
+void adv_scheduler_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+	if (p_ble_evt->header.evt_id == BLE_GAP_EVT_CONNECTED)
+	{
+		// Advertising stopped. ble_advertising starts it again in the fast mode on disconnection.
+		m_mode = BLE_ADV_EVT_IDLE;
+	}
+}
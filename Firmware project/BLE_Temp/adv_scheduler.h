@@ -0,0 +1,83 @@
+#ifndef ADV_SCHEDULER_H__
+#define ADV_SCHEDULER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_advdata.h"
+#include "ble_advertising.h"
+
+/**@brief Advertising intervals that follow the data.
+ *
+ * @details Advertising runs in the ble_advertising fast mode for fast_timeout seconds after
+ *          something worth seeing quickly happened (start-up, a disconnection, a new log entry,
+ *          a reading that moved by more than the thresholds since the last burst) and in the slow
+ *          mode otherwise, without a timeout. Most of the time the device therefore advertises at
+ *          the slow interval, and a scanner or a phone that is waiting for news gets it within
+ *          one fast interval.
+ */
+#define ADV_SCHEDULER_FAST_INTERVAL           244     /**< 152.5 ms, one of the intervals Apple recommends for fast discovery. */
+#define ADV_SCHEDULER_FAST_TIMEOUT            5       /**< s */
+#define ADV_SCHEDULER_SLOW_INTERVAL           4800    /**< 3 s */
+#define ADV_SCHEDULER_TEMPERATURE_THRESHOLD   50      /**< 0.5 C */
+#define ADV_SCHEDULER_HUMIDITY_THRESHOLD      500     /**< 5 %RH */
+
+/**@brief Scheduler configuration. Intervals are in 0.625 ms units. */
+typedef struct
+{
+	uint16_t fast_interval;
+	uint16_t fast_timeout;                  /**< Length of a burst in seconds, 0 disables the bursts. */
+	uint16_t slow_interval;
+	uint16_t temperature_threshold;         /**< 0.01 C, 0 bursts on every reading. */
+	uint16_t humidity_threshold;            /**< 0.01 %RH, 0 bursts on every reading. */
+} adv_scheduler_config_t;
+
+/**@brief Function for getting the default configuration, from the ADV_SCHEDULER_ constants. */
+void adv_scheduler_config_default(adv_scheduler_config_t * p_config);
+
+/**@brief Function for checking a configuration. */
+bool adv_scheduler_config_valid(const adv_scheduler_config_t * p_config);
+
+/**@brief Function for initializing ble_advertising with the scheduler's modes.
+ *
+ * @param[in]   p_advdata    Advertising data. Kept by reference, as ble_advertising is initialized
+ *                           again when the configuration changes.
+ * @param[in]   p_srdata     Scan response data, kept by reference too.
+ * @param[in]   p_config     Configuration.
+ * @param[in]   evt_handler  Application handler for the ble_advertising events, or NULL.
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM for a bad configuration, or an error from
+ *              ble_advertising_init().
+ */
+uint32_t adv_scheduler_init(const ble_advdata_t * p_advdata, const ble_advdata_t * p_srdata,
+                            const adv_scheduler_config_t * p_config, ble_advertising_evt_handler_t evt_handler);
+
+/**@brief Function for changing the configuration at run time. Advertising in progress restarts
+ *        with a burst at the new fast interval.
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM for a bad configuration, or an error from the
+ *              SoftDevice.
+ */
+uint32_t adv_scheduler_config_set(const adv_scheduler_config_t * p_config);
+
+/**@brief Function for getting the configuration in use. */
+void adv_scheduler_config_get(adv_scheduler_config_t * p_config);
+
+/**@brief Function for starting advertising with a burst. */
+uint32_t adv_scheduler_start(void);
+
+/**@brief Function for starting a burst now, if advertising at the slow interval. */
+uint32_t adv_scheduler_burst(void);
+
+/**@brief Function for passing a new reading. Starts a burst if it moved by more than a threshold
+ *        since the last burst.
+ *
+ * @param[in]   temperature  0.01 C
+ * @param[in]   humidity     0.01 %RH
+ */
+uint32_t adv_scheduler_on_reading(int16_t temperature, int16_t humidity);
+
+/**@brief Function for handling the BLE events: advertising stops while connected. */
+void adv_scheduler_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif // ADV_SCHEDULER_H__
@@ -0,0 +1,284 @@
+#include <string.h>
+#include "battery.h"
+#include "nrf.h"
+#include "nrf_soc.h"
+#include "nrf_error.h"
+#include "nrf51_bitfields.h"
+#include "app_timer.h"
+#include "app_error.h"
+#include "power_profile.h"
+
+#define ADC_FULL_SCALE_MV       3600        /**< VDD/3 against the 1.2 V bandgap. */
+#define ADC_MAX                 1023        /**< 10 bit */
+#define ADC_CONVERSION_US       68
+#define HFCLK_STARTUP_US        800         /**< Typical crystal start-up, for the power profile. */
+#define FILTER_SHIFT            2           /**< The filtered voltage moves by a quarter of the difference. */
+#define SAMPLES_PER_DAY         (86400 / BATTERY_SAMPLE_INTERVAL)
+#define CAPACITY_FULL           10000       /**< Capacity unit: 0.01 % */
+
+typedef enum
+{
+	BATTERY_IDLE,                           /**< Waiting for the next measurement. */
+	BATTERY_RADIO,                          /**< Waiting for the end of a radio event. */
+	BATTERY_CONVERTING                      /**< Conversions running, or started by the crystal through PPI. */
+} battery_state_t;
+
+/**@brief Capacity left against the voltage under load, two alkaline cells at a few mA. */
+static const struct
+{
+	uint16_t voltage;                       /**< mV */
+	uint16_t capacity;                      /**< CAPACITY_FULL units */
+} m_discharge[] =
+{
+	{3200, 10000}, {3000, 9000}, {2800, 7000}, {2600, 4500}, {2400, 2000}, {2300, 1000}, {2200, 0}
+};
+
+static app_timer_id_t        m_timer;
+static uint32_t              m_prescaler;
+static battery_evt_handler_t m_evt_handler;
+static battery_state_t       m_state;
+static uint32_t              m_sum;
+static uint8_t               m_conversions;
+static bool                  m_clock_waited;            /**< The crystal was not running when requested. */
+static uint32_t              m_filtered;                /**< mV << FILTER_SHIFT */
+static uint32_t              m_samples;                 /**< Measurements since init. */
+static uint16_t              m_history[BATTERY_HISTORY_DAYS];   /**< Capacity once a day, oldest first from m_history_first. */
+static uint8_t               m_history_first;
+static uint8_t               m_history_count;
+static battery_status_t      m_status;
+
+static uint32_t timer_start_s(uint32_t s)
+{
+	return app_timer_start(m_timer, APP_TIMER_TICKS(s * 1000, m_prescaler), NULL);
+}
+
+static uint16_t capacity_get(uint16_t voltage)
+{
+	uint8_t i;
+
+	if (voltage >= m_discharge[0].voltage)
+	{
+		return m_discharge[0].capacity;
+	}
+	for (i = 1; i < sizeof(m_discharge) / sizeof(m_discharge[0]); i++)
+	{
+		if (voltage >= m_discharge[i].voltage)
+		{
+			return m_discharge[i].capacity + (uint32_t)(voltage - m_discharge[i].voltage) *
+			       (m_discharge[i - 1].capacity - m_discharge[i].capacity) / (m_discharge[i - 1].voltage - m_discharge[i].voltage);
+		}
+	}
+	return 0;
+}
+
+/**@brief Keeps the capacity of the first measurement of every day. */
+static void history_add(uint16_t capacity)
+{
+	if (((m_samples - 1) % SAMPLES_PER_DAY) != 0)
+	{
+		return;
+	}
+	if (m_history_count == BATTERY_HISTORY_DAYS)
+	{
+		m_history_first = (m_history_first + 1) % BATTERY_HISTORY_DAYS;
+		m_history_count--;
+	}
+	m_history[(m_history_first + m_history_count) % BATTERY_HISTORY_DAYS] = capacity;
+	m_history_count++;
+}
+
+/**@brief Days until the capacity runs out at the rate it went down since the oldest day kept. */
+static uint16_t days_left_get(uint16_t capacity)
+{
+	uint16_t oldest  = m_history[m_history_first];
+	uint32_t elapsed = (uint32_t)(m_history_count - 1) * SAMPLES_PER_DAY + (m_samples - 1) % SAMPLES_PER_DAY;
+	uint32_t days;
+
+	if ((elapsed >= SAMPLES_PER_DAY) && (oldest > capacity))
+	{
+		days = (uint32_t)capacity * elapsed / (oldest - capacity) / SAMPLES_PER_DAY;
+	}
+	else
+	{
+		// mAh * 1000 / uA is hours
+		days = (uint32_t)BATTERY_CAPACITY_MAH * capacity / (CAPACITY_FULL / 1000) / BATTERY_NOMINAL_UA / 24;
+	}
+	return (days < BATTERY_DAYS_UNKNOWN) ? (uint16_t)days : BATTERY_DAYS_UNKNOWN - 1;
+}
+
+static void measurement_done(uint32_t voltage)
+{
+	uint16_t capacity;
+
+	if (m_samples == 0)
+	{
+		m_filtered = voltage << FILTER_SHIFT;
+	}
+	else
+	{
+		m_filtered = m_filtered + voltage - (m_filtered >> FILTER_SHIFT);
+	}
+	m_samples++;
+
+	m_status.voltage   = (uint16_t)((m_filtered + (1 << (FILTER_SHIFT - 1))) >> FILTER_SHIFT);
+	capacity           = capacity_get(m_status.voltage);
+	m_status.level     = (uint8_t)((capacity + CAPACITY_FULL / 200) / (CAPACITY_FULL / 100));
+	history_add(capacity);
+	m_status.days_left = days_left_get(capacity);
+	m_evt_handler(&m_status);
+}
+
+/**@brief Requests the crystal with the PPI channel armed: its HFCLKSTARTED event starts the first
+ *        conversion, without the CPU.
+ */
+static void measurement_start(void)
+{
+	uint32_t running = 0;
+	uint32_t err_code;
+
+	err_code = sd_nvic_DisableIRQ(SWI1_IRQn);
+	APP_ERROR_CHECK(err_code);
+	m_state       = BATTERY_CONVERTING;
+	m_sum         = 0;
+	m_conversions = 0;
+	err_code = sd_ppi_channel_enable_set(1UL << BATTERY_PPI_CHANNEL);
+	APP_ERROR_CHECK(err_code);
+	err_code = sd_clock_hfclk_request();
+	APP_ERROR_CHECK(err_code);
+	err_code = sd_clock_hfclk_is_running(&running);
+	APP_ERROR_CHECK(err_code);
+	m_clock_waited = !running;
+	if (running)
+	{
+		// Running already, for the SoftDevice: no HFCLKSTARTED to come, unless it started just
+		// now and the conversion with it. The ADC interrupt cannot have run yet at this priority.
+		err_code = sd_ppi_channel_enable_clr(1UL << BATTERY_PPI_CHANNEL);
+		APP_ERROR_CHECK(err_code);
+		if (!NRF_ADC->BUSY && !NRF_ADC->EVENTS_END)
+		{
+			NRF_ADC->TASKS_START = 1;
+		}
+	}
+}
+
+/**@brief Waits for the end of the next radio event, or BATTERY_RADIO_WAIT if none comes. */
+static void radio_wait(void)
+{
+	uint32_t err_code;
+
+	m_state  = BATTERY_RADIO;
+	err_code = sd_nvic_ClearPendingIRQ(SWI1_IRQn); // Left pending by the radio events since the last measurement
+	APP_ERROR_CHECK(err_code);
+	err_code = sd_nvic_EnableIRQ(SWI1_IRQn);
+	APP_ERROR_CHECK(err_code);
+	err_code = timer_start_s(BATTERY_RADIO_WAIT);
+	APP_ERROR_CHECK(err_code);
+}
+
+static void timeout_handler(void * p_context)
+{
+	if (m_state == BATTERY_IDLE)
+	{
+		radio_wait();
+	}
+	else if (m_state == BATTERY_RADIO)
+	{
+		measurement_start(); // The radio is idle, its load does not matter now
+	}
+}
+
+/**@brief Radio notification: a radio event has just ended. */
+void SWI1_IRQHandler(void)
+{
+	uint32_t err_code;
+
+	if (m_state != BATTERY_RADIO)
+	{
+		return;
+	}
+	err_code = app_timer_stop(m_timer);
+	APP_ERROR_CHECK(err_code);
+	measurement_start();
+}
+
+void ADC_IRQHandler(void)
+{
+	uint32_t err_code;
+
+	NRF_ADC->EVENTS_END = 0;
+	if (m_conversions == 0)
+	{
+		// The crystal starts again for every radio event
+		err_code = sd_ppi_channel_enable_clr(1UL << BATTERY_PPI_CHANNEL);
+		APP_ERROR_CHECK(err_code);
+	}
+	m_sum += NRF_ADC->RESULT;
+	if (++m_conversions < BATTERY_OVERSAMPLING)
+	{
+		NRF_ADC->TASKS_START = 1;
+		return;
+	}
+
+	// Use the STOP task to save current. Workaround for PAN_028 rev1.5 anomaly 1.
+	NRF_ADC->TASKS_STOP = 1;
+	err_code = sd_clock_hfclk_release();
+	APP_ERROR_CHECK(err_code);
+	power_profile_hfclk_add((m_clock_waited ? HFCLK_STARTUP_US : 0) + BATTERY_OVERSAMPLING * ADC_CONVERSION_US);
+
+	m_state  = BATTERY_IDLE;
+	err_code = timer_start_s(BATTERY_SAMPLE_INTERVAL);
+	APP_ERROR_CHECK(err_code);
+	measurement_done((m_sum * ADC_FULL_SCALE_MV + (ADC_MAX * BATTERY_OVERSAMPLING) / 2) / (ADC_MAX * BATTERY_OVERSAMPLING));
+}
+
+const battery_status_t * battery_status_get(void)
+{
+	return &m_status;
+}
+
+uint32_t battery_init(uint32_t app_timer_prescaler, battery_evt_handler_t evt_handler)
+{
+	uint32_t err_code;
+
+	m_prescaler       = app_timer_prescaler;
+	m_evt_handler     = evt_handler;
+	m_samples         = 0;
+	m_history_first   = 0;
+	m_history_count   = 0;
+	memset(&m_status, 0, sizeof(m_status));
+	m_status.level     = 100;
+	m_status.days_left = BATTERY_DAYS_UNKNOWN;
+
+	NRF_ADC->CONFIG = (ADC_CONFIG_RES_10bit << ADC_CONFIG_RES_Pos) |
+	                  (ADC_CONFIG_INPSEL_SupplyOneThirdPrescaling << ADC_CONFIG_INPSEL_Pos) |
+	                  (ADC_CONFIG_REFSEL_VBG << ADC_CONFIG_REFSEL_Pos);
+	NRF_ADC->INTENSET = ADC_INTENSET_END_Msk;
+	NRF_ADC->ENABLE   = ADC_ENABLE_ENABLE_Enabled;
+	err_code = sd_nvic_SetPriority(ADC_IRQn, NRF_APP_PRIORITY_LOW);
+	if (err_code == NRF_SUCCESS)
+	{
+		err_code = sd_ppi_channel_assign(BATTERY_PPI_CHANNEL, &NRF_CLOCK->EVENTS_HFCLKSTARTED, &NRF_ADC->TASKS_START);
+	}
+	if (err_code == NRF_SUCCESS)
+	{
+		err_code = sd_nvic_EnableIRQ(ADC_IRQn);
+	}
+	if (err_code == NRF_SUCCESS)
+	{
+		err_code = sd_radio_notification_cfg_set(NRF_RADIO_NOTIFICATION_TYPE_INT_ON_INACTIVE, NRF_RADIO_NOTIFICATION_DISTANCE_NONE);
+	}
+	if (err_code == NRF_SUCCESS)
+	{
+		err_code = sd_nvic_SetPriority(SWI1_IRQn, NRF_APP_PRIORITY_LOW);
+	}
+	if (err_code == NRF_SUCCESS)
+	{
+		err_code = app_timer_create(&m_timer, APP_TIMER_MODE_SINGLE_SHOT, timeout_handler);
+	}
+	if (err_code != NRF_SUCCESS)
+	{
+		return err_code;
+	}
+	radio_wait();
+	return NRF_SUCCESS;
+}
@@ -0,0 +1,63 @@
+#ifndef BATTERY_H__
+#define BATTERY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief Battery measurement and discharge estimate, for two AAA alkaline cells in series.
+ *
+ * @details The supply is measured every BATTERY_SAMPLE_INTERVAL seconds, as the mean of
+ *          BATTERY_OVERSAMPLING 10 bit conversions of VDD/3 against the 1.2 V bandgap. A
+ *          measurement waits for the end of the next radio event (radio notification): the cells
+ *          are still recovering from the heaviest load the device puts on them, which is what
+ *          decides when the supply gets too low. With no radio event for BATTERY_RADIO_WAIT
+ *          seconds it measures anyway. The 16 MHz crystal the ADC needs is requested without
+ *          waiting for it: a PPI channel from its HFCLKSTARTED event to the ADC START task starts
+ *          the first conversion as soon as it runs, and the ADC interrupt does the rest, down to
+ *          the measurement handler. The channel is armed only from the request to that first
+ *          conversion, as the crystal also starts for every radio event.
+ *
+ *          The measurements are filtered, and a discharge table of alkaline cells at a few mA
+ *          turns the voltage into the capacity left. The days left follow from how fast that
+ *          capacity went down over the last BATTERY_HISTORY_DAYS days, so they reflect the duty
+ *          cycle the device actually ran; until a day has passed, or while the capacity did not
+ *          go down, they assume BATTERY_NOMINAL_UA.
+ *
+ *          Radio notifications can only be configured while the radio is unused: battery_init()
+ *          must run before advertising starts. The notification interrupt (SWI1) is enabled only
+ *          while a measurement waits for the radio.
+ */
+#define BATTERY_SAMPLE_INTERVAL     3600    /**< s */
+#define BATTERY_OVERSAMPLING        4       /**< Conversions per measurement. */
+#define BATTERY_RADIO_WAIT          10      /**< s */
+#define BATTERY_CAPACITY_MAH        1000    /**< Of one cell, the two are in series. */
+#define BATTERY_NOMINAL_UA          10      /**< Average current assumed until the discharge has been measured. */
+#define BATTERY_HISTORY_DAYS        8
+#define BATTERY_PPI_CHANNEL         0       /**< Of those the SoftDevice leaves to the application. */
+#define BATTERY_DAYS_UNKNOWN        0xFFFF
+
+/**@brief Battery status. */
+typedef struct
+{
+	uint16_t voltage;                       /**< mV, filtered. */
+	uint8_t  level;                         /**< % of the capacity left. */
+	uint16_t days_left;                     /**< Days until empty, BATTERY_DAYS_UNKNOWN before the first measurement. */
+} battery_status_t;
+
+/**@brief Called after every measurement, in the ADC interrupt context. */
+typedef void (*battery_evt_handler_t)(const battery_status_t * p_status);
+
+/**@brief Function for initializing the ADC, its PPI channel and the radio notification, and
+ *        measuring for the first time on the next radio event.
+ *
+ * @param[in]   app_timer_prescaler  Value the app_timer module was initialized with.
+ * @param[in]   evt_handler          Measurement handler.
+ *
+ * @return      NRF_SUCCESS, or an error from app_timer or the SoftDevice.
+ */
+uint32_t battery_init(uint32_t app_timer_prescaler, battery_evt_handler_t evt_handler);
+
+/**@brief Function for getting the last status. */
+const battery_status_t * battery_status_get(void);
+
+#endif // BATTERY_H__
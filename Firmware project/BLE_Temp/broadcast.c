@@ -0,0 +1,37 @@
+#include <string.h>
+#include "broadcast.h"
+#include "app_util.h"
+
+static ble_advdata_t *          mp_advdata;
+static ble_advdata_manuf_data_t m_manuf_data;
+static uint8_t                  m_data[BROADCAST_DATA_LEN];
+static uint8_t                  m_counter;
+
+void broadcast_encode(const broadcast_reading_t * p_reading, uint8_t counter, uint8_t * p_data)
+{
+	p_data[0] = BROADCAST_FORMAT;
+	(void)uint16_encode((uint16_t)p_reading->temperature, &p_data[1]);
+	(void)uint16_encode(p_reading->humidity, &p_data[3]);
+	p_data[5] = p_reading->battery_level;
+	p_data[6] = counter;
+}
+
+void broadcast_init(ble_advdata_t * p_advdata)
+{
+	mp_advdata = p_advdata;
+	m_counter  = 0;
+
+	m_manuf_data.company_identifier = BROADCAST_COMPANY_ID;
+	m_manuf_data.data.p_data        = m_data;
+	m_manuf_data.data.size          = sizeof(m_data);
+
+	mp_advdata->p_manuf_specific_data = &m_manuf_data;
+}
+
+uint32_t broadcast_update(const broadcast_reading_t * p_reading)
+{
+	broadcast_encode(p_reading, m_counter++, m_data);
+
+	// The scan response does not change, NULL leaves it alone.
+	return ble_advdata_set(mp_advdata, NULL);
+}
@@ -0,0 +1,58 @@
+#ifndef BROADCAST_H__
+#define BROADCAST_H__
+
+#include <stdint.h>
+#include "ble_advdata.h"
+
+/**@brief Set to 0 to advertise without the readings. */
+#ifndef BROADCAST_ENABLED
+#define BROADCAST_ENABLED 1
+#endif
+
+/**@brief Live readings in the advertising data, so a scanner collects them without connecting.
+ *
+ * @details Manufacturer specific data with company identifier BROADCAST_COMPANY_ID, followed by
+ *          (little endian):
+ *
+ *          byte 0      BROADCAST_FORMAT
+ *          bytes 1-2   temperature in 0.01 C (int16)
+ *          bytes 3-4   humidity in 0.01 %RH (uint16)
+ *          byte 5      battery level in %
+ *          byte 6      measurement counter, wraps at 256
+ *
+ *          The counter goes up with every measurement, so a scanner can tell a new reading from the
+ *          same one advertised again and count the ones it missed. Nothing is advertised before
+ *          the first measurement.
+ */
+#define BROADCAST_COMPANY_ID          0xFFFF    /**< Reserved by the Bluetooth SIG for testing, a product needs an assigned one. */
+#define BROADCAST_FORMAT              0x01
+#define BROADCAST_DATA_LEN            7
+
+/**@brief One reading. */
+typedef struct
+{
+	int16_t  temperature;                   /**< 0.01 C */
+	uint16_t humidity;                      /**< 0.01 %RH */
+	uint8_t  battery_level;                 /**< % */
+} broadcast_reading_t;
+
+/**@brief Function for adding the readings to the advertising data.
+ *
+ * @details The advertising data is only set again by broadcast_update(), so the readings go on
+ *          the air with the first one.
+ *
+ * @param[in]   p_advdata  Advertising data as given to ble_advertising_init(). Kept by reference,
+ *                         it must stay valid.
+ */
+void broadcast_init(ble_advdata_t * p_advdata);
+
+/**@brief Function for advertising a new reading.
+ *
+ * @return      NRF_SUCCESS, or an error from ble_advdata_set().
+ */
+uint32_t broadcast_update(const broadcast_reading_t * p_reading);
+
+/**@brief Function for encoding a reading into BROADCAST_DATA_LEN bytes of manufacturer data. */
+void broadcast_encode(const broadcast_reading_t * p_reading, uint8_t counter, uint8_t * p_data);
+
+#endif // BROADCAST_H__
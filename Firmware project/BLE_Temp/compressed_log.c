@@ -0,0 +1,426 @@
+#include <string.h>
+#include "compressed_log.h"
+
+#define COMPRESSED_LOG_DATA_BITS      (COMPRESSED_LOG_DATA_SIZE * 8)
+#define COMPRESSED_LOG_T_ESCAPE_BITS  11
+#define COMPRESSED_LOG_H_ESCAPE_BITS  9
+#define COMPRESSED_LOG_T_RANGE_BITS   11
+#define COMPRESSED_LOG_H_RANGE_BITS   7
+#define COMPRESSED_LOG_RANGE_CODES    4
+
+static compressed_log_block_t m_blocks[COMPRESSED_LOG_BLOCKS];
+static uint16_t               m_first;                  /**< Index of the oldest block in m_blocks. */
+static uint16_t               m_count;                  /**< Blocks in use. */
+static uint16_t               m_next_seq;
+static uint16_t               m_bits;                   /**< Bits used in the newest block. */
+static int16_t                m_last_temperature;
+static uint8_t                m_last_humidity;
+static bool                   m_ranges;                 /**< The newest block carries ranges. */
+
+static uint32_t zigzag(int32_t value)
+{
+	return (value >= 0) ? ((uint32_t)value << 1) : (((uint32_t)-value << 1) - 1);
+}
+
+static int32_t unzigzag(uint16_t value)
+{
+	return (value & 1) ? -(int32_t)((value + 1) >> 1) : (int32_t)(value >> 1);
+}
+
+static void put_bits(uint8_t * p_data, uint16_t * p_bit, uint16_t value, uint8_t bits)
+{
+	while (bits-- > 0)
+	{
+		if (value & 1)
+		{
+			p_data[*p_bit >> 3] |= (uint8_t)(1 << (*p_bit & 7));
+		}
+		value >>= 1;
+		(*p_bit)++;
+	}
+}
+
+/**@brief Prefix code of a temperature delta, as value and length in bits (prefix bits first).
+ *
+ * @return      false if the delta is out of range for a code.
+ */
+static bool temperature_code(int32_t delta, uint16_t * p_value, uint8_t * p_bits)
+{
+	uint32_t z = zigzag(delta);
+
+	if (z == 0)
+	{
+		*p_value = 0;                                   // 0, 0
+		*p_bits  = 2;
+	}
+	else if (z <= 2)
+	{
+		*p_value = (uint16_t)(0x2 | ((z - 1) << 2));    // 0, 1, 1 bit
+		*p_bits  = 3;
+	}
+	else if (z <= 6)
+	{
+		*p_value = (uint16_t)(0x1 | ((z - 3) << 2));    // 1, 0, 2 bits
+		*p_bits  = 4;
+	}
+	else if (z <= 38)
+	{
+		*p_value = (uint16_t)(0x3 | ((z - 7) << 3));    // 1, 1, 0, 5 bits
+		*p_bits  = 8;
+	}
+	else if (z < (1 << COMPRESSED_LOG_T_ESCAPE_BITS))
+	{
+		*p_value = (uint16_t)(0x7 | (z << 3));          // 1, 1, 1, 11 bits
+		*p_bits  = 3 + COMPRESSED_LOG_T_ESCAPE_BITS;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+static void humidity_code(int32_t delta, uint16_t * p_value, uint8_t * p_bits)
+{
+	uint32_t z = zigzag(delta);
+
+	if (z == 0)
+	{
+		*p_value = 0;                                   // 0
+		*p_bits  = 1;
+	}
+	else if (z <= 2)
+	{
+		*p_value = (uint16_t)(0x1 | ((z - 1) << 2));    // 1, 0, 1 bit
+		*p_bits  = 3;
+	}
+	else
+	{
+		*p_value = (uint16_t)(0x3 | (z << 2));          // 1, 1, 9 bits
+		*p_bits  = 2 + COMPRESSED_LOG_H_ESCAPE_BITS;
+	}
+}
+
+/**@brief Prefix code of a distance from the mean, temperature (0.1 C) or humidity (%RH). */
+static void range_code(int32_t distance, bool is_temperature, uint16_t * p_value, uint8_t * p_bits)
+{
+	uint32_t d   = (distance > 0) ? (uint32_t)distance : 0;
+	uint32_t max = (1u << (is_temperature ? COMPRESSED_LOG_T_RANGE_BITS : COMPRESSED_LOG_H_RANGE_BITS)) - 1;
+
+	if (d > max)
+	{
+		d = max;
+	}
+	if (d == 0)
+	{
+		*p_value = 0;                                   // 0
+		*p_bits  = 1;
+	}
+	else if (d <= 2)
+	{
+		*p_value = (uint16_t)(0x1 | ((d - 1) << 2));    // 1, 0, 1 bit
+		*p_bits  = 3;
+	}
+	else if (!is_temperature)
+	{
+		*p_value = (uint16_t)(0x3 | (d << 2));          // 1, 1, 7 bits
+		*p_bits  = 2 + COMPRESSED_LOG_H_RANGE_BITS;
+	}
+	else if (d <= 10)
+	{
+		*p_value = (uint16_t)(0x3 | ((d - 3) << 3));    // 1, 1, 0, 3 bits
+		*p_bits  = 6;
+	}
+	else
+	{
+		*p_value = (uint16_t)(0x7 | (d << 3));          // 1, 1, 1, 11 bits
+		*p_bits  = 3 + COMPRESSED_LOG_T_RANGE_BITS;
+	}
+}
+
+/**@brief Codes of the range of a sample, in the order they are written.
+ *
+ * @return      Bits they take.
+ */
+static uint8_t range_codes(const compressed_log_sample_t * p_sample, uint16_t * p_values, uint8_t * p_bits)
+{
+	range_code((int32_t)p_sample->temperature - p_sample->temperature_min, true, &p_values[0], &p_bits[0]);
+	range_code((int32_t)p_sample->temperature_max - p_sample->temperature, true, &p_values[1], &p_bits[1]);
+	range_code((int32_t)p_sample->humidity - p_sample->humidity_min, false, &p_values[2], &p_bits[2]);
+	range_code((int32_t)p_sample->humidity_max - p_sample->humidity, false, &p_values[3], &p_bits[3]);
+	return p_bits[0] + p_bits[1] + p_bits[2] + p_bits[3];
+}
+
+static bool has_range(const compressed_log_sample_t * p_sample)
+{
+	return (p_sample->temperature_min < p_sample->temperature) || (p_sample->temperature_max > p_sample->temperature) ||
+	       (p_sample->humidity_min < p_sample->humidity) || (p_sample->humidity_max > p_sample->humidity);
+}
+
+static void put_range(uint8_t * p_data, const compressed_log_sample_t * p_sample)
+{
+	uint16_t values[COMPRESSED_LOG_RANGE_CODES];
+	uint8_t  bits[COMPRESSED_LOG_RANGE_CODES];
+	uint8_t  i;
+
+	(void)range_codes(p_sample, values, bits);
+	for (i = 0; i < COMPRESSED_LOG_RANGE_CODES; i++)
+	{
+		put_bits(p_data, &m_bits, values[i], bits[i]);
+	}
+}
+
+/**@brief Starts a new block with the sample as its keyframe, dropping the oldest block if needed. */
+static void block_start(uint32_t time, uint16_t interval, const compressed_log_sample_t * p_sample, bool ranges)
+{
+	compressed_log_block_t * p_block;
+
+	if (m_count == COMPRESSED_LOG_BLOCKS)
+	{
+		m_first = (m_first + 1) % COMPRESSED_LOG_BLOCKS;
+		m_count--;
+	}
+	p_block = &m_blocks[(m_first + m_count) % COMPRESSED_LOG_BLOCKS];
+	m_count++;
+
+	memset(p_block, 0, sizeof(*p_block));
+	p_block->seq         = m_next_seq++;
+	p_block->interval    = interval;
+	p_block->time        = time;
+	p_block->temperature = p_sample->temperature;
+	p_block->humidity    = p_sample->humidity;
+	p_block->count       = 1;
+	m_bits               = 0;
+	m_ranges             = ranges;
+	put_bits(p_block->data, &m_bits, ranges ? 1 : 0, 1);
+	if (ranges)
+	{
+		put_range(p_block->data, p_sample);
+	}
+}
+
+void compressed_log_init(void)
+{
+	m_first    = 0;
+	m_count    = 0;
+	m_next_seq = 0;
+	m_bits     = 0;
+}
+
+/**@brief Checks that a sample lands where the newest block expects the next one. */
+static bool block_time_matches(const compressed_log_block_t * p_block, uint32_t time, uint16_t interval)
+{
+	int32_t error = (int32_t)(time - (p_block->time + (uint32_t)p_block->count * p_block->interval));
+
+	return (interval == p_block->interval) && (error <= COMPRESSED_LOG_TIME_TOLERANCE) && (error >= -COMPRESSED_LOG_TIME_TOLERANCE);
+}
+
+void compressed_log_append(uint32_t time, uint16_t interval, const compressed_log_sample_t * p_sample)
+{
+	compressed_log_block_t * p_block = &m_blocks[(m_first + m_count + COMPRESSED_LOG_BLOCKS - 1) % COMPRESSED_LOG_BLOCKS];
+	bool                     ranges  = has_range(p_sample);
+	uint16_t                 t_value;
+	uint16_t                 h_value;
+	uint8_t                  t_bits;
+	uint8_t                  h_bits;
+	uint16_t                 r_values[COMPRESSED_LOG_RANGE_CODES];
+	uint8_t                  r_bits[COMPRESSED_LOG_RANGE_CODES];
+	uint16_t                 bits;
+
+	if ((m_count == 0) || (ranges && !m_ranges) || !block_time_matches(p_block, time, interval) ||
+	    !temperature_code((int32_t)p_sample->temperature - m_last_temperature, &t_value, &t_bits))
+	{
+		block_start(time, interval, p_sample, ranges);
+	}
+	else
+	{
+		humidity_code((int32_t)p_sample->humidity - m_last_humidity, &h_value, &h_bits);
+		bits = t_bits + h_bits + (m_ranges ? range_codes(p_sample, r_values, r_bits) : 0);
+		if (m_bits + bits > COMPRESSED_LOG_DATA_BITS)
+		{
+			block_start(time, interval, p_sample, ranges);
+		}
+		else
+		{
+			put_bits(p_block->data, &m_bits, t_value, t_bits);
+			put_bits(p_block->data, &m_bits, h_value, h_bits);
+			if (m_ranges)
+			{
+				put_range(p_block->data, p_sample);
+			}
+			p_block->count++;
+		}
+	}
+	m_last_temperature = p_sample->temperature;
+	m_last_humidity    = p_sample->humidity;
+}
+
+void compressed_log_time_shift(int32_t step)
+{
+	uint16_t i;
+
+	for (i = 0; i < m_count; i++)
+	{
+		m_blocks[(m_first + i) % COMPRESSED_LOG_BLOCKS].time += (uint32_t)step;
+	}
+}
+
+uint16_t compressed_log_block_count(void)
+{
+	return m_count;
+}
+
+const compressed_log_block_t * compressed_log_block_get(uint16_t index)
+{
+	return (index < m_count) ? &m_blocks[(m_first + index) % COMPRESSED_LOG_BLOCKS] : NULL;
+}
+
+uint32_t compressed_log_sample_count(void)
+{
+	uint32_t count = 0;
+	uint16_t i;
+
+	for (i = 0; i < m_count; i++)
+	{
+		count += m_blocks[(m_first + i) % COMPRESSED_LOG_BLOCKS].count;
+	}
+	return count;
+}
+
+/**@brief Bit reader for the decoder. Reading past the end of the data fails the whole block. */
+typedef struct
+{
+	const uint8_t * p_data;
+	uint16_t        bit;
+	bool            overrun;
+} bit_reader_t;
+
+static uint16_t get_bits(bit_reader_t * p_reader, uint8_t bits)
+{
+	uint16_t value = 0;
+	uint8_t  i;
+
+	for (i = 0; i < bits; i++)
+	{
+		if (p_reader->bit >= COMPRESSED_LOG_DATA_BITS)
+		{
+			p_reader->overrun = true;
+			return 0;
+		}
+		value |= (uint16_t)((p_reader->p_data[p_reader->bit >> 3] >> (p_reader->bit & 7)) & 1) << i;
+		p_reader->bit++;
+	}
+	return value;
+}
+
+/**@brief Reads a distance from the mean, temperature (0.1 C) or humidity (%RH). */
+static uint16_t get_range(bit_reader_t * p_reader, bool is_temperature)
+{
+	if (!get_bits(p_reader, 1))
+	{
+		return 0;
+	}
+	if (!get_bits(p_reader, 1))
+	{
+		return 1 + get_bits(p_reader, 1);
+	}
+	if (!is_temperature)
+	{
+		return get_bits(p_reader, COMPRESSED_LOG_H_RANGE_BITS);
+	}
+	if (!get_bits(p_reader, 1))
+	{
+		return 3 + get_bits(p_reader, 3);
+	}
+	return get_bits(p_reader, COMPRESSED_LOG_T_RANGE_BITS);
+}
+
+/**@brief Reads the range of a sample, or gives it none. */
+static void get_sample_range(bit_reader_t * p_reader, bool ranges, compressed_log_sample_t * p_sample)
+{
+	int32_t temperature_min = p_sample->temperature;
+	int32_t temperature_max = p_sample->temperature;
+	int32_t humidity_min    = p_sample->humidity;
+	int32_t humidity_max    = p_sample->humidity;
+
+	if (ranges)
+	{
+		temperature_min -= get_range(p_reader, true);
+		temperature_max += get_range(p_reader, true);
+		humidity_min    -= get_range(p_reader, false);
+		humidity_max    += get_range(p_reader, false);
+	}
+	// Out of range only in a malformed block: keep the values representable
+	p_sample->temperature_min = (int16_t)((temperature_min < INT16_MIN) ? INT16_MIN : temperature_min);
+	p_sample->temperature_max = (int16_t)((temperature_max > INT16_MAX) ? INT16_MAX : temperature_max);
+	p_sample->humidity_min    = (uint8_t)((humidity_min < 0) ? 0 : humidity_min);
+	p_sample->humidity_max    = (uint8_t)((humidity_max > UINT8_MAX) ? UINT8_MAX : humidity_max);
+}
+
+uint8_t compressed_log_decode(const compressed_log_block_t * p_block, compressed_log_sample_t * p_samples)
+{
+	bit_reader_t reader = { p_block->data, 0, false };
+	int32_t      temperature = p_block->temperature;
+	int32_t      humidity    = p_block->humidity;
+	bool         ranges;
+	uint8_t      n;
+
+	if (p_block->count == 0)
+	{
+		return 0;
+	}
+	ranges                   = get_bits(&reader, 1);
+	p_samples[0].temperature = p_block->temperature;
+	p_samples[0].humidity    = p_block->humidity;
+	get_sample_range(&reader, ranges, &p_samples[0]);
+	for (n = 1; n < p_block->count; n++)
+	{
+		uint16_t z;
+
+		if (!get_bits(&reader, 1))
+		{
+			z = get_bits(&reader, 1) ? 1 + get_bits(&reader, 1) : 0;
+		}
+		else if (!get_bits(&reader, 1))
+		{
+			z = 3 + get_bits(&reader, 2);
+		}
+		else if (!get_bits(&reader, 1))
+		{
+			z = 7 + get_bits(&reader, 5);
+		}
+		else
+		{
+			z = get_bits(&reader, COMPRESSED_LOG_T_ESCAPE_BITS);
+		}
+		temperature += unzigzag(z);
+
+		if (!get_bits(&reader, 1))
+		{
+			z = 0;
+		}
+		else if (!get_bits(&reader, 1))
+		{
+			z = 1 + get_bits(&reader, 1);
+		}
+		else
+		{
+			z = get_bits(&reader, COMPRESSED_LOG_H_ESCAPE_BITS);
+		}
+		humidity += unzigzag(z);
+
+		if (reader.overrun || (temperature < INT16_MIN) || (temperature > INT16_MAX) ||
+		    (humidity < 0) || (humidity > UINT8_MAX))
+		{
+			break;
+		}
+		p_samples[n].temperature = (int16_t)temperature;
+		p_samples[n].humidity    = (uint8_t)humidity;
+		get_sample_range(&reader, ranges, &p_samples[n]);
+		if (reader.overrun)
+		{
+			break;
+		}
+	}
+	return n;
+}
@@ -0,0 +1,119 @@
+#ifndef COMPRESSED_LOG_H__
+#define COMPRESSED_LOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief Log blocks. Each block starts with a keyframe (the first sample in full) followed by the
+ *        deltas of the next samples, zigzag encoded and bit packed with a short prefix code:
+ *
+ *        temperature delta (0.1 C)  0           -> 00
+ *                                   +-1         -> 01 + 1 bit (sensor noise)
+ *                                   +-2, +-3    -> 10 + 2 bits
+ *                                   up to +-19  -> 110 + 5 bits
+ *                                   up to +-1023 -> 111 + 11 bits
+ *        humidity delta (1 %RH)     0           -> 0
+ *                                   +-1         -> 10 + 1 bit
+ *                                   other       -> 11 + 9 bits
+ *
+ *        A sample is the mean of the readings of a log slot. When the lowest and highest readings
+ *        of the slot differ from it, the sample carries them too, as two distances from the mean
+ *        (the mean minus the lowest, the highest minus the mean) for each of temperature then
+ *        humidity:
+ *
+ *        temperature (0.1 C)        0           -> 0
+ *                                   1, 2        -> 10 + 1 bit
+ *                                   3 to 10     -> 110 + 3 bits
+ *                                   up to 2047  -> 111 + 11 bits
+ *        humidity (1 %RH)           0           -> 0
+ *                                   1, 2        -> 10 + 1 bit
+ *                                   up to 127   -> 11 + 7 bits
+ *
+ *        The data starts with one bit, set when the block carries ranges: then the keyframe's
+ *        range follows it and every other sample's range follows its deltas. Blocks without
+ *        ranges cost that one bit only; a sample with a range starts a new block unless the
+ *        newest one carries ranges already. Longer distances are cut to the longest code.
+ *
+ *        Bits are packed from bit 0 of data[0] upwards. A sample that does not fit, or a
+ *        temperature step larger than the longest code, starts a new block. Blocks can be decoded
+ *        on their own, so dropping the oldest one never corrupts the rest.
+ *
+ *        The header carries the time of the keyframe and the interval between the samples, so
+ *        sample n of a block was taken at time + n * interval. A sample at another interval, or
+ *        more than COMPRESSED_LOG_TIME_TOLERANCE from where the block puts it (the clock was set),
+ *        starts a new block too.
+ */
+#define COMPRESSED_LOG_BLOCK_SIZE     96
+#define COMPRESSED_LOG_HEADER_SIZE    12
+#define COMPRESSED_LOG_DATA_SIZE      (COMPRESSED_LOG_BLOCK_SIZE - COMPRESSED_LOG_HEADER_SIZE)
+#define COMPRESSED_LOG_MAX_SAMPLES    (1 + (COMPRESSED_LOG_DATA_SIZE * 8 - 1) / 3)  /**< Keyframe plus the shortest (3 bit) deltas, after the range bit. */
+#define COMPRESSED_LOG_BLOCKS         5                                        /**< 480 bytes, less RAM than the two legacy logs (2 * LOG_SIZE). */
+#define COMPRESSED_LOG_TIME_TOLERANCE 2                                         /**< s */
+
+/**@brief One block, also its byte layout (little endian) on the air. */
+typedef struct
+{
+	uint16_t seq;                           /**< Block sequence number, counts up from 0 at reset. */
+	uint16_t interval;                      /**< Seconds between two samples. */
+	uint32_t time;                          /**< Keyframe time, see device_time.h: seconds since 1970-01-01 UTC, or since reset. */
+	int16_t  temperature;                   /**< Keyframe temperature in 0.1 C. */
+	uint8_t  humidity;                      /**< Keyframe humidity in %RH. */
+	uint8_t  count;                         /**< Samples in the block, keyframe included. */
+	uint8_t  data[COMPRESSED_LOG_DATA_SIZE];
+} compressed_log_block_t;
+
+/**@brief One sample: the mean of a log slot, and its lowest and highest readings. */
+typedef struct
+{
+	int16_t  temperature;                   /**< 0.1 C */
+	uint8_t  humidity;                      /**< %RH */
+	int16_t  temperature_min;
+	int16_t  temperature_max;
+	uint8_t  humidity_min;
+	uint8_t  humidity_max;
+} compressed_log_sample_t;
+
+/**@brief Function for emptying the log. */
+void compressed_log_init(void);
+
+/**@brief Function for appending a sample. When all blocks are in use the oldest one is dropped.
+ *
+ * @param[in]   time         Time of the sample, in seconds.
+ * @param[in]   interval     Seconds since the previous sample (or that there would have been).
+ * @param[in]   p_sample     Sample. Lowest and highest readings equal to the mean (a slot of one
+ *                           reading) keep the sample without a range.
+ */
+void compressed_log_append(uint32_t time, uint16_t interval, const compressed_log_sample_t * p_sample);
+
+/**@brief Function for moving the time of every block, when the clock is set for the first time and
+ *        the times taken until then turn out to be since reset.
+ *
+ * @param[in]   step       Seconds to add.
+ */
+void compressed_log_time_shift(int32_t step);
+
+/**@brief Function for getting the number of blocks in the log, the newest one included while it fills. */
+uint16_t compressed_log_block_count(void);
+
+/**@brief Function for getting a block.
+ *
+ * @param[in]   index      0 is the oldest block.
+ *
+ * @return      The block, or NULL if index is not below compressed_log_block_count().
+ */
+const compressed_log_block_t * compressed_log_block_get(uint16_t index);
+
+/**@brief Function for getting the number of samples held by all blocks. */
+uint32_t compressed_log_sample_count(void);
+
+/**@brief Reference decoder.
+ *
+ * @param[in]   p_block    Block to decode.
+ * @param[out]  p_samples  Room for COMPRESSED_LOG_MAX_SAMPLES samples. Samples without a range
+ *                         get the mean as lowest and highest reading.
+ *
+ * @return      Number of samples decoded, less than p_block->count if the block is malformed.
+ */
+uint8_t compressed_log_decode(const compressed_log_block_t * p_block, compressed_log_sample_t * p_samples);
+
+#endif // COMPRESSED_LOG_H__
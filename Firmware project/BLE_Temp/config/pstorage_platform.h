@@ -40,9 +40,12 @@ static __INLINE uint32_t pstorage_flash_page_end()
 
 #define PSTORAGE_FLASH_PAGE_END pstorage_flash_page_end()
 
-#define PSTORAGE_NUM_OF_PAGES       2                                                           /**< Number of flash pages allocated for the pstorage module excluding the swap page, configurable based on system requirements. */
+#define PSTORAGE_DM_PAGES           1                                                           /**< Bond information of the device manager, registered first. */
+#define PSTORAGE_LOG_PAGES          8                                                           /**< Measurement log ring (flash_log.c), 508 records per page, at least 37 days of history. */
+#define PSTORAGE_CONFIG_PAGES       1                                                           /**< Runtime configuration (device_config.c), registered after the device manager. */
+#define PSTORAGE_NUM_OF_PAGES       (PSTORAGE_DM_PAGES + PSTORAGE_LOG_PAGES + PSTORAGE_CONFIG_PAGES) /**< Number of flash pages allocated for the pstorage module excluding the swap page, configurable based on system requirements. */
 
-#define PSTORAGE_MAX_APPLICATIONS   1                                                           /**< Maximum number of applications that can be registered with the module, configurable based on system requirements. */
+#define PSTORAGE_MAX_APPLICATIONS   3                                                           /**< Maximum number of applications that can be registered with the module, configurable based on system requirements. */
 #define PSTORAGE_MIN_BLOCK_SIZE     0x0010                                                      /**< Minimum size of block that can be registered with the module. Should be configured based on system requirements, recommendation is not have this value to be at least size of word. */
 
 #define PSTORAGE_DATA_START_ADDR    ((PSTORAGE_FLASH_PAGE_END - PSTORAGE_NUM_OF_PAGES - 1) \
@@ -0,0 +1,173 @@
+#include <string.h>
+#include "current_time.h"
+#include "device_time.h"
+#include "ble_srv_common.h"
+#include "app_error.h"
+#include "nrf_error.h"
+
+static uint16_t                   m_service_handle;
+static ble_gatts_char_handles_t   m_current_time_handles;
+static current_time_evt_handler_t m_evt_handler;
+static uint8_t                    m_adjust_reason;      /**< As written by the last client that set the time. */
+
+/**@brief Encodes the device clock as Exact Time 256. */
+static void current_time_encode(uint8_t * p_value)
+{
+	device_time_date_t date;
+	uint32_t           seconds;
+	uint8_t            fractions256;
+
+	memset(p_value, 0, CURRENT_TIME_LEN);
+	if (!device_time_is_set())
+	{
+		return;
+	}
+	device_time_get(&seconds, &fractions256);
+	device_time_to_date(seconds, &date);
+	p_value[0] = (uint8_t)date.year;
+	p_value[1] = (uint8_t)(date.year >> 8);
+	p_value[2] = date.month;
+	p_value[3] = date.day;
+	p_value[4] = date.hours;
+	p_value[5] = date.minutes;
+	p_value[6] = date.seconds;
+	p_value[7] = date.day_of_week;
+	p_value[8] = fractions256;
+	p_value[9] = m_adjust_reason;
+}
+
+/**@brief Decodes Exact Time 256.
+ *
+ * @return      false if it is not a date the device clock can hold.
+ */
+static bool current_time_decode(const uint8_t * p_value, uint32_t * p_seconds)
+{
+	device_time_date_t date;
+
+	date.year    = (uint16_t)(p_value[0] | (p_value[1] << 8));
+	date.month   = p_value[2];
+	date.day     = p_value[3];
+	date.hours   = p_value[4];
+	date.minutes = p_value[5];
+	date.seconds = p_value[6];
+	return device_time_from_date(&date, p_seconds) && (*p_seconds >= DEVICE_TIME_VALID_MIN);
+}
+
+static void on_read_authorize(uint16_t conn_handle)
+{
+	ble_gatts_rw_authorize_reply_params_t reply;
+	uint8_t                               value[CURRENT_TIME_LEN];
+	uint32_t                              err_code;
+
+	current_time_encode(value);
+
+	memset(&reply, 0, sizeof(reply));
+	reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_READ;
+	reply.params.read.gatt_status  = BLE_GATT_STATUS_SUCCESS;
+	reply.params.read.update       = 1;
+	reply.params.read.len          = sizeof(value);
+	reply.params.read.p_data       = value;
+
+	err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &reply);
+	if (err_code != BLE_ERROR_INVALID_CONN_HANDLE)
+	{
+		APP_ERROR_CHECK(err_code);
+	}
+}
+
+static void on_write_authorize(uint16_t conn_handle, const ble_gatts_evt_write_t * p_write)
+{
+	ble_gatts_rw_authorize_reply_params_t reply;
+	current_time_evt_t                    evt;
+	uint32_t                              seconds;
+	uint32_t                              err_code;
+	bool                                  valid;
+
+	valid = (p_write->op == BLE_GATTS_OP_WRITE_REQ) && (p_write->offset == 0) &&
+	        (p_write->len == CURRENT_TIME_LEN) && current_time_decode(p_write->data, &seconds);
+
+	memset(&reply, 0, sizeof(reply));
+	reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+	reply.params.write.gatt_status = valid ? BLE_GATT_STATUS_SUCCESS : CURRENT_TIME_STATUS_INVALID;
+
+	err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &reply);
+	if (err_code != BLE_ERROR_INVALID_CONN_HANDLE)
+	{
+		APP_ERROR_CHECK(err_code);
+	}
+	if (!valid)
+	{
+		return;
+	}
+
+	evt.was_set     = device_time_is_set();
+	evt.step        = device_time_set(seconds, p_write->data[8]);
+	m_adjust_reason = p_write->data[9];
+	if (m_evt_handler != NULL)
+	{
+		m_evt_handler(&evt);
+	}
+}
+
+uint32_t current_time_init(current_time_evt_handler_t evt_handler)
+{
+	uint32_t            err_code;
+	ble_uuid_t          ble_uuid = {BLE_UUID_CURRENT_TIME_SERVICE, BLE_UUID_TYPE_BLE};
+	ble_gatts_char_md_t char_md;
+	ble_gatts_attr_md_t attr_md;
+	ble_gatts_attr_t    attr_char_value;
+
+	m_evt_handler   = evt_handler;
+	m_adjust_reason = 0;
+
+	err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &m_service_handle);
+	if (err_code != NRF_SUCCESS)
+	{
+		return err_code;
+	}
+
+	memset(&char_md, 0, sizeof(char_md));
+	char_md.char_props.read  = 1;
+	char_md.char_props.write = 1;
+
+	// Both directions go through the application: reads get the clock as it is now, writes are
+	// checked before they are accepted.
+	memset(&attr_md, 0, sizeof(attr_md));
+	BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+	BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+	attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+	attr_md.rd_auth = 1;
+	attr_md.wr_auth = 1;
+	attr_md.vlen    = 0;
+
+	ble_uuid.uuid = BLE_UUID_CURRENT_TIME_CHAR;
+	memset(&attr_char_value, 0, sizeof(attr_char_value));
+	attr_char_value.p_uuid    = &ble_uuid;
+	attr_char_value.p_attr_md = &attr_md;
+	attr_char_value.init_len  = CURRENT_TIME_LEN;
+	attr_char_value.max_len   = CURRENT_TIME_LEN;
+	attr_char_value.p_value   = NULL;
+
+	return sd_ble_gatts_characteristic_add(m_service_handle, &char_md, &attr_char_value, &m_current_time_handles);
+}
+
+void current_time_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+	const ble_gatts_evt_rw_authorize_request_t * p_request;
+
+	if (p_ble_evt->header.evt_id != BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST)
+	{
+		return;
+	}
+	p_request = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+	if ((p_request->type == BLE_GATTS_AUTHORIZE_TYPE_READ) &&
+	    (p_request->request.read.handle == m_current_time_handles.value_handle))
+	{
+		on_read_authorize(p_ble_evt->evt.gatts_evt.conn_handle);
+	}
+	else if ((p_request->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE) &&
+	         (p_request->request.write.handle == m_current_time_handles.value_handle))
+	{
+		on_write_authorize(p_ble_evt->evt.gatts_evt.conn_handle, &p_request->request.write);
+	}
+}
@@ -0,0 +1,50 @@
+#ifndef CURRENT_TIME_H__
+#define CURRENT_TIME_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
+/**@brief Current Time Service (0x1805) with a readable and writable Current Time characteristic
+ *        (0x2A2B), so a client can set the device clock.
+ *
+ * @details The value is the Exact Time 256 of the Bluetooth specification (little endian):
+ *
+ *          bytes 0-1   year
+ *          byte 2      month, 1 to 12
+ *          byte 3      day, 1 to 31
+ *          bytes 4-6   hours, minutes, seconds
+ *          byte 7      day of week, 1 is Monday (ignored on writes)
+ *          byte 8      fractions, 1/256 s
+ *          byte 9      adjust reason
+ *
+ *          All in UTC: the device has no use for a time zone. Reads return the device clock (a
+ *          year of 0, unknown, before it was set). Writes outside 2016-2105, or that are not a
+ *          valid date, are refused with CURRENT_TIME_STATUS_INVALID. There are no notifications:
+ *          nothing but a client ever adjusts the clock.
+ */
+#define CURRENT_TIME_LEN              10
+#define CURRENT_TIME_STATUS_INVALID   BLE_GATT_STATUS_ATTERR_APP_BEGIN   /**< ATT error 0x80, "Data field ignored". */
+
+/**@brief Time changes. */
+typedef struct
+{
+	int32_t step;                           /**< How far the clock moved, in seconds. */
+	bool    was_set;                        /**< The clock had been set before: it counted seconds since reset if not. */
+} current_time_evt_t;
+
+/**@brief Time change handler. */
+typedef void (*current_time_evt_handler_t)(current_time_evt_t * p_evt);
+
+/**@brief Function for adding the service. device_time_init() must have been called.
+ *
+ * @param[in]   evt_handler  Handler for the time changes, or NULL.
+ *
+ * @return      NRF_SUCCESS, or an error from the SoftDevice.
+ */
+uint32_t current_time_init(current_time_evt_handler_t evt_handler);
+
+/**@brief Function for handling the BLE events: reads and writes of the Current Time characteristic. */
+void current_time_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif // CURRENT_TIME_H__
@@ -0,0 +1,255 @@
+#include <stddef.h>
+#include <string.h>
+#include "device_config.h"
+#include "our_service.h"
+#include "pstorage.h"
+#include "app_error.h"
+#include "nrf_error.h"
+
+#define CONN_SUP_TIMEOUT_MIN          0x000A    /**< 100 ms, in 10 ms units. */
+#define CONN_SUP_TIMEOUT_MAX          0x0C80    /**< 32 s, in 10 ms units. */
+#define DEVICE_CONFIG_PARTS           5
+
+/**@brief A part of device_config_t behind a characteristic of its own. */
+typedef struct
+{
+	uint16_t uuid;
+	uint8_t  offset;
+	uint8_t  len;
+} config_part_t;
+
+static const config_part_t m_parts[DEVICE_CONFIG_PARTS] =
+{
+	{BLE_UUID_DEVICE_CONFIG_MEASUREMENT, offsetof(device_config_t, measurement), sizeof(measurement_scheduler_config_t)},
+	{BLE_UUID_DEVICE_CONFIG_ADVERTISING, offsetof(device_config_t, advertising), sizeof(adv_scheduler_config_t)},
+	{BLE_UUID_DEVICE_CONFIG_CONNECTION,  offsetof(device_config_t, connection),  sizeof(ble_gap_conn_params_t)},
+	{BLE_UUID_DEVICE_CONFIG_TX_POWER,    offsetof(device_config_t, tx_power),    sizeof(int8_t)},
+	{BLE_UUID_DEVICE_CONFIG_SENSOR,      offsetof(device_config_t, sensor),      sizeof(sht2x_async_config_t)},
+};
+
+static pstorage_handle_t           m_storage;
+static device_config_t             m_config;
+static device_config_t             m_stored;           /**< pstorage writes from here, so it stays put until done. */
+static bool                        m_busy;             /**< A flash update is running. */
+static bool                        m_dirty;            /**< m_config changed since m_stored was copied from it. */
+static uint16_t                    m_service_handle;
+static ble_gatts_char_handles_t    m_part_handles[DEVICE_CONFIG_PARTS];
+static device_config_evt_handler_t m_evt_handler;
+
+static bool tx_power_valid(int8_t tx_power)
+{
+	static const int8_t levels[] = {-40, -30, -20, -16, -12, -8, -4, 0, 4};
+	uint32_t            i;
+
+	for (i = 0; i < sizeof(levels); i++)
+	{
+		if (tx_power == levels[i])
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**@brief The limits of the Bluetooth specification, and a supervision timeout longer than
+ *        (1 + slave latency) connection intervals, twice over. */
+static bool conn_params_valid(const ble_gap_conn_params_t * p_params)
+{
+	return (p_params->min_conn_interval >= BLE_GAP_CP_MIN_CONN_INTVL_MIN) &&
+	       (p_params->max_conn_interval <= BLE_GAP_CP_MAX_CONN_INTVL_MAX) &&
+	       (p_params->min_conn_interval <= p_params->max_conn_interval) &&
+	       (p_params->slave_latency <= BLE_GAP_CP_SLAVE_LATENCY_MAX) &&
+	       (p_params->conn_sup_timeout >= CONN_SUP_TIMEOUT_MIN) &&
+	       (p_params->conn_sup_timeout <= CONN_SUP_TIMEOUT_MAX) &&
+	       ((uint32_t)p_params->conn_sup_timeout * 4 > (uint32_t)(p_params->slave_latency + 1) * p_params->max_conn_interval);
+}
+
+/**@brief Writes m_config to flash, unless a write is already running: it is written when that one
+ *        is done. */
+static void config_store(void)
+{
+	uint32_t err_code;
+
+	if (m_busy || !m_dirty)
+	{
+		return;
+	}
+	m_stored = m_config;
+	m_dirty  = false;
+	err_code = pstorage_update(&m_storage, (uint8_t *)&m_stored, sizeof(m_stored), 0);
+	if (err_code == NRF_ERROR_NO_MEM)
+	{
+		m_dirty = true; // The pstorage queue is full, written with the next change
+		return;
+	}
+	APP_ERROR_CHECK(err_code);
+	m_busy = true;
+}
+
+static void storage_cb(pstorage_handle_t * p_handle, uint8_t op_code, uint32_t result, uint8_t * p_data, uint32_t data_len)
+{
+	m_busy = false;
+	if (result != NRF_SUCCESS)
+	{
+		m_dirty = true; // The radio left no time for it, write again
+	}
+	config_store();
+}
+
+static void on_write_authorize(uint16_t conn_handle, const config_part_t * p_part, const ble_gatts_evt_write_t * p_write)
+{
+	ble_gatts_rw_authorize_reply_params_t reply;
+	device_config_t                       config;
+	uint32_t                              err_code;
+	bool                                  valid;
+
+	// The part is checked within the whole configuration, as other parts depend on it.
+	valid = (p_write->op == BLE_GATTS_OP_WRITE_REQ) && (p_write->offset == 0) && (p_write->len == p_part->len);
+	if (valid)
+	{
+		config = m_config;
+		memcpy((uint8_t *)&config + p_part->offset, p_write->data, p_part->len);
+		valid = device_config_valid(&config);
+	}
+
+	memset(&reply, 0, sizeof(reply));
+	reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+	reply.params.write.gatt_status = valid ? BLE_GATT_STATUS_SUCCESS : DEVICE_CONFIG_STATUS_INVALID;
+
+	// On success the stack writes the value into the characteristic.
+	err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &reply);
+	if (err_code != BLE_ERROR_INVALID_CONN_HANDLE)
+	{
+		APP_ERROR_CHECK(err_code);
+	}
+	if (!valid)
+	{
+		return;
+	}
+
+	m_config = config;
+	m_evt_handler(&m_config);
+	m_dirty = true;
+	config_store();
+}
+
+bool device_config_valid(const device_config_t * p_config)
+{
+	return (p_config->version == DEVICE_CONFIG_VERSION) &&
+	       tx_power_valid(p_config->tx_power) &&
+	       measurement_scheduler_config_valid(&p_config->measurement) &&
+	       adv_scheduler_config_valid(&p_config->advertising) &&
+	       conn_params_valid(&p_config->connection) &&
+	       sht2x_async_config_valid(&p_config->sensor);
+}
+
+uint32_t device_config_init(const device_config_t * p_default, device_config_evt_handler_t evt_handler)
+{
+	pstorage_module_param_t param;
+	ble_uuid128_t           base_uuid = BLE_UUID_OUR_BASE_UUID;
+	ble_uuid_t              ble_uuid;
+	ble_gatts_char_md_t     char_md;
+	ble_gatts_attr_md_t     attr_md;
+	ble_gatts_attr_t        attr_char_value;
+	uint32_t                err_code;
+	uint32_t                i;
+
+	m_evt_handler = evt_handler;
+	m_busy        = false;
+	m_dirty       = false;
+
+	param.cb          = storage_cb;
+	param.block_size  = sizeof(device_config_t);
+	param.block_count = 1;
+	err_code = pstorage_register(&param, &m_storage);
+	if (err_code == NRF_SUCCESS)
+	{
+		err_code = pstorage_load((uint8_t *)&m_config, &m_storage, sizeof(m_config), 0);
+	}
+	if (err_code != NRF_SUCCESS)
+	{
+		return err_code;
+	}
+	if (!device_config_valid(&m_config))
+	{
+		// Blank flash, or written by a firmware with another layout
+		m_config         = *p_default;
+		m_config.version = DEVICE_CONFIG_VERSION;
+		if (!device_config_valid(&m_config))
+		{
+			return NRF_ERROR_INVALID_PARAM;
+		}
+	}
+
+	err_code = sd_ble_uuid_vs_add(&base_uuid, &ble_uuid.type);
+	if (err_code != NRF_SUCCESS)
+	{
+		return err_code;
+	}
+	ble_uuid.uuid = BLE_UUID_DEVICE_CONFIG_SERVICE;
+	err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &m_service_handle);
+	if (err_code != NRF_SUCCESS)
+	{
+		return err_code;
+	}
+
+	memset(&char_md, 0, sizeof(char_md));
+	char_md.char_props.read  = 1;
+	char_md.char_props.write = 1;
+
+	// Reads come from the stack; writes go through the application, which checks them first.
+	memset(&attr_md, 0, sizeof(attr_md));
+	BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+	BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+	attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+	attr_md.rd_auth = 0;
+	attr_md.wr_auth = 1;
+	attr_md.vlen    = 0;
+
+	for (i = 0; i < DEVICE_CONFIG_PARTS; i++)
+	{
+		ble_uuid.uuid = m_parts[i].uuid;
+		memset(&attr_char_value, 0, sizeof(attr_char_value));
+		attr_char_value.p_uuid    = &ble_uuid;
+		attr_char_value.p_attr_md = &attr_md;
+		attr_char_value.init_len  = m_parts[i].len;
+		attr_char_value.max_len   = m_parts[i].len;
+		attr_char_value.p_value   = (uint8_t *)&m_config + m_parts[i].offset;
+
+		err_code = sd_ble_gatts_characteristic_add(m_service_handle, &char_md, &attr_char_value, &m_part_handles[i]);
+		if (err_code != NRF_SUCCESS)
+		{
+			return err_code;
+		}
+	}
+	return NRF_SUCCESS;
+}
+
+const device_config_t * device_config_get(void)
+{
+	return &m_config;
+}
+
+void device_config_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+	const ble_gatts_evt_rw_authorize_request_t * p_request;
+	uint32_t                                     i;
+
+	if (p_ble_evt->header.evt_id != BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST)
+	{
+		return;
+	}
+	p_request = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+	if (p_request->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE)
+	{
+		return;
+	}
+	for (i = 0; i < DEVICE_CONFIG_PARTS; i++)
+	{
+		if (p_request->request.write.handle == m_part_handles[i].value_handle)
+		{
+			on_write_authorize(p_ble_evt->evt.gatts_evt.conn_handle, &m_parts[i], &p_request->request.write);
+			return;
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef DEVICE_CONFIG_H__
+#define DEVICE_CONFIG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_gap.h"
+#include "adv_scheduler.h"
+#include "measurement_scheduler.h"
+#include "sht2x_async.h"
+
+/**@brief Runtime configuration, kept in flash and exposed by a service of its own.
+ *
+ * @details Each part of device_config_t is a characteristic holding it as it is in memory (little
+ *          endian, no padding), no longer than a Write Request takes at the default ATT MTU. A
+ *          client reads one, changes the fields it wants and writes the whole part back (write
+ *          request, offset 0). A part that would leave the configuration invalid as a whole
+ *          (min_interval above a max_interval in the same part, a supervision timeout too short
+ *          for the connection interval in use, ...) is refused with DEVICE_CONFIG_STATUS_INVALID and
+ *          nothing changes. An accepted one is handed to the application to apply right away and
+ *          the configuration is written to flash, where it is found again at boot. A blank or out
+ *          of date flash record gives the application's defaults.
+ */
+#define BLE_UUID_DEVICE_CONFIG_SERVICE      0x0010      /**< On the base UUID of our service. */
+#define BLE_UUID_DEVICE_CONFIG_MEASUREMENT  0x0011      /**< measurement_scheduler_config_t, 12 bytes. */
+#define BLE_UUID_DEVICE_CONFIG_ADVERTISING  0x0012      /**< adv_scheduler_config_t, 10 bytes. */
+#define BLE_UUID_DEVICE_CONFIG_CONNECTION   0x0013      /**< ble_gap_conn_params_t, 8 bytes. */
+#define BLE_UUID_DEVICE_CONFIG_TX_POWER     0x0014      /**< int8_t, 1 byte. */
+#define BLE_UUID_DEVICE_CONFIG_SENSOR       0x0015      /**< sht2x_async_config_t, 2 bytes. */
+
+#define DEVICE_CONFIG_VERSION           2                                   /**< Changes with the layout of device_config_t. */
+#define DEVICE_CONFIG_STATUS_INVALID    BLE_GATT_STATUS_ATTERR_APP_BEGIN    /**< ATT error 0x80. */
+
+/**@brief Configuration, 36 bytes in flash. */
+typedef struct
+{
+	uint8_t                        version;         /**< DEVICE_CONFIG_VERSION */
+	int8_t                         tx_power;        /**< dBm: -40, -30, -20, -16, -12, -8, -4, 0 or 4. */
+	measurement_scheduler_config_t measurement;
+	adv_scheduler_config_t         advertising;
+	ble_gap_conn_params_t          connection;      /**< Preferred parameters when no log transfer is running. */
+	sht2x_async_config_t           sensor;
+	uint8_t                        reserved[2];     /**< 0, pstorage writes whole words. */
+} device_config_t;
+
+/**@brief Configuration change handler. The configuration has been checked, applying it must not fail. */
+typedef void (*device_config_evt_handler_t)(const device_config_t * p_config);
+
+/**@brief Function for checking a configuration. */
+bool device_config_valid(const device_config_t * p_config);
+
+/**@brief Function for loading the configuration and adding the service.
+ *
+ * @details pstorage_init() must have been called. The flash page is registered with pstorage,
+ *          so the order of this call against the other pstorage users sets the flash layout.
+ *
+ * @param[in]   p_default     Configuration to use when flash holds none. version is ignored.
+ * @param[in]   evt_handler   Handler for the changes written by a client.
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM for bad defaults, or an error from pstorage or
+ *              the SoftDevice.
+ */
+uint32_t device_config_init(const device_config_t * p_default, device_config_evt_handler_t evt_handler);
+
+/**@brief Function for getting the configuration in use. */
+const device_config_t * device_config_get(void);
+
+/**@brief Function for handling the BLE events: writes of the configuration characteristics. */
+void device_config_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif // DEVICE_CONFIG_H__
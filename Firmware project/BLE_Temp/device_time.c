@@ -0,0 +1,144 @@
+#include "device_time.h"
+#include "app_timer.h"
+#include "nrf_error.h"
+
+#define SECONDS_PER_DAY               86400UL
+#define DAYS_1970_TO_2106             49710UL   /**< The seconds no longer fit in 32 bits from 2106-02-07. */
+
+static app_timer_id_t m_update_timer;
+static uint32_t       m_ticks_per_second;
+static uint32_t       m_last_ticks;             /**< RTC1 counter at the last update. */
+static uint32_t       m_ticks;                  /**< Ticks into the current second. */
+static uint32_t       m_seconds;
+static bool           m_set;
+
+/**@brief Adds the ticks since the last update. */
+static void clock_update(void)
+{
+	uint32_t ticks;
+	uint32_t elapsed;
+
+	(void)app_timer_cnt_get(&ticks);
+	(void)app_timer_cnt_diff_compute(ticks, m_last_ticks, &elapsed);
+	m_last_ticks = ticks;
+
+	m_ticks   += elapsed;
+	m_seconds += m_ticks / m_ticks_per_second;
+	m_ticks   %= m_ticks_per_second;
+}
+
+static void update_timeout_handler(void * p_context)
+{
+	clock_update();
+}
+
+/**@brief Days since 1970-01-01 of a date in the proleptic Gregorian calendar. Years count from
+ *        March, so the leap day is the last day of the year. */
+static uint32_t days_from_civil(uint32_t year, uint32_t month, uint32_t day)
+{
+	uint32_t era;
+	uint32_t year_of_era;
+	uint32_t day_of_year;
+
+	year       -= (month <= 2) ? 1 : 0;
+	era         = year / 400;
+	year_of_era = year - era * 400;
+	day_of_year = (153 * ((month > 2) ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	return era * 146097 + year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year - 719468;
+}
+
+static bool is_leap_year(uint32_t year)
+{
+	return ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+}
+
+uint32_t device_time_init(uint32_t app_timer_prescaler)
+{
+	uint32_t err_code;
+
+	m_ticks_per_second = APP_TIMER_CLOCK_FREQ / (app_timer_prescaler + 1);
+	m_ticks            = 0;
+	m_seconds          = 0;
+	m_set              = false;
+	(void)app_timer_cnt_get(&m_last_ticks);
+
+	err_code = app_timer_create(&m_update_timer, APP_TIMER_MODE_REPEATED, update_timeout_handler);
+	if (err_code != NRF_SUCCESS)
+	{
+		return err_code;
+	}
+	return app_timer_start(m_update_timer, APP_TIMER_TICKS(DEVICE_TIME_UPDATE_INTERVAL_MS, app_timer_prescaler), NULL);
+}
+
+uint32_t device_time_now(void)
+{
+	clock_update();
+	return m_seconds;
+}
+
+void device_time_get(uint32_t * p_seconds, uint8_t * p_fractions256)
+{
+	clock_update();
+	*p_seconds      = m_seconds;
+	*p_fractions256 = (uint8_t)(m_ticks * 256 / m_ticks_per_second);
+}
+
+int32_t device_time_set(uint32_t seconds, uint8_t fractions256)
+{
+	int32_t step;
+
+	clock_update();
+	step      = (int32_t)(seconds - m_seconds);
+	m_seconds = seconds;
+	m_ticks   = (uint32_t)fractions256 * m_ticks_per_second / 256;
+	m_set     = true;
+	return step;
+}
+
+bool device_time_is_set(void)
+{
+	return m_set;
+}
+
+void device_time_to_date(uint32_t seconds, device_time_date_t * p_date)
+{
+	uint32_t days        = seconds / SECONDS_PER_DAY;
+	uint32_t rest        = seconds % SECONDS_PER_DAY;
+	uint32_t z           = days + 719468;
+	uint32_t era         = z / 146097;
+	uint32_t day_of_era  = z - era * 146097;
+	uint32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	uint32_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	uint32_t mp          = (5 * day_of_year + 2) / 153;
+
+	p_date->day         = (uint8_t)(day_of_year - (153 * mp + 2) / 5 + 1);
+	p_date->month       = (uint8_t)((mp < 10) ? mp + 3 : mp - 9);
+	p_date->year        = (uint16_t)(era * 400 + year_of_era + ((p_date->month <= 2) ? 1 : 0));
+	p_date->hours       = (uint8_t)(rest / 3600);
+	p_date->minutes     = (uint8_t)((rest / 60) % 60);
+	p_date->seconds     = (uint8_t)(rest % 60);
+	p_date->day_of_week = (uint8_t)((days + 3) % 7 + 1);  // 1970-01-01 was a Thursday
+}
+
+bool device_time_from_date(const device_time_date_t * p_date, uint32_t * p_seconds)
+{
+	static const uint8_t month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	uint32_t             days;
+
+	if ((p_date->year < 1970) || (p_date->month < 1) || (p_date->month > 12) || (p_date->day < 1) ||
+	    (p_date->hours > 23) || (p_date->minutes > 59) || (p_date->seconds > 59))
+	{
+		return false;
+	}
+	if (p_date->day > month_days[p_date->month - 1] + (((p_date->month == 2) && is_leap_year(p_date->year)) ? 1 : 0))
+	{
+		return false;
+	}
+	days = days_from_civil(p_date->year, p_date->month, p_date->day);
+	if (days >= DAYS_1970_TO_2106)
+	{
+		return false;
+	}
+	*p_seconds = days * SECONDS_PER_DAY + p_date->hours * 3600UL + p_date->minutes * 60UL + p_date->seconds;
+	return true;
+}
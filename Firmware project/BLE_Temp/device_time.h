@@ -0,0 +1,71 @@
+#ifndef DEVICE_TIME_H__
+#define DEVICE_TIME_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief Device clock, kept from the app_timer (RTC1) tick count.
+ *
+ * @details Seconds since 1970-01-01 00:00 UTC once a client has set it, seconds since reset
+ *          before that. The two cannot be confused: counting from reset takes 46 years to reach
+ *          DEVICE_TIME_VALID_MIN.
+ *
+ *          RTC1 is a 24 bit counter, it wraps every 4.5 hours at the 1024 Hz of prescaler 31. The
+ *          module takes the elapsed ticks whenever the time is asked for, and from its own timer
+ *          every DEVICE_TIME_UPDATE_INTERVAL_MS so that no wrap goes unseen. The counter runs from
+ *          the 32 kHz crystal (20 ppm, under 2 s a day); clients set the time again when they
+ *          connect.
+ */
+#define DEVICE_TIME_VALID_MIN            1451606400UL  /**< 2016-01-01 00:00 UTC. Earlier times are seconds since reset. */
+#define DEVICE_TIME_UPDATE_INTERVAL_MS   3600000UL     /**< 1 hour, well inside the RTC1 wrap. */
+
+/**@brief Calendar date and time, UTC. */
+typedef struct
+{
+	uint16_t year;
+	uint8_t  month;                         /**< 1 to 12 */
+	uint8_t  day;                           /**< 1 to 31 */
+	uint8_t  hours;
+	uint8_t  minutes;
+	uint8_t  seconds;
+	uint8_t  day_of_week;                   /**< 1 is Monday, 7 is Sunday. */
+} device_time_date_t;
+
+/**@brief Function for starting the clock at 0.
+ *
+ * @details Creates and starts the repeated app_timer that keeps up with RTC1.
+ *
+ * @param[in]   app_timer_prescaler  Value the app_timer module was initialized with.
+ *
+ * @return      NRF_SUCCESS, or an error from app_timer_create() or app_timer_start().
+ */
+uint32_t device_time_init(uint32_t app_timer_prescaler);
+
+/**@brief Function for getting the time in seconds. */
+uint32_t device_time_now(void);
+
+/**@brief Function for getting the time in seconds and 1/256 s. */
+void device_time_get(uint32_t * p_seconds, uint8_t * p_fractions256);
+
+/**@brief Function for setting the time.
+ *
+ * @param[in]   seconds        Seconds since 1970-01-01 00:00 UTC.
+ * @param[in]   fractions256   1/256 s.
+ *
+ * @return      How far the clock moved, in seconds (new time - old time, the fractions ignored).
+ */
+int32_t device_time_set(uint32_t seconds, uint8_t fractions256);
+
+/**@brief Function for checking if a client has set the time since reset. */
+bool device_time_is_set(void);
+
+/**@brief Function for converting seconds since 1970-01-01 to a date. */
+void device_time_to_date(uint32_t seconds, device_time_date_t * p_date);
+
+/**@brief Function for converting a date to seconds since 1970-01-01. The day of the week is ignored.
+ *
+ * @return      false if the date is not valid or not between 1970 and 2105.
+ */
+bool device_time_from_date(const device_time_date_t * p_date, uint32_t * p_seconds);
+
+#endif // DEVICE_TIME_H__
@@ -0,0 +1,281 @@
+#include <string.h>
+#include "flash_log.h"
+#include "nrf_error.h"
+#include "app_error.h"
+
+#define FLASH_LOG_MAGIC               0x474C5452                                    /**< "RTLG", marks a log page. */
+#define FLASH_LOG_HEADER_WORDS        2                                             /**< Magic and page sequence number. */
+#define FLASH_LOG_PAGE_WORDS          (FLASH_LOG_PAGE_SIZE / 4 - FLASH_LOG_HEADER_WORDS) /**< Data words per page. */
+#define FLASH_LOG_RING_WORDS          (FLASH_LOG_PAGES * FLASH_LOG_PAGE_WORDS)
+#define FLASH_LOG_EMPTY_WORD          0xFFFFFFFF
+
+/**@brief Next flash operation for the word at the head of the queue. */
+typedef enum
+{
+	FLASH_LOG_STEP_ERASE,                   /**< First word of a page: erase the page, */
+	FLASH_LOG_STEP_HEADER,                  /**< then write its header, */
+	FLASH_LOG_STEP_DATA                     /**< then the word itself. */
+} flash_log_step_t;
+
+static pstorage_handle_t m_storage;
+static uint32_t          m_tail_seq;                            /**< Sequence number of the oldest page. Page seq lives in block seq % FLASH_LOG_PAGES. */
+static uint32_t          m_written;                             /**< Data words in flash, counted from the start of the oldest page. */
+static uint32_t          m_words;                               /**< m_written plus the queued words. */
+static uint32_t          m_queue[FLASH_LOG_QUEUE_SIZE];         /**< Words not in flash yet. pstorage writes from here, so they stay put until done. */
+static uint8_t           m_queue_first;
+static uint8_t           m_queue_count;
+static uint8_t           m_pending[FLASH_LOG_RECORD_SIZE];      /**< First record of a word still waiting for the second. */
+static bool              m_pending_valid;
+static uint32_t          m_header[FLASH_LOG_HEADER_WORDS];
+static flash_log_step_t  m_step;
+static bool              m_busy;
+
+/**@brief Gets the pstorage handle of the block holding page seq. */
+static uint32_t page_handle(uint32_t seq, pstorage_handle_t * p_handle)
+{
+	return pstorage_block_identifier_get(&m_storage, (pstorage_size_t)(seq % FLASH_LOG_PAGES), p_handle);
+}
+
+/**@brief Issues the next flash operation. Completion continues in storage_cb(). */
+static void log_process(void)
+{
+	pstorage_handle_t handle;
+	uint32_t          seq = m_tail_seq + m_written / FLASH_LOG_PAGE_WORDS;
+	uint32_t          err_code;
+
+	if (m_busy || (m_queue_count == 0))
+	{
+		return;
+	}
+	err_code = page_handle(seq, &handle);
+	if (err_code == NRF_SUCCESS)
+	{
+		switch (m_step)
+		{
+			case FLASH_LOG_STEP_ERASE:
+				err_code = pstorage_clear(&handle, FLASH_LOG_PAGE_SIZE);
+				break;
+
+			case FLASH_LOG_STEP_HEADER:
+				m_header[0] = FLASH_LOG_MAGIC;
+				m_header[1] = seq;
+				err_code = pstorage_store(&handle, (uint8_t *)m_header, sizeof(m_header), 0);
+				break;
+
+			default:
+				err_code = pstorage_store(&handle, (uint8_t *)&m_queue[m_queue_first], sizeof(uint32_t),
+				                          (pstorage_size_t)(4 * (FLASH_LOG_HEADER_WORDS + m_written % FLASH_LOG_PAGE_WORDS)));
+				break;
+		}
+	}
+	if (err_code == NRF_ERROR_NO_MEM)
+	{
+		return; // The pstorage queue is full, tried again on the next append
+	}
+	APP_ERROR_CHECK(err_code);
+	m_busy = true;
+}
+
+static void storage_cb(pstorage_handle_t * p_handle, uint8_t op_code, uint32_t result, uint8_t * p_data, uint32_t data_len)
+{
+	m_busy = false;
+	if (result == NRF_SUCCESS)
+	{
+		switch (m_step)
+		{
+			case FLASH_LOG_STEP_ERASE:
+				m_step = FLASH_LOG_STEP_HEADER;
+				break;
+
+			case FLASH_LOG_STEP_HEADER:
+				m_step = FLASH_LOG_STEP_DATA;
+				break;
+
+			default:
+				m_queue_first = (m_queue_first + 1) % FLASH_LOG_QUEUE_SIZE;
+				m_queue_count--;
+				m_written++;
+				m_step = (m_written % FLASH_LOG_PAGE_WORDS == 0) ? FLASH_LOG_STEP_ERASE : FLASH_LOG_STEP_DATA;
+				break;
+		}
+	}
+	// A failed operation (the radio left no time for it) is simply issued again.
+	log_process();
+}
+
+/**@brief Checks that the block of page seq holds that page. */
+static bool page_valid(uint32_t seq)
+{
+	pstorage_handle_t handle;
+	uint32_t          header[FLASH_LOG_HEADER_WORDS];
+
+	return (page_handle(seq, &handle) == NRF_SUCCESS) &&
+	       (pstorage_load((uint8_t *)header, &handle, sizeof(header), 0) == NRF_SUCCESS) &&
+	       (header[0] == FLASH_LOG_MAGIC) && (header[1] == seq);
+}
+
+/**@brief Finds the number of data words in page seq. Words are written in order, so the written
+ *        ones come first and a binary search over erased ones finds the end. */
+static uint32_t page_words(uint32_t seq, uint32_t * p_count)
+{
+	pstorage_handle_t handle;
+	uint32_t          low  = 0;
+	uint32_t          high = FLASH_LOG_PAGE_WORDS;
+	uint32_t          err_code;
+
+	err_code = page_handle(seq, &handle);
+	while ((err_code == NRF_SUCCESS) && (low < high))
+	{
+		uint32_t middle = (low + high) / 2;
+		uint32_t word   = FLASH_LOG_EMPTY_WORD;
+
+		err_code = pstorage_load((uint8_t *)&word, &handle, sizeof(word),
+		                         (pstorage_size_t)(4 * (FLASH_LOG_HEADER_WORDS + middle)));
+		if (word == FLASH_LOG_EMPTY_WORD)
+		{
+			high = middle;
+		}
+		else
+		{
+			low = middle + 1;
+		}
+	}
+	*p_count = low;
+	return err_code;
+}
+
+uint32_t flash_log_init(void)
+{
+	pstorage_module_param_t param;
+	pstorage_handle_t       handle;
+	uint32_t                header[FLASH_LOG_HEADER_WORDS];
+	uint32_t                head_seq = 0;
+	bool                    found    = false;
+	uint32_t                err_code;
+	uint32_t                i;
+
+	param.cb          = storage_cb;
+	param.block_size  = FLASH_LOG_PAGE_SIZE;
+	param.block_count = FLASH_LOG_PAGES;
+	err_code = pstorage_register(&param, &m_storage);
+	if (err_code != NRF_SUCCESS)
+	{
+		return err_code;
+	}
+
+	// The newest page has the highest sequence number of the pages with a valid header.
+	for (i = 0; i < FLASH_LOG_PAGES; i++)
+	{
+		err_code = pstorage_block_identifier_get(&m_storage, (pstorage_size_t)i, &handle);
+		if (err_code == NRF_SUCCESS)
+		{
+			err_code = pstorage_load((uint8_t *)header, &handle, sizeof(header), 0);
+		}
+		if (err_code != NRF_SUCCESS)
+		{
+			return err_code;
+		}
+		if ((header[0] == FLASH_LOG_MAGIC) && (header[1] % FLASH_LOG_PAGES == i) &&
+		    (!found || (header[1] > head_seq)))
+		{
+			head_seq = header[1];
+			found    = true;
+		}
+	}
+
+	m_tail_seq      = head_seq;
+	m_written       = 0;
+	m_queue_first   = 0;
+	m_queue_count   = 0;
+	m_pending_valid = false;
+	m_busy          = false;
+	if (found)
+	{
+		// Older pages count as long as they are in sequence; a page erased for reuse breaks it.
+		while ((head_seq - m_tail_seq < FLASH_LOG_PAGES - 1) && (m_tail_seq > 0) && page_valid(m_tail_seq - 1))
+		{
+			m_tail_seq--;
+		}
+		err_code = page_words(head_seq, &m_written);
+		m_written += (head_seq - m_tail_seq) * FLASH_LOG_PAGE_WORDS;
+	}
+	m_words = m_written;
+	m_step  = (m_written % FLASH_LOG_PAGE_WORDS == 0) ? FLASH_LOG_STEP_ERASE : FLASH_LOG_STEP_DATA;
+	return err_code;
+}
+
+uint32_t flash_log_append(const uint8_t * p_record)
+{
+	if (p_record[1] == 0xFF)
+	{
+		return NRF_ERROR_INVALID_PARAM;
+	}
+	if (!m_pending_valid)
+	{
+		memcpy(m_pending, p_record, FLASH_LOG_RECORD_SIZE);
+		m_pending_valid = true;
+		return NRF_SUCCESS;
+	}
+	if (m_queue_count >= FLASH_LOG_QUEUE_SIZE)
+	{
+		return NRF_ERROR_NO_MEM;
+	}
+	if (m_words == FLASH_LOG_RING_WORDS)
+	{
+		// Ring full: the next page to write is the oldest one, drop it.
+		m_tail_seq++;
+		m_written -= FLASH_LOG_PAGE_WORDS;
+		m_words   -= FLASH_LOG_PAGE_WORDS;
+	}
+	m_queue[(m_queue_first + m_queue_count) % FLASH_LOG_QUEUE_SIZE] =
+	    (uint32_t)m_pending[0] | ((uint32_t)m_pending[1] << 8) | ((uint32_t)p_record[0] << 16) | ((uint32_t)p_record[1] << 24);
+	m_queue_count++;
+	m_words++;
+	m_pending_valid = false;
+	log_process();
+	return NRF_SUCCESS;
+}
+
+uint32_t flash_log_count(void)
+{
+	return m_words * 2 + (m_pending_valid ? 1 : 0);
+}
+
+uint32_t flash_log_read(uint32_t index, uint8_t * p_record)
+{
+	uint32_t word_index = index / 2;
+	uint32_t word;
+
+	if (index >= flash_log_count())
+	{
+		return NRF_ERROR_INVALID_PARAM;
+	}
+	if (word_index == m_words)
+	{
+		memcpy(p_record, m_pending, FLASH_LOG_RECORD_SIZE);
+		return NRF_SUCCESS;
+	}
+	if (word_index >= m_written)
+	{
+		word = m_queue[(m_queue_first + word_index - m_written) % FLASH_LOG_QUEUE_SIZE];
+	}
+	else
+	{
+		pstorage_handle_t handle;
+		uint32_t          err_code = page_handle(m_tail_seq + word_index / FLASH_LOG_PAGE_WORDS, &handle);
+
+		if (err_code == NRF_SUCCESS)
+		{
+			err_code = pstorage_load((uint8_t *)&word, &handle, sizeof(word),
+			                         (pstorage_size_t)(4 * (FLASH_LOG_HEADER_WORDS + word_index % FLASH_LOG_PAGE_WORDS)));
+		}
+		if (err_code != NRF_SUCCESS)
+		{
+			return err_code;
+		}
+	}
+	word >>= (index & 1) ? 16 : 0;
+	p_record[0] = (uint8_t)word;
+	p_record[1] = (uint8_t)(word >> 8);
+	return NRF_SUCCESS;
+}
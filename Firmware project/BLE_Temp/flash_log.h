@@ -0,0 +1,52 @@
+#ifndef FLASH_LOG_H__
+#define FLASH_LOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pstorage.h"
+
+#define FLASH_LOG_PAGES               PSTORAGE_LOG_PAGES    /**< Flash pages in the log ring, see pstorage_platform.h. */
+#define FLASH_LOG_PAGE_SIZE           1024                  /**< nRF51 code page size, one pstorage block per page. */
+#define FLASH_LOG_RECORD_SIZE         2                     /**< Bytes per record. */
+#define FLASH_LOG_QUEUE_SIZE          8                     /**< Words waiting for flash, a record arrives every 15 minutes. */
+
+/**@brief Function for registering the log pages with pstorage and finding the end of the log.
+ *
+ * @details Reads the page headers to find the newest page and the oldest page still in sequence
+ *          with it, then the last written word of the newest page. Pages without a valid header are
+ *          treated as empty, so a blank chip starts an empty log. pstorage_init() must have been
+ *          called.
+ *
+ * @return      NRF_SUCCESS, or an error from pstorage.
+ */
+uint32_t flash_log_init(void);
+
+/**@brief Function for appending a record.
+ *
+ * @details Records are written to flash in pairs, as one word. The first record of a pair waits in
+ *          RAM for the second one and is lost if the chip resets in between. When the ring is full
+ *          the oldest page is erased and reused.
+ *
+ * @param[in]   p_record   FLASH_LOG_RECORD_SIZE bytes: the temperature and the humidity log byte.
+ *                         The humidity byte must not be 0xFF, so a written word never reads as
+ *                         erased flash.
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM for a humidity byte of 0xFF, or NRF_ERROR_NO_MEM
+ *              if flash has fallen FLASH_LOG_QUEUE_SIZE words behind (the record is dropped).
+ */
+uint32_t flash_log_append(const uint8_t * p_record);
+
+/**@brief Function for getting the number of records in the log, including those not in flash yet. */
+uint32_t flash_log_count(void);
+
+/**@brief Function for reading a record.
+ *
+ * @param[in]   index      Record index, 0 is the oldest.
+ * @param[out]  p_record   FLASH_LOG_RECORD_SIZE bytes.
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if index is not below flash_log_count(), or an
+ *              error from pstorage_load().
+ */
+uint32_t flash_log_read(uint32_t index, uint8_t * p_record);
+
+#endif // FLASH_LOG_H__
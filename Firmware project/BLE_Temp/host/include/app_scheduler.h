@@ -0,0 +1,34 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 scheduler.
+ *
+ * Events put from interrupt handlers are run in order by app_sched_execute()
+ * in the main loop, in thread mode: interrupts due while an event handler
+ * busy-waits preempt it, like on the chip.
+ */
+#ifndef APP_SCHEDULER_H__
+#define APP_SCHEDULER_H__
+
+#include <stdint.h>
+#include "app_util.h"
+#include "app_error.h"
+
+#define APP_SCHED_EVENT_HEADER_SIZE 8
+
+#define APP_SCHED_BUF_SIZE(EVENT_SIZE, QUEUE_SIZE)                                                 \
+            (((EVENT_SIZE) + APP_SCHED_EVENT_HEADER_SIZE) * ((QUEUE_SIZE) + 1))
+
+typedef void (*app_sched_event_handler_t)(void * p_event_data, uint16_t event_size);
+
+#define APP_SCHED_INIT(EVENT_SIZE, QUEUE_SIZE)                                                     \
+    do                                                                                              \
+    {                                                                                               \
+        static uint32_t APP_SCHED_BUF[CEIL_DIV(APP_SCHED_BUF_SIZE((EVENT_SIZE), (QUEUE_SIZE)),     \
+                                               sizeof(uint32_t))];                                  \
+        uint32_t ERR_CODE = app_sched_init((EVENT_SIZE), (QUEUE_SIZE), APP_SCHED_BUF);             \
+        APP_ERROR_CHECK(ERR_CODE);                                                                  \
+    } while (0)
+
+uint32_t app_sched_init(uint16_t max_event_size, uint16_t queue_size, void * p_evt_buffer);
+void     app_sched_execute(void);
+uint32_t app_sched_event_put(void * p_event_data, uint16_t event_size, app_sched_event_handler_t handler);
+
+#endif // APP_SCHEDULER_H__
@@ -0,0 +1,49 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 application timer.
+ *
+ * Timers run on the simulator's virtual RTC1: ticks are derived from the
+ * virtual clock with the same 24-bit counter and prescaler as on the chip.
+ */
+#ifndef APP_TIMER_H__
+#define APP_TIMER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_util.h"
+#include "app_error.h"
+
+#define APP_TIMER_CLOCK_FREQ         32768
+#define APP_TIMER_MIN_TIMEOUT_TICKS  5
+#define MAX_RTC_COUNTER_VAL          0x00FFFFFF
+
+#define APP_TIMER_TICKS(MS, PRESCALER)\
+            ((uint32_t)ROUNDED_DIV((MS) * (uint64_t)APP_TIMER_CLOCK_FREQ, ((PRESCALER) + 1) * 1000))
+
+typedef uint32_t app_timer_id_t;
+
+typedef void (*app_timer_timeout_handler_t)(void * p_context);
+
+typedef enum
+{
+    APP_TIMER_MODE_SINGLE_SHOT,
+    APP_TIMER_MODE_REPEATED
+} app_timer_mode_t;
+
+uint32_t app_timer_init(uint32_t prescaler, uint8_t max_timers, uint8_t op_queues_size, bool use_scheduler);
+
+#define APP_TIMER_INIT(PRESCALER, MAX_TIMERS, OP_QUEUES_SIZE, USE_SCHEDULER)                       \
+    do                                                                                              \
+    {                                                                                               \
+        uint32_t ERR_CODE = app_timer_init((PRESCALER), (MAX_TIMERS), (OP_QUEUES_SIZE), (USE_SCHEDULER)); \
+        APP_ERROR_CHECK(ERR_CODE);                                                                  \
+    } while (0)
+
+uint32_t app_timer_create(app_timer_id_t *            p_timer_id,
+                          app_timer_mode_t            mode,
+                          app_timer_timeout_handler_t timeout_handler);
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context);
+uint32_t app_timer_stop(app_timer_id_t timer_id);
+uint32_t app_timer_stop_all(void);
+uint32_t app_timer_cnt_get(uint32_t * p_ticks);
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from, uint32_t * p_ticks_diff);
+
+#endif // APP_TIMER_H__
@@ -0,0 +1,11 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 trace library. */
+#ifndef APP_TRACE_H__
+#define APP_TRACE_H__
+
+#include <stdio.h>
+
+#define app_trace_init()
+#define app_trace_log(...)
+#define app_trace_dump(p_buffer, len)
+
+#endif // APP_TRACE_H__
@@ -0,0 +1,23 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 header of the same name.
+ *
+ * A critical region holds off the application interrupts (SoftDevice events,
+ * timers, peripherals) while thread mode code runs; they are delivered when it
+ * ends. Interrupt handlers are never preempted in the simulation, so there it
+ * only counts the SVC calls.
+ */
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+#include <stdint.h>
+#include "nrf_soc.h"
+
+#define CRITICAL_REGION_ENTER()                                                                     \
+    {                                                                                               \
+        uint8_t IS_NESTED_CRITICAL_REGION = 0;                                                      \
+        (void)sd_nvic_critical_region_enter(&IS_NESTED_CRITICAL_REGION);
+
+#define CRITICAL_REGION_EXIT()                                                                      \
+        (void)sd_nvic_critical_region_exit(IS_NESTED_CRITICAL_REGION);                              \
+    }
+
+#endif // APP_UTIL_PLATFORM_H__
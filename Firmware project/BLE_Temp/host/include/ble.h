@@ -0,0 +1,60 @@
+/* Host simulation shim of the S110 v8.0.0 header of the same name. */
+#ifndef BLE_H__
+#define BLE_H__
+
+#include <stdint.h>
+#include "ble_types.h"
+#include "ble_gap.h"
+#include "ble_gatt.h"
+#include "ble_gatts.h"
+#include "nrf_soc.h"
+
+enum BLE_COMMON_EVTS
+{
+    BLE_EVT_TX_COMPLETE = 0x01,
+    BLE_EVT_USER_MEM_REQUEST,
+    BLE_EVT_USER_MEM_RELEASE
+};
+
+typedef struct
+{
+    uint8_t count;
+} ble_evt_tx_complete_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_evt_tx_complete_t tx_complete;
+    } params;
+} ble_common_evt_t;
+
+typedef struct
+{
+    uint16_t evt_id;
+    uint16_t evt_len;
+} ble_evt_hdr_t;
+
+typedef struct
+{
+    ble_evt_hdr_t header;
+    union
+    {
+        ble_common_evt_t common_evt;
+        ble_gap_evt_t    gap_evt;
+        ble_gatts_evt_t  gatts_evt;
+    } evt;
+} ble_evt_t;
+
+typedef struct
+{
+    ble_gatts_enable_params_t gatts_enable_params;
+} ble_enable_params_t;
+
+uint32_t sd_ble_enable(ble_enable_params_t * p_ble_enable_params);
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * p_vs_uuid, uint8_t * p_uuid_type);
+uint32_t sd_ble_uuid_encode(ble_uuid_t const * p_uuid, uint8_t * p_uuid_le_len, uint8_t * p_uuid_le);
+uint32_t sd_ble_tx_buffer_count_get(uint8_t * p_count);
+
+#endif // BLE_H__
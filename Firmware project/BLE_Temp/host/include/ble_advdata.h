@@ -0,0 +1,65 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 header of the same name. */
+#ifndef BLE_ADVDATA_H__
+#define BLE_ADVDATA_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "app_util.h"
+
+typedef enum
+{
+    BLE_ADVDATA_NO_NAME,
+    BLE_ADVDATA_SHORT_NAME,
+    BLE_ADVDATA_FULL_NAME
+} ble_advdata_name_type_t;
+
+typedef struct
+{
+    uint16_t    uuid_cnt;
+    ble_uuid_t *p_uuids;
+} ble_advdata_uuid_list_t;
+
+typedef struct
+{
+    uint16_t min_conn_interval;
+    uint16_t max_conn_interval;
+} ble_advdata_conn_int_t;
+
+typedef struct
+{
+    uint16_t  size;
+    uint8_t * p_data;
+} uint8_array_t;
+
+typedef struct
+{
+    uint16_t      company_identifier;
+    uint8_array_t data;
+} ble_advdata_manuf_data_t;
+
+typedef struct
+{
+    uint16_t      service_uuid;
+    uint8_array_t data;
+} ble_advdata_service_data_t;
+
+typedef struct
+{
+    ble_advdata_name_type_t      name_type;
+    uint8_t                      short_name_len;
+    bool                         include_appearance;
+    uint8_t                      flags;
+    int8_t *                     p_tx_power_level;
+    ble_advdata_uuid_list_t      uuids_more_available;
+    ble_advdata_uuid_list_t      uuids_complete;
+    ble_advdata_uuid_list_t      uuids_solicited;
+    ble_advdata_conn_int_t *     p_slave_conn_int;
+    ble_advdata_manuf_data_t *   p_manuf_specific_data;
+    ble_advdata_service_data_t * p_service_data_array;
+    uint8_t                      service_data_count;
+} ble_advdata_t;
+
+uint32_t ble_advdata_set(const ble_advdata_t * p_advdata, const ble_advdata_t * p_srdata);
+
+#endif // BLE_ADVDATA_H__
@@ -0,0 +1,50 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 Battery Service. */
+#ifndef BLE_BAS_H__
+#define BLE_BAS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+
+typedef enum
+{
+    BLE_BAS_EVT_NOTIFICATION_ENABLED,
+    BLE_BAS_EVT_NOTIFICATION_DISABLED
+} ble_bas_evt_type_t;
+
+typedef struct
+{
+    ble_bas_evt_type_t evt_type;
+} ble_bas_evt_t;
+
+typedef struct ble_bas_s ble_bas_t;
+
+typedef void (*ble_bas_evt_handler_t) (ble_bas_t * p_bas, ble_bas_evt_t * p_evt);
+
+typedef struct
+{
+    ble_bas_evt_handler_t         evt_handler;
+    bool                          support_notification;
+    ble_srv_report_ref_t *        p_report_ref;
+    uint8_t                       initial_batt_level;
+    ble_srv_cccd_security_mode_t  battery_level_char_attr_md;
+    ble_gap_conn_sec_mode_t       battery_level_report_read_perm;
+} ble_bas_init_t;
+
+struct ble_bas_s
+{
+    ble_bas_evt_handler_t         evt_handler;
+    uint16_t                      service_handle;
+    ble_gatts_char_handles_t      battery_level_handles;
+    uint16_t                      report_ref_handle;
+    uint8_t                       battery_level_last;
+    uint16_t                      conn_handle;
+    bool                          is_notification_supported;
+};
+
+uint32_t ble_bas_init(ble_bas_t * p_bas, const ble_bas_init_t * p_bas_init);
+void     ble_bas_on_ble_evt(ble_bas_t * p_bas, ble_evt_t * p_ble_evt);
+uint32_t ble_bas_battery_level_update(ble_bas_t * p_bas, uint8_t battery_level);
+
+#endif // BLE_BAS_H__
@@ -0,0 +1,24 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 Device Information Service. */
+#ifndef BLE_DIS_H__
+#define BLE_DIS_H__
+
+#include <stdint.h>
+#include "ble_srv_common.h"
+
+typedef struct
+{
+    ble_srv_utf8_str_t      manufact_name_str;
+    ble_srv_utf8_str_t      model_num_str;
+    ble_srv_utf8_str_t      serial_num_str;
+    ble_srv_utf8_str_t      hw_rev_str;
+    ble_srv_utf8_str_t      fw_rev_str;
+    ble_srv_utf8_str_t      sw_rev_str;
+    void *                  p_sys_id;
+    void *                  p_reg_cert_data_list;
+    void *                  p_pnp_id;
+    ble_srv_security_mode_t dis_attr_md;
+} ble_dis_init_t;
+
+uint32_t ble_dis_init(const ble_dis_init_t * p_dis_init);
+
+#endif // BLE_DIS_H__
@@ -0,0 +1,165 @@
+/* Host simulation shim of the S110 v8.0.0 header of the same name. */
+#ifndef BLE_GAP_H__
+#define BLE_GAP_H__
+
+#include <stdint.h>
+#include "ble_types.h"
+
+enum BLE_GAP_EVTS
+{
+    BLE_GAP_EVT_CONNECTED = 0x10,
+    BLE_GAP_EVT_DISCONNECTED,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE,
+    BLE_GAP_EVT_SEC_PARAMS_REQUEST,
+    BLE_GAP_EVT_SEC_INFO_REQUEST,
+    BLE_GAP_EVT_PASSKEY_DISPLAY,
+    BLE_GAP_EVT_AUTH_KEY_REQUEST,
+    BLE_GAP_EVT_AUTH_STATUS,
+    BLE_GAP_EVT_CONN_SEC_UPDATE,
+    BLE_GAP_EVT_TIMEOUT,
+    BLE_GAP_EVT_RSSI_CHANGED,
+    BLE_GAP_EVT_ADV_REPORT,
+    BLE_GAP_EVT_SEC_REQUEST,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST,
+    BLE_GAP_EVT_SCAN_REQ_REPORT
+};
+
+#define BLE_GAP_ADV_TYPE_ADV_IND         0x00
+#define BLE_GAP_ADV_TYPE_ADV_DIRECT_IND  0x01
+#define BLE_GAP_ADV_TYPE_ADV_SCAN_IND    0x02
+#define BLE_GAP_ADV_TYPE_ADV_NONCONN_IND 0x03
+
+#define BLE_GAP_ADV_FP_ANY               0x00
+
+#define BLE_GAP_ADV_INTERVAL_MIN         0x0020
+#define BLE_GAP_ADV_INTERVAL_MAX         0x4000
+#define BLE_GAP_ADV_TIMEOUT_LIMITED_MAX  180
+#define BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED 0
+
+#define BLE_GAP_ADV_MAX_SIZE             31
+
+#define BLE_GAP_AD_TYPE_FLAGS                               0x01
+#define BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE         0x03
+#define BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE        0x07
+#define BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME                    0x08
+#define BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME                 0x09
+#define BLE_GAP_AD_TYPE_TX_POWER_LEVEL                      0x0A
+#define BLE_GAP_AD_TYPE_SERVICE_DATA                        0x16
+#define BLE_GAP_AD_TYPE_APPEARANCE                          0x19
+#define BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA          0xFF
+
+#define BLE_GAP_ADV_FLAG_LE_LIMITED_DISC_MODE   (0x01)
+#define BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE   (0x02)
+#define BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED   (0x04)
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE (BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE | BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED)
+
+#define BLE_GAP_TIMEOUT_SRC_ADVERTISING  0x00
+#define BLE_GAP_TIMEOUT_SRC_SECURITY_REQUEST 0x01
+#define BLE_GAP_TIMEOUT_SRC_SCAN         0x02
+#define BLE_GAP_TIMEOUT_SRC_CONN         0x03
+
+#define BLE_GAP_IO_CAPS_DISPLAY_ONLY     0x00
+#define BLE_GAP_IO_CAPS_DISPLAY_YESNO    0x01
+#define BLE_GAP_IO_CAPS_KEYBOARD_ONLY    0x02
+#define BLE_GAP_IO_CAPS_NONE             0x03
+#define BLE_GAP_IO_CAPS_KEYBOARD_DISPLAY 0x04
+
+#define BLE_GAP_CP_MIN_CONN_INTVL_MIN    0x0006
+#define BLE_GAP_CP_MAX_CONN_INTVL_MAX    0x0C80
+#define BLE_GAP_CP_SLAVE_LATENCY_MAX     0x01F3
+
+typedef struct
+{
+    uint8_t sm : 4;
+    uint8_t lv : 4;
+} ble_gap_conn_sec_mode_t;
+
+#define BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(ptr)  do {(ptr)->sm = 0; (ptr)->lv = 0;} while(0)
+#define BLE_GAP_CONN_SEC_MODE_SET_OPEN(ptr)       do {(ptr)->sm = 1; (ptr)->lv = 1;} while(0)
+#define BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(ptr) do {(ptr)->sm = 1; (ptr)->lv = 2;} while(0)
+
+typedef struct
+{
+    uint16_t min_conn_interval;
+    uint16_t max_conn_interval;
+    uint16_t slave_latency;
+    uint16_t conn_sup_timeout;
+} ble_gap_conn_params_t;
+
+typedef struct
+{
+    uint8_t addr_type;
+    uint8_t addr[6];
+} ble_gap_addr_t;
+
+typedef struct
+{
+    uint8_t                 type;
+    ble_gap_addr_t        * p_peer_addr;
+    uint8_t                 fp;
+    void                  * p_whitelist;
+    uint16_t                interval;
+    uint16_t                timeout;
+    uint8_t                 channel_mask;
+} ble_gap_adv_params_t;
+
+typedef struct
+{
+    uint8_t bond         : 1;
+    uint8_t mitm         : 1;
+    uint8_t io_caps      : 3;
+    uint8_t oob          : 1;
+    uint8_t min_key_size;
+    uint8_t max_key_size;
+} ble_gap_sec_params_t;
+
+typedef struct
+{
+    ble_gap_addr_t        peer_addr;
+    ble_gap_addr_t        own_addr;
+    uint8_t               irk_match :1;
+    uint8_t               irk_match_idx  :7;
+    ble_gap_conn_params_t conn_params;
+} ble_gap_evt_connected_t;
+
+typedef struct
+{
+    uint8_t reason;
+} ble_gap_evt_disconnected_t;
+
+typedef struct
+{
+    ble_gap_conn_params_t conn_params;
+} ble_gap_evt_conn_param_update_t;
+
+typedef struct
+{
+    uint8_t src;
+} ble_gap_evt_timeout_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_gap_evt_connected_t         connected;
+        ble_gap_evt_disconnected_t      disconnected;
+        ble_gap_evt_conn_param_update_t conn_param_update;
+        ble_gap_evt_timeout_t           timeout;
+    } params;
+} ble_gap_evt_t;
+
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const * p_write_perm, uint8_t const * p_dev_name, uint16_t len);
+uint32_t sd_ble_gap_device_name_get(uint8_t * p_dev_name, uint16_t * p_len);
+uint32_t sd_ble_gap_appearance_set(uint16_t appearance);
+uint32_t sd_ble_gap_appearance_get(uint16_t * p_appearance);
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const * p_conn_params);
+uint32_t sd_ble_gap_ppcp_get(ble_gap_conn_params_t * p_conn_params);
+uint32_t sd_ble_gap_tx_power_set(int8_t tx_power);
+uint32_t sd_ble_gap_adv_data_set(uint8_t const * p_data, uint8_t dlen, uint8_t const * p_sr_data, uint8_t srdlen);
+uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const * p_adv_params);
+uint32_t sd_ble_gap_adv_stop(void);
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const * p_conn_params);
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code);
+
+#endif // BLE_GAP_H__
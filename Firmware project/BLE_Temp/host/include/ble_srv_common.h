@@ -0,0 +1,58 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 header of the same name. */
+#ifndef BLE_SRV_COMMON_H__
+#define BLE_SRV_COMMON_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "app_util.h"
+
+#define BLE_UUID_BATTERY_SERVICE                0x180F
+#define BLE_UUID_DEVICE_INFORMATION_SERVICE     0x180A
+#define BLE_UUID_CURRENT_TIME_SERVICE           0x1805
+
+#define BLE_UUID_BATTERY_LEVEL_CHAR             0x2A19
+#define BLE_UUID_CURRENT_TIME_CHAR              0x2A2B
+#define BLE_UUID_MANUFACTURER_NAME_STRING_CHAR  0x2A29
+#define BLE_UUID_MODEL_NUMBER_STRING_CHAR       0x2A24
+#define BLE_UUID_FIRMWARE_REVISION_STRING_CHAR  0x2A26
+#define BLE_UUID_SOFTWARE_REVISION_STRING_CHAR  0x2A28
+
+#define BLE_CCCD_VALUE_LEN 2
+
+typedef void (*ble_srv_error_handler_t) (uint32_t nrf_error);
+
+typedef struct
+{
+    ble_gap_conn_sec_mode_t read_perm;
+    ble_gap_conn_sec_mode_t write_perm;
+} ble_srv_security_mode_t;
+
+typedef struct
+{
+    ble_gap_conn_sec_mode_t cccd_write_perm;
+    ble_gap_conn_sec_mode_t read_perm;
+    ble_gap_conn_sec_mode_t write_perm;
+} ble_srv_cccd_security_mode_t;
+
+typedef struct
+{
+    uint16_t  length;
+    uint8_t * p_str;
+} ble_srv_utf8_str_t;
+
+typedef struct
+{
+    uint8_t report_id;
+    uint8_t report_type;
+} ble_srv_report_ref_t;
+
+void ble_srv_ascii_to_utf8(ble_srv_utf8_str_t * p_utf8, char * p_ascii);
+
+static inline bool ble_srv_is_notification_enabled(uint8_t const * p_encoded_data)
+{
+    uint16_t cccd_value = uint16_decode(p_encoded_data);
+    return ((cccd_value & BLE_GATT_HVX_NOTIFICATION) != 0);
+}
+
+#endif // BLE_SRV_COMMON_H__
@@ -0,0 +1,36 @@
+/* Host simulation shim of the S110 v8.0.0 header of the same name. */
+#ifndef BLE_TYPES_H__
+#define BLE_TYPES_H__
+
+#include <stdint.h>
+#include "nrf_error.h"
+
+#define BLE_CONN_HANDLE_INVALID 0xFFFF
+#define BLE_CONN_HANDLE_ALL     0xFFFE
+
+#define BLE_UUID_TYPE_UNKNOWN       0x00
+#define BLE_UUID_TYPE_BLE           0x01
+#define BLE_UUID_TYPE_VENDOR_BEGIN  0x02
+
+#define BLE_ERROR_NOT_ENABLED             (0x3001)
+#define BLE_ERROR_INVALID_CONN_HANDLE     (0x3002)
+#define BLE_ERROR_INVALID_ATTR_HANDLE     (0x3003)
+#define BLE_ERROR_NO_TX_BUFFERS           (0x3004)
+#define BLE_ERROR_GATTS_INVALID_ATTR_TYPE (0x3400)
+#define BLE_ERROR_GATTS_SYS_ATTR_MISSING  (0x3401)
+
+#define BLE_APPEARANCE_UNKNOWN            0
+#define BLE_APPEARANCE_GENERIC_THERMOMETER 768
+
+typedef struct
+{
+    uint8_t uuid128[16];
+} ble_uuid128_t;
+
+typedef struct
+{
+    uint16_t uuid;
+    uint8_t  type;
+} ble_uuid_t;
+
+#endif // BLE_TYPES_H__
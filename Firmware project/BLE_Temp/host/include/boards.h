@@ -0,0 +1,7 @@
+/* Host simulation shim: the RTemp board has no BSP definitions in use. */
+#ifndef BOARDS_H
+#define BOARDS_H
+
+#include "nrf_gpio.h"
+
+#endif // BOARDS_H
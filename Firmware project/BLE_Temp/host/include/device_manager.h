@@ -0,0 +1,63 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 device manager.
+ *
+ * Bonding is disabled in RTemp, so only the registration surface exists.
+ */
+#ifndef DEVICE_MANAGER_H__
+#define DEVICE_MANAGER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nordic_common.h"
+#include "ble.h"
+#include "ble_gap.h"
+#include "device_manager_cnfg.h"
+
+#define DM_PROTOCOL_CNTXT_NONE         0x00
+#define DM_PROTOCOL_CNTXT_GATT_SRVR_ID 0x01
+#define DM_PROTOCOL_CNTXT_GATT_CLI_ID  0x02
+#define DM_PROTOCOL_CNTXT_ALL          (DM_PROTOCOL_CNTXT_GATT_SRVR_ID | DM_PROTOCOL_CNTXT_GATT_CLI_ID)
+
+#define DM_EVT_CONNECTION              0x11
+#define DM_EVT_DISCONNECTION           0x12
+#define DM_EVT_SECURITY_SETUP          0x13
+#define DM_EVT_SECURITY_SETUP_COMPLETE 0x14
+#define DM_EVT_LINK_SECURED            0x15
+
+typedef uint8_t dm_application_instance_t;
+
+typedef struct
+{
+    uint8_t  appl_id;
+    uint8_t  connection_id;
+    uint8_t  device_id;
+    uint8_t  service_id;
+} dm_handle_t;
+
+typedef struct
+{
+    uint8_t  event_id;
+    uint16_t event_paramlen;
+} dm_event_t;
+
+typedef uint32_t (*dm_event_cb_t)(dm_handle_t const * p_handle,
+                                  dm_event_t const  * p_event,
+                                  ret_code_t        event_result);
+
+typedef struct
+{
+    bool clear_persistent_data;
+} dm_init_param_t;
+
+typedef struct
+{
+    ble_gap_sec_params_t sec_param;
+    dm_event_cb_t        evt_handler;
+    uint8_t              service_type;
+} dm_application_param_t;
+
+ret_code_t dm_init(dm_init_param_t const * p_init_param);
+ret_code_t dm_register(dm_application_instance_t    * p_appl_instance,
+                       dm_application_param_t const * p_appl_param);
+ret_code_t dm_ble_evt_handler(ble_evt_t * p_ble_evt);
+
+#endif // DEVICE_MANAGER_H__
@@ -0,0 +1,48 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 header of the same name.
+ *
+ * Only the subset used by the RTemp firmware is provided.
+ */
+#ifndef NORDIC_COMMON_H__
+#define NORDIC_COMMON_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+
+#define UNUSED_VARIABLE(X)  ((void)(X))
+#define UNUSED_PARAMETER(X) UNUSED_VARIABLE(X)
+
+#define STRINGIFY_(val) #val
+#define STRINGIFY(val)  STRINGIFY_(val)
+
+#define NRF_SUCCESS                       (0)
+#define NRF_ERROR_BASE_NUM                (0x0)
+#define NRF_ERROR_SVC_HANDLER_MISSING     (NRF_ERROR_BASE_NUM + 1)
+#define NRF_ERROR_SOFTDEVICE_NOT_ENABLED  (NRF_ERROR_BASE_NUM + 2)
+#define NRF_ERROR_INTERNAL                (NRF_ERROR_BASE_NUM + 3)
+#define NRF_ERROR_NO_MEM                  (NRF_ERROR_BASE_NUM + 4)
+#define NRF_ERROR_NOT_FOUND               (NRF_ERROR_BASE_NUM + 5)
+#define NRF_ERROR_NOT_SUPPORTED           (NRF_ERROR_BASE_NUM + 6)
+#define NRF_ERROR_INVALID_PARAM           (NRF_ERROR_BASE_NUM + 7)
+#define NRF_ERROR_INVALID_STATE           (NRF_ERROR_BASE_NUM + 8)
+#define NRF_ERROR_INVALID_LENGTH          (NRF_ERROR_BASE_NUM + 9)
+#define NRF_ERROR_INVALID_FLAGS           (NRF_ERROR_BASE_NUM + 10)
+#define NRF_ERROR_INVALID_DATA            (NRF_ERROR_BASE_NUM + 11)
+#define NRF_ERROR_DATA_SIZE               (NRF_ERROR_BASE_NUM + 12)
+#define NRF_ERROR_TIMEOUT                 (NRF_ERROR_BASE_NUM + 13)
+#define NRF_ERROR_NULL                    (NRF_ERROR_BASE_NUM + 14)
+#define NRF_ERROR_FORBIDDEN               (NRF_ERROR_BASE_NUM + 15)
+#define NRF_ERROR_INVALID_ADDR            (NRF_ERROR_BASE_NUM + 16)
+#define NRF_ERROR_BUSY                    (NRF_ERROR_BASE_NUM + 17)
+
+typedef uint32_t ret_code_t;
+
+#endif // NORDIC_COMMON_H__
@@ -0,0 +1,139 @@
+/* Host simulation shim of the nRF51 device header.
+ *
+ * Peripherals are plain structs owned by the simulator. The firmware writes
+ * TASKS registers exactly as on the chip; the simulator picks the writes up
+ * when the CPU goes to sleep (see sim_hw.c) and raises the matching IRQ.
+ */
+#ifndef NRF_H
+#define NRF_H
+
+#include <stdint.h>
+#include "nordic_common.h"
+
+#define __INLINE inline
+#define __I  volatile const
+#define __O  volatile
+#define __IO volatile
+
+typedef enum
+{
+    POWER_CLOCK_IRQn      = 0,
+    RADIO_IRQn            = 1,
+    UART0_IRQn            = 2,
+    SPI0_TWI0_IRQn        = 3,
+    SPI1_TWI1_IRQn        = 4,
+    GPIOTE_IRQn           = 6,
+    ADC_IRQn              = 7,
+    TIMER0_IRQn           = 8,
+    TIMER1_IRQn           = 9,
+    TIMER2_IRQn           = 10,
+    RTC0_IRQn             = 11,
+    TEMP_IRQn             = 12,
+    RNG_IRQn              = 13,
+    ECB_IRQn              = 14,
+    CCM_AAR_IRQn          = 15,
+    WDT_IRQn              = 16,
+    RTC1_IRQn             = 17,
+    QDEC_IRQn             = 18,
+    LPCOMP_IRQn           = 19,
+    SWI0_IRQn             = 20,
+    SWI1_IRQn             = 21,
+    SWI2_IRQn             = 22,
+    SWI3_IRQn             = 23,
+    SWI4_IRQn             = 24,
+    SWI5_IRQn             = 25
+} IRQn_Type;
+
+typedef struct
+{
+    __I  uint32_t BUSY;
+    __O  uint32_t TASKS_START;
+    __O  uint32_t TASKS_STOP;
+    __IO uint32_t EVENTS_END;
+    __IO uint32_t INTENSET;
+    __IO uint32_t INTENCLR;
+    __IO uint32_t ENABLE;
+    __IO uint32_t CONFIG;
+    __I  uint32_t RESULT;
+    __IO uint32_t POWER;
+} NRF_ADC_Type;
+
+typedef struct
+{
+    __O  uint32_t TASKS_STARTRX;
+    __O  uint32_t TASKS_STARTTX;
+    __O  uint32_t TASKS_STOP;
+    __O  uint32_t TASKS_SUSPEND;
+    __O  uint32_t TASKS_RESUME;
+    __IO uint32_t EVENTS_STOPPED;
+    __IO uint32_t EVENTS_RXDREADY;
+    __IO uint32_t EVENTS_TXDSENT;
+    __IO uint32_t EVENTS_ERROR;
+    __IO uint32_t EVENTS_BB;
+    __IO uint32_t EVENTS_SUSPENDED;
+    __IO uint32_t SHORTS;
+    __IO uint32_t INTENSET;
+    __IO uint32_t INTENCLR;
+    __IO uint32_t ERRORSRC;
+    __IO uint32_t ENABLE;
+    __IO uint32_t PSELSCL;
+    __IO uint32_t PSELSDA;
+    __I  uint32_t RXD;
+    __IO uint32_t TXD;
+    __IO uint32_t FREQUENCY;
+    __IO uint32_t ADDRESS;
+    __IO uint32_t POWER;
+} NRF_TWI_Type;
+
+/* Only PIN_CNF is modelled as a register; pin levels go through nrf_gpio.h. */
+typedef struct
+{
+    __IO uint32_t PIN_CNF[32];
+} NRF_GPIO_Type;
+
+typedef struct
+{
+    __I  uint32_t CODEPAGESIZE;
+    __I  uint32_t CODESIZE;
+    __I  uint32_t DEVICEID[2];
+    __I  uint32_t DEVICEADDRTYPE;
+    __I  uint32_t DEVICEADDR[2];
+} NRF_FICR_Type;
+
+/* Only the events: the SoftDevice owns the clock tasks, the application reaches the events
+ * through PPI. */
+typedef struct
+{
+    __IO uint32_t EVENTS_HFCLKSTARTED;
+    __IO uint32_t EVENTS_LFCLKSTARTED;
+} NRF_CLOCK_Type;
+
+typedef struct
+{
+    __IO uint32_t CLENR0;
+    __IO uint32_t RBPCONF;
+    __IO uint32_t XTALFREQ;
+    __I  uint32_t FWID;
+    __IO uint32_t BOOTLOADERADDR;
+} NRF_UICR_Type;
+
+extern NRF_ADC_Type   sim_nrf_adc;
+extern NRF_CLOCK_Type sim_nrf_clock;
+extern NRF_TWI_Type  sim_nrf_twi1;
+extern NRF_GPIO_Type sim_nrf_gpio;
+extern NRF_FICR_Type sim_nrf_ficr;
+extern NRF_UICR_Type sim_nrf_uicr;
+
+#define NRF_ADC  (&sim_nrf_adc)
+#define NRF_CLOCK (&sim_nrf_clock)
+#define NRF_TWI1 (&sim_nrf_twi1)
+#define NRF_GPIO (&sim_nrf_gpio)
+#define NRF_FICR (&sim_nrf_ficr)
+#define NRF_UICR (&sim_nrf_uicr)
+
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+void NVIC_SystemReset(void);
+
+#endif // NRF_H
@@ -0,0 +1,65 @@
+/* Host simulation shim: the nRF51 register bit fields used by the firmware. */
+#ifndef NRF51_BITFIELDS_H
+#define NRF51_BITFIELDS_H
+
+#define ADC_INTENSET_END_Pos (0UL)
+#define ADC_INTENSET_END_Msk (0x1UL << ADC_INTENSET_END_Pos)
+
+#define ADC_ENABLE_ENABLE_Disabled (0x00UL)
+#define ADC_ENABLE_ENABLE_Enabled  (0x01UL)
+
+#define ADC_CONFIG_RES_Pos   (0UL)
+#define ADC_CONFIG_RES_Msk   (0x3UL << ADC_CONFIG_RES_Pos)
+#define ADC_CONFIG_RES_8bit  (0x00UL)
+#define ADC_CONFIG_RES_9bit  (0x01UL)
+#define ADC_CONFIG_RES_10bit (0x02UL)
+
+#define ADC_CONFIG_INPSEL_Pos                        (2UL)
+#define ADC_CONFIG_INPSEL_Msk                        (0x7UL << ADC_CONFIG_INPSEL_Pos)
+#define ADC_CONFIG_INPSEL_AnalogInputNoPrescaling    (0x00UL)
+#define ADC_CONFIG_INPSEL_SupplyTwoThirdsPrescaling  (0x05UL)
+#define ADC_CONFIG_INPSEL_SupplyOneThirdPrescaling   (0x06UL)
+
+#define ADC_CONFIG_REFSEL_Pos (5UL)
+#define ADC_CONFIG_REFSEL_Msk (0x3UL << ADC_CONFIG_REFSEL_Pos)
+#define ADC_CONFIG_REFSEL_VBG (0x00UL)
+
+#define TWI_SHORTS_BB_SUSPEND_Msk   (0x1UL << 0)
+#define TWI_SHORTS_BB_STOP_Msk      (0x1UL << 1)
+
+#define TWI_INTENSET_STOPPED_Msk    (0x1UL << 1)
+#define TWI_INTENSET_RXDREADY_Msk   (0x1UL << 2)
+#define TWI_INTENSET_TXDSENT_Msk    (0x1UL << 7)
+#define TWI_INTENSET_ERROR_Msk      (0x1UL << 9)
+#define TWI_INTENSET_BB_Msk         (0x1UL << 14)
+#define TWI_INTENSET_SUSPENDED_Msk  (0x1UL << 18)
+
+#define TWI_ERRORSRC_OVERRUN_Msk    (0x1UL << 0)
+#define TWI_ERRORSRC_ANACK_Msk      (0x1UL << 1)
+#define TWI_ERRORSRC_DNACK_Msk      (0x1UL << 2)
+
+#define TWI_ENABLE_ENABLE_Pos       (0UL)
+#define TWI_ENABLE_ENABLE_Disabled  (0x00UL)
+#define TWI_ENABLE_ENABLE_Enabled   (0x05UL)
+
+#define TWI_FREQUENCY_FREQUENCY_Pos  (0UL)
+#define TWI_FREQUENCY_FREQUENCY_K100 (0x01980000UL)
+#define TWI_FREQUENCY_FREQUENCY_K250 (0x04000000UL)
+#define TWI_FREQUENCY_FREQUENCY_K400 (0x06680000UL)
+
+#define GPIO_PIN_CNF_DIR_Pos        (0UL)
+#define GPIO_PIN_CNF_DIR_Input      (0x0UL)
+#define GPIO_PIN_CNF_DIR_Output     (0x1UL)
+#define GPIO_PIN_CNF_INPUT_Pos      (1UL)
+#define GPIO_PIN_CNF_INPUT_Connect  (0x0UL)
+#define GPIO_PIN_CNF_INPUT_Disconnect (0x1UL)
+#define GPIO_PIN_CNF_PULL_Pos       (2UL)
+#define GPIO_PIN_CNF_PULL_Disabled  (0x0UL)
+#define GPIO_PIN_CNF_PULL_Pullup    (0x3UL)
+#define GPIO_PIN_CNF_DRIVE_Pos      (8UL)
+#define GPIO_PIN_CNF_DRIVE_S0S1     (0x0UL)
+#define GPIO_PIN_CNF_DRIVE_S0D1     (0x6UL)
+#define GPIO_PIN_CNF_SENSE_Pos      (16UL)
+#define GPIO_PIN_CNF_SENSE_Disabled (0x0UL)
+
+#endif // NRF51_BITFIELDS_H
@@ -0,0 +1,15 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 delay HAL.
+ *
+ * Busy-waits advance the simulator's virtual clock with the CPU awake. In
+ * thread mode, interrupts due in the meantime preempt them.
+ */
+#ifndef NRF_DELAY_H
+#define NRF_DELAY_H
+
+#include <stdint.h>
+#include "nrf_gpio.h"
+
+void nrf_delay_us(uint32_t number_of_us);
+void nrf_delay_ms(uint32_t number_of_ms);
+
+#endif // NRF_DELAY_H
@@ -0,0 +1,7 @@
+/* Host simulation shim: error codes live in nordic_common.h. */
+#ifndef NRF_ERROR_H__
+#define NRF_ERROR_H__
+
+#include "nordic_common.h"
+
+#endif // NRF_ERROR_H__
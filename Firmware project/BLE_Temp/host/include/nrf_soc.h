@@ -0,0 +1,65 @@
+/* Host simulation shim of the S110 v8.0.0 SoC library API. */
+#ifndef NRF_SOC_H__
+#define NRF_SOC_H__
+
+#include <stdint.h>
+#include "nrf.h"
+#include "nrf_error.h"
+
+#define NRF_APP_PRIORITY_HIGH 1
+#define NRF_APP_PRIORITY_LOW  3
+
+#define NRF_ERROR_SOC_PPI_INVALID_CHANNEL (0x2000 + 8)
+
+enum NRF_SOC_EVTS
+{
+    NRF_EVT_HFCLKSTARTED,
+    NRF_EVT_POWER_FAILURE_WARNING,
+    NRF_EVT_FLASH_OPERATION_SUCCESS,
+    NRF_EVT_FLASH_OPERATION_ERROR,
+    NRF_EVT_RADIO_BLOCKED,
+    NRF_EVT_RADIO_CANCELED,
+    NRF_EVT_RADIO_SIGNAL_CALLBACK_INVALID_RETURN,
+    NRF_EVT_RADIO_SESSION_IDLE,
+    NRF_EVT_RADIO_SESSION_CLOSED,
+    NRF_EVT_NUMBER_OF_EVTS
+};
+
+enum NRF_RADIO_NOTIFICATION_TYPES
+{
+    NRF_RADIO_NOTIFICATION_TYPE_NONE = 0,
+    NRF_RADIO_NOTIFICATION_TYPE_INT_ON_ACTIVE,
+    NRF_RADIO_NOTIFICATION_TYPE_INT_ON_INACTIVE,
+    NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH
+};
+
+enum NRF_RADIO_NOTIFICATION_DISTANCES
+{
+    NRF_RADIO_NOTIFICATION_DISTANCE_NONE = 0,
+    NRF_RADIO_NOTIFICATION_DISTANCE_800US,
+    NRF_RADIO_NOTIFICATION_DISTANCE_1740US,
+    NRF_RADIO_NOTIFICATION_DISTANCE_2680US,
+    NRF_RADIO_NOTIFICATION_DISTANCE_3620US,
+    NRF_RADIO_NOTIFICATION_DISTANCE_4560US,
+    NRF_RADIO_NOTIFICATION_DISTANCE_5500US
+};
+
+uint32_t sd_app_evt_wait(void);
+uint32_t sd_power_system_off(void);
+uint32_t sd_clock_hfclk_request(void);
+uint32_t sd_clock_hfclk_release(void);
+uint32_t sd_clock_hfclk_is_running(uint32_t * p_is_running);
+uint32_t sd_nvic_SetPriority(IRQn_Type IRQn, uint32_t priority);
+uint32_t sd_nvic_EnableIRQ(IRQn_Type IRQn);
+uint32_t sd_nvic_DisableIRQ(IRQn_Type IRQn);
+uint32_t sd_nvic_ClearPendingIRQ(IRQn_Type IRQn);
+uint32_t sd_nvic_critical_region_enter(uint8_t * p_is_nested_critical_region);
+uint32_t sd_nvic_critical_region_exit(uint8_t is_nested_critical_region);
+uint32_t sd_radio_notification_cfg_set(uint8_t type, uint8_t distance);
+uint32_t sd_ppi_channel_enable_set(uint32_t channel_enable_set_msk);
+uint32_t sd_ppi_channel_enable_clr(uint32_t channel_enable_clr_msk);
+uint32_t sd_ppi_channel_assign(uint8_t channel_num, const volatile void * evt_endpoint, const volatile void * task_endpoint);
+uint32_t sd_flash_write(uint32_t * const p_dst, uint32_t const * const p_src, uint32_t size);
+uint32_t sd_flash_page_erase(uint32_t page_number);
+
+#endif // NRF_SOC_H__
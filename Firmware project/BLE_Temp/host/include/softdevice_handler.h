@@ -0,0 +1,43 @@
+/* Host simulation shim of the nRF51 SDK v9.0.0 SoftDevice handler. */
+#ifndef SOFTDEVICE_HANDLER_H__
+#define SOFTDEVICE_HANDLER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nordic_common.h"
+#include "ble.h"
+#include "nrf_soc.h"
+
+typedef enum
+{
+    NRF_CLOCK_LFCLKSRC_SYNTH_250_PPM,
+    NRF_CLOCK_LFCLKSRC_XTAL_500_PPM,
+    NRF_CLOCK_LFCLKSRC_XTAL_250_PPM,
+    NRF_CLOCK_LFCLKSRC_XTAL_150_PPM,
+    NRF_CLOCK_LFCLKSRC_XTAL_100_PPM,
+    NRF_CLOCK_LFCLKSRC_XTAL_75_PPM,
+    NRF_CLOCK_LFCLKSRC_XTAL_50_PPM,
+    NRF_CLOCK_LFCLKSRC_XTAL_30_PPM,
+    NRF_CLOCK_LFCLKSRC_XTAL_20_PPM,
+    NRF_CLOCK_LFCLKSRC_RC_250_PPM_250MS_CALIBRATION
+} nrf_clock_lfclksrc_t;
+
+typedef uint32_t (*softdevice_evt_schedule_func_t) (void);
+typedef void (*ble_evt_handler_t) (ble_evt_t * p_ble_evt);
+typedef void (*sys_evt_handler_t) (uint32_t evt_id);
+
+uint32_t softdevice_handler_init(nrf_clock_lfclksrc_t           clock_source,
+                                 void *                         p_ble_evt_buffer,
+                                 uint16_t                       ble_evt_buffer_size,
+                                 softdevice_evt_schedule_func_t evt_schedule_func);
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler);
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler);
+
+#define SOFTDEVICE_HANDLER_INIT(CLOCK_SOURCE, EVT_HANDLER)                                          \
+    do                                                                                              \
+    {                                                                                               \
+        uint32_t ERR_CODE = softdevice_handler_init((CLOCK_SOURCE), NULL, 0, (EVT_HANDLER));        \
+        APP_ERROR_CHECK(ERR_CODE);                                                                  \
+    } while (0)
+
+#endif // SOFTDEVICE_HANDLER_H__
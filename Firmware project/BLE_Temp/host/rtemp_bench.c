@@ -0,0 +1,659 @@
+/** @file
+ *
+ * @brief RTemp host bench - equivalence checks and micro-benchmarks of firmware kernels.
+ *
+ * Each kernel that replaces a reference implementation (float conversions,
+ * bitwise CRC, ...) is checked against it over its whole input space and then
+ * timed next to it. The timings are host cycles, so they only show the ratio
+ * between two implementations; on the Cortex-M0 every float operation is a
+ * soft-float library call and the gap is much wider.
+ *
+ *   make bench
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "SHT2x.h"
+#include "compressed_log.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+static uint64_t bench_clock(void)
+{
+    return __rdtsc();
+}
+#else
+#define BENCH_UNIT "ns"
+static uint64_t bench_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+#define BENCH_RAW_CODES     16384           /**< 14 bit raw codes, the two status bits are always masked. */
+#define BENCH_REPEAT        200
+
+static volatile int32_t m_sink;             /**< Keeps the compiler from dropping the timed loops. */
+static bool             m_failed;
+
+/* The bench links the Sensirion sensor layer for its pure functions and answers its bus
+ * transfers from a fixed serial number, so SHT2x_GetSerialNumber can be checked too. */
+static const uint8_t m_serial_snb[4] = { 0x1A, 0x5F, 0x37, 0x2C };    /**< SNB_3 .. SNB_0 */
+static const uint8_t m_serial_snc[2] = { 0x32, 0x01 };                /**< SNC_1, SNC_0 */
+static const uint8_t m_serial_sna[2] = { 0x00, 0x80 };                /**< SNA_1, SNA_0 */
+static int           m_serial_corrupt = -1;                           /**< Response byte to flip, -1 for none. */
+static uint8_t       m_serial_reads;
+
+uint8_t i2c_bus_xfer_sync(const i2c_bus_xfer_t * p_xfer)
+{
+    uint8_t * p_rx = p_xfer->p_rx;
+
+    if ((p_xfer->tx_length != 2) || (p_xfer->p_rx == NULL))
+    {
+        return ACK_ERROR;
+    }
+    if ((p_xfer->p_tx[0] == 0xFA) && (p_xfer->p_tx[1] == 0x0F) && (p_xfer->rx_length == 8))
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            p_rx[2 * i]     = m_serial_snb[i];
+            p_rx[2 * i + 1] = SHT2x_CalcCrcBitwise(&m_serial_snb[i], 1);
+        }
+    }
+    else if ((p_xfer->p_tx[0] == 0xFC) && (p_xfer->p_tx[1] == 0xC9) && (p_xfer->rx_length == 6))
+    {
+        p_rx[0] = m_serial_snc[0];
+        p_rx[1] = m_serial_snc[1];
+        p_rx[2] = SHT2x_CalcCrcBitwise(m_serial_snc, 2);
+        p_rx[3] = m_serial_sna[0];
+        p_rx[4] = m_serial_sna[1];
+        p_rx[5] = SHT2x_CalcCrcBitwise(m_serial_sna, 2);
+    }
+    else
+    {
+        return ACK_ERROR;
+    }
+    if ((m_serial_corrupt >= 0) && (m_serial_corrupt / 8 == m_serial_reads) && (m_serial_corrupt % 8 < p_xfer->rx_length))
+    {
+        p_rx[m_serial_corrupt % 8] ^= 0x10;
+    }
+    m_serial_reads++;
+    return 0;
+}
+
+
+void DelayMicroSeconds(u32t nbrOfUs)
+{
+    (void)nbrOfUs;
+}
+
+
+static void check(const char * p_name, bool ok, const char * p_detail)
+{
+    printf("  %-44s %s%s\n", p_name, ok ? "ok" : "FAIL", p_detail);
+    m_failed |= !ok;
+}
+
+
+/**@brief Rounds half away from zero, on a value that is exact in a double. */
+static long round_half_away(double value)
+{
+    return (value >= 0.0) ? (long)floor(value + 0.5) : -(long)floor(-value + 0.5);
+}
+
+
+/**@brief Integer conversions against the exact result and against the float reference. */
+static void check_conversions(void)
+{
+    unsigned t_exact_mismatch  = 0;
+    unsigned rh_exact_mismatch = 0;
+    unsigned t_float_ties      = 0;
+    unsigned rh_float_ties     = 0;
+    double   t_float_err       = 0.0;
+    double   rh_float_err      = 0.0;
+    char     detail[96];
+
+    for (uint32_t code = 0; code < BENCH_RAW_CODES; code++)
+    {
+        u16t   raw   = (u16t)(code << 2);
+        i16t   t     = SHT2x_CalcTemperatureCentiC(raw);
+        i16t   rh    = SHT2x_CalcRHCenti(raw);
+        double t_ex  = -4685.0 + 17572.0 * raw / 65536.0;   // Exact: every step is representable
+        double rh_ex = -600.0 + 12500.0 * raw / 65536.0;
+        double t_fl  = 100.0 * SHT2x_CalcTemperatureC(raw);
+        double rh_fl = 100.0 * SHT2x_CalcRH(raw);
+
+        t_exact_mismatch  += (t != round_half_away(t_ex));
+        rh_exact_mismatch += (rh != round_half_away(rh_ex));
+        t_float_ties      += (t != round_half_away(t_fl));
+        rh_float_ties     += (rh != round_half_away(rh_fl));
+        t_float_err        = fmax(t_float_err, fabs(t - t_fl));
+        rh_float_err       = fmax(rh_float_err, fabs(rh - rh_fl));
+    }
+
+    snprintf(detail, sizeof(detail), " (%u of %u codes differ)", t_exact_mismatch, BENCH_RAW_CODES);
+    check("T centi-C == round(exact)", t_exact_mismatch == 0, detail);
+    snprintf(detail, sizeof(detail), " (%u of %u codes differ)", rh_exact_mismatch, BENCH_RAW_CODES);
+    check("RH centi-% == round(exact)", rh_exact_mismatch == 0, detail);
+
+    // The float reference itself is off by up to ~1e-4 centi-units, so it can only round
+    // differently where the exact value is within that of a .5 tie.
+    snprintf(detail, sizeof(detail), " (max %.5f, %u ties rounded differently)", t_float_err, t_float_ties);
+    check("T |centi-C - 100 * float| <= 0.5", t_float_err <= 0.5 + 1e-3, detail);
+    snprintf(detail, sizeof(detail), " (max %.5f, %u ties rounded differently)", rh_float_err, rh_float_ties);
+    check("RH |centi-% - 100 * float| <= 0.5", rh_float_err <= 0.5 + 1e-3, detail);
+}
+
+
+typedef u8t (*crc_fn_t)(const u8t data[], u8t nbrOfBytes);
+
+static const struct
+{
+    const char * p_name;
+    crc_fn_t     fn;
+} m_crc_impl[] =
+{
+    { "SHT2x_CalcCrcBitwise", SHT2x_CalcCrcBitwise },
+    { "SHT2x_CalcCrcTable",   SHT2x_CalcCrcTable   },
+    { "SHT2x_CalcCrcNibble",  SHT2x_CalcCrcNibble  },
+};
+
+#define CRC_IMPL_COUNT  (sizeof(m_crc_impl) / sizeof(m_crc_impl[0]))
+#define CRC_RANDOM_RUNS 100000
+
+/**@brief Table and nibble CRC against the bitwise one on every 1 and 2 byte input, plus random
+ *        longer inputs and the examples from the Sensirion CRC application note. */
+static void check_crc(void)
+{
+    static const struct { u8t data[2]; u8t len; u8t crc; } vectors[] =
+    {
+        { { 0xDC, 0x00 }, 1, 0x79 },
+        { { 0x68, 0x3A }, 2, 0x7C },
+        { { 0x4E, 0x85 }, 2, 0x6B },
+    };
+    uint32_t seed = 12345;
+    char     detail[96];
+
+    for (unsigned v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++)
+    {
+        for (unsigned i = 0; i < CRC_IMPL_COUNT; i++)
+        {
+            bool ok = (m_crc_impl[i].fn(vectors[v].data, vectors[v].len) == vectors[v].crc);
+
+            snprintf(detail, sizeof(detail), "%s example %u", m_crc_impl[i].p_name, v);
+            check(detail, ok, "");
+        }
+    }
+
+    for (unsigned i = 1; i < CRC_IMPL_COUNT; i++)
+    {
+        unsigned mismatches = 0;
+        u8t      data[16];
+
+        for (uint32_t x = 0; x < 0x10000; x++)
+        {
+            data[0] = (u8t)(x >> 8);
+            data[1] = (u8t)x;
+            mismatches += (m_crc_impl[i].fn(&data[1], 1) != SHT2x_CalcCrcBitwise(&data[1], 1));
+            mismatches += (m_crc_impl[i].fn(data, 2) != SHT2x_CalcCrcBitwise(data, 2));
+            mismatches += (SHT2x_CheckCrc(data, 2, SHT2x_CalcCrcBitwise(data, 2)) != 0);
+        }
+        for (uint32_t run = 0; run < CRC_RANDOM_RUNS; run++)
+        {
+            u8t len = (u8t)(run % sizeof(data));
+
+            for (u8t b = 0; b < len; b++)
+            {
+                seed    = seed * 1103515245UL + 12345UL;
+                data[b] = (u8t)(seed >> 16);
+            }
+            mismatches += (m_crc_impl[i].fn(data, len) != SHT2x_CalcCrcBitwise(data, len));
+        }
+        snprintf(detail, sizeof(detail), "%s == bitwise", m_crc_impl[i].p_name);
+        snprintf(detail + 48, sizeof(detail) - 48, " (%u mismatches)", mismatches);
+        check(detail, mismatches == 0, detail + 48);
+    }
+}
+
+
+/**@brief SHT2x_GetSerialNumber accepts a clean readout and rejects every single corrupted byte. */
+static void check_serial_number(void)
+{
+    static const uint8_t expected[8] = { 0x01, 0x32, 0x2C, 0x37, 0x5F, 0x1A, 0x80, 0x00 };
+    u8t      serial[8];
+    unsigned missed = 0;
+    char     detail[64];
+    u8t      error;
+
+    m_serial_corrupt = -1;
+    m_serial_reads   = 0;
+    error            = SHT2x_GetSerialNumber(serial);
+    check("serial number read and CRCs accepted", (error == 0) && (memcmp(serial, expected, 8) == 0), "");
+
+    for (int corrupt = 0; corrupt < 8 + 6; corrupt++)
+    {
+        m_serial_corrupt = corrupt;          // 0..7 first readout, 8..13 second
+        m_serial_reads   = 0;
+        missed          += (SHT2x_GetSerialNumber(serial) != CHECKSUM_ERROR);
+    }
+    m_serial_corrupt = -1;
+    snprintf(detail, sizeof(detail), " (%u of 14 corrupted bytes missed)", missed);
+    check("serial number CRC errors detected", missed == 0, detail);
+}
+
+
+#define CLOG_RANDOM_APPENDS     20000
+#define CLOG_TRACE_DAYS         30
+#define CLOG_LOG_PERIOD_S       (31 * 30)  /**< LOGGING_INTERVAL + 1 measurements of MEASUREMENT_INTERVAL. */
+#define CLOG_LEGACY_ENTRIES     254        /**< LOG_SIZE - 1 */
+
+#define CLOG_TIME_BASE          1476748800UL  /**< 2016-10-18 00:00 UTC */
+
+static compressed_log_sample_t m_clog_appended[CLOG_RANDOM_APPENDS];
+static uint32_t                m_clog_times[CLOG_RANDOM_APPENDS];
+
+/**@brief Sets a sample without a range: a slot of one reading. */
+static void clog_plain(compressed_log_sample_t * p_sample, int16_t temperature, uint8_t humidity)
+{
+    p_sample->temperature     = temperature;
+    p_sample->temperature_min = temperature;
+    p_sample->temperature_max = temperature;
+    p_sample->humidity        = humidity;
+    p_sample->humidity_min    = humidity;
+    p_sample->humidity_max    = humidity;
+}
+
+/**@brief Decodes the whole compressed log and counts the samples that differ from the newest
+ *        ones appended, ranges included, or that the block header puts more than COMPRESSED_LOG_TIME_TOLERANCE
+ *        away from their time. Blocks are checked for sequence numbers without gaps as well. */
+static unsigned clog_mismatches(const compressed_log_sample_t * p_appended, const uint32_t * p_times, uint32_t appended)
+{
+    static compressed_log_sample_t samples[COMPRESSED_LOG_MAX_SAMPLES];
+    uint32_t held       = compressed_log_sample_count();
+    uint32_t k          = appended - held;
+    unsigned mismatches = (held > appended);
+
+    for (uint16_t b = 0; (b < compressed_log_block_count()) && !mismatches; b++)
+    {
+        const compressed_log_block_t * p_block = compressed_log_block_get(b);
+        uint8_t                        n       = compressed_log_decode(p_block, samples);
+
+        mismatches += (n != p_block->count);
+        mismatches += (b > 0) && (p_block->seq != (uint16_t)(compressed_log_block_get(b - 1)->seq + 1));
+        for (uint8_t i = 0; i < n; i++, k++)
+        {
+            int32_t time_error = (int32_t)(p_block->time + (uint32_t)i * p_block->interval - p_times[k]);
+
+            mismatches += (samples[i].temperature != p_appended[k].temperature) ||
+                          (samples[i].humidity != p_appended[k].humidity) ||
+                          (samples[i].temperature_min != p_appended[k].temperature_min) ||
+                          (samples[i].temperature_max != p_appended[k].temperature_max) ||
+                          (samples[i].humidity_min != p_appended[k].humidity_min) ||
+                          (samples[i].humidity_max != p_appended[k].humidity_max) ||
+                          (time_error > COMPRESSED_LOG_TIME_TOLERANCE) || (time_error < -COMPRESSED_LOG_TIME_TOLERANCE);
+        }
+    }
+    return mismatches;
+}
+
+
+/**@brief Appends a random walk and decodes the log after every sample. Each run mixes code
+ *        lengths differently, the last one includes steps too large for any code. The clock
+ *        is stepped now and then, by less or more than the tolerance, and the interval changes. */
+static void check_compressed_log_random(void)
+{
+    static const int32_t t_steps[] = { 2, 20, 200, 4000 };
+    uint32_t seed = 4242;
+    char     detail[64];
+
+    for (unsigned r = 0; r < sizeof(t_steps) / sizeof(t_steps[0]); r++)
+    {
+        int32_t  t          = 200;
+        int32_t  h          = 40;
+        uint32_t time       = CLOG_TIME_BASE;
+        uint16_t interval   = CLOG_LOG_PERIOD_S;
+        unsigned mismatches = 0;
+
+        compressed_log_init();
+        for (uint32_t i = 0; i < CLOG_RANDOM_APPENDS; i++)
+        {
+            seed = seed * 1103515245UL + 12345UL;
+            if (((seed >> 4) & 0x3F) == 0)
+            {
+                time += (seed >> 10) % 11 - 5;
+            }
+            if (((seed >> 20) & 0xFF) == 0)
+            {
+                interval = (interval == CLOG_LOG_PERIOD_S) ? 60 : CLOG_LOG_PERIOD_S;
+            }
+            time += interval;
+            t   += (int32_t)((seed >> 8) % (2 * t_steps[r] + 1)) - t_steps[r];
+            t    = (t > INT16_MAX) ? INT16_MAX : (t < INT16_MIN) ? INT16_MIN : t;
+            h    = ((seed >> 28) == 0) ? (int32_t)((seed >> 16) & 0xFF)
+                                       : h + (int32_t)((seed >> 24) % 3) - 1;
+            h    = (h > UINT8_MAX) ? UINT8_MAX : (h < 0) ? 0 : h;
+
+            clog_plain(&m_clog_appended[i], (int16_t)t, (uint8_t)h);
+            m_clog_times[i] = time;
+            compressed_log_append(time, interval, &m_clog_appended[i]);
+            mismatches += clog_mismatches(m_clog_appended, m_clog_times, i + 1);
+        }
+        snprintf(detail, sizeof(detail), "round trip, random walk +-%d", (int)t_steps[r]);
+        snprintf(detail + 40, sizeof(detail) - 40, " (%u mismatches)", mismatches);
+        check(detail, mismatches == 0, detail + 40);
+    }
+}
+
+
+/**@brief Every temperature step up to +-110 C against every humidity step, each as the second
+ *        sample of a log, so all code lengths and both escapes are covered. */
+static void check_compressed_log_steps(void)
+{
+    unsigned mismatches = 0;
+    char     detail[64];
+
+    for (int32_t dt = -1100; dt <= 1100; dt++)
+    {
+        for (int32_t h = 0; h <= UINT8_MAX; h++)
+        {
+            clog_plain(&m_clog_appended[0], 0, 128);
+            clog_plain(&m_clog_appended[1], (int16_t)dt, (uint8_t)h);
+            m_clog_times[0] = CLOG_TIME_BASE;
+            m_clog_times[1] = CLOG_TIME_BASE + CLOG_LOG_PERIOD_S;
+            compressed_log_init();
+            compressed_log_append(m_clog_times[0], CLOG_LOG_PERIOD_S, &m_clog_appended[0]);
+            compressed_log_append(m_clog_times[1], CLOG_LOG_PERIOD_S, &m_clog_appended[1]);
+            mismatches += clog_mismatches(m_clog_appended, m_clog_times, 2);
+        }
+    }
+    snprintf(detail, sizeof(detail), " (%u mismatches)", mismatches);
+    check("round trip, all steps", mismatches == 0, detail);
+}
+
+
+/**@brief Random walk with a random range on three samples in four, every code length of each of
+ *        the four distances, so ranged and plain blocks follow each other. Decoded after every
+ *        sample. */
+static void check_compressed_log_ranges(void)
+{
+    static const uint16_t t_ranges[] = { 3, 11, 2048 };
+    static const uint16_t h_ranges[] = { 3, 128 };
+    uint32_t seed       = 1717;
+    int32_t  t          = 200;
+    int32_t  h          = 40;
+    unsigned mismatches = 0;
+    char     detail[64];
+
+    compressed_log_init();
+    for (uint32_t i = 0; i < CLOG_RANDOM_APPENDS; i++)
+    {
+        compressed_log_sample_t * p_sample = &m_clog_appended[i];
+
+        seed = seed * 1103515245UL + 12345UL;
+        t   += (int32_t)((seed >> 8) % 41) - 20;
+        t    = (t > 3000) ? 3000 : (t < -3000) ? -3000 : t;
+        h    = (h + (int32_t)((seed >> 24) % 5) - 2) & 0x3F;
+        clog_plain(p_sample, (int16_t)t, (uint8_t)(h + 64));
+        if (((seed >> 4) & 0x3) != 0)
+        {
+            seed = seed * 1103515245UL + 12345UL;
+            p_sample->temperature_min -= (int16_t)((seed >> 4) % t_ranges[(seed >> 16) % 3]);
+            p_sample->temperature_max += (int16_t)((seed >> 8) % t_ranges[(seed >> 18) % 3]);
+            p_sample->humidity_min    -= (uint8_t)((seed >> 12) % (p_sample->humidity < h_ranges[(seed >> 20) % 2] ? 1 : h_ranges[(seed >> 20) % 2]));
+            p_sample->humidity_max    += (uint8_t)((seed >> 24) % h_ranges[(seed >> 22) % 2]);
+        }
+        m_clog_times[i] = CLOG_TIME_BASE + i * CLOG_LOG_PERIOD_S;
+        compressed_log_append(m_clog_times[i], CLOG_LOG_PERIOD_S, p_sample);
+        mismatches += clog_mismatches(m_clog_appended, m_clog_times, i + 1);
+    }
+    snprintf(detail, sizeof(detail), " (%u mismatches)", mismatches);
+    check("round trip, random ranges", mismatches == 0, detail);
+}
+
+
+/**@brief Indoor-like trace: a daily swing plus a slow drift and sensor noise, one sample per log period. */
+static void clog_trace_sample(uint32_t i, compressed_log_sample_t * p_sample, uint32_t * p_seed)
+{
+    double hours = (double)i * CLOG_LOG_PERIOD_S / 3600.0;
+    double day   = 2.0 * M_PI * hours / 24.0;
+
+    *p_seed = *p_seed * 1103515245UL + 12345UL;
+    clog_plain(p_sample,
+               (int16_t)lround(10.0 * (21.0 + 2.5 * sin(day) + 0.8 * sin(day / 7.0)) + (double)((*p_seed >> 16) % 3) - 1.0),
+               (uint8_t)lround(45.0 - 6.0 * sin(day) + 3.0 * sin(day / 5.0)));
+}
+
+/**@brief The indoor trace as slot means, with the spread of the readings around them: noise most
+ *        of the time, a window opened or a shower now and then. */
+static void clog_trace_slot(uint32_t i, compressed_log_sample_t * p_sample, uint32_t * p_seed)
+{
+    clog_trace_sample(i, p_sample, p_seed);
+    *p_seed = *p_seed * 1103515245UL + 12345UL;
+    p_sample->temperature_min -= (int16_t)((*p_seed >> 8) % 3);
+    p_sample->temperature_max += (int16_t)((*p_seed >> 10) % 3);
+    p_sample->humidity_min    -= (uint8_t)((*p_seed >> 12) % 2);
+    p_sample->humidity_max    += (uint8_t)((*p_seed >> 13) % 2);
+    if (((*p_seed >> 16) % 48) == 0)
+    {
+        p_sample->temperature_min -= 40;
+        p_sample->humidity_max    += 20;
+    }
+}
+
+
+/**@brief Samples stamped with the time since reset, then the clock is set: every block moves and
+ *        the log carries on in the same block. */
+static void check_compressed_log_time_shift(void)
+{
+    uint32_t samples = 300;
+    uint32_t seed    = 7;
+    int32_t  step    = (int32_t)CLOG_TIME_BASE;
+    unsigned mismatches;
+    char     detail[64];
+
+    compressed_log_init();
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        if (i == samples / 2)
+        {
+            compressed_log_time_shift(step);
+            for (uint32_t k = 0; k < i; k++)
+            {
+                m_clog_times[k] += (uint32_t)step;
+            }
+        }
+        clog_trace_sample(i, &m_clog_appended[i], &seed);
+        m_clog_times[i] = 60 + i * CLOG_LOG_PERIOD_S + ((i >= samples / 2) ? (uint32_t)step : 0);
+        compressed_log_append(m_clog_times[i], CLOG_LOG_PERIOD_S, &m_clog_appended[i]);
+    }
+    mismatches = clog_mismatches(m_clog_appended, m_clog_times, samples);
+    snprintf(detail, sizeof(detail), " (%u mismatches)", mismatches);
+    check("clock set after the first samples", mismatches == 0, detail);
+}
+
+
+/**@brief How much history the compressed log holds compared to the two legacy byte logs. */
+static void check_compressed_log_depth(void)
+{
+    uint32_t samples = CLOG_TRACE_DAYS * 24 * 3600 / CLOG_LOG_PERIOD_S;
+    uint32_t seed    = 99;
+    uint32_t held;
+    char     detail[96];
+
+    compressed_log_init();
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        clog_trace_sample(i, &m_clog_appended[i], &seed);
+        m_clog_times[i] = CLOG_TIME_BASE + i * CLOG_LOG_PERIOD_S;
+        compressed_log_append(m_clog_times[i], CLOG_LOG_PERIOD_S, &m_clog_appended[i]);
+    }
+    held = compressed_log_sample_count();
+    check("round trip, indoor trace", clog_mismatches(m_clog_appended, m_clog_times, samples) == 0, "");
+    snprintf(detail, sizeof(detail), " (%u samples, %.1f days in %u bytes; legacy %u in %u)",
+             held, (double)held * CLOG_LOG_PERIOD_S / 86400.0, (unsigned)sizeof(compressed_log_block_t) * COMPRESSED_LOG_BLOCKS,
+             CLOG_LEGACY_ENTRIES, 2 * (CLOG_LEGACY_ENTRIES + 1));
+    check("indoor trace holds >= 2.5x the legacy log", 2 * held >= 5 * CLOG_LEGACY_ENTRIES, detail);
+
+    compressed_log_init();
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        clog_trace_slot(i, &m_clog_appended[i], &seed);
+        m_clog_times[i] = CLOG_TIME_BASE + i * CLOG_LOG_PERIOD_S;
+        compressed_log_append(m_clog_times[i], CLOG_LOG_PERIOD_S, &m_clog_appended[i]);
+    }
+    held = compressed_log_sample_count();
+    check("round trip, indoor trace with ranges", clog_mismatches(m_clog_appended, m_clog_times, samples) == 0, "");
+    snprintf(detail, sizeof(detail), " (%u samples, %.1f days)", held, (double)held * CLOG_LOG_PERIOD_S / 86400.0);
+    check("indoor trace with ranges holds >= 2 days", held * CLOG_LOG_PERIOD_S >= 2 * 86400, detail);
+}
+
+
+typedef int32_t (*bench_fn_t)(u16t raw);
+
+static int32_t bench_t_float(u16t raw)  { return (int32_t)(SHT2x_CalcTemperatureC(raw) * 100.0f); }
+static int32_t bench_t_int(u16t raw)    { return SHT2x_CalcTemperatureCentiC(raw); }
+static int32_t bench_rh_float(u16t raw) { return (int32_t)(SHT2x_CalcRH(raw) * 100.0f); }
+static int32_t bench_rh_int(u16t raw)   { return SHT2x_CalcRHCenti(raw); }
+
+/**@brief Returns the average time of one call over all raw codes. */
+static double bench_run(bench_fn_t fn)
+{
+    uint64_t start;
+    int32_t  sum = 0;
+
+    start = bench_clock();
+    for (int r = 0; r < BENCH_REPEAT; r++)
+    {
+        for (uint32_t code = 0; code < BENCH_RAW_CODES; code++)
+        {
+            sum += fn((u16t)(code << 2));
+        }
+    }
+    m_sink = sum;
+    return (double)(bench_clock() - start) / ((double)BENCH_REPEAT * BENCH_RAW_CODES);
+}
+
+
+static void bench_conversions(void)
+{
+    double t_float  = bench_run(bench_t_float);
+    double t_int    = bench_run(bench_t_int);
+    double rh_float = bench_run(bench_rh_float);
+    double rh_int   = bench_run(bench_rh_int);
+
+    printf("  %-44s %7.2f %s\n", "SHT2x_CalcTemperatureC (float)", t_float, BENCH_UNIT);
+    printf("  %-44s %7.2f %s\n", "SHT2x_CalcTemperatureCentiC (integer)", t_int, BENCH_UNIT);
+    printf("  %-44s %7.2f %s\n", "SHT2x_CalcRH (float)", rh_float, BENCH_UNIT);
+    printf("  %-44s %7.2f %s\n", "SHT2x_CalcRHCenti (integer)", rh_int, BENCH_UNIT);
+}
+
+
+/**@brief Times each CRC implementation on 2 byte (measurement) and 8 byte inputs. */
+static void bench_crc(void)
+{
+    static const u8t lengths[] = { 2, 8 };
+    u8t data[8];
+
+    for (unsigned l = 0; l < sizeof(lengths); l++)
+    {
+        for (unsigned i = 0; i < CRC_IMPL_COUNT; i++)
+        {
+            uint64_t start;
+            uint32_t sum = 0;
+            char     name[64];
+
+            start = bench_clock();
+            for (uint32_t x = 0; x < 0x10000 * 16; x++)
+            {
+                data[0] = (u8t)(x >> 8);
+                data[1] = (u8t)x;
+                data[lengths[l] - 1] ^= (u8t)(x >> 4);
+                sum += m_crc_impl[i].fn(data, lengths[l]);
+            }
+            m_sink = (int32_t)sum;
+            snprintf(name, sizeof(name), "%s, %u bytes", m_crc_impl[i].p_name, lengths[l]);
+            printf("  %-44s %7.2f %s\n", name,
+                   (double)(bench_clock() - start) / (0x10000 * 16.0), BENCH_UNIT);
+        }
+    }
+}
+
+
+/**@brief Times appending and decoding the indoor trace, per sample. */
+static void bench_compressed_log(void)
+{
+    static compressed_log_sample_t samples[COMPRESSED_LOG_MAX_SAMPLES];
+    uint32_t count = CLOG_TRACE_DAYS * 24 * 3600 / CLOG_LOG_PERIOD_S;
+    uint32_t seed  = 99;
+    uint64_t start;
+    uint32_t decoded = 0;
+    int32_t  sum     = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        clog_trace_sample(i, &m_clog_appended[i], &seed);
+    }
+    start = bench_clock();
+    for (int r = 0; r < BENCH_REPEAT; r++)
+    {
+        compressed_log_init();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            compressed_log_append(CLOG_TIME_BASE + i * CLOG_LOG_PERIOD_S, CLOG_LOG_PERIOD_S, &m_clog_appended[i]);
+        }
+    }
+    printf("  %-44s %7.2f %s\n", "compressed_log_append",
+           (double)(bench_clock() - start) / ((double)BENCH_REPEAT * count), BENCH_UNIT);
+
+    start = bench_clock();
+    for (int r = 0; r < BENCH_REPEAT; r++)
+    {
+        for (uint16_t b = 0; b < compressed_log_block_count(); b++)
+        {
+            uint8_t n = compressed_log_decode(compressed_log_block_get(b), samples);
+
+            decoded += n;
+            sum     += samples[n - 1].temperature;
+        }
+    }
+    m_sink = sum;
+    printf("  %-44s %7.2f %s\n", "compressed_log_decode, per sample",
+           (double)(bench_clock() - start) / decoded, BENCH_UNIT);
+}
+
+
+int main(void)
+{
+    printf("Conversions, all %u raw codes\n", BENCH_RAW_CODES);
+    check_conversions();
+    printf("CRC-8, polynomial 0x131\n");
+    check_crc();
+    check_serial_number();
+    printf("Compressed log, %u blocks of %u bytes\n", COMPRESSED_LOG_BLOCKS, COMPRESSED_LOG_BLOCK_SIZE);
+    check_compressed_log_random();
+    check_compressed_log_steps();
+    check_compressed_log_ranges();
+    check_compressed_log_time_shift();
+    check_compressed_log_depth();
+    printf("Conversion time per call\n");
+    bench_conversions();
+    printf("CRC time per call\n");
+    bench_crc();
+    printf("Compressed log time\n");
+    bench_compressed_log();
+
+    if (m_failed)
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,148 @@
+/** @file
+ *
+ * @brief RTemp host simulation - internal simulator interface.
+ *
+ * The firmware (main.c, our_service.c and the Sensirion driver) is compiled
+ * unmodified against the shim headers in include/. Everything those headers
+ * declare is implemented by the sim_*.c files on top of a single virtual
+ * clock. Time only moves when the firmware busy-waits (CPU awake) or calls
+ * sd_app_evt_wait() (CPU asleep until the next scheduled event), so weeks of
+ * operation run in seconds and every run is reproducible.
+ */
+#ifndef SIM_H__
+#define SIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
+typedef uint64_t sim_time_t;                /**< Virtual time in microseconds since power-on. */
+
+#define SIM_US_PER_MS   1000ULL
+#define SIM_US_PER_S    1000000ULL
+#define SIM_US_PER_MIN  (60ULL * SIM_US_PER_S)
+#define SIM_US_PER_HOUR (60ULL * SIM_US_PER_MIN)
+#define SIM_US_PER_DAY  (24ULL * SIM_US_PER_HOUR)
+
+#define SIM_EPOCH_S     1476748800ULL      /**< Wall clock at power-on, seconds since 1970 (2016-10-18 00:00 UTC). */
+
+#define SIM_SDA_PIN     3                   /**< Must match SDA_Pin in Sensirion/I2C_HAL.h. */
+#define SIM_SCL_PIN     4                   /**< Must match SCL_Pin in Sensirion/I2C_HAL.h. */
+
+typedef void (*sim_event_fn_t)(void * p_context);
+
+/**@brief Simulation options, filled from the command line. */
+typedef struct
+{
+    sim_time_t duration;                    /**< How long to run. */
+    uint32_t   seed;                        /**< Seed for the environment and radio jitter. */
+    uint32_t   client_period_min;           /**< Minutes between central connections, 0 disables the central. */
+    uint32_t   client_stay_s;               /**< Seconds the central stays connected. */
+    bool       verbose;                     /**< Trace every BLE and sensor transaction. */
+    bool       dump_log;                    /**< Print the decoded logs at the end of the run. */
+    bool       bulk_sync;                   /**< The central fetches the compressed log instead of long reads of the legacy logs. */
+    bool       full_sync;                   /**< With bulk_sync, the central asks for the whole log every time. */
+    bool       log_full_reads;              /**< The central reads the legacy logs whole, not from the log head on. */
+    uint32_t   scan_period_s;               /**< Seconds between advertising packets picked up by the scanner, 0 disables it. */
+    const char * p_flash_image;             /**< File the flash is loaded from at start and saved to at the end, or NULL. */
+    const char * p_config;                  /**< Configuration fields the central writes, "name=value,...", or NULL. */
+} sim_options_t;
+
+/**@brief Counters collected by the simulator itself (independent of any firmware instrumentation). */
+typedef struct
+{
+    sim_time_t cpu_active_us;               /**< Time spent busy-waiting with the CPU running. */
+    sim_time_t cpu_sleep_us;                /**< Time spent inside sd_app_evt_wait(). */
+    sim_time_t hfxo_on_us;                  /**< Time the 16 MHz crystal was requested. */
+    uint64_t   wakeups;                     /**< Number of returns from sd_app_evt_wait(). */
+    uint64_t   adv_events;                  /**< Advertising events (3 channels each). */
+    uint64_t   conn_events;                 /**< Connection events the peripheral took part in. */
+    uint64_t   tx_packets;                  /**< Data packets sent by the peripheral (notifications and read responses). */
+    uint64_t   notifications;               /**< Successful sd_ble_gatts_hvx() calls. */
+    uint64_t   value_sets;                  /**< sd_ble_gatts_value_set() calls. */
+    uint64_t   value_set_bytes;             /**< Bytes copied into the attribute table by sd_ble_gatts_value_set(). */
+    uint64_t   i2c_transactions;            /**< START conditions seen by the sensor model. */
+    uint64_t   sensor_conversions;          /**< Conversions performed by the sensor model. */
+    sim_time_t sensor_busy_us;              /**< Time the sensor model spent converting. */
+    uint64_t   adc_samples;                 /**< ADC conversions performed. */
+    uint64_t   flash_writes;                /**< Words written to flash. */
+    uint64_t   flash_erases;                /**< Pages erased. */
+    uint64_t   events_dispatched;           /**< Interrupt-level events delivered to the firmware. */
+    sim_time_t event_latency_total_us;      /**< Sum of (dispatch time - due time) over all events. */
+    sim_time_t event_latency_max_us;        /**< Worst dispatch delay of any event. */
+    uint64_t   ble_events;                  /**< BLE stack events delivered. */
+    sim_time_t ble_latency_total_us;        /**< Sum of BLE event dispatch delays. */
+    sim_time_t ble_latency_max_us;          /**< Worst BLE event dispatch delay. */
+    uint64_t   preemptions;                 /**< Events delivered while thread mode busy-waited or left a critical region. */
+} sim_stats_t;
+
+extern sim_options_t g_sim_options;
+extern sim_stats_t   g_sim_stats;
+
+/* sim_core.c */
+sim_time_t sim_now(void);
+void       sim_busy_us(uint64_t us);
+void       sim_thread_busy_us(uint64_t us);
+void       sim_interrupts_mask(bool masked);
+int        sim_schedule(sim_time_t at, sim_event_fn_t fn, void * p_context, bool is_ble);
+void       sim_cancel(int event_id);
+uint32_t   sim_random(void);
+void       sim_trace(const char * p_fmt, ...);
+void       sim_fatal(const char * p_fmt, ...);
+
+/* sim_hw.c */
+void       sim_hw_init(void);
+void       sim_hw_poll(void);
+double     sim_battery_voltage(void);
+void       sim_gpio_attach(uint32_t pin, void (*on_change)(void));
+uint32_t   sim_gpio_master_level(uint32_t pin);
+uint8_t  * sim_flash_ptr(uint32_t address);
+void       sim_flash_save(void);
+
+/* sim_sht2x.c */
+void       sim_sht2x_init(void);
+void       sim_sht2x_bus_changed(void);
+uint32_t   sim_sht2x_sda_level(void);
+uint32_t   sim_sht2x_scl_level(void);
+double     sim_env_temperature(sim_time_t t);
+double     sim_env_humidity(sim_time_t t);
+
+/* sim_softdevice.c */
+typedef void (*sim_att_rsp_fn_t)(uint16_t gatt_status, const uint8_t * p_data, uint16_t len);
+
+void       sim_softdevice_init(void);
+void       sim_ble_dispatch(ble_evt_t * p_ble_evt);
+void       sim_sys_dispatch(uint32_t sys_evt);
+bool       sim_ble_connect(uint16_t interval, uint16_t latency);
+void       sim_ble_disconnect(uint8_t reason);
+bool       sim_ble_is_connected(void);
+bool       sim_ble_is_advertising(void);
+sim_time_t sim_adv_wait_us(void);
+sim_time_t sim_radio_next_inactive(void);
+sim_time_t sim_radio_last_inactive(void);
+uint16_t   sim_ble_conn_interval(void);
+void       sim_att_read(uint16_t handle, uint16_t offset, sim_att_rsp_fn_t rsp);
+void       sim_att_write(uint16_t handle, const uint8_t * p_data, uint16_t len, sim_att_rsp_fn_t rsp);
+uint16_t   sim_gatts_find(uint16_t uuid, uint16_t after_handle);
+uint16_t   sim_gatts_cccd_handle(uint16_t value_handle);
+uint16_t   sim_gatts_value_len(uint16_t handle);
+const uint8_t * sim_gatts_value(uint16_t handle);
+void       sim_adv_pdu(uint8_t * p_data, uint8_t * p_len, bool * p_connectable);
+void       sim_softdevice_account(void);
+void       sim_softdevice_report(void);
+
+/* sim_sdk.c */
+void       sim_sdk_report(void);
+
+/* sim_central.c */
+void       sim_central_init(void);
+void       sim_central_on_connected(void);
+void       sim_central_on_disconnected(uint8_t reason);
+void       sim_central_on_notification(uint16_t handle, const uint8_t * p_data, uint16_t len);
+void       sim_central_report(void);
+
+/* sim_scanner.c */
+void       sim_scanner_init(void);
+void       sim_scanner_report(void);
+
+#endif // SIM_H__
@@ -0,0 +1,1117 @@
+/** @file
+ *
+ * @brief RTemp host simulation - a phone running the RTemp app.
+ *
+ * Every --client-period minutes the central connects, enables notifications
+ * on every characteristic that has a CCCD, reads the current values and both
+ * logs (long reads, 22 bytes per request like iOS with the default ATT MTU),
+ * stays for --client-stay seconds and disconnects. All ATT traffic goes over
+ * the simulated link, so it shows up in the radio accounting.
+ *
+ * The central keeps copies of the logs and reads the log head before them:
+ * only the entries logged since the head of its last sync are read, with
+ * Read Blob requests at their offset, and none when the head did not move.
+ * --log-full-reads reads both logs whole every time instead, as the app
+ * did before the log head.
+ *
+ * With --bulk-sync the legacy logs are not read. The central asks the log
+ * control point for the compressed log blocks since the newest one it has and
+ * collects them from the log data notifications instead. --full-sync asks for
+ * the whole log every time, which is what a freshly installed app does, and
+ * the report gives the throughput of the transfers (control point write to
+ * the DONE notification).
+ *
+ * Like the app, the central reads the Current Time characteristic and then
+ * sets it from its own clock (SIM_EPOCH_S at power-on). The report gives how
+ * far the device clock was off when read, and checks the compressed log
+ * timestamps: the temperature of every sample against the environment at the
+ * time its block puts it.
+ *
+ * With --config the central then reads the configuration characteristics
+ * and writes back the ones the fields given change, every session: the
+ * report counts the writes the device accepted and refused. A refused write
+ * is tried again next time, an accepted one is not needed any more.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "sim.h"
+#include "ble_hci.h"
+#include "our_service.h"
+#include "compressed_log.h"
+#include "log_transfer.h"
+#include "device_time.h"
+#include "current_time.h"
+#include "device_config.h"
+
+#define SIM_CENTRAL_INTERVAL    24          /**< 30 ms, what iOS picks for a fresh connection. */
+#define SIM_CENTRAL_RETRY_US    (5 * SIM_US_PER_S)
+#define SIM_CENTRAL_MAX_VALUE   512
+#define SIM_CENTRAL_MAX_HANDLES 16
+#define SIM_CENTRAL_MAX_BLOCKS  64          /**< Compressed log blocks the app keeps, by sequence number. */
+#define SIM_CENTRAL_STREAM_SIZE ((COMPRESSED_LOG_BLOCKS + 1) * COMPRESSED_LOG_BLOCK_SIZE)
+#define SIM_CENTRAL_MAX_CONFIG  16          /**< Fields --config can list. */
+#define SIM_CENTRAL_RANGE_MARGIN_C 0.15       /**< Sensor noise plus rounding to 0.1 C. */
+
+static const uint16_t m_read_uuids[] =
+{
+    BLE_UUID_CURRENT_TIME_CHAR,
+    BLE_UUID_CHAR_TEMPERATURE,
+    BLE_UUID_CHAR_HUMIDITY,
+    BLE_UUID_BATTERY_LEVEL_CHAR,
+    BLE_UUID_CHAR_BATTERY,
+    BLE_UUID_CHAR_LOG_HEAD,
+    BLE_UUID_CHAR_TEMP_LOG,
+    BLE_UUID_CHAR_HUMIDITY_LOG,
+};
+
+static const uint16_t m_config_uuids[] =
+{
+    BLE_UUID_DEVICE_CONFIG_MEASUREMENT,
+    BLE_UUID_DEVICE_CONFIG_ADVERTISING,
+    BLE_UUID_DEVICE_CONFIG_CONNECTION,
+    BLE_UUID_DEVICE_CONFIG_TX_POWER,
+    BLE_UUID_DEVICE_CONFIG_SENSOR,
+};
+
+/**@brief A field of the configuration characteristics, by the name --config gives it. */
+typedef struct
+{
+    const char * p_name;
+    uint16_t     uuid;
+    uint8_t      offset;
+    uint8_t      size;                      /**< Bytes, little endian. */
+} sim_config_field_t;
+
+static const sim_config_field_t m_config_fields[] =
+{
+    {"min_interval",          BLE_UUID_DEVICE_CONFIG_MEASUREMENT, 0,  2},
+    {"max_interval",          BLE_UUID_DEVICE_CONFIG_MEASUREMENT, 2,  2},
+    {"temperature_deadband",  BLE_UUID_DEVICE_CONFIG_MEASUREMENT, 4,  2},
+    {"humidity_deadband",     BLE_UUID_DEVICE_CONFIG_MEASUREMENT, 6,  2},
+    {"max_silence",           BLE_UUID_DEVICE_CONFIG_MEASUREMENT, 8,  2},
+    {"log_period",            BLE_UUID_DEVICE_CONFIG_MEASUREMENT, 10, 2},
+    {"fast_interval",         BLE_UUID_DEVICE_CONFIG_ADVERTISING, 0,  2},
+    {"fast_timeout",          BLE_UUID_DEVICE_CONFIG_ADVERTISING, 2,  2},
+    {"slow_interval",         BLE_UUID_DEVICE_CONFIG_ADVERTISING, 4,  2},
+    {"temperature_threshold", BLE_UUID_DEVICE_CONFIG_ADVERTISING, 6,  2},
+    {"humidity_threshold",    BLE_UUID_DEVICE_CONFIG_ADVERTISING, 8,  2},
+    {"min_conn_interval",     BLE_UUID_DEVICE_CONFIG_CONNECTION,  0,  2},
+    {"max_conn_interval",     BLE_UUID_DEVICE_CONFIG_CONNECTION,  2,  2},
+    {"slave_latency",         BLE_UUID_DEVICE_CONFIG_CONNECTION,  4,  2},
+    {"conn_sup_timeout",      BLE_UUID_DEVICE_CONFIG_CONNECTION,  6,  2},
+    {"tx_power",              BLE_UUID_DEVICE_CONFIG_TX_POWER,    0,  1},
+    {"resolution",            BLE_UUID_DEVICE_CONFIG_SENSOR,      0,  1},
+    {"heater",                BLE_UUID_DEVICE_CONFIG_SENSOR,      1,  1},
+};
+
+/**@brief The fields given with --config. */
+static struct
+{
+    const sim_config_field_t * p_field;
+    long                       value;
+} m_config_settings[SIM_CENTRAL_MAX_CONFIG];
+static uint8_t m_config_setting_count;
+
+static struct
+{
+    bool     connected;
+    uint16_t cccds[SIM_CENTRAL_MAX_HANDLES];
+    uint8_t  cccd_count;
+    uint8_t  cccd_next;
+    uint8_t  read_next;
+    uint16_t read_handle;
+    uint8_t  value[SIM_CENTRAL_MAX_VALUE];
+    uint16_t value_len;
+    int      leave_event;
+
+    uint8_t  temp_log[LOG_SIZE];
+    uint16_t temp_log_len;
+    uint8_t  hum_log[LOG_SIZE];
+    uint16_t hum_log_len;
+    uint8_t  log_head[3];                   /**< Log head read this session. */
+    bool     log_head_read;
+    bool     log_failed;                    /**< A log read of this session failed. */
+    uint32_t log_head_count;                /**< Entries logged, by the head read this session. */
+    bool     log_synced;                    /**< The copies of the logs hold everything up to log_count. */
+    uint32_t log_count;                     /**< Entries logged, by the head of the last sync. */
+    uint16_t log_new;                       /**< Entries to read from each log this session, LOG_SIZE - 1 for all. */
+    uint16_t slice_pos;                     /**< Position of the next entry to read, 0 based. */
+    uint16_t slice_left;
+    uint64_t log_entries_read;
+    uint64_t log_reads_skipped;             /**< Logs not read at all: the head had not moved. */
+    double   temperature;
+    int      humidity;
+    int      battery;
+    int      battery_mv;
+    int      battery_days;
+
+    uint64_t connect_attempts;
+    sim_time_t discovery_started;           /**< First connect attempt of the session, 0 when connected. */
+    sim_time_t discovery_total_us;
+    sim_time_t discovery_max_us;
+    uint64_t sessions;
+    uint64_t completed_syncs;
+    uint64_t att_requests;
+    uint64_t read_bytes;
+    uint64_t notifications;
+    uint64_t notification_bytes;
+    sim_time_t sync_time_total_us;
+    sim_time_t sync_started;
+    uint64_t sync_conn_events_start;
+    uint64_t sync_conn_events_total;
+
+    bool     bulk_running;
+    uint8_t  stream[SIM_CENTRAL_STREAM_SIZE];
+    uint16_t stream_len;
+    uint16_t next_seq;                      /**< Block to ask for next time: the newest one received, it was still filling. */
+    compressed_log_block_t blocks[SIM_CENTRAL_MAX_BLOCKS];
+    bool     block_valid[SIM_CENTRAL_MAX_BLOCKS];
+    uint16_t newest_seq;
+    uint64_t bulk_blocks;
+    uint64_t bulk_bytes;
+    uint64_t bulk_errors;
+    sim_time_t bulk_started;
+    sim_time_t bulk_time_total_us;          /**< Time spent in successful transfers. */
+    uint64_t bulk_transfers;
+
+    uint64_t clock_reads;                   /**< Current Time reads with the clock set. */
+    uint64_t clock_unset_reads;
+    double   clock_error_total_ms;
+    double   clock_error_max_ms;
+    uint64_t clock_writes;
+    uint64_t clock_write_errors;
+
+    uint8_t  config_part;                   /**< Index in m_config_uuids of the characteristic being read or written. */
+    uint16_t config_handle;
+    uint64_t config_writes;
+    uint64_t config_refused;
+} m_central;
+
+static void read_next_value(void);
+
+static void schedule_connect(sim_time_t at);
+
+
+static void connect_attempt(void * p_context)
+{
+    (void)p_context;
+    m_central.connect_attempts++;
+    if (m_central.discovery_started == 0)
+    {
+        m_central.discovery_started = sim_now();
+    }
+    if (!sim_ble_connect(SIM_CENTRAL_INTERVAL, 0))
+    {
+        // Not advertising (or not connectable) right now: scan again shortly.
+        schedule_connect(sim_now() + SIM_CENTRAL_RETRY_US);
+    }
+}
+
+
+static void schedule_connect(sim_time_t at)
+{
+    if (g_sim_options.client_period_min > 0)
+    {
+        sim_schedule(at, connect_attempt, NULL, false);
+    }
+}
+
+
+static void leave(void * p_context)
+{
+    (void)p_context;
+    m_central.leave_event = 0;
+    if (m_central.connected)
+    {
+        sim_ble_disconnect(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+    }
+}
+
+
+/**@brief Decodes the current temperature characteristic (sign, integer, tenths, 0xAA marker). */
+static double decode_temperature(const uint8_t * p_value)
+{
+    return (int8_t)p_value[2] + (int8_t)p_value[1] / 10.0;
+}
+
+
+/**@brief The central's clock: seconds since 1970 and the microseconds into the second. */
+static uint64_t wall_clock_us(void)
+{
+    return SIM_EPOCH_S * SIM_US_PER_S + sim_now();
+}
+
+
+/**@brief Compares a Current Time value with the central's clock. */
+static void clock_check(const uint8_t * p_value)
+{
+    struct tm date;
+    double    error_ms;
+
+    if (p_value[0] == 0 && p_value[1] == 0)
+    {
+        m_central.clock_unset_reads++;
+        return;
+    }
+    memset(&date, 0, sizeof(date));
+    date.tm_year = (p_value[0] | (p_value[1] << 8)) - 1900;
+    date.tm_mon  = p_value[2] - 1;
+    date.tm_mday = p_value[3];
+    date.tm_hour = p_value[4];
+    date.tm_min  = p_value[5];
+    date.tm_sec  = p_value[6];
+    error_ms = ((double)timegm(&date) + p_value[8] / 256.0) * 1000.0 - (double)wall_clock_us() / 1000.0;
+    m_central.clock_reads++;
+    m_central.clock_error_total_ms += fabs(error_ms);
+    if (fabs(error_ms) > m_central.clock_error_max_ms)
+    {
+        m_central.clock_error_max_ms = fabs(error_ms);
+    }
+}
+
+
+/**@brief Works out from the log head how many entries of each log are new since the last sync. */
+static void log_head_check(const uint8_t * p_head)
+{
+    uint32_t count = (uint32_t)uint16_decode(&p_head[1]) * (LOG_SIZE - 1) + p_head[0] - 1;
+
+    memcpy(m_central.log_head, p_head, sizeof(m_central.log_head));
+    m_central.log_head_read  = true;
+    m_central.log_head_count = count;
+    if (g_sim_options.log_full_reads || !m_central.log_synced || (p_head[0] == 0) ||
+        (count < m_central.log_count) || (count - m_central.log_count >= LOG_SIZE - 1))
+    {
+        // First sync, a restarted device, or a log that went all the way round: read it whole
+        m_central.log_new = LOG_SIZE - 1;
+        return;
+    }
+    m_central.log_new = (uint16_t)(count - m_central.log_count);
+}
+
+
+static void log_slice_rsp(uint16_t gatt_status, const uint8_t * p_data, uint16_t len)
+{
+    bool      temperature = (m_read_uuids[m_central.read_next] == BLE_UUID_CHAR_TEMP_LOG);
+    uint8_t * p_log       = temperature ? m_central.temp_log : m_central.hum_log;
+
+    m_central.att_requests++;
+    if ((gatt_status != BLE_GATT_STATUS_SUCCESS) || (len == 0))
+    {
+        sim_trace("central: log read at %u failed (0x%04X)", 1 + m_central.slice_pos, gatt_status);
+        m_central.log_failed = true;
+        m_central.read_next++;
+        read_next_value();
+        return;
+    }
+    m_central.read_bytes += len;
+
+    // The response runs on to the end of the log, past the entries wanted
+    len = (len > m_central.slice_left) ? m_central.slice_left : len;
+    len = (len > LOG_SIZE - 1 - m_central.slice_pos) ? LOG_SIZE - 1 - m_central.slice_pos : len;
+    memcpy(&p_log[1 + m_central.slice_pos], p_data, len);
+    m_central.log_entries_read += len;
+    m_central.slice_left       -= len;
+    m_central.slice_pos         = (uint16_t)((m_central.slice_pos + len) % (LOG_SIZE - 1));
+    if (m_central.slice_left > 0)
+    {
+        sim_att_read(m_central.read_handle, 1 + m_central.slice_pos, log_slice_rsp);
+        return;
+    }
+
+    p_log[0] = m_central.log_head[0];
+    if (temperature)
+    {
+        m_central.temp_log_len = LOG_SIZE;
+    }
+    else
+    {
+        m_central.hum_log_len = LOG_SIZE;
+    }
+    m_central.read_next++;
+    read_next_value();
+}
+
+
+/**@brief Reads the new entries of a log into its copy, from the oldest one on. */
+static void log_slice_start(uint16_t handle)
+{
+    uint16_t next = (m_central.log_head[0] >= LOG_SIZE) ? 0 : m_central.log_head[0] - 1;
+
+    m_central.read_handle = handle;
+    m_central.slice_pos   = (uint16_t)((next + (LOG_SIZE - 1) - m_central.log_new) % (LOG_SIZE - 1));
+    m_central.slice_left  = m_central.log_new;
+    sim_att_read(handle, 1 + m_central.slice_pos, log_slice_rsp);
+}
+
+
+static void read_rsp(uint16_t gatt_status, const uint8_t * p_data, uint16_t len)
+{
+    m_central.att_requests++;
+    if (gatt_status != BLE_GATT_STATUS_SUCCESS)
+    {
+        sim_trace("central: read of 0x%04X failed (0x%04X)", m_central.read_handle, gatt_status);
+        m_central.read_next++;
+        read_next_value();
+        return;
+    }
+    if (m_central.value_len + len > sizeof(m_central.value))
+    {
+        len = sizeof(m_central.value) - m_central.value_len;
+    }
+    memcpy(&m_central.value[m_central.value_len], p_data, len);
+    m_central.value_len  += len;
+    m_central.read_bytes += len;
+
+    if ((len == GATT_MTU_SIZE_DEFAULT - 1) && (m_central.value_len < sizeof(m_central.value)))
+    {
+        // A full response: the value may continue, issue a Read Blob for the rest.
+        sim_att_read(m_central.read_handle, m_central.value_len, read_rsp);
+        return;
+    }
+
+    switch (m_read_uuids[m_central.read_next])
+    {
+        case BLE_UUID_CURRENT_TIME_CHAR:
+            if (m_central.value_len == CURRENT_TIME_LEN)
+            {
+                clock_check(m_central.value);
+            }
+            break;
+
+        case BLE_UUID_CHAR_TEMPERATURE:
+            if (m_central.value_len >= 4)
+            {
+                m_central.temperature = decode_temperature(m_central.value);
+            }
+            break;
+
+        case BLE_UUID_CHAR_HUMIDITY:
+            if (m_central.value_len >= 1)
+            {
+                m_central.humidity = m_central.value[0];
+            }
+            break;
+
+        case BLE_UUID_BATTERY_LEVEL_CHAR:
+            if (m_central.value_len >= 1)
+            {
+                m_central.battery = m_central.value[0];
+            }
+            break;
+
+        case BLE_UUID_CHAR_BATTERY:
+            if (m_central.value_len >= 4)
+            {
+                m_central.battery_mv   = uint16_decode(&m_central.value[0]);
+                m_central.battery_days = uint16_decode(&m_central.value[2]);
+            }
+            break;
+
+        case BLE_UUID_CHAR_LOG_HEAD:
+            if (m_central.value_len >= sizeof(m_central.log_head))
+            {
+                log_head_check(m_central.value);
+            }
+            break;
+
+        case BLE_UUID_CHAR_TEMP_LOG:
+            m_central.log_entries_read += LOG_SIZE - 1;
+            m_central.temp_log_len = (m_central.value_len > LOG_SIZE) ? LOG_SIZE : m_central.value_len;
+            memcpy(m_central.temp_log, m_central.value, m_central.temp_log_len);
+            break;
+
+        case BLE_UUID_CHAR_HUMIDITY_LOG:
+            m_central.log_entries_read += LOG_SIZE - 1;
+            m_central.hum_log_len = (m_central.value_len > LOG_SIZE) ? LOG_SIZE : m_central.value_len;
+            memcpy(m_central.hum_log, m_central.value, m_central.hum_log_len);
+            break;
+
+        default:
+            break;
+    }
+    m_central.read_next++;
+    read_next_value();
+}
+
+
+static void sync_done(void)
+{
+    sim_softdevice_account();
+    m_central.completed_syncs++;
+    m_central.sync_conn_events_total += g_sim_stats.conn_events - m_central.sync_conn_events_start;
+    m_central.sync_time_total_us += sim_now() - m_central.sync_started;
+    sim_trace("central: sync done in %.1f ms, %.1f C, %d %%RH, battery %d %%",
+              (double)(sim_now() - m_central.sync_started) / 1000.0,
+              m_central.temperature, m_central.humidity, m_central.battery);
+    m_central.leave_event = sim_schedule(sim_now() + g_sim_options.client_stay_s * SIM_US_PER_S, leave, NULL, false);
+}
+
+
+static void control_point_rsp(uint16_t gatt_status, const uint8_t * p_data, uint16_t len)
+{
+    (void)p_data;
+    (void)len;
+    m_central.att_requests++;
+    if (gatt_status != BLE_GATT_STATUS_SUCCESS)
+    {
+        sim_trace("central: log control point write failed (0x%04X)", gatt_status);
+        m_central.bulk_running = false;
+        m_central.bulk_errors++;
+        sync_done();
+    }
+}
+
+
+/**@brief Asks for the compressed log blocks from the newest one received on. */
+static void bulk_start(void)
+{
+    uint16_t handle = sim_gatts_find(BLE_UUID_CHAR_LOG_CONTROL, 0);
+    uint8_t  request[3];
+    uint16_t seq;
+
+    if (handle == BLE_GATT_HANDLE_INVALID)
+    {
+        sync_done();
+        return;
+    }
+    // Block 0xFFFF is never in the log (or is the last one before the numbering wraps), so
+    // the transfer starts with the oldest block.
+    seq                    = g_sim_options.full_sync ? 0xFFFF : m_central.next_seq;
+    request[0]             = LOG_TRANSFER_OP_START;
+    request[1]             = (uint8_t)seq;
+    request[2]             = (uint8_t)(seq >> 8);
+    m_central.stream_len   = 0;
+    m_central.bulk_running = true;
+    m_central.bulk_started = sim_now();
+    sim_att_write(handle, request, sizeof(request), control_point_rsp);
+}
+
+
+/**@brief Stores the blocks of a finished transfer, replacing older copies of the same blocks. */
+static void bulk_done(const uint8_t * p_data, uint16_t len)
+{
+    uint16_t first;
+    uint16_t count;
+
+    m_central.bulk_running = false;
+    if ((len < LOG_TRANSFER_CONTROL_LEN) || (p_data[1] != LOG_TRANSFER_STATUS_SUCCESS))
+    {
+        sim_trace("central: log transfer failed (status %u)", (len > 1) ? p_data[1] : 0xFF);
+        m_central.bulk_errors++;
+        sync_done();
+        return;
+    }
+    first = (uint16_t)(p_data[2] | (p_data[3] << 8));
+    count = (uint16_t)(p_data[4] | (p_data[5] << 8));
+    if (m_central.stream_len != count * COMPRESSED_LOG_BLOCK_SIZE)
+    {
+        sim_trace("central: log transfer of %u blocks brought %u bytes", count, m_central.stream_len);
+        m_central.bulk_errors++;
+        sync_done();
+        return;
+    }
+    if ((count > 0) && (first < m_central.next_seq))
+    {
+        // The numbering restarted (the device was reset): what we have is from another run.
+        memset(m_central.block_valid, 0, sizeof(m_central.block_valid));
+    }
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint16_t seq = (uint16_t)(first + i);
+
+        memcpy(&m_central.blocks[seq % SIM_CENTRAL_MAX_BLOCKS], &m_central.stream[i * COMPRESSED_LOG_BLOCK_SIZE],
+               COMPRESSED_LOG_BLOCK_SIZE);
+        m_central.block_valid[seq % SIM_CENTRAL_MAX_BLOCKS] = true;
+        m_central.newest_seq = seq;
+        m_central.next_seq   = seq;
+    }
+    m_central.bulk_blocks        += count;
+    m_central.bulk_bytes         += m_central.stream_len;
+    m_central.bulk_time_total_us += sim_now() - m_central.bulk_started;
+    m_central.bulk_transfers++;
+    sim_trace("central: log transfer of %u bytes in %.1f ms, at %.2f ms intervals", m_central.stream_len,
+              (double)(sim_now() - m_central.bulk_started) / 1000.0, sim_ble_conn_interval() * 1.25);
+    sync_done();
+}
+
+
+/**@brief Done with the time and the configuration, on to the log. */
+static void log_sync(void)
+{
+    if (g_sim_options.bulk_sync)
+    {
+        bulk_start();
+        return;
+    }
+    sync_done();
+}
+
+
+static void config_next_part(void);
+
+
+static void config_write_rsp(uint16_t gatt_status, const uint8_t * p_data, uint16_t len)
+{
+    (void)p_data;
+    (void)len;
+    m_central.att_requests++;
+    if (gatt_status != BLE_GATT_STATUS_SUCCESS)
+    {
+        sim_trace("central: configuration write to 0x%04X refused (0x%04X)", m_central.config_handle, gatt_status);
+        m_central.config_refused++;
+    }
+    m_central.config_part++;
+    config_next_part();
+}
+
+
+/**@brief Changes the fields given in the value read and writes it back if any of them differ. */
+static void config_read_rsp(uint16_t gatt_status, const uint8_t * p_data, uint16_t len)
+{
+    uint16_t uuid    = m_config_uuids[m_central.config_part];
+    bool     changed = false;
+    uint8_t  value[GATT_MTU_SIZE_DEFAULT - 3];
+
+    m_central.att_requests++;
+    if ((gatt_status != BLE_GATT_STATUS_SUCCESS) || (len > sizeof(value)))
+    {
+        sim_trace("central: read of 0x%04X failed (0x%04X)", m_central.config_handle, gatt_status);
+        m_central.config_part++;
+        config_next_part();
+        return;
+    }
+    m_central.read_bytes += len;
+    memcpy(value, p_data, len);
+    for (uint8_t i = 0; i < m_config_setting_count; i++)
+    {
+        const sim_config_field_t * p_field = m_config_settings[i].p_field;
+        uint8_t                    field[2];
+
+        if ((p_field->uuid != uuid) || (p_field->offset + p_field->size > len))
+        {
+            continue;
+        }
+        field[0] = (uint8_t)m_config_settings[i].value;
+        field[1] = (uint8_t)(m_config_settings[i].value >> 8);
+        if (memcmp(&value[p_field->offset], field, p_field->size) != 0)
+        {
+            memcpy(&value[p_field->offset], field, p_field->size);
+            changed = true;
+        }
+    }
+    if (!changed)
+    {
+        m_central.config_part++;
+        config_next_part();
+        return;
+    }
+    m_central.config_writes++;
+    sim_att_write(m_central.config_handle, value, len, config_write_rsp);
+}
+
+
+/**@brief Reads the next configuration characteristic that --config has fields for. */
+static void config_next_part(void)
+{
+    while (m_central.config_part < sizeof(m_config_uuids) / sizeof(m_config_uuids[0]))
+    {
+        uint16_t uuid   = m_config_uuids[m_central.config_part];
+        uint16_t handle = sim_gatts_find(uuid, 0);
+
+        for (uint8_t i = 0; (handle != BLE_GATT_HANDLE_INVALID) && (i < m_config_setting_count); i++)
+        {
+            if (m_config_settings[i].p_field->uuid == uuid)
+            {
+                m_central.config_handle = handle;
+                sim_att_read(handle, 0, config_read_rsp);
+                return;
+            }
+        }
+        m_central.config_part++;
+    }
+    log_sync();
+}
+
+
+/**@brief Done with the time, on to the configuration. */
+static void clock_set_rsp(uint16_t gatt_status, const uint8_t * p_data, uint16_t len)
+{
+    (void)p_data;
+    (void)len;
+    m_central.att_requests++;
+    if (gatt_status != BLE_GATT_STATUS_SUCCESS)
+    {
+        sim_trace("central: Current Time write failed (0x%04X)", gatt_status);
+        m_central.clock_write_errors++;
+    }
+    m_central.config_part = 0;
+    config_next_part();
+}
+
+
+/**@brief Sets the device clock, in UTC as Exact Time 256. */
+static void clock_set(void)
+{
+    uint16_t  handle = sim_gatts_find(BLE_UUID_CURRENT_TIME_CHAR, 0);
+    uint64_t  now_us = wall_clock_us();
+    time_t    seconds = (time_t)(now_us / SIM_US_PER_S);
+    struct tm date;
+    uint8_t   value[CURRENT_TIME_LEN];
+
+    if (handle == BLE_GATT_HANDLE_INVALID)
+    {
+        clock_set_rsp(BLE_GATT_STATUS_SUCCESS, NULL, 0);
+        m_central.att_requests--;
+        return;
+    }
+    gmtime_r(&seconds, &date);
+    value[0] = (uint8_t)(date.tm_year + 1900);
+    value[1] = (uint8_t)((date.tm_year + 1900) >> 8);
+    value[2] = (uint8_t)(date.tm_mon + 1);
+    value[3] = (uint8_t)date.tm_mday;
+    value[4] = (uint8_t)date.tm_hour;
+    value[5] = (uint8_t)date.tm_min;
+    value[6] = (uint8_t)date.tm_sec;
+    value[7] = (uint8_t)((date.tm_wday == 0) ? 7 : date.tm_wday);
+    value[8] = (uint8_t)((now_us % SIM_US_PER_S) * 256 / SIM_US_PER_S);
+    value[9] = 0x02;                        // Adjust reason: external reference time update
+    m_central.clock_writes++;
+    sim_att_write(handle, value, sizeof(value), clock_set_rsp);
+}
+
+
+static void read_next_value(void)
+{
+    while (m_central.read_next < sizeof(m_read_uuids) / sizeof(m_read_uuids[0]))
+    {
+        uint16_t uuid   = m_read_uuids[m_central.read_next];
+        uint16_t handle = sim_gatts_find(uuid, 0);
+
+        bool     log    = (uuid == BLE_UUID_CHAR_TEMP_LOG) || (uuid == BLE_UUID_CHAR_HUMIDITY_LOG);
+
+        if (g_sim_options.bulk_sync && (log || (uuid == BLE_UUID_CHAR_LOG_HEAD)))
+        {
+            handle = BLE_GATT_HANDLE_INVALID;
+        }
+        if ((handle != BLE_GATT_HANDLE_INVALID) && log && m_central.log_head_read && (m_central.log_new < LOG_SIZE - 1))
+        {
+            if (m_central.log_new == 0)
+            {
+                m_central.log_reads_skipped++;
+                m_central.read_next++;
+                continue;
+            }
+            log_slice_start(handle);
+            return;
+        }
+        if (handle != BLE_GATT_HANDLE_INVALID)
+        {
+            m_central.read_handle = handle;
+            m_central.value_len   = 0;
+            sim_att_read(handle, 0, read_rsp);
+            return;
+        }
+        m_central.read_next++;
+    }
+
+    // The copies of the logs are good up to the head if every read of them went through
+    m_central.log_synced = m_central.log_head_read && !m_central.log_failed;
+    m_central.log_count  = m_central.log_head_count;
+    clock_set();
+}
+
+
+static void cccd_rsp(uint16_t gatt_status, const uint8_t * p_data, uint16_t len)
+{
+    static const uint8_t enable[2] = {BLE_GATT_HVX_NOTIFICATION, 0};
+
+    (void)p_data;
+    (void)len;
+    if (gatt_status != BLE_GATT_STATUS_SUCCESS)
+    {
+        sim_trace("central: CCCD write failed (0x%04X)", gatt_status);
+    }
+    m_central.att_requests++;
+    if (m_central.cccd_next < m_central.cccd_count)
+    {
+        sim_att_write(m_central.cccds[m_central.cccd_next++], enable, sizeof(enable), cccd_rsp);
+        return;
+    }
+    read_next_value();
+}
+
+
+void sim_central_on_connected(void)
+{
+    sim_time_t discovery = sim_now() - m_central.discovery_started;
+
+    m_central.discovery_total_us += discovery;
+    if (discovery > m_central.discovery_max_us)
+    {
+        m_central.discovery_max_us = discovery;
+    }
+    m_central.discovery_started = 0;
+    m_central.connected    = true;
+    m_central.cccd_count   = 0;
+    m_central.cccd_next    = 0;
+    m_central.read_next    = 0;
+    m_central.log_head_read = false;
+    m_central.log_failed   = false;
+    m_central.sync_started = sim_now();
+    sim_softdevice_account();
+    m_central.sync_conn_events_start = g_sim_stats.conn_events;
+    m_central.bulk_running = false;
+    m_central.sessions++;
+
+    // Service discovery is not simulated: the app caches the handles after the first connection.
+    for (uint16_t handle = 1; (handle < 0x0100) && (m_central.cccd_count < SIM_CENTRAL_MAX_HANDLES); handle++)
+    {
+        uint16_t cccd = sim_gatts_cccd_handle(handle);
+
+        if (cccd != BLE_GATT_HANDLE_INVALID)
+        {
+            m_central.cccds[m_central.cccd_count++] = cccd;
+        }
+    }
+    cccd_rsp(BLE_GATT_STATUS_SUCCESS, NULL, 0);
+    m_central.att_requests--;               // cccd_rsp() counts a response; this call started the chain.
+}
+
+
+void sim_central_on_disconnected(uint8_t reason)
+{
+    (void)reason;
+    m_central.connected = false;
+    if (m_central.leave_event != 0)
+    {
+        sim_cancel(m_central.leave_event);
+        m_central.leave_event = 0;
+    }
+    schedule_connect(sim_now() + g_sim_options.client_period_min * SIM_US_PER_MIN);
+}
+
+
+void sim_central_on_notification(uint16_t handle, const uint8_t * p_data, uint16_t len)
+{
+    m_central.notifications++;
+    m_central.notification_bytes += len;
+    if ((handle == sim_gatts_find(BLE_UUID_CHAR_TEMPERATURE, 0)) && (len >= 4))
+    {
+        m_central.temperature = decode_temperature(p_data);
+    }
+    else if ((handle == sim_gatts_find(BLE_UUID_CHAR_HUMIDITY, 0)) && (len >= 1))
+    {
+        m_central.humidity = p_data[0];
+    }
+    else if ((handle == sim_gatts_find(BLE_UUID_BATTERY_LEVEL_CHAR, 0)) && (len >= 1))
+    {
+        m_central.battery = p_data[0];
+    }
+    else if ((handle == sim_gatts_find(BLE_UUID_CHAR_LOG_DATA, 0)) && m_central.bulk_running)
+    {
+        if (m_central.stream_len + len <= sizeof(m_central.stream))
+        {
+            memcpy(&m_central.stream[m_central.stream_len], p_data, len);
+        }
+        m_central.stream_len += len;
+    }
+    else if ((handle == sim_gatts_find(BLE_UUID_CHAR_LOG_CONTROL, 0)) && (len >= 1) &&
+             (p_data[0] == LOG_TRANSFER_OP_DONE) && m_central.bulk_running)
+    {
+        bulk_done(p_data, len);
+    }
+}
+
+
+/**@brief Parses --config: name=value pairs separated by commas. */
+static void config_parse(const char * p_list)
+{
+    while ((p_list != NULL) && (*p_list != '\0'))
+    {
+        const char * p_end   = strchr(p_list, ',');
+        const char * p_equal = strchr(p_list, '=');
+        size_t       name_len;
+        uint8_t      i;
+
+        if (p_end == NULL)
+        {
+            p_end = p_list + strlen(p_list);
+        }
+        if ((p_equal == NULL) || (p_equal > p_end))
+        {
+            sim_fatal("--config: expected name=value in \"%.*s\"", (int)(p_end - p_list), p_list);
+        }
+        name_len = (size_t)(p_equal - p_list);
+        for (i = 0; i < sizeof(m_config_fields) / sizeof(m_config_fields[0]); i++)
+        {
+            if ((strlen(m_config_fields[i].p_name) == name_len) && (strncmp(m_config_fields[i].p_name, p_list, name_len) == 0))
+            {
+                break;
+            }
+        }
+        if (i == sizeof(m_config_fields) / sizeof(m_config_fields[0]))
+        {
+            sim_fatal("--config: no configuration field \"%.*s\"", (int)name_len, p_list);
+        }
+        if (m_config_setting_count == SIM_CENTRAL_MAX_CONFIG)
+        {
+            sim_fatal("--config: more than %u fields", SIM_CENTRAL_MAX_CONFIG);
+        }
+        if (sscanf(p_equal + 1, "%li", &m_config_settings[m_config_setting_count].value) != 1)
+        {
+            sim_fatal("--config: no value for \"%.*s\"", (int)name_len, p_list);
+        }
+        m_config_settings[m_config_setting_count].p_field = &m_config_fields[i];
+        m_config_setting_count++;
+        p_list = (*p_end == ',') ? p_end + 1 : p_end;
+    }
+}
+
+
+void sim_central_init(void)
+{
+    memset(&m_central, 0, sizeof(m_central));
+    m_central.battery = -1;
+    config_parse(g_sim_options.p_config);
+    schedule_connect(g_sim_options.client_period_min * SIM_US_PER_MIN);
+}
+
+
+/**@brief Prints a legacy ring log oldest entry first. Byte 0 is the next write index, 0xFF marks empty slots. */
+static void dump_log(const char * p_name, const uint8_t * p_log, uint16_t len, bool is_temperature)
+{
+    if (len < 2)
+    {
+        printf("  %s: not read\n", p_name);
+        return;
+    }
+    uint16_t next = ((p_log[0] >= 1) && (p_log[0] < len)) ? p_log[0] : 1;
+
+    printf("  %s (oldest first):", p_name);
+    for (uint16_t i = 0, n = 0; i < len - 1; i++)
+    {
+        uint8_t entry = p_log[1 + (next - 1 + i) % (len - 1)];
+
+        if (entry == 0xFF)
+        {
+            continue;
+        }
+        if ((n++ % 16) == 0)
+        {
+            printf("\n   ");
+        }
+        if (is_temperature)
+        {
+            // Same as the iOS app: the half degree is added after the sign.
+            double value = (entry & 0x80) ? -(double)(entry & 0x3F) : (double)(entry & 0x3F);
+            printf(" %5.1f", value + ((entry & 0x40) ? 0.5 : 0.0));
+        }
+        else
+        {
+            printf(" %5u", entry);
+        }
+    }
+    printf("\n");
+}
+
+
+/**@brief Gets a compressed log block received, oldest first, or NULL. */
+static const compressed_log_block_t * received_block(uint16_t index)
+{
+    uint16_t seq = (uint16_t)(m_central.newest_seq - (SIM_CENTRAL_MAX_BLOCKS - 1) + index);
+
+    if ((index >= SIM_CENTRAL_MAX_BLOCKS) || !m_central.block_valid[seq % SIM_CENTRAL_MAX_BLOCKS] ||
+        (seq > m_central.newest_seq))
+    {
+        return NULL;
+    }
+    return &m_central.blocks[seq % SIM_CENTRAL_MAX_BLOCKS];
+}
+
+
+/**@brief Prints the compressed log blocks received, oldest first, with the reference decoder. */
+static void dump_compressed_log(void)
+{
+    static compressed_log_sample_t samples[COMPRESSED_LOG_MAX_SAMPLES];
+
+    printf("  compressed log (oldest first, C / %%RH, slot mean and range):");
+    for (uint16_t i = 0; i < SIM_CENTRAL_MAX_BLOCKS; i++)
+    {
+        const compressed_log_block_t * p_block = received_block(i);
+        time_t                         time;
+        struct tm                      date;
+        char                           text[32];
+
+        if (p_block == NULL)
+        {
+            continue;
+        }
+        time = (time_t)p_block->time;
+        if (p_block->time >= DEVICE_TIME_VALID_MIN)
+        {
+            gmtime_r(&time, &date);
+            strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S UTC", &date);
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "%u s after reset", (unsigned)p_block->time);
+        }
+        printf("\n   block %u, from %s, every %u s:", p_block->seq, text, p_block->interval);
+
+        uint8_t count = compressed_log_decode(p_block, samples);
+        for (uint8_t k = 0; k < count; k++)
+        {
+            if ((k % 3) == 0)
+            {
+                printf("\n   ");
+            }
+            printf(" %5.1f/%-3u", samples[k].temperature / 10.0, samples[k].humidity);
+            printf(" [%5.1f %5.1f/%3u %-3u]", samples[k].temperature_min / 10.0, samples[k].temperature_max / 10.0,
+                   samples[k].humidity_min, samples[k].humidity_max);
+        }
+    }
+    printf("\n");
+}
+
+
+/**@brief Mean of the environment temperature over the log slot that ends at t. */
+static double env_slot_temperature(sim_time_t t, uint16_t interval)
+{
+    sim_time_t span = (sim_time_t)interval * SIM_US_PER_S;
+    double     sum  = 0.0;
+
+    if (span > t)
+    {
+        span = t;
+    }
+    for (unsigned i = 0; i < 64; i++)
+    {
+        sum += sim_env_temperature(t - span + span * (2 * i + 1) / 128);
+    }
+    return sum / 64;
+}
+
+
+/**@brief Checks the time of every sample received against the environment model: the logged
+ *        temperature (0.1 C) should match the mean of the environment over its slot, and the
+ *        environment at that time, when the last reading of the slot was taken, should lie within
+ *        the range of the slot. */
+static void timestamp_report(void)
+{
+    static compressed_log_sample_t samples[COMPRESSED_LOG_MAX_SAMPLES];
+    uint64_t absolute = 0;
+    uint64_t relative = 0;
+    uint64_t outside     = 0;
+    double   error_total = 0.0;
+    double   error_max   = 0.0;
+
+    for (uint16_t i = 0; i < SIM_CENTRAL_MAX_BLOCKS; i++)
+    {
+        const compressed_log_block_t * p_block = received_block(i);
+
+        if (p_block == NULL)
+        {
+            continue;
+        }
+        uint8_t count = compressed_log_decode(p_block, samples);
+        if (p_block->time < DEVICE_TIME_VALID_MIN)
+        {
+            relative += count;
+            continue;
+        }
+        for (uint8_t k = 0; k < count; k++)
+        {
+            uint64_t time  = (uint64_t)p_block->time + (uint64_t)k * p_block->interval;
+            double   error;
+            double   env;
+
+            if (time < SIM_EPOCH_S)
+            {
+                relative++;
+                continue;
+            }
+            error = fabs(samples[k].temperature / 10.0 - env_slot_temperature((time - SIM_EPOCH_S) * SIM_US_PER_S, p_block->interval));
+            env   = sim_env_temperature((time - SIM_EPOCH_S) * SIM_US_PER_S);
+            outside += (env < samples[k].temperature_min / 10.0 - SIM_CENTRAL_RANGE_MARGIN_C) ||
+                       (env > samples[k].temperature_max / 10.0 + SIM_CENTRAL_RANGE_MARGIN_C);
+            absolute++;
+            error_total += error;
+            if (error > error_max)
+            {
+                error_max = error;
+            }
+        }
+    }
+    printf("  log timestamps          %10llu samples in UTC (%llu since reset)\n",
+           (unsigned long long)absolute, (unsigned long long)relative);
+    printf("  temperature at them     %10.3f C avg error, %.3f C max (slot means against the environment)\n",
+           absolute ? error_total / absolute : 0.0, error_max);
+    printf("  slot ranges             %10llu samples with the environment outside\n", (unsigned long long)outside);
+}
+
+
+void sim_central_report(void)
+{
+    if (g_sim_options.client_period_min == 0)
+    {
+        return;
+    }
+    printf("Central\n");
+    printf("  connect attempts        %10llu (%llu sessions, %llu complete syncs)\n",
+           (unsigned long long)m_central.connect_attempts,
+           (unsigned long long)m_central.sessions,
+           (unsigned long long)m_central.completed_syncs);
+    printf("  discovery latency       %10.1f ms avg, %.1f ms max (first connect attempt to connection)\n",
+           m_central.sessions ? (double)m_central.discovery_total_us / m_central.sessions / 1000.0 : 0.0,
+           (double)m_central.discovery_max_us / 1000.0);
+    printf("  sync time               %10.1f ms avg (%.1f connection events)\n",
+           m_central.completed_syncs ? (double)m_central.sync_time_total_us / m_central.completed_syncs / 1000.0 : 0.0,
+           m_central.completed_syncs ? (double)m_central.sync_conn_events_total / m_central.completed_syncs : 0.0);
+    if (g_sim_options.bulk_sync)
+    {
+        printf("  log transfers           %10llu blocks (%llu bytes, %llu failed syncs)\n",
+               (unsigned long long)m_central.bulk_blocks, (unsigned long long)m_central.bulk_bytes,
+               (unsigned long long)m_central.bulk_errors);
+        printf("  log transfer throughput %10.0f B/s (%.0f bytes in %.1f ms avg)\n",
+               m_central.bulk_time_total_us ? (double)m_central.bulk_bytes * SIM_US_PER_S / m_central.bulk_time_total_us : 0.0,
+               m_central.bulk_transfers ? (double)m_central.bulk_bytes / m_central.bulk_transfers : 0.0,
+               m_central.bulk_transfers ? (double)m_central.bulk_time_total_us / m_central.bulk_transfers / 1000.0 : 0.0);
+    }
+    if (!g_sim_options.bulk_sync)
+    {
+        printf("  legacy log entries read %10llu (%llu log reads skipped, the head had not moved)\n",
+               (unsigned long long)m_central.log_entries_read, (unsigned long long)m_central.log_reads_skipped);
+    }
+    printf("  device clock            %10.1f ms avg error, %.1f ms max (%llu reads, %llu before it was set)\n",
+           m_central.clock_reads ? m_central.clock_error_total_ms / m_central.clock_reads : 0.0,
+           m_central.clock_error_max_ms, (unsigned long long)m_central.clock_reads,
+           (unsigned long long)m_central.clock_unset_reads);
+    if (g_sim_options.bulk_sync)
+    {
+        timestamp_report();
+    }
+    if (m_config_setting_count > 0)
+    {
+        printf("  configuration writes    %10llu (%llu refused)\n",
+               (unsigned long long)m_central.config_writes, (unsigned long long)m_central.config_refused);
+    }
+    printf("  att requests            %10llu (%llu bytes read)\n",
+           (unsigned long long)m_central.att_requests, (unsigned long long)m_central.read_bytes);
+    printf("  notifications received  %10llu (%llu bytes)\n",
+           (unsigned long long)m_central.notifications, (unsigned long long)m_central.notification_bytes);
+    printf("  last values             %10.1f C, %d %%RH, battery %d %%\n",
+           m_central.temperature, m_central.humidity, m_central.battery);
+    printf("  battery estimate        %10d mV, %d days left (supply now %.3f V)\n",
+           m_central.battery_mv, m_central.battery_days, sim_battery_voltage());
+    if (g_sim_options.dump_log && g_sim_options.bulk_sync)
+    {
+        dump_compressed_log();
+    }
+    else if (g_sim_options.dump_log)
+    {
+        dump_log("temperature log", m_central.temp_log, m_central.temp_log_len, true);
+        dump_log("humidity log", m_central.hum_log, m_central.hum_log_len, false);
+    }
+}
@@ -0,0 +1,482 @@
+/** @file
+ *
+ * @brief RTemp host simulation - virtual clock, event queue and entry point.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+#include "sim.h"
+#include "nrf_soc.h"
+#include "our_service.h"
+
+#define SIM_MAX_EVENTS 64
+
+/* Rough nRF51822 + SHT21 figures used for the charge estimate. They are only meant to rank
+ * optimizations against each other, not to replace a measurement with a power analyzer. */
+#define SIM_I_SLEEP_UA          2.6         /**< System ON, RTC1 and 32 kHz crystal running. */
+#define SIM_I_CPU_UA            4400.0      /**< CPU running from flash at 16 MHz. */
+#define SIM_I_HFXO_UA           470.0       /**< 16 MHz crystal, on top of the CPU current. */
+#define SIM_Q_ADV_EVENT_UC      11.0        /**< One advertising event on 3 channels at -4 dBm. */
+#define SIM_Q_CONN_EVENT_UC     4.0         /**< One empty connection event. */
+#define SIM_Q_TX_PACKET_UC      1.2         /**< Extra charge for each data packet in a connection event. */
+#define SIM_I_SENSOR_UA         300.0       /**< SHT21 measuring, for as long as the conversions of its resolution take. */
+#define SIM_Q_FLASH_WORD_UC     0.2         /**< Writing one flash word. */
+#define SIM_Q_FLASH_ERASE_UC    90.0        /**< Erasing one flash page. */
+#define SIM_BATTERY_MAH         1000.0      /**< Two AAA alkaline cells in series. */
+
+typedef struct
+{
+    bool           active;
+    int            id;
+    sim_time_t     at;
+    bool           is_ble;
+    sim_event_fn_t fn;
+    void         * p_context;
+} sim_event_t;
+
+sim_options_t g_sim_options;
+sim_stats_t   g_sim_stats;
+
+static sim_time_t  m_now;
+static sim_event_t m_events[SIM_MAX_EVENTS];
+static int         m_next_event_id = 1;
+static uint32_t    m_random_state;
+static jmp_buf     m_finish;
+static bool        m_in_interrupt;          /**< An event handler runs, nothing preempts it. */
+static bool        m_masked;                /**< Thread mode is in a critical region. */
+
+extern int rtemp_main(void);
+
+sim_time_t sim_now(void)
+{
+    return m_now;
+}
+
+
+void sim_busy_us(uint64_t us)
+{
+    m_now                      += us;
+    g_sim_stats.cpu_active_us  += us;
+}
+
+
+/**@brief Index of the earliest scheduled event, -1 if there is none. */
+static int event_next(void)
+{
+    int next = -1;
+
+    for (int i = 0; i < SIM_MAX_EVENTS; i++)
+    {
+        if (m_events[i].active && ((next < 0) || (m_events[i].at < m_events[next].at)))
+        {
+            next = i;
+        }
+    }
+    return next;
+}
+
+
+/**@brief Runs the handler of an event that is due, at interrupt level, and accounts its latency. */
+static void event_dispatch(int index)
+{
+    sim_event_t event = m_events[index];
+    bool        in_interrupt = m_in_interrupt;
+
+    m_events[index].active = false;
+
+    sim_time_t latency = m_now - event.at;
+    g_sim_stats.events_dispatched++;
+    g_sim_stats.event_latency_total_us += latency;
+    if (latency > g_sim_stats.event_latency_max_us)
+    {
+        g_sim_stats.event_latency_max_us = latency;
+    }
+    if (event.is_ble)
+    {
+        g_sim_stats.ble_events++;
+        g_sim_stats.ble_latency_total_us += latency;
+        if (latency > g_sim_stats.ble_latency_max_us)
+        {
+            g_sim_stats.ble_latency_max_us = latency;
+        }
+    }
+
+    m_in_interrupt = true;
+    event.fn(event.p_context);
+    m_in_interrupt = in_interrupt;
+}
+
+
+/**@brief A busy-wait that is preempted, outside interrupts and critical regions, by the events
+ *        falling due before it ends; 0 delivers the ones already due. */
+void sim_thread_busy_us(uint64_t us)
+{
+    sim_time_t end = m_now + us;
+    int        next;
+
+    while (!m_in_interrupt && !m_masked && ((next = event_next()) >= 0) && (m_events[next].at <= end))
+    {
+        sim_time_t start;
+
+        if (m_events[next].at > m_now)
+        {
+            g_sim_stats.cpu_active_us += m_events[next].at - m_now;
+            m_now                      = m_events[next].at;
+        }
+        // The busy-wait resumes where it was interrupted
+        start = m_now;
+        g_sim_stats.preemptions++;
+        event_dispatch(next);
+        end  += m_now - start;
+    }
+    if (end > m_now)
+    {
+        g_sim_stats.cpu_active_us += end - m_now;
+        m_now                      = end;
+    }
+}
+
+
+/**@brief Critical region of thread mode: events wait for its end. */
+void sim_interrupts_mask(bool masked)
+{
+    m_masked = masked;
+    if (!masked)
+    {
+        sim_thread_busy_us(0);
+    }
+}
+
+
+int sim_schedule(sim_time_t at, sim_event_fn_t fn, void * p_context, bool is_ble)
+{
+    for (int i = 0; i < SIM_MAX_EVENTS; i++)
+    {
+        if (!m_events[i].active)
+        {
+            m_events[i].active    = true;
+            m_events[i].id        = m_next_event_id++;
+            m_events[i].at        = (at < m_now) ? m_now : at;
+            m_events[i].is_ble    = is_ble;
+            m_events[i].fn        = fn;
+            m_events[i].p_context = p_context;
+            return m_events[i].id;
+        }
+    }
+    sim_fatal("event queue full");
+    return 0;
+}
+
+
+void sim_cancel(int event_id)
+{
+    for (int i = 0; i < SIM_MAX_EVENTS; i++)
+    {
+        if (m_events[i].active && (m_events[i].id == event_id))
+        {
+            m_events[i].active = false;
+        }
+    }
+}
+
+
+uint32_t sim_random(void)
+{
+    // xorshift32, deterministic for a given --seed.
+    m_random_state ^= m_random_state << 13;
+    m_random_state ^= m_random_state >> 17;
+    m_random_state ^= m_random_state << 5;
+    return m_random_state;
+}
+
+
+void sim_trace(const char * p_fmt, ...)
+{
+    va_list args;
+
+    if (!g_sim_options.verbose)
+    {
+        return;
+    }
+    fprintf(stderr, "[%10.3f] ", (double)m_now / SIM_US_PER_S);
+    va_start(args, p_fmt);
+    vfprintf(stderr, p_fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+
+void sim_fatal(const char * p_fmt, ...)
+{
+    va_list args;
+
+    fprintf(stderr, "sim: fatal at t=%.3f s: ", (double)m_now / SIM_US_PER_S);
+    va_start(args, p_fmt);
+    vfprintf(stderr, p_fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+    exit(2);
+}
+
+
+/**@brief System OFF ends the run: only a reset (pin or power cycle) could wake the chip. */
+uint32_t sd_power_system_off(void)
+{
+    sim_trace("system off");
+    printf("sim: firmware entered System OFF at t=%.3f s\n", (double)m_now / SIM_US_PER_S);
+    g_sim_options.duration = m_now;
+    longjmp(m_finish, 1);
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Sleeps until the next scheduled event and delivers it, like WFE plus the ISR it wakes.
+ *
+ * @details Everything the firmware does in interrupts runs at the same application priority, so
+ *          a long handler delays every event behind it. Thread mode (main and the scheduler
+ *          events it runs) is preempted by events that fall due while it busy-waits, see
+ *          sim_thread_busy_us(). The delays are what the latency counters measure.
+ */
+uint32_t sd_app_evt_wait(void)
+{
+    int next;
+
+    sim_hw_poll();
+
+    next = event_next();
+    if ((next < 0) || (m_events[next].at > g_sim_options.duration))
+    {
+        if (m_now < g_sim_options.duration)
+        {
+            g_sim_stats.cpu_sleep_us += g_sim_options.duration - m_now;
+            m_now                     = g_sim_options.duration;
+        }
+        longjmp(m_finish, 1);
+    }
+
+    if (m_events[next].at > m_now)
+    {
+        g_sim_stats.cpu_sleep_us += m_events[next].at - m_now;
+        m_now                     = m_events[next].at;
+    }
+
+    g_sim_stats.wakeups++;
+    event_dispatch(next);
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Prints the firmware's own counters, as last published on the debug characteristic,
+ *        next to what the simulator measured for the same quantities. */
+static void profile_report(void)
+{
+#if POWER_PROFILE_ENABLED
+    uint16_t        handle = sim_gatts_find(BLE_UUID_CHAR_POWER_PROFILE, 0);
+    power_profile_t profile;
+
+    if ((handle == BLE_GATT_HANDLE_INVALID) || (sim_gatts_value_len(handle) != sizeof(profile)))
+    {
+        return;
+    }
+    memcpy(&profile, sim_gatts_value(handle), sizeof(profile));
+    printf("Firmware power profile (debug characteristic)\n");
+    printf("  measurements            %10u\n", profile.measurements);
+    printf("  busy-wait               %10.3f s (simulator: %.3f s cpu active)\n",
+           (double)profile.busy_wait_us / SIM_US_PER_S, (double)g_sim_stats.cpu_active_us / SIM_US_PER_S);
+    printf("  i2c bus time            %10.3f s, %.3f ms in the last measurement\n",
+           (double)profile.i2c_us / SIM_US_PER_S, profile.i2c_us_last / 1000.0);
+    printf("  hfclk on                %10.3f s (simulator: %.3f s)\n",
+           (double)profile.hfclk_us / SIM_US_PER_S, (double)g_sim_stats.hfxo_on_us / SIM_US_PER_S);
+    printf("  notifications           %10u (%u bytes)\n", profile.notifications, profile.notification_bytes);
+#endif
+}
+
+
+static void report(double wall_s)
+{
+    sim_softdevice_account();
+
+    double days      = (double)m_now / SIM_US_PER_DAY;
+    double q_cpu     = SIM_I_CPU_UA * g_sim_stats.cpu_active_us / SIM_US_PER_S;
+    double q_sleep   = SIM_I_SLEEP_UA * g_sim_stats.cpu_sleep_us / SIM_US_PER_S;
+    double q_hfxo    = SIM_I_HFXO_UA * g_sim_stats.hfxo_on_us / SIM_US_PER_S;
+    double q_radio   = SIM_Q_ADV_EVENT_UC * g_sim_stats.adv_events
+                     + SIM_Q_CONN_EVENT_UC * g_sim_stats.conn_events
+                     + SIM_Q_TX_PACKET_UC * g_sim_stats.tx_packets;
+    double q_sensor  = SIM_I_SENSOR_UA * g_sim_stats.sensor_busy_us / SIM_US_PER_S;
+    double q_flash   = SIM_Q_FLASH_WORD_UC * g_sim_stats.flash_writes
+                     + SIM_Q_FLASH_ERASE_UC * g_sim_stats.flash_erases;
+    double q_total   = q_cpu + q_sleep + q_hfxo + q_radio + q_sensor + q_flash;
+    double i_avg_ua  = (m_now > 0) ? q_total / ((double)m_now / SIM_US_PER_S) : 0.0;
+    double life_days = (i_avg_ua > 0) ? (SIM_BATTERY_MAH * 1000.0 / i_avg_ua) / 24.0 : 0.0;
+
+    printf("RTemp host simulation\n");
+    printf("  simulated time          %10.2f days (%.2f s wall clock)\n", days, wall_s);
+    printf("  cpu active              %10.3f s (%.4f %%)\n",
+           (double)g_sim_stats.cpu_active_us / SIM_US_PER_S,
+           100.0 * g_sim_stats.cpu_active_us / (double)(m_now ? m_now : 1));
+    printf("  hfxo on                 %10.3f s\n", (double)g_sim_stats.hfxo_on_us / SIM_US_PER_S);
+    printf("  wakeups                 %10llu\n", (unsigned long long)g_sim_stats.wakeups);
+    printf("  sensor conversions      %10llu (%llu i2c transactions, %.3f s converting)\n",
+           (unsigned long long)g_sim_stats.sensor_conversions,
+           (unsigned long long)g_sim_stats.i2c_transactions,
+           (double)g_sim_stats.sensor_busy_us / SIM_US_PER_S);
+    printf("  adc samples             %10llu\n", (unsigned long long)g_sim_stats.adc_samples);
+    printf("  advertising events      %10llu\n", (unsigned long long)g_sim_stats.adv_events);
+    printf("  connection events       %10llu (%llu data packets)\n",
+           (unsigned long long)g_sim_stats.conn_events,
+           (unsigned long long)g_sim_stats.tx_packets);
+    printf("  notifications           %10llu\n", (unsigned long long)g_sim_stats.notifications);
+    printf("  gatts value_set         %10llu calls, %llu bytes\n",
+           (unsigned long long)g_sim_stats.value_sets,
+           (unsigned long long)g_sim_stats.value_set_bytes);
+    printf("  flash                   %10llu words written, %llu pages erased\n",
+           (unsigned long long)g_sim_stats.flash_writes,
+           (unsigned long long)g_sim_stats.flash_erases);
+    printf("  event latency           %10.3f ms avg, %.3f ms max (%llu events)\n",
+           g_sim_stats.events_dispatched ? (double)g_sim_stats.event_latency_total_us / g_sim_stats.events_dispatched / 1000.0 : 0.0,
+           (double)g_sim_stats.event_latency_max_us / 1000.0,
+           (unsigned long long)g_sim_stats.events_dispatched);
+    printf("  ble event latency       %10.3f ms avg, %.3f ms max (%llu events)\n",
+           g_sim_stats.ble_events ? (double)g_sim_stats.ble_latency_total_us / g_sim_stats.ble_events / 1000.0 : 0.0,
+           (double)g_sim_stats.ble_latency_max_us / 1000.0,
+           (unsigned long long)g_sim_stats.ble_events);
+    printf("  thread preemptions      %10llu\n", (unsigned long long)g_sim_stats.preemptions);
+    printf("  charge estimate         %10.1f mC (cpu %.1f, sleep %.1f, hfxo %.1f, radio %.1f, sensor %.1f, flash %.1f)\n",
+           q_total / 1000.0, q_cpu / 1000.0, q_sleep / 1000.0, q_hfxo / 1000.0,
+           q_radio / 1000.0, q_sensor / 1000.0, q_flash / 1000.0);
+    printf("  average current         %10.2f uA (~%.0f days on %.0f mAh)\n",
+           i_avg_ua, life_days, SIM_BATTERY_MAH);
+
+    sim_softdevice_report();
+    sim_sdk_report();
+    sim_central_report();
+    sim_scanner_report();
+    profile_report();
+}
+
+
+static void usage(const char * p_name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --days N            simulated run time in days (default 7)\n"
+            "  --hours N           simulated run time in hours\n"
+            "  --seed N            environment and radio jitter seed (default 1)\n"
+            "  --client-period N   connect a central every N minutes (default 0 = never)\n"
+            "  --client-stay N     seconds the central stays connected (default 10)\n"
+            "  --bulk-sync         the central fetches the compressed log through the log control point\n"
+            "                      instead of reading the legacy logs\n"
+            "  --full-sync         like --bulk-sync, but the whole log every time\n"
+            "  --log-full-reads    read both legacy logs whole every time, not only the entries since the\n"
+            "                      log head of the last sync\n"
+            "  --scan-period N     a scanner picks up an advertising packet every N seconds (default 0 = never)\n"
+            "  --dump-log          print the decoded logs at the end\n"
+            "  --flash-image FILE  load the flash from FILE (if it exists) and save it there at the end\n"
+            "  --config LIST       the central writes the configuration fields in LIST (name=value,...)\n"
+            "  --verbose           trace BLE and sensor activity to stderr\n",
+            p_name);
+}
+
+
+int main(int argc, char * argv[])
+{
+    g_sim_options.duration          = 7 * SIM_US_PER_DAY;
+    g_sim_options.seed              = 1;
+    g_sim_options.client_period_min = 0;
+    g_sim_options.client_stay_s     = 10;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char * p_arg   = argv[i];
+        const char * p_value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if ((strcmp(p_arg, "--days") == 0) && p_value)
+        {
+            g_sim_options.duration = (sim_time_t)(atof(p_value) * SIM_US_PER_DAY);
+            i++;
+        }
+        else if ((strcmp(p_arg, "--hours") == 0) && p_value)
+        {
+            g_sim_options.duration = (sim_time_t)(atof(p_value) * SIM_US_PER_HOUR);
+            i++;
+        }
+        else if ((strcmp(p_arg, "--seed") == 0) && p_value)
+        {
+            g_sim_options.seed = (uint32_t)strtoul(p_value, NULL, 0);
+            i++;
+        }
+        else if ((strcmp(p_arg, "--client-period") == 0) && p_value)
+        {
+            g_sim_options.client_period_min = (uint32_t)strtoul(p_value, NULL, 0);
+            i++;
+        }
+        else if ((strcmp(p_arg, "--client-stay") == 0) && p_value)
+        {
+            g_sim_options.client_stay_s = (uint32_t)strtoul(p_value, NULL, 0);
+            i++;
+        }
+        else if ((strcmp(p_arg, "--scan-period") == 0) && p_value)
+        {
+            g_sim_options.scan_period_s = (uint32_t)strtoul(p_value, NULL, 0);
+            i++;
+        }
+        else if ((strcmp(p_arg, "--flash-image") == 0) && p_value)
+        {
+            g_sim_options.p_flash_image = p_value;
+            i++;
+        }
+        else if ((strcmp(p_arg, "--config") == 0) && p_value)
+        {
+            g_sim_options.p_config = p_value;
+            i++;
+        }
+        else if (strcmp(p_arg, "--bulk-sync") == 0)
+        {
+            g_sim_options.bulk_sync = true;
+        }
+        else if (strcmp(p_arg, "--full-sync") == 0)
+        {
+            g_sim_options.bulk_sync = true;
+            g_sim_options.full_sync = true;
+        }
+        else if (strcmp(p_arg, "--log-full-reads") == 0)
+        {
+            g_sim_options.log_full_reads = true;
+        }
+        else if (strcmp(p_arg, "--dump-log") == 0)
+        {
+            g_sim_options.dump_log = true;
+        }
+        else if (strcmp(p_arg, "--verbose") == 0)
+        {
+            g_sim_options.verbose = true;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    m_random_state = g_sim_options.seed ? g_sim_options.seed : 1;
+
+    sim_hw_init();
+    sim_sht2x_init();
+    sim_softdevice_init();
+    sim_central_init();
+    sim_scanner_init();
+
+    clock_t wall_start = clock();
+    if (setjmp(m_finish) == 0)
+    {
+        rtemp_main();
+        sim_fatal("firmware main() returned");
+    }
+    report((double)(clock() - wall_start) / CLOCKS_PER_SEC);
+    sim_flash_save();
+    return 0;
+}
@@ -0,0 +1,887 @@
+/** @file
+ *
+ * @brief RTemp host simulation - GPIO, delays, clock control, ADC, PPI, TWI and NVIC.
+ */
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+#include "nrf.h"
+#include "nrf51_bitfields.h"
+#include "nrf_gpio.h"
+#include "nrf_delay.h"
+#include "nrf_soc.h"
+
+#define SIM_GPIO_PINS           32
+#define SIM_HFXO_STARTUP_US     800         /**< Typical 16 MHz crystal start-up time. */
+#define SIM_SVC_CALL_US         1           /**< Cost of one SoftDevice SVC call seen from the application. */
+#define SIM_FLASH_PAGE_SIZE     1024
+#define SIM_FLASH_PAGES         256
+#define SIM_FLASH_WORD_US       46          /**< nRF51 worst case word write time. */
+#define SIM_FLASH_ERASE_US      22300       /**< nRF51 worst case page erase time. */
+#define SIM_TWI_TXD_EMPTY       0xFFFFFFFFUL /**< TXD value meaning "nothing written"; the firmware only writes bytes. */
+#define SIM_TWI_STRETCH_POLL_US 50          /**< How often a stretched clock is checked again. */
+#define SIM_RADIO_SAG_V         0.03        /**< Supply drop at the end of a radio event, from the cells' internal resistance. */
+#define SIM_RADIO_RECOVERY_US   1000.0      /**< Time constant of the recovery after it. */
+#define SIM_PPI_APP_CHANNELS    8           /**< Channels the S110 leaves to the application. */
+
+NRF_ADC_Type   sim_nrf_adc;
+NRF_CLOCK_Type sim_nrf_clock;
+NRF_TWI_Type   sim_nrf_twi1;
+NRF_GPIO_Type  sim_nrf_gpio;
+NRF_FICR_Type  sim_nrf_ficr;
+NRF_UICR_Type  sim_nrf_uicr;
+
+extern void ADC_IRQHandler(void);
+extern void SPI1_TWI1_IRQHandler(void) __attribute__((weak)); // Only linked with the TWI backend
+extern void SWI1_IRQHandler(void) __attribute__((weak));      // Radio notification
+
+static struct
+{
+    uint32_t dir;                           /**< 1 = output. */
+    uint32_t out;
+    void   (*on_change[SIM_GPIO_PINS])(void);
+} m_gpio;
+
+static uint32_t   m_irq_enabled;
+static bool       m_hfclk_requested;
+static sim_time_t m_hfclk_request_time;
+static uint32_t   m_hfclk_requests;         /**< Tells a stale start-up event from the current one. */
+static uint32_t   m_swi1_arms;              /**< Tells a stale radio notification from the current one. */
+static uint32_t   m_ppi_enabled;
+static uint8_t    m_critical_region;        /**< Thread mode holds the application interrupts off. */
+static struct
+{
+    const volatile void * p_event;
+    volatile uint32_t   * p_task;
+} m_ppi[SIM_PPI_APP_CHANNELS];
+static uint8_t    m_flash[SIM_FLASH_PAGE_SIZE * SIM_FLASH_PAGES];
+
+typedef enum
+{
+    TWI_IDLE,                               /**< Bus free. */
+    TWI_BUSY,                               /**< A byte, START or STOP is on the bus. */
+    TWI_TX_WAIT,                            /**< Holding the bus after a byte was sent, waiting for TXD, STARTRX or STOP. */
+    TWI_RX_SUSPENDED,                       /**< Holding the bus after a byte was received, waiting for RESUME or STOP. */
+    TWI_ERROR_WAIT                          /**< Slave NACKed, waiting for STOP. */
+} twi_state_t;
+
+/**@brief TWI1 model. It drives the bus lines bit by bit into the sensor model, so the sensor
+ *        sees exactly the same protocol as from the bit-banged driver. */
+static struct
+{
+    twi_state_t state;
+    uint32_t    scl;                        /**< Master level of SCL, 1 = released. */
+    uint32_t    sda;                        /**< Master level of SDA, 1 = released. */
+    bool        stop_pending;
+    uint8_t     txd;
+} m_twi;
+
+static struct
+{
+    bool             busy;
+    bool             is_erase;
+    uint32_t         address;
+    uint32_t         words;
+    uint32_t const * p_src;
+} m_flash_op;
+
+static void gpio_changed(uint32_t pin_number)
+{
+    if ((pin_number < SIM_GPIO_PINS) && (m_gpio.on_change[pin_number] != NULL))
+    {
+        m_gpio.on_change[pin_number]();
+    }
+}
+
+
+void sim_gpio_attach(uint32_t pin, void (*on_change)(void))
+{
+    m_gpio.on_change[pin] = on_change;
+}
+
+
+uint32_t sim_gpio_master_level(uint32_t pin)
+{
+    if (NRF_TWI1->ENABLE == TWI_ENABLE_ENABLE_Enabled)
+    {
+        if (pin == NRF_TWI1->PSELSCL)
+        {
+            return m_twi.scl;
+        }
+        if (pin == NRF_TWI1->PSELSDA)
+        {
+            return m_twi.sda;
+        }
+    }
+    // Released pins float high: the I2C lines have external pull-ups on the board.
+    if (m_gpio.dir & (1UL << pin))
+    {
+        return (m_gpio.out >> pin) & 1UL;
+    }
+    return 1;
+}
+
+
+void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+    m_gpio.dir |= (1UL << pin_number);
+    gpio_changed(pin_number);
+}
+
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config)
+{
+    (void)pull_config;
+    m_gpio.dir &= ~(1UL << pin_number);
+    gpio_changed(pin_number);
+}
+
+
+void nrf_gpio_pin_set(uint32_t pin_number)
+{
+    m_gpio.out |= (1UL << pin_number);
+    gpio_changed(pin_number);
+}
+
+
+void nrf_gpio_pin_clear(uint32_t pin_number)
+{
+    m_gpio.out &= ~(1UL << pin_number);
+    gpio_changed(pin_number);
+}
+
+
+void nrf_gpio_pin_toggle(uint32_t pin_number)
+{
+    m_gpio.out ^= (1UL << pin_number);
+    gpio_changed(pin_number);
+}
+
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    uint32_t level = sim_gpio_master_level(pin_number);
+
+    if (m_gpio.on_change[pin_number] != NULL)
+    {
+        // Wired-AND with whatever the sensor drives on the bus.
+        level &= (pin_number == SIM_SDA_PIN) ? sim_sht2x_sda_level() : sim_sht2x_scl_level();
+    }
+    return level;
+}
+
+
+void nrf_delay_us(uint32_t number_of_us)
+{
+    sim_thread_busy_us(number_of_us);
+}
+
+
+void nrf_delay_ms(uint32_t number_of_ms)
+{
+    sim_thread_busy_us((uint64_t)number_of_ms * SIM_US_PER_MS);
+}
+
+
+/**@brief An event: triggers the tasks of the enabled PPI channels on it, at once. */
+static void ppi_event(volatile uint32_t * p_event)
+{
+    bool triggered = false;
+
+    *p_event = 1;
+    for (uint8_t i = 0; i < SIM_PPI_APP_CHANNELS; i++)
+    {
+        if ((m_ppi_enabled & (1UL << i)) && (m_ppi[i].p_event == p_event) && (m_ppi[i].p_task != NULL))
+        {
+            *m_ppi[i].p_task = 1;
+            triggered        = true;
+        }
+    }
+    if (triggered)
+    {
+        sim_hw_poll();
+    }
+}
+
+
+static void hfclk_started(void * p_context)
+{
+    if (m_hfclk_requested && ((uint32_t)(uintptr_t)p_context == m_hfclk_requests))
+    {
+        ppi_event(&NRF_CLOCK->EVENTS_HFCLKSTARTED);
+        sim_sys_dispatch(NRF_EVT_HFCLKSTARTED);
+    }
+}
+
+
+uint32_t sd_clock_hfclk_request(void)
+{
+    sim_busy_us(SIM_SVC_CALL_US);
+    if (!m_hfclk_requested)
+    {
+        m_hfclk_requested    = true;
+        m_hfclk_request_time = sim_now();
+        m_hfclk_requests++;
+        sim_schedule(sim_now() + SIM_HFXO_STARTUP_US, hfclk_started, (void *)(uintptr_t)m_hfclk_requests, false);
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_clock_hfclk_release(void)
+{
+    sim_busy_us(SIM_SVC_CALL_US);
+    if (m_hfclk_requested)
+    {
+        m_hfclk_requested         = false;
+        g_sim_stats.hfxo_on_us   += sim_now() - m_hfclk_request_time;
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_clock_hfclk_is_running(uint32_t * p_is_running)
+{
+    sim_busy_us(SIM_SVC_CALL_US);
+    *p_is_running = m_hfclk_requested && (sim_now() >= m_hfclk_request_time + SIM_HFXO_STARTUP_US);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ppi_channel_enable_set(uint32_t channel_enable_set_msk)
+{
+    sim_busy_us(SIM_SVC_CALL_US);
+    if (channel_enable_set_msk >> SIM_PPI_APP_CHANNELS)
+    {
+        return NRF_ERROR_SOC_PPI_INVALID_CHANNEL;
+    }
+    m_ppi_enabled |= channel_enable_set_msk;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ppi_channel_enable_clr(uint32_t channel_enable_clr_msk)
+{
+    sim_busy_us(SIM_SVC_CALL_US);
+    if (channel_enable_clr_msk >> SIM_PPI_APP_CHANNELS)
+    {
+        return NRF_ERROR_SOC_PPI_INVALID_CHANNEL;
+    }
+    m_ppi_enabled &= ~channel_enable_clr_msk;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ppi_channel_assign(uint8_t channel_num, const volatile void * evt_endpoint, const volatile void * task_endpoint)
+{
+    sim_busy_us(SIM_SVC_CALL_US);
+    if (channel_num >= SIM_PPI_APP_CHANNELS)
+    {
+        return NRF_ERROR_SOC_PPI_INVALID_CHANNEL;
+    }
+    m_ppi[channel_num].p_event = evt_endpoint;
+    m_ppi[channel_num].p_task  = (volatile uint32_t *)task_endpoint;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+    (void)IRQn;
+    (void)priority;
+    sim_busy_us(SIM_SVC_CALL_US);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_EnableIRQ(IRQn_Type IRQn)
+{
+    NVIC_EnableIRQ(IRQn);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_DisableIRQ(IRQn_Type IRQn)
+{
+    NVIC_DisableIRQ(IRQn);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    (void)IRQn;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_critical_region_enter(uint8_t * p_is_nested_critical_region)
+{
+    sim_busy_us(SIM_SVC_CALL_US);
+    *p_is_nested_critical_region = m_critical_region;
+    m_critical_region            = 1;
+    sim_interrupts_mask(true);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_critical_region_exit(uint8_t is_nested_critical_region)
+{
+    sim_busy_us(SIM_SVC_CALL_US);
+    if (!is_nested_critical_region)
+    {
+        m_critical_region = 0;
+        sim_interrupts_mask(false);
+    }
+    return NRF_SUCCESS;
+}
+
+
+static void swi1_arm(void);
+
+
+/**@brief Radio notification: SWI1 fires at the end of every radio event while it is enabled. */
+static void swi1_fire(void * p_context)
+{
+    if (((uint32_t)(uintptr_t)p_context != m_swi1_arms) || !(m_irq_enabled & (1UL << SWI1_IRQn)))
+    {
+        return;
+    }
+    if (SWI1_IRQHandler != NULL)
+    {
+        sim_trace("radio: notification, radio inactive");
+        SWI1_IRQHandler();
+    }
+    swi1_arm();
+}
+
+
+static void swi1_arm(void)
+{
+    sim_time_t at;
+
+    m_swi1_arms++;
+    if (m_irq_enabled & (1UL << SWI1_IRQn))
+    {
+        // Radio events that start later, or a radio that goes quiet, are not followed: the
+        // firmware falls back on a timer for those.
+        at = sim_radio_next_inactive();
+        if (at != 0)
+        {
+            sim_schedule(at, swi1_fire, (void *)(uintptr_t)m_swi1_arms, false);
+        }
+    }
+}
+
+
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    m_irq_enabled |= (1UL << IRQn);
+    if (IRQn == SWI1_IRQn)
+    {
+        swi1_arm();
+    }
+}
+
+
+void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    m_irq_enabled &= ~(1UL << IRQn);
+    if (IRQn == SWI1_IRQn)
+    {
+        swi1_arm();
+    }
+}
+
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    (void)IRQn;
+}
+
+
+void NVIC_SystemReset(void)
+{
+    sim_fatal("NVIC_SystemReset() - the firmware hit app_error_handler()");
+}
+
+
+uint8_t * sim_flash_ptr(uint32_t address)
+{
+    if (address >= sizeof(m_flash))
+    {
+        sim_fatal("flash access outside the chip at 0x%08X", address);
+    }
+    return &m_flash[address];
+}
+
+
+/**@brief Writes the flash to the image file, as a power cycle would leave it: an operation still
+ *        in progress is lost. */
+void sim_flash_save(void)
+{
+    if (g_sim_options.p_flash_image)
+    {
+        FILE * p_file = fopen(g_sim_options.p_flash_image, "wb");
+        if (!p_file || (fwrite(m_flash, 1, sizeof(m_flash), p_file) != sizeof(m_flash)))
+        {
+            sim_fatal("cannot write the flash image %s", g_sim_options.p_flash_image);
+        }
+        fclose(p_file);
+    }
+}
+
+
+/**@brief Applies a flash operation once the SoftDevice has found time for it. */
+static void flash_done(void * p_context)
+{
+    (void)p_context;
+    if (m_flash_op.is_erase)
+    {
+        memset(&m_flash[m_flash_op.address], 0xFF, SIM_FLASH_PAGE_SIZE);
+        g_sim_stats.flash_erases++;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < m_flash_op.words; i++)
+        {
+            uint32_t word;
+
+            // Programming can only clear bits.
+            memcpy(&word, &m_flash[m_flash_op.address + 4 * i], 4);
+            word &= m_flash_op.p_src[i];
+            memcpy(&m_flash[m_flash_op.address + 4 * i], &word, 4);
+        }
+        g_sim_stats.flash_writes += m_flash_op.words;
+    }
+    m_flash_op.busy = false;
+    sim_sys_dispatch(NRF_EVT_FLASH_OPERATION_SUCCESS);
+}
+
+
+/**@brief The destination is a chip address (as computed from pstorage_platform.h), not a host pointer. */
+uint32_t sd_flash_write(uint32_t * const p_dst, uint32_t const * const p_src, uint32_t size)
+{
+    uint32_t address = (uint32_t)(uintptr_t)p_dst;
+
+    sim_busy_us(SIM_SVC_CALL_US);
+    if (m_flash_op.busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if ((address & 3) || (size == 0) || (address + 4 * size > sizeof(m_flash)))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    m_flash_op.busy     = true;
+    m_flash_op.is_erase = false;
+    m_flash_op.address  = address;
+    m_flash_op.words    = size;
+    m_flash_op.p_src    = p_src;
+    sim_schedule(sim_now() + (sim_time_t)size * SIM_FLASH_WORD_US, flash_done, NULL, false);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_flash_page_erase(uint32_t page_number)
+{
+    sim_busy_us(SIM_SVC_CALL_US);
+    if (m_flash_op.busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (page_number >= SIM_FLASH_PAGES)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    m_flash_op.busy     = true;
+    m_flash_op.is_erase = true;
+    m_flash_op.address  = page_number * SIM_FLASH_PAGE_SIZE;
+    sim_schedule(sim_now() + SIM_FLASH_ERASE_US, flash_done, NULL, false);
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Supply voltage of two AAA alkaline cells: a slow linear sag plus a few mV of noise, and a
+ *        dip that recovers after every radio event. */
+double sim_battery_voltage(void)
+{
+    double     days  = (double)sim_now() / SIM_US_PER_DAY;
+    double     noise = ((double)(sim_random() % 11) - 5.0) / 1000.0;
+    double     v     = 3.05 - 0.004 * days + noise;
+    sim_time_t radio = sim_radio_last_inactive();
+
+    if (radio != 0)
+    {
+        v -= SIM_RADIO_SAG_V * exp(-(double)(sim_now() - radio) / SIM_RADIO_RECOVERY_US);
+    }
+
+    return (v < 1.8) ? 1.8 : v;
+}
+
+
+static void adc_end(void * p_context)
+{
+    (void)p_context;
+
+    uint32_t res    = (NRF_ADC->CONFIG & ADC_CONFIG_RES_Msk) >> ADC_CONFIG_RES_Pos;
+    uint32_t inpsel = (NRF_ADC->CONFIG & ADC_CONFIG_INPSEL_Msk) >> ADC_CONFIG_INPSEL_Pos;
+    uint32_t full   = (res == ADC_CONFIG_RES_10bit) ? 1023 : (res == ADC_CONFIG_RES_9bit) ? 511 : 255;
+    double   input  = sim_battery_voltage();
+
+    if (inpsel == ADC_CONFIG_INPSEL_SupplyOneThirdPrescaling)
+    {
+        input /= 3.0;
+    }
+    else if (inpsel == ADC_CONFIG_INPSEL_SupplyTwoThirdsPrescaling)
+    {
+        input = input * 2.0 / 3.0;
+    }
+
+    uint32_t result = (uint32_t)(input / 1.2 * full + 0.5);
+    *(uint32_t *)&NRF_ADC->RESULT = (result > full) ? full : result;
+    *(uint32_t *)&NRF_ADC->BUSY   = 0;
+    NRF_ADC->EVENTS_END           = 1;
+    g_sim_stats.adc_samples++;
+
+    if ((NRF_ADC->INTENSET & ADC_INTENSET_END_Msk) && (m_irq_enabled & (1UL << ADC_IRQn)))
+    {
+        ADC_IRQHandler();
+    }
+}
+
+
+static void twi_scl(uint32_t level)
+{
+    m_twi.scl = level;
+    sim_sht2x_bus_changed();
+}
+
+
+static void twi_sda(uint32_t level)
+{
+    m_twi.sda = level;
+    sim_sht2x_bus_changed();
+}
+
+
+static uint32_t twi_sda_read(void)
+{
+    return m_twi.sda & sim_sht2x_sda_level();
+}
+
+
+/**@brief Time of n bits at the configured frequency, rounded up to whole microseconds. */
+static sim_time_t twi_bits_us(uint32_t bits)
+{
+    uint32_t bit_ns = (NRF_TWI1->FREQUENCY == TWI_FREQUENCY_FREQUENCY_K400) ? 2500 :
+                      (NRF_TWI1->FREQUENCY == TWI_FREQUENCY_FREQUENCY_K250) ? 4000 : 10000;
+
+    return ((sim_time_t)bits * bit_ns + 999) / 1000;
+}
+
+
+static void twi_start_condition(void)
+{
+    if (!m_twi.scl)
+    {
+        // Repeated START.
+        twi_sda(1);
+        twi_scl(1);
+    }
+    twi_sda(0);
+    twi_scl(0);
+}
+
+
+static void twi_stop_condition(void)
+{
+    twi_sda(0);
+    twi_scl(1);
+    twi_sda(1);
+}
+
+
+/**@brief Clocks out one byte. Returns true if the slave acknowledged it. */
+static bool twi_write_byte(uint8_t byte)
+{
+    bool ack;
+
+    for (int bit = 7; bit >= 0; bit--)
+    {
+        twi_sda((byte >> bit) & 1);
+        twi_scl(1);
+        twi_scl(0);
+    }
+    twi_sda(1);
+    twi_scl(1);
+    ack = (twi_sda_read() == 0);
+    twi_scl(0);
+    return ack;
+}
+
+
+/**@brief Clocks in the eight data bits of one byte. The ACK bit is sent separately. */
+static uint8_t twi_read_bits(void)
+{
+    uint8_t byte = 0;
+
+    for (int bit = 0; bit < 8; bit++)
+    {
+        twi_scl(1);
+        byte = (uint8_t)((byte << 1) | twi_sda_read());
+        twi_scl(0);
+    }
+    return byte;
+}
+
+
+static void twi_ack_bit(bool ack)
+{
+    twi_sda(ack ? 0 : 1);
+    twi_scl(1);
+    twi_scl(0);
+    twi_sda(1);
+}
+
+
+static void twi_poll(void);
+
+
+/**@brief Raises the TWI1 interrupt if an enabled event is set, then acts on what the handler did. */
+static void twi_irq(void)
+{
+    uint32_t pending = (NRF_TWI1->EVENTS_STOPPED  ? TWI_INTENSET_STOPPED_Msk   : 0) |
+                       (NRF_TWI1->EVENTS_RXDREADY ? TWI_INTENSET_RXDREADY_Msk : 0) |
+                       (NRF_TWI1->EVENTS_TXDSENT  ? TWI_INTENSET_TXDSENT_Msk  : 0) |
+                       (NRF_TWI1->EVENTS_ERROR    ? TWI_INTENSET_ERROR_Msk    : 0);
+
+    if ((pending & NRF_TWI1->INTENSET) && (m_irq_enabled & (1UL << SPI1_TWI1_IRQn)) &&
+        (SPI1_TWI1_IRQHandler != NULL))
+    {
+        SPI1_TWI1_IRQHandler();
+    }
+    twi_poll();
+}
+
+
+static void twi_nack(uint32_t errorsrc)
+{
+    NRF_TWI1->ERRORSRC     |= errorsrc;
+    NRF_TWI1->EVENTS_ERROR  = 1;
+    m_twi.state             = TWI_ERROR_WAIT;
+}
+
+
+/**@brief Ends a byte: a STOP requested while it was on the bus is executed now. */
+static bool twi_stop_if_pending(void)
+{
+    if (!m_twi.stop_pending)
+    {
+        return false;
+    }
+    m_twi.stop_pending       = false;
+    twi_stop_condition();
+    NRF_TWI1->EVENTS_STOPPED = 1;
+    m_twi.state              = TWI_IDLE;
+    return true;
+}
+
+
+static void twi_stop_done(void * p_context)
+{
+    (void)p_context;
+    twi_stop_condition();
+    NRF_TWI1->EVENTS_STOPPED = 1;
+    m_twi.state              = TWI_IDLE;
+    twi_irq();
+}
+
+
+static void twi_tx_done(void * p_context)
+{
+    (void)p_context;
+    if (!twi_write_byte(m_twi.txd))
+    {
+        twi_nack(TWI_ERRORSRC_DNACK_Msk);
+    }
+    else
+    {
+        NRF_TWI1->EVENTS_TXDSENT = 1;
+        m_twi.state              = TWI_TX_WAIT;
+    }
+    twi_stop_if_pending();
+    twi_irq();
+}
+
+
+static void twi_tx_address_done(void * p_context)
+{
+    (void)p_context;
+    twi_start_condition();
+    if (!twi_write_byte((uint8_t)(NRF_TWI1->ADDRESS << 1)))
+    {
+        twi_nack(TWI_ERRORSRC_ANACK_Msk);
+    }
+    else if (!twi_stop_if_pending())
+    {
+        // The TXD byte written before STARTTX goes out right behind the address.
+        m_twi.state = TWI_TX_WAIT;
+    }
+    twi_irq();
+}
+
+
+static void twi_rx_byte_done(void * p_context)
+{
+    uint8_t byte;
+
+    (void)p_context;
+    if (sim_sht2x_scl_level() == 0)
+    {
+        // Hold master: the TWI waits for as long as the slave stretches the clock.
+        sim_schedule(sim_now() + SIM_TWI_STRETCH_POLL_US, twi_rx_byte_done, NULL, false);
+        return;
+    }
+    byte = twi_read_bits();
+    *(uint32_t *)&NRF_TWI1->RXD = byte;
+    NRF_TWI1->EVENTS_RXDREADY   = 1;
+    if ((NRF_TWI1->SHORTS & TWI_SHORTS_BB_STOP_Msk) || m_twi.stop_pending)
+    {
+        // Last byte: NACK it and release the bus.
+        m_twi.stop_pending = true;
+        twi_ack_bit(false);
+        twi_stop_if_pending();
+    }
+    else
+    {
+        m_twi.state = TWI_RX_SUSPENDED;
+    }
+    twi_irq();
+}
+
+
+static void twi_rx_address_done(void * p_context)
+{
+    (void)p_context;
+    twi_start_condition();
+    if (!twi_write_byte((uint8_t)((NRF_TWI1->ADDRESS << 1) | 1)))
+    {
+        twi_nack(TWI_ERRORSRC_ANACK_Msk);
+        twi_stop_if_pending();
+        twi_irq();
+        return;
+    }
+    sim_schedule(sim_now() + twi_bits_us(9), twi_rx_byte_done, NULL, false);
+}
+
+
+/**@brief Acts on TWI1 task and TXD writes, like the peripheral does between bytes. */
+static void twi_poll(void)
+{
+    bool stop          = NRF_TWI1->TASKS_STOP;
+    bool start_tx      = NRF_TWI1->TASKS_STARTTX;
+    bool start_rx      = NRF_TWI1->TASKS_STARTRX;
+    bool resume        = NRF_TWI1->TASKS_RESUME;
+
+    NRF_TWI1->TASKS_STOP    = 0;
+    NRF_TWI1->TASKS_STARTTX = 0;
+    NRF_TWI1->TASKS_STARTRX = 0;
+    NRF_TWI1->TASKS_RESUME  = 0;
+    NRF_TWI1->TASKS_SUSPEND = 0;
+
+    if (NRF_TWI1->ENABLE != TWI_ENABLE_ENABLE_Enabled)
+    {
+        return;
+    }
+    if (m_twi.state == TWI_BUSY)
+    {
+        m_twi.stop_pending |= stop;
+        return;
+    }
+    if (start_tx)
+    {
+        m_twi.state = TWI_BUSY;
+        sim_schedule(sim_now() + twi_bits_us(10), twi_tx_address_done, NULL, false);
+    }
+    else if (start_rx)
+    {
+        m_twi.state = TWI_BUSY;
+        sim_schedule(sim_now() + twi_bits_us(10), twi_rx_address_done, NULL, false);
+    }
+    else if (stop && (m_twi.state != TWI_IDLE))
+    {
+        m_twi.state = TWI_BUSY;
+        sim_schedule(sim_now() + twi_bits_us(2), twi_stop_done, NULL, false);
+    }
+    else if (resume && (m_twi.state == TWI_RX_SUSPENDED))
+    {
+        twi_ack_bit(true);
+        m_twi.state = TWI_BUSY;
+        sim_schedule(sim_now() + twi_bits_us(9), twi_rx_byte_done, NULL, false);
+    }
+    else if ((m_twi.state == TWI_TX_WAIT) && (NRF_TWI1->TXD != SIM_TWI_TXD_EMPTY))
+    {
+        m_twi.txd     = (uint8_t)NRF_TWI1->TXD;
+        NRF_TWI1->TXD = SIM_TWI_TXD_EMPTY;
+        m_twi.state   = TWI_BUSY;
+        sim_schedule(sim_now() + twi_bits_us(9), twi_tx_done, NULL, false);
+    }
+}
+
+
+/**@brief Acts on TASKS register writes made since the last call. */
+void sim_hw_poll(void)
+{
+    if (NRF_ADC->TASKS_STOP)
+    {
+        NRF_ADC->TASKS_STOP = 0;
+    }
+    if (NRF_ADC->TASKS_START)
+    {
+        NRF_ADC->TASKS_START = 0;
+        if ((NRF_ADC->ENABLE == ADC_ENABLE_ENABLE_Enabled) && !NRF_ADC->BUSY)
+        {
+            uint32_t res = (NRF_ADC->CONFIG & ADC_CONFIG_RES_Msk) >> ADC_CONFIG_RES_Pos;
+
+            *(uint32_t *)&NRF_ADC->BUSY = 1;
+            sim_schedule(sim_now() + ((res == ADC_CONFIG_RES_10bit) ? 68 : (res == ADC_CONFIG_RES_9bit) ? 36 : 20),
+                         adc_end, NULL, false);
+        }
+    }
+    twi_poll();
+}
+
+
+void sim_hw_init(void)
+{
+    memset(&m_gpio, 0, sizeof(m_gpio));
+    memset(&sim_nrf_adc, 0, sizeof(sim_nrf_adc));
+    memset(&sim_nrf_clock, 0, sizeof(sim_nrf_clock));
+    memset(m_ppi, 0, sizeof(m_ppi));
+    m_ppi_enabled = 0;
+    memset(&sim_nrf_twi1, 0, sizeof(sim_nrf_twi1));
+    memset(&m_twi, 0, sizeof(m_twi));
+    m_twi.scl        = 1;
+    m_twi.sda        = 1;
+    sim_nrf_twi1.TXD = SIM_TWI_TXD_EMPTY;
+    memset(&m_flash_op, 0, sizeof(m_flash_op));
+    memset(m_flash, 0xFF, sizeof(m_flash));
+    if (g_sim_options.p_flash_image)
+    {
+        // A missing image is a blank chip, a short one leaves the rest erased.
+        FILE * p_file = fopen(g_sim_options.p_flash_image, "rb");
+        if (p_file)
+        {
+            (void)fread(m_flash, 1, sizeof(m_flash), p_file);
+            fclose(p_file);
+        }
+    }
+
+    *(uint32_t *)&sim_nrf_ficr.CODEPAGESIZE  = SIM_FLASH_PAGE_SIZE;
+    *(uint32_t *)&sim_nrf_ficr.CODESIZE      = SIM_FLASH_PAGES;
+    *(uint32_t *)&sim_nrf_ficr.DEVICEADDR[0] = 0x5EA1C0DEUL ^ g_sim_options.seed;
+    *(uint32_t *)&sim_nrf_ficr.DEVICEADDR[1] = 0x0000C0DEUL;
+    sim_nrf_uicr.BOOTLOADERADDR              = 0xFFFFFFFFUL;
+}
@@ -0,0 +1,163 @@
+/** @file
+ *
+ * @brief RTemp host simulation - a gateway listening to the advertising.
+ *
+ * Every --scan-period seconds the scanner listens until the next advertising
+ * packet, if the device is advertising (it is not while a central is
+ * connected), and decodes the readings broadcast.c puts in the manufacturer
+ * specific data. It never connects, so it costs the device nothing beyond the
+ * advertising it does anyway. The report gives how many readings arrived,
+ * how many the measurement counter says were missed, and how far the
+ * received temperature was from the environment at that moment.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "sim.h"
+#include "broadcast.h"
+
+static struct
+{
+    uint64_t   packets;                     /**< Advertising packets picked up. */
+    uint64_t   readings;                    /**< Packets with a counter not seen before. */
+    uint64_t   missed;                      /**< Counter values skipped between two readings. */
+    uint64_t   not_advertising;             /**< Scans that found nothing. */
+    sim_time_t wait_total_us;               /**< Time spent listening for a packet. */
+    sim_time_t wait_max_us;
+    sim_time_t scan_started;
+    bool       have_counter;
+    uint8_t    counter;
+    double     error_max;                   /**< Worst |received - environment| temperature, C. */
+    double     error_total;
+    double     temperature;
+    double     humidity;
+    int        battery;
+} m_scanner;
+
+
+/**@brief Finds the readings in an advertising packet.
+ *
+ * @return      Pointer to the BROADCAST_DATA_LEN bytes after the company identifier, or NULL.
+ */
+static const uint8_t * find_readings(const uint8_t * p_data, uint8_t len)
+{
+    uint8_t i = 0;
+
+    while (i + 1 < len)
+    {
+        uint8_t field_len = p_data[i];
+
+        if ((field_len == 0) || (i + 1 + field_len > len))
+        {
+            break;
+        }
+        if ((p_data[i + 1] == BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA) &&
+            (field_len == 1 + 2 + BROADCAST_DATA_LEN) &&
+            ((p_data[i + 2] | (p_data[i + 3] << 8)) == BROADCAST_COMPANY_ID) &&
+            (p_data[i + 4] == BROADCAST_FORMAT))
+        {
+            return &p_data[i + 4];
+        }
+        i += 1 + field_len;
+    }
+    return NULL;
+}
+
+
+static void packet_received(void * p_context)
+{
+    uint8_t         pdu[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t         len;
+    bool            connectable;
+    const uint8_t * p_readings;
+    sim_time_t      wait = sim_now() - m_scanner.scan_started;
+
+    (void)p_context;
+    if (!sim_ble_is_advertising())
+    {
+        m_scanner.not_advertising++;
+        return;
+    }
+    sim_adv_pdu(pdu, &len, &connectable);
+    m_scanner.packets++;
+    m_scanner.wait_total_us += wait;
+    if (wait > m_scanner.wait_max_us)
+    {
+        m_scanner.wait_max_us = wait;
+    }
+    p_readings = find_readings(pdu, len);
+    if (p_readings == NULL)
+    {
+        return;
+    }
+    if (m_scanner.have_counter && (p_readings[6] == m_scanner.counter))
+    {
+        return;
+    }
+    if (m_scanner.have_counter)
+    {
+        m_scanner.missed += (uint8_t)(p_readings[6] - m_scanner.counter - 1);
+    }
+    m_scanner.have_counter = true;
+    m_scanner.counter      = p_readings[6];
+    m_scanner.readings++;
+    m_scanner.temperature  = (int16_t)(p_readings[1] | (p_readings[2] << 8)) / 100.0;
+    m_scanner.humidity     = (uint16_t)(p_readings[3] | (p_readings[4] << 8)) / 100.0;
+    m_scanner.battery      = p_readings[5];
+
+    double error = fabs(m_scanner.temperature - sim_env_temperature(sim_now()));
+    m_scanner.error_total += error;
+    if (error > m_scanner.error_max)
+    {
+        m_scanner.error_max = error;
+    }
+    sim_trace("scanner: %.2f C, %.2f %%RH, battery %d %%, counter %u",
+              m_scanner.temperature, m_scanner.humidity, m_scanner.battery, m_scanner.counter);
+}
+
+
+static void scan(void * p_context)
+{
+    (void)p_context;
+    sim_schedule(sim_now() + g_sim_options.scan_period_s * SIM_US_PER_S, scan, NULL, false);
+
+    if (!sim_ble_is_advertising())
+    {
+        m_scanner.not_advertising++;
+        return;
+    }
+    m_scanner.scan_started = sim_now();
+    sim_schedule(sim_now() + sim_adv_wait_us(), packet_received, NULL, false);
+}
+
+
+void sim_scanner_init(void)
+{
+    memset(&m_scanner, 0, sizeof(m_scanner));
+    m_scanner.battery = -1;
+    if (g_sim_options.scan_period_s > 0)
+    {
+        sim_schedule(g_sim_options.scan_period_s * SIM_US_PER_S, scan, NULL, false);
+    }
+}
+
+
+void sim_scanner_report(void)
+{
+    if (g_sim_options.scan_period_s == 0)
+    {
+        return;
+    }
+    printf("Scanner\n");
+    printf("  advertising packets     %10llu (%llu scans while not advertising)\n",
+           (unsigned long long)m_scanner.packets, (unsigned long long)m_scanner.not_advertising);
+    printf("  scan latency            %10.1f ms avg, %.1f ms max (listening until a packet)\n",
+           m_scanner.packets ? (double)m_scanner.wait_total_us / m_scanner.packets / 1000.0 : 0.0,
+           (double)m_scanner.wait_max_us / 1000.0);
+    printf("  readings                %10llu (%llu missed by the counter)\n",
+           (unsigned long long)m_scanner.readings, (unsigned long long)m_scanner.missed);
+    printf("  temperature error       %10.3f C avg, %.3f C max (against the environment)\n",
+           m_scanner.readings ? m_scanner.error_total / m_scanner.readings : 0.0, m_scanner.error_max);
+    printf("  last values             %10.2f C, %.2f %%RH, battery %d %%\n",
+           m_scanner.temperature, m_scanner.humidity, m_scanner.battery);
+}
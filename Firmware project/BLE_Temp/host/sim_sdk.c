@@ -0,0 +1,1351 @@
+/** @file
+ *
+ * @brief RTemp host simulation - nRF51 SDK v9.0.0 libraries used by the firmware.
+ *
+ * Re-implementations of app_timer, app_scheduler, ble_advdata, ble_advertising,
+ * ble_conn_params, ble_bas, ble_dis, the device manager and pstorage with the
+ * behaviour RTemp relies on. They run on top of the simulated SoftDevice, so
+ * their radio and flash traffic is accounted like the real libraries'.
+ */
+#include <string.h>
+#include "sim.h"
+#include "app_timer.h"
+#include "app_scheduler.h"
+#include "ble_advdata.h"
+#include "ble_advertising.h"
+#include "ble_conn_params.h"
+#include "ble_hci.h"
+#include "ble_bas.h"
+#include "ble_dis.h"
+#include "device_manager.h"
+#include "pstorage.h"
+
+#define SIM_TIMER_IRQ_US        12          /**< RTC1 interrupt plus timer list processing per expiry. */
+#define SIM_TIMER_OP_US         8           /**< Queueing a start/stop operation and running SWI0. */
+#define SIM_SCHED_PUT_US        3           /**< Copying an event into the scheduler queue, interrupts off. */
+#define SIM_SCHED_EXECUTE_US    2           /**< Taking an event off the queue and calling its handler. */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* app_timer                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define SIM_MAX_TIMERS 16
+
+typedef struct
+{
+    bool                        created;
+    bool                        running;
+    app_timer_mode_t            mode;
+    app_timer_timeout_handler_t handler;
+    void                      * p_context;
+    uint64_t                    expiry_tick;    /**< Absolute (unwrapped) RTC1 tick of the next expiry. */
+    uint32_t                    period;
+    int                         event;
+} sim_timer_t;
+
+static sim_timer_t m_timers[SIM_MAX_TIMERS];
+static uint8_t     m_timer_max;
+static uint32_t    m_prescaler;
+static uint64_t    m_timer_expiries;
+
+static uint64_t rtc_ticks_now(void)
+{
+    return (sim_now() * APP_TIMER_CLOCK_FREQ / SIM_US_PER_S) / (m_prescaler + 1);
+}
+
+
+static sim_time_t rtc_tick_time(uint64_t tick)
+{
+    // First microsecond at which the counter reads "tick".
+    return CEIL_DIV(tick * (m_prescaler + 1) * SIM_US_PER_S, APP_TIMER_CLOCK_FREQ);
+}
+
+
+static void timer_expired(void * p_context)
+{
+    sim_timer_t * p_timer = (sim_timer_t *)p_context;
+
+    p_timer->event = 0;
+    if (!p_timer->running)
+    {
+        return;
+    }
+    m_timer_expiries++;
+    sim_busy_us(SIM_TIMER_IRQ_US);
+    if (p_timer->mode == APP_TIMER_MODE_REPEATED)
+    {
+        p_timer->expiry_tick += p_timer->period;
+        p_timer->event        = sim_schedule(rtc_tick_time(p_timer->expiry_tick), timer_expired, p_timer, false);
+    }
+    else
+    {
+        p_timer->running = false;
+    }
+    p_timer->handler(p_timer->p_context);
+}
+
+
+uint32_t app_timer_init(uint32_t prescaler, uint8_t max_timers, uint8_t op_queues_size, bool use_scheduler)
+{
+    (void)op_queues_size;
+    (void)use_scheduler;
+    if (max_timers > SIM_MAX_TIMERS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    memset(m_timers, 0, sizeof(m_timers));
+    m_prescaler   = prescaler;
+    m_timer_max   = max_timers;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_create(app_timer_id_t *            p_timer_id,
+                          app_timer_mode_t            mode,
+                          app_timer_timeout_handler_t timeout_handler)
+{
+    if ((p_timer_id == NULL) || (timeout_handler == NULL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    for (uint8_t i = 0; i < m_timer_max; i++)
+    {
+        if (!m_timers[i].created)
+        {
+            m_timers[i].created = true;
+            m_timers[i].mode    = mode;
+            m_timers[i].handler = timeout_handler;
+            *p_timer_id         = i;
+            return NRF_SUCCESS;
+        }
+    }
+    return NRF_ERROR_NO_MEM;
+}
+
+
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    if ((timer_id >= m_timer_max) || !m_timers[timer_id].created)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if ((timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS) || (timeout_ticks > MAX_RTC_COUNTER_VAL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    sim_timer_t * p_timer = &m_timers[timer_id];
+
+    sim_busy_us(SIM_TIMER_OP_US);
+    if (p_timer->event != 0)
+    {
+        sim_cancel(p_timer->event);
+    }
+    p_timer->running     = true;
+    p_timer->p_context   = p_context;
+    p_timer->period      = timeout_ticks;
+    p_timer->expiry_tick = rtc_ticks_now() + timeout_ticks;
+    p_timer->event       = sim_schedule(rtc_tick_time(p_timer->expiry_tick), timer_expired, p_timer, false);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_stop(app_timer_id_t timer_id)
+{
+    if ((timer_id >= m_timer_max) || !m_timers[timer_id].created)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    sim_timer_t * p_timer = &m_timers[timer_id];
+
+    sim_busy_us(SIM_TIMER_OP_US);
+    if (p_timer->event != 0)
+    {
+        sim_cancel(p_timer->event);
+        p_timer->event = 0;
+    }
+    p_timer->running = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_stop_all(void)
+{
+    for (uint8_t i = 0; i < m_timer_max; i++)
+    {
+        if (m_timers[i].created)
+        {
+            (void)app_timer_stop(i);
+        }
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_get(uint32_t * p_ticks)
+{
+    *p_ticks = (uint32_t)(rtc_ticks_now() & MAX_RTC_COUNTER_VAL);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from, uint32_t * p_ticks_diff)
+{
+    *p_ticks_diff = (ticks_to - ticks_from) & MAX_RTC_COUNTER_VAL;
+    return NRF_SUCCESS;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* app_scheduler                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define SIM_SCHED_MAX_QUEUE 32
+
+typedef struct
+{
+    app_sched_event_handler_t handler;
+    uint16_t                  event_size;
+    sim_time_t                put_time;
+} sim_sched_event_t;
+
+static struct
+{
+    sim_sched_event_t events[SIM_SCHED_MAX_QUEUE + 1];
+    uint8_t         * p_data;               /**< Event data, max_event_size bytes for each entry. */
+    uint16_t          max_event_size;
+    uint16_t          size;                 /**< Entries, one more than the queue holds. */
+    uint16_t          start;
+    uint16_t          end;
+    uint16_t          peak;                 /**< Most events queued at once. */
+    uint64_t          executed;
+    sim_time_t        wait_total_us;        /**< Sum of (run time - put time). */
+    sim_time_t        wait_max_us;
+    sim_time_t        run_max_us;           /**< Longest event handler, interrupts that preempted it included. */
+} m_sched;
+
+uint32_t app_sched_init(uint16_t max_event_size, uint16_t queue_size, void * p_evt_buffer)
+{
+    if ((queue_size > SIM_SCHED_MAX_QUEUE) || (p_evt_buffer == NULL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    memset(&m_sched, 0, sizeof(m_sched));
+    m_sched.p_data         = (uint8_t *)p_evt_buffer;
+    m_sched.max_event_size = max_event_size;
+    m_sched.size           = queue_size + 1;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_sched_event_put(void * p_event_data, uint16_t event_size, app_sched_event_handler_t handler)
+{
+    uint16_t next = (uint16_t)((m_sched.end + 1) % m_sched.size);
+    uint16_t queued;
+
+    if (event_size > m_sched.max_event_size)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    sim_busy_us(SIM_SCHED_PUT_US);
+    if (next == m_sched.start)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_sched.events[m_sched.end].handler    = handler;
+    m_sched.events[m_sched.end].event_size = event_size;
+    m_sched.events[m_sched.end].put_time   = sim_now();
+    if (event_size > 0)
+    {
+        memcpy(&m_sched.p_data[m_sched.end * m_sched.max_event_size], p_event_data, event_size);
+    }
+    m_sched.end = next;
+    queued      = (uint16_t)((m_sched.end + m_sched.size - m_sched.start) % m_sched.size);
+    if (queued > m_sched.peak)
+    {
+        m_sched.peak = queued;
+    }
+    return NRF_SUCCESS;
+}
+
+
+void app_sched_execute(void)
+{
+    while (m_sched.start != m_sched.end)
+    {
+        sim_sched_event_t * p_event = &m_sched.events[m_sched.start];
+        sim_time_t          wait    = sim_now() - p_event->put_time;
+        sim_time_t          run_start;
+
+        m_sched.executed++;
+        m_sched.wait_total_us += wait;
+        if (wait > m_sched.wait_max_us)
+        {
+            m_sched.wait_max_us = wait;
+        }
+        sim_busy_us(SIM_SCHED_EXECUTE_US);
+        run_start = sim_now();
+        p_event->handler(&m_sched.p_data[m_sched.start * m_sched.max_event_size], p_event->event_size);
+        if (sim_now() - run_start > m_sched.run_max_us)
+        {
+            m_sched.run_max_us = sim_now() - run_start;
+        }
+        m_sched.start = (uint16_t)((m_sched.start + 1) % m_sched.size);
+        // Interrupts that fell due during the handler's SoftDevice calls run before the next one
+        sim_thread_busy_us(0);
+    }
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ble_advdata                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+static uint32_t ad_put(uint8_t * p_buf, uint8_t * p_len, uint8_t type, const uint8_t * p_data, uint8_t data_len)
+{
+    if (*p_len + 2 + data_len > BLE_GAP_ADV_MAX_SIZE)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    p_buf[(*p_len)++] = data_len + 1;
+    p_buf[(*p_len)++] = type;
+    memcpy(&p_buf[*p_len], p_data, data_len);
+    *p_len += data_len;
+    return NRF_SUCCESS;
+}
+
+
+static uint32_t uuid_list_encode(const ble_advdata_uuid_list_t * p_list, uint8_t type16, uint8_t type128,
+                                 uint8_t * p_buf, uint8_t * p_len)
+{
+    uint8_t  data[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t  data_len = 0;
+    uint32_t err_code;
+
+    for (uint16_t i = 0; i < p_list->uuid_cnt; i++)
+    {
+        uint8_t uuid_len;
+        if ((sd_ble_uuid_encode(&p_list->p_uuids[i], &uuid_len, NULL) == NRF_SUCCESS) && (uuid_len == 2))
+        {
+            (void)sd_ble_uuid_encode(&p_list->p_uuids[i], &uuid_len, &data[data_len]);
+            data_len += 2;
+        }
+    }
+    if (data_len > 0)
+    {
+        err_code = ad_put(p_buf, p_len, type16, data, data_len);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    data_len = 0;
+    for (uint16_t i = 0; i < p_list->uuid_cnt; i++)
+    {
+        uint8_t uuid_len;
+        err_code = sd_ble_uuid_encode(&p_list->p_uuids[i], &uuid_len, NULL);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+        if (uuid_len == 16)
+        {
+            (void)sd_ble_uuid_encode(&p_list->p_uuids[i], &uuid_len, &data[data_len]);
+            data_len += 16;
+        }
+    }
+    return (data_len > 0) ? ad_put(p_buf, p_len, type128, data, data_len) : NRF_SUCCESS;
+}
+
+
+/**@brief Field order and name shortening follow ble_advdata.c of SDK v9.0.0. */
+static uint32_t adv_data_encode(const ble_advdata_t * p_advdata, uint8_t * p_buf, uint8_t * p_len)
+{
+    uint32_t err_code = NRF_SUCCESS;
+    uint8_t  data[BLE_GAP_ADV_MAX_SIZE];
+
+    *p_len = 0;
+    if (p_advdata->name_type != BLE_ADVDATA_NO_NAME)
+    {
+        uint16_t name_len = sizeof(data);
+        uint8_t  type     = BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME;
+
+        (void)sd_ble_gap_device_name_get(data, &name_len);
+        if ((p_advdata->name_type == BLE_ADVDATA_SHORT_NAME) && (name_len > p_advdata->short_name_len))
+        {
+            name_len = p_advdata->short_name_len;
+            type     = BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME;
+        }
+        if (name_len > BLE_GAP_ADV_MAX_SIZE - 2)
+        {
+            name_len = BLE_GAP_ADV_MAX_SIZE - 2;
+            type     = BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME;
+        }
+        err_code = ad_put(p_buf, p_len, type, data, (uint8_t)name_len);
+    }
+    if ((err_code == NRF_SUCCESS) && p_advdata->include_appearance)
+    {
+        uint16_t appearance;
+        (void)sd_ble_gap_appearance_get(&appearance);
+        (void)uint16_encode(appearance, data);
+        err_code = ad_put(p_buf, p_len, BLE_GAP_AD_TYPE_APPEARANCE, data, 2);
+    }
+    if ((err_code == NRF_SUCCESS) && (p_advdata->flags != 0))
+    {
+        err_code = ad_put(p_buf, p_len, BLE_GAP_AD_TYPE_FLAGS, &p_advdata->flags, 1);
+    }
+    if ((err_code == NRF_SUCCESS) && (p_advdata->p_tx_power_level != NULL))
+    {
+        err_code = ad_put(p_buf, p_len, BLE_GAP_AD_TYPE_TX_POWER_LEVEL, (uint8_t *)p_advdata->p_tx_power_level, 1);
+    }
+    if ((err_code == NRF_SUCCESS) && (p_advdata->uuids_complete.uuid_cnt > 0))
+    {
+        err_code = uuid_list_encode(&p_advdata->uuids_complete,
+                                    BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE,
+                                    BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE,
+                                    p_buf, p_len);
+    }
+    if ((err_code == NRF_SUCCESS) && (p_advdata->p_manuf_specific_data != NULL))
+    {
+        const ble_advdata_manuf_data_t * p_manuf = p_advdata->p_manuf_specific_data;
+
+        if (p_manuf->data.size > sizeof(data) - 2)
+        {
+            return NRF_ERROR_DATA_SIZE;
+        }
+        (void)uint16_encode(p_manuf->company_identifier, data);
+        memcpy(&data[2], p_manuf->data.p_data, p_manuf->data.size);
+        err_code = ad_put(p_buf, p_len, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA,
+                          data, (uint8_t)(2 + p_manuf->data.size));
+    }
+    for (uint8_t i = 0; (err_code == NRF_SUCCESS) && (i < p_advdata->service_data_count); i++)
+    {
+        const ble_advdata_service_data_t * p_service = &p_advdata->p_service_data_array[i];
+
+        if (p_service->data.size > sizeof(data) - 2)
+        {
+            return NRF_ERROR_DATA_SIZE;
+        }
+        (void)uint16_encode(p_service->service_uuid, data);
+        memcpy(&data[2], p_service->data.p_data, p_service->data.size);
+        err_code = ad_put(p_buf, p_len, BLE_GAP_AD_TYPE_SERVICE_DATA, data, (uint8_t)(2 + p_service->data.size));
+    }
+    return err_code;
+}
+
+
+uint32_t ble_advdata_set(const ble_advdata_t * p_advdata, const ble_advdata_t * p_srdata)
+{
+    uint8_t  adv[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t  sr[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t  adv_len = 0;
+    uint8_t  sr_len  = 0;
+    uint32_t err_code;
+
+    if (p_advdata != NULL)
+    {
+        err_code = adv_data_encode(p_advdata, adv, &adv_len);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+    if (p_srdata != NULL)
+    {
+        err_code = adv_data_encode(p_srdata, sr, &sr_len);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+    return sd_ble_gap_adv_data_set((p_advdata != NULL) ? adv : NULL, adv_len,
+                                   (p_srdata != NULL) ? sr : NULL, sr_len);
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ble_advertising                                                                                */
+/* ---------------------------------------------------------------------------------------------- */
+
+static struct
+{
+    ble_adv_modes_config_t          config;
+    ble_advertising_evt_handler_t   evt_handler;
+    ble_advertising_error_handler_t error_handler;
+    ble_adv_mode_t                  mode;
+    uint16_t                        conn_handle;
+} m_adv;
+
+uint32_t ble_advertising_init(ble_advdata_t const                 * p_advdata,
+                              ble_advdata_t const                 * p_srdata,
+                              ble_adv_modes_config_t const        * p_config,
+                              ble_advertising_evt_handler_t const   evt_handler,
+                              ble_advertising_error_handler_t const error_handler)
+{
+    if ((p_advdata == NULL) || (p_config == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    m_adv.config        = *p_config;
+    m_adv.evt_handler   = evt_handler;
+    m_adv.error_handler = error_handler;
+    m_adv.mode          = BLE_ADV_MODE_IDLE;
+    m_adv.conn_handle   = BLE_CONN_HANDLE_INVALID;
+    return ble_advdata_set(p_advdata, p_srdata);
+}
+
+
+uint32_t ble_advertising_start(ble_adv_mode_t advertising_mode)
+{
+    ble_gap_adv_params_t adv_params;
+    ble_adv_evt_t        evt;
+
+    memset(&adv_params, 0, sizeof(adv_params));
+    adv_params.type = BLE_GAP_ADV_TYPE_ADV_IND;
+    adv_params.fp   = BLE_GAP_ADV_FP_ANY;
+
+    // Directed advertising needs a bonded peer, which RTemp never has.
+    if ((advertising_mode == BLE_ADV_MODE_DIRECTED) || (advertising_mode == BLE_ADV_MODE_DIRECTED_SLOW))
+    {
+        advertising_mode = BLE_ADV_MODE_FAST;
+    }
+    if ((advertising_mode == BLE_ADV_MODE_FAST) && !m_adv.config.ble_adv_fast_enabled)
+    {
+        advertising_mode = BLE_ADV_MODE_SLOW;
+    }
+    if ((advertising_mode == BLE_ADV_MODE_SLOW) && !m_adv.config.ble_adv_slow_enabled)
+    {
+        advertising_mode = BLE_ADV_MODE_IDLE;
+    }
+
+    m_adv.mode = advertising_mode;
+    switch (advertising_mode)
+    {
+        case BLE_ADV_MODE_FAST:
+            adv_params.interval = (uint16_t)m_adv.config.ble_adv_fast_interval;
+            adv_params.timeout  = (uint16_t)m_adv.config.ble_adv_fast_timeout;
+            evt                 = BLE_ADV_EVT_FAST;
+            break;
+
+        case BLE_ADV_MODE_SLOW:
+            adv_params.interval = (uint16_t)m_adv.config.ble_adv_slow_interval;
+            adv_params.timeout  = (uint16_t)m_adv.config.ble_adv_slow_timeout;
+            evt                 = BLE_ADV_EVT_SLOW;
+            break;
+
+        default:
+            if (m_adv.evt_handler != NULL)
+            {
+                m_adv.evt_handler(BLE_ADV_EVT_IDLE);
+            }
+            return NRF_SUCCESS;
+    }
+
+    uint32_t err_code = sd_ble_gap_adv_start(&adv_params);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    if (m_adv.evt_handler != NULL)
+    {
+        m_adv.evt_handler(evt);
+    }
+    return NRF_SUCCESS;
+}
+
+
+void ble_advertising_on_ble_evt(ble_evt_t const * p_ble_evt)
+{
+    uint32_t err_code;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            m_adv.conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            m_adv.mode        = BLE_ADV_MODE_IDLE;
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            m_adv.conn_handle = BLE_CONN_HANDLE_INVALID;
+            err_code = ble_advertising_start(BLE_ADV_MODE_DIRECTED);
+            if ((err_code != NRF_SUCCESS) && (m_adv.error_handler != NULL))
+            {
+                m_adv.error_handler(err_code);
+            }
+            break;
+
+        case BLE_GAP_EVT_TIMEOUT:
+            if (p_ble_evt->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_ADVERTISING)
+            {
+                err_code = ble_advertising_start((m_adv.mode == BLE_ADV_MODE_FAST) ? BLE_ADV_MODE_SLOW
+                                                                                   : BLE_ADV_MODE_IDLE);
+                if ((err_code != NRF_SUCCESS) && (m_adv.error_handler != NULL))
+                {
+                    m_adv.error_handler(err_code);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void ble_advertising_on_sys_evt(uint32_t sys_evt)
+{
+    (void)sys_evt;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* ble_conn_params                                                                                */
+/* ---------------------------------------------------------------------------------------------- */
+
+static struct
+{
+    ble_conn_params_init_t init;
+    ble_gap_conn_params_t  preferred;
+    uint16_t               conn_handle;
+    uint8_t                update_count;
+    app_timer_id_t         timer;
+    ble_gap_conn_params_t  current;
+    bool                   change_param;    /**< The application changed the preferred parameters and asked for them. */
+} m_cp;
+
+static bool conn_params_ok(ble_gap_conn_params_t const * p_params)
+{
+    return (p_params->max_conn_interval >= m_cp.preferred.min_conn_interval) &&
+           (p_params->max_conn_interval <= m_cp.preferred.max_conn_interval) &&
+           (p_params->slave_latency == m_cp.preferred.slave_latency);
+}
+
+
+static void conn_params_timeout(void * p_context)
+{
+    (void)p_context;
+    if (m_cp.conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+    m_cp.update_count++;
+    uint32_t err_code = sd_ble_gap_conn_param_update(m_cp.conn_handle, &m_cp.preferred);
+    if ((err_code != NRF_SUCCESS) && (m_cp.init.error_handler != NULL))
+    {
+        m_cp.init.error_handler(err_code);
+    }
+}
+
+
+static void conn_params_negotiate(void)
+{
+    uint32_t ticks = (m_cp.update_count == 0) ? m_cp.init.first_conn_params_update_delay
+                                              : m_cp.init.next_conn_params_update_delay;
+    uint32_t err_code;
+    bool     change_param = m_cp.change_param;
+
+    m_cp.change_param = false;
+    if (conn_params_ok(&m_cp.current))
+    {
+        if (m_cp.init.evt_handler != NULL)
+        {
+            ble_conn_params_evt_t evt = {BLE_CONN_PARAMS_EVT_SUCCEEDED};
+            m_cp.init.evt_handler(&evt);
+        }
+        return;
+    }
+    if (change_param)
+    {
+        // Like the SDK: an update that was asked for by ble_conn_params_change_conn_params()
+        // and did not bring the preferred parameters fails at once.
+        if (m_cp.init.evt_handler != NULL)
+        {
+            ble_conn_params_evt_t evt = {BLE_CONN_PARAMS_EVT_FAILED};
+            m_cp.init.evt_handler(&evt);
+        }
+        return;
+    }
+    if (m_cp.update_count < m_cp.init.max_conn_params_update_count)
+    {
+        err_code = app_timer_start(m_cp.timer, ticks, NULL);
+        if ((err_code != NRF_SUCCESS) && (m_cp.init.error_handler != NULL))
+        {
+            m_cp.init.error_handler(err_code);
+        }
+        return;
+    }
+    if (m_cp.init.disconnect_on_fail)
+    {
+        err_code = sd_ble_gap_disconnect(m_cp.conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
+        if ((err_code != NRF_SUCCESS) && (m_cp.init.error_handler != NULL))
+        {
+            m_cp.init.error_handler(err_code);
+        }
+    }
+    else if (m_cp.init.evt_handler != NULL)
+    {
+        ble_conn_params_evt_t evt = {BLE_CONN_PARAMS_EVT_FAILED};
+        m_cp.init.evt_handler(&evt);
+    }
+}
+
+
+uint32_t ble_conn_params_init(const ble_conn_params_init_t * p_init)
+{
+    m_cp.init        = *p_init;
+    m_cp.conn_handle = BLE_CONN_HANDLE_INVALID;
+    if (p_init->p_conn_params != NULL)
+    {
+        m_cp.preferred = *p_init->p_conn_params;
+        uint32_t err_code = sd_ble_gap_ppcp_set(&m_cp.preferred);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+    else
+    {
+        uint32_t err_code = sd_ble_gap_ppcp_get(&m_cp.preferred);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+    return app_timer_create(&m_cp.timer, APP_TIMER_MODE_SINGLE_SHOT, conn_params_timeout);
+}
+
+
+uint32_t ble_conn_params_stop(void)
+{
+    return app_timer_stop(m_cp.timer);
+}
+
+
+uint32_t ble_conn_params_change_conn_params(ble_gap_conn_params_t * new_params)
+{
+    uint32_t err_code;
+
+    m_cp.preferred = *new_params;
+    err_code       = sd_ble_gap_ppcp_set(&m_cp.preferred);
+    if ((err_code != NRF_SUCCESS) || (m_cp.conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return err_code;
+    }
+    if (!conn_params_ok(&m_cp.current))
+    {
+        m_cp.change_param = true;
+        m_cp.update_count = 1;
+        return sd_ble_gap_conn_param_update(m_cp.conn_handle, &m_cp.preferred);
+    }
+    if (m_cp.init.evt_handler != NULL)
+    {
+        ble_conn_params_evt_t evt = {BLE_CONN_PARAMS_EVT_SUCCEEDED};
+        m_cp.init.evt_handler(&evt);
+    }
+    return NRF_SUCCESS;
+}
+
+
+void ble_conn_params_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            m_cp.conn_handle  = p_ble_evt->evt.gap_evt.conn_handle;
+            m_cp.current      = p_ble_evt->evt.gap_evt.params.connected.conn_params;
+            m_cp.update_count = 0;
+            m_cp.change_param = false;
+            if (m_cp.init.start_on_notify_cccd_handle == BLE_GATT_HANDLE_INVALID)
+            {
+                conn_params_negotiate();
+            }
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            m_cp.conn_handle = BLE_CONN_HANDLE_INVALID;
+            (void)app_timer_stop(m_cp.timer);
+            break;
+
+        case BLE_GATTS_EVT_WRITE:
+            if ((m_cp.init.start_on_notify_cccd_handle != BLE_GATT_HANDLE_INVALID) &&
+                (p_ble_evt->evt.gatts_evt.params.write.handle == m_cp.init.start_on_notify_cccd_handle) &&
+                (p_ble_evt->evt.gatts_evt.params.write.len == 2))
+            {
+                if (ble_srv_is_notification_enabled(p_ble_evt->evt.gatts_evt.params.write.data))
+                {
+                    conn_params_negotiate();
+                }
+                else
+                {
+                    (void)app_timer_stop(m_cp.timer);
+                }
+            }
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            m_cp.current = p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params;
+            conn_params_negotiate();
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Battery and Device Information services                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+uint32_t ble_bas_init(ble_bas_t * p_bas, const ble_bas_init_t * p_bas_init)
+{
+    uint32_t                 err_code;
+    ble_uuid_t               ble_uuid = {BLE_UUID_BATTERY_SERVICE, BLE_UUID_TYPE_BLE};
+    ble_gatts_char_md_t      char_md;
+    ble_gatts_attr_md_t      cccd_md;
+    ble_gatts_attr_md_t      attr_md;
+    ble_gatts_attr_t         attr_char_value;
+    uint8_t                  initial_level = p_bas_init->initial_batt_level;
+
+    p_bas->evt_handler               = p_bas_init->evt_handler;
+    p_bas->conn_handle               = BLE_CONN_HANDLE_INVALID;
+    p_bas->is_notification_supported = p_bas_init->support_notification;
+    p_bas->battery_level_last        = 0xFF;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_bas->service_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+    memset(&char_md, 0, sizeof(char_md));
+    memset(&attr_md, 0, sizeof(attr_md));
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    cccd_md.read_perm         = p_bas_init->battery_level_char_attr_md.read_perm;
+    cccd_md.write_perm        = p_bas_init->battery_level_char_attr_md.cccd_write_perm;
+    cccd_md.vloc              = BLE_GATTS_VLOC_STACK;
+    char_md.char_props.read   = 1;
+    char_md.char_props.notify = p_bas->is_notification_supported ? 1 : 0;
+    char_md.p_cccd_md         = p_bas->is_notification_supported ? &cccd_md : NULL;
+
+    ble_uuid.uuid      = BLE_UUID_BATTERY_LEVEL_CHAR;
+    attr_md.read_perm  = p_bas_init->battery_level_char_attr_md.read_perm;
+    attr_md.write_perm = p_bas_init->battery_level_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = sizeof(uint8_t);
+    attr_char_value.max_len   = sizeof(uint8_t);
+    attr_char_value.p_value   = &initial_level;
+
+    err_code = sd_ble_gatts_characteristic_add(p_bas->service_handle, &char_md, &attr_char_value,
+                                               &p_bas->battery_level_handles);
+    if (err_code == NRF_SUCCESS)
+    {
+        p_bas->battery_level_last = initial_level;
+    }
+    return err_code;
+}
+
+
+void ble_bas_on_ble_evt(ble_bas_t * p_bas, ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            p_bas->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            p_bas->conn_handle = BLE_CONN_HANDLE_INVALID;
+            break;
+
+        case BLE_GATTS_EVT_WRITE:
+            if (p_bas->is_notification_supported &&
+                (p_ble_evt->evt.gatts_evt.params.write.handle == p_bas->battery_level_handles.cccd_handle) &&
+                (p_ble_evt->evt.gatts_evt.params.write.len == 2) &&
+                (p_bas->evt_handler != NULL))
+            {
+                ble_bas_evt_t evt;
+                evt.evt_type = ble_srv_is_notification_enabled(p_ble_evt->evt.gatts_evt.params.write.data)
+                             ? BLE_BAS_EVT_NOTIFICATION_ENABLED : BLE_BAS_EVT_NOTIFICATION_DISABLED;
+                p_bas->evt_handler(p_bas, &evt);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+uint32_t ble_bas_battery_level_update(ble_bas_t * p_bas, uint8_t battery_level)
+{
+    uint32_t err_code = NRF_SUCCESS;
+
+    if (battery_level != p_bas->battery_level_last)
+    {
+        ble_gatts_value_t gatts_value = {sizeof(uint8_t), 0, &battery_level};
+
+        err_code = sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID,
+                                          p_bas->battery_level_handles.value_handle,
+                                          &gatts_value);
+        if (err_code == NRF_SUCCESS)
+        {
+            p_bas->battery_level_last = battery_level;
+        }
+        else
+        {
+            return err_code;
+        }
+
+        if ((p_bas->conn_handle != BLE_CONN_HANDLE_INVALID) && p_bas->is_notification_supported)
+        {
+            ble_gatts_hvx_params_t hvx_params;
+            uint16_t               len = sizeof(uint8_t);
+
+            memset(&hvx_params, 0, sizeof(hvx_params));
+            hvx_params.handle = p_bas->battery_level_handles.value_handle;
+            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+            hvx_params.p_len  = &len;
+            hvx_params.p_data = &battery_level;
+            err_code = sd_ble_gatts_hvx(p_bas->conn_handle, &hvx_params);
+        }
+        else
+        {
+            err_code = NRF_ERROR_INVALID_STATE;
+        }
+    }
+    return err_code;
+}
+
+
+static uint32_t dis_char_add(uint16_t uuid, const ble_srv_utf8_str_t * p_str, const ble_srv_security_mode_t * p_sec)
+{
+    ble_gatts_char_md_t      char_md;
+    ble_gatts_attr_md_t      attr_md;
+    ble_gatts_attr_t         attr_char_value;
+    ble_uuid_t               ble_uuid = {uuid, BLE_UUID_TYPE_BLE};
+    ble_gatts_char_handles_t handles;
+
+    memset(&char_md, 0, sizeof(char_md));
+    memset(&attr_md, 0, sizeof(attr_md));
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    char_md.char_props.read = 1;
+    attr_md.read_perm       = p_sec->read_perm;
+    attr_md.write_perm      = p_sec->write_perm;
+    attr_md.vloc            = BLE_GATTS_VLOC_STACK;
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = p_str->length;
+    attr_char_value.max_len   = p_str->length;
+    attr_char_value.p_value   = p_str->p_str;
+    return sd_ble_gatts_characteristic_add(BLE_GATT_HANDLE_INVALID, &char_md, &attr_char_value, &handles);
+}
+
+
+uint32_t ble_dis_init(const ble_dis_init_t * p_dis_init)
+{
+    static const struct
+    {
+        uint16_t uuid;
+        size_t   offset;
+    } chars[] =
+    {
+        {BLE_UUID_MANUFACTURER_NAME_STRING_CHAR, offsetof(ble_dis_init_t, manufact_name_str)},
+        {BLE_UUID_MODEL_NUMBER_STRING_CHAR,      offsetof(ble_dis_init_t, model_num_str)},
+        {0x2A25,                                 offsetof(ble_dis_init_t, serial_num_str)},
+        {0x2A27,                                 offsetof(ble_dis_init_t, hw_rev_str)},
+        {BLE_UUID_FIRMWARE_REVISION_STRING_CHAR, offsetof(ble_dis_init_t, fw_rev_str)},
+        {BLE_UUID_SOFTWARE_REVISION_STRING_CHAR, offsetof(ble_dis_init_t, sw_rev_str)},
+    };
+    ble_uuid_t service_uuid = {BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_TYPE_BLE};
+    uint16_t   service_handle;
+    uint32_t   err_code;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &service_uuid, &service_handle);
+    for (size_t i = 0; (err_code == NRF_SUCCESS) && (i < sizeof(chars) / sizeof(chars[0])); i++)
+    {
+        const ble_srv_utf8_str_t * p_str = (const ble_srv_utf8_str_t *)((const uint8_t *)p_dis_init + chars[i].offset);
+        if (p_str->length > 0)
+        {
+            err_code = dis_char_add(chars[i].uuid, p_str, &p_dis_init->dis_attr_md);
+        }
+    }
+    return err_code;
+}
+
+
+void ble_srv_ascii_to_utf8(ble_srv_utf8_str_t * p_utf8, char * p_ascii)
+{
+    p_utf8->length = (uint16_t)strlen(p_ascii);
+    p_utf8->p_str  = (uint8_t *)p_ascii;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* pstorage                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+typedef struct
+{
+    uint8_t            op_code;
+    pstorage_handle_t  handle;
+    uint8_t          * p_src;
+    pstorage_size_t    size;
+    pstorage_size_t    offset;
+    uint8_t            step;
+    uint32_t           page;                    /**< Page being rewritten by update and partial clear. */
+} ps_cmd_t;
+
+static struct
+{
+    pstorage_module_param_t modules[PSTORAGE_MAX_APPLICATIONS];
+    uint32_t                module_base[PSTORAGE_MAX_APPLICATIONS];
+    uint32_t                module_count;
+    uint32_t                next_page;
+    ps_cmd_t                queue[PSTORAGE_CMD_QUEUE_SIZE];
+    uint8_t                 queue_count;
+    bool                    busy;
+    uint32_t                swap_image[256];    /**< Largest page the simulator models is 1 kB. */
+    uint64_t                ops;
+} m_ps;
+
+static uint32_t ps_page_size(void)
+{
+    return PSTORAGE_FLASH_PAGE_SIZE;
+}
+
+
+/**@brief Builds the new content of the page holding the command's data in the swap image. */
+static void ps_prepare_page(ps_cmd_t * p_cmd)
+{
+    uint32_t page_addr = p_cmd->page * ps_page_size();
+    uint32_t offset    = p_cmd->handle.block_id + p_cmd->offset - page_addr;
+
+    memcpy(m_ps.swap_image, sim_flash_ptr(page_addr), ps_page_size());
+    if (p_cmd->op_code == PSTORAGE_UPDATE_OP_CODE)
+    {
+        memcpy((uint8_t *)m_ps.swap_image + offset, p_cmd->p_src, p_cmd->size);
+    }
+    else
+    {
+        memset((uint8_t *)m_ps.swap_image + offset, 0xFF, p_cmd->size);
+    }
+}
+
+
+/**@brief Issues the next flash operation of the command at the head of the queue.
+ *
+ * @return true when the command has no more steps.
+ */
+static bool ps_step(void)
+{
+    ps_cmd_t * p_cmd     = &m_ps.queue[0];
+    uint32_t   page_size = ps_page_size();
+    uint32_t   err_code  = NRF_SUCCESS;
+
+    switch (p_cmd->op_code)
+    {
+        case PSTORAGE_STORE_OP_CODE:
+            if (p_cmd->step++ == 0)
+            {
+                err_code = sd_flash_write((uint32_t *)(uintptr_t)(p_cmd->handle.block_id + p_cmd->offset),
+                                          (uint32_t *)p_cmd->p_src, p_cmd->size / 4);
+                break;
+            }
+            return true;
+
+        case PSTORAGE_CLEAR_OP_CODE:
+            if (((p_cmd->handle.block_id % page_size) == 0) && ((p_cmd->size % page_size) == 0))
+            {
+                // Whole pages: erase them one by one.
+                if (p_cmd->step * page_size < p_cmd->size)
+                {
+                    err_code = sd_flash_page_erase(p_cmd->handle.block_id / page_size + p_cmd->step++);
+                    break;
+                }
+                return true;
+            }
+            // Fall through - partial pages are cleared through the swap page like an update.
+
+        case PSTORAGE_UPDATE_OP_CODE:
+            switch (p_cmd->step++)
+            {
+                case 0:
+                    p_cmd->page = (p_cmd->handle.block_id + p_cmd->offset) / page_size;
+                    ps_prepare_page(p_cmd);
+                    err_code = sd_flash_page_erase(PSTORAGE_SWAP_ADDR / page_size);
+                    break;
+                case 1:
+                    err_code = sd_flash_write((uint32_t *)(uintptr_t)PSTORAGE_SWAP_ADDR, m_ps.swap_image, page_size / 4);
+                    break;
+                case 2:
+                    err_code = sd_flash_page_erase(p_cmd->page);
+                    break;
+                case 3:
+                    memcpy(m_ps.swap_image, sim_flash_ptr(PSTORAGE_SWAP_ADDR), page_size);
+                    err_code = sd_flash_write((uint32_t *)(uintptr_t)(p_cmd->page * page_size), m_ps.swap_image, page_size / 4);
+                    break;
+                default:
+                    return true;
+            }
+            break;
+
+        default:
+            return true;
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        sim_fatal("pstorage: flash operation rejected (0x%X)", err_code);
+    }
+    return false;
+}
+
+
+static void ps_process(void)
+{
+    while ((m_ps.queue_count > 0) && !m_ps.busy)
+    {
+        if (!ps_step())
+        {
+            m_ps.busy = true;
+            return;
+        }
+
+        ps_cmd_t cmd = m_ps.queue[0];
+        m_ps.queue_count--;
+        memmove(&m_ps.queue[0], &m_ps.queue[1], m_ps.queue_count * sizeof(ps_cmd_t));
+        m_ps.ops++;
+        m_ps.modules[cmd.handle.module_id].cb(&cmd.handle, cmd.op_code, NRF_SUCCESS, cmd.p_src, cmd.size);
+    }
+}
+
+
+void pstorage_sys_event_handler(uint32_t sys_evt)
+{
+    if ((sys_evt == NRF_EVT_FLASH_OPERATION_SUCCESS) || (sys_evt == NRF_EVT_FLASH_OPERATION_ERROR))
+    {
+        m_ps.busy = false;
+        ps_process();
+    }
+}
+
+
+static uint32_t ps_enqueue(uint8_t op_code, pstorage_handle_t * p_handle, uint8_t * p_src,
+                           pstorage_size_t size, pstorage_size_t offset)
+{
+    if (m_ps.queue_count >= PSTORAGE_CMD_QUEUE_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    ps_cmd_t * p_cmd = &m_ps.queue[m_ps.queue_count++];
+    memset(p_cmd, 0, sizeof(*p_cmd));
+    p_cmd->op_code = op_code;
+    p_cmd->handle  = *p_handle;
+    p_cmd->p_src   = p_src;
+    p_cmd->size    = size;
+    p_cmd->offset  = offset;
+    sim_busy_us(SIM_TIMER_OP_US);
+    ps_process();
+    return NRF_SUCCESS;
+}
+
+
+static uint32_t ps_check(pstorage_handle_t * p_handle, pstorage_size_t size, pstorage_size_t offset)
+{
+    if ((p_handle == NULL) || (p_handle->module_id >= m_ps.module_count))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if ((size == 0) || (size % 4) || (offset % 4) || (p_handle->block_id % 4))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    uint32_t base = m_ps.module_base[p_handle->module_id];
+    uint32_t end  = base + m_ps.modules[p_handle->module_id].block_size * m_ps.modules[p_handle->module_id].block_count;
+    if ((p_handle->block_id < base) || (p_handle->block_id + offset + size > end))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pstorage_init(void)
+{
+    memset(&m_ps, 0, sizeof(m_ps));
+    m_ps.next_page = PSTORAGE_DATA_START_ADDR / ps_page_size();
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pstorage_register(pstorage_module_param_t * p_module_param, pstorage_handle_t * p_block_id)
+{
+    if ((p_module_param == NULL) || (p_block_id == NULL) || (p_module_param->cb == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if ((p_module_param->block_size < PSTORAGE_MIN_BLOCK_SIZE) ||
+        (p_module_param->block_size > PSTORAGE_MAX_BLOCK_SIZE) ||
+        (p_module_param->block_count == 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_ps.module_count >= PSTORAGE_MAX_APPLICATIONS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    uint32_t pages = CEIL_DIV((uint32_t)p_module_param->block_size * p_module_param->block_count, ps_page_size());
+    if ((m_ps.next_page + pages) * ps_page_size() > PSTORAGE_DATA_END_ADDR)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_ps.modules[m_ps.module_count]     = *p_module_param;
+    m_ps.module_base[m_ps.module_count] = m_ps.next_page * ps_page_size();
+    p_block_id->module_id               = m_ps.module_count;
+    p_block_id->block_id                = m_ps.next_page * ps_page_size();
+    m_ps.next_page                     += pages;
+    m_ps.module_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pstorage_block_identifier_get(pstorage_handle_t * p_base_id,
+                                       pstorage_size_t     block_num,
+                                       pstorage_handle_t * p_block_id)
+{
+    if ((p_base_id == NULL) || (p_block_id == NULL) || (p_base_id->module_id >= m_ps.module_count))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (block_num >= m_ps.modules[p_base_id->module_id].block_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    *p_block_id           = *p_base_id;
+    p_block_id->block_id += (uint32_t)block_num * m_ps.modules[p_base_id->module_id].block_size;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pstorage_store(pstorage_handle_t * p_dest, uint8_t * p_src, pstorage_size_t size, pstorage_size_t offset)
+{
+    uint32_t err_code = ps_check(p_dest, size, offset);
+    return (err_code != NRF_SUCCESS) ? err_code : ps_enqueue(PSTORAGE_STORE_OP_CODE, p_dest, p_src, size, offset);
+}
+
+
+uint32_t pstorage_update(pstorage_handle_t * p_dest, uint8_t * p_src, pstorage_size_t size, pstorage_size_t offset)
+{
+    uint32_t err_code = ps_check(p_dest, size, offset);
+    if ((err_code == NRF_SUCCESS) &&
+        ((p_dest->block_id + offset) / ps_page_size() != (p_dest->block_id + offset + size - 1) / ps_page_size()))
+    {
+        err_code = NRF_ERROR_INVALID_PARAM; // The simulator only rewrites one page per update.
+    }
+    return (err_code != NRF_SUCCESS) ? err_code : ps_enqueue(PSTORAGE_UPDATE_OP_CODE, p_dest, p_src, size, offset);
+}
+
+
+uint32_t pstorage_load(uint8_t * p_dest, pstorage_handle_t * p_src, pstorage_size_t size, pstorage_size_t offset)
+{
+    uint32_t err_code = ps_check(p_src, size, offset);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    memcpy(p_dest, sim_flash_ptr(p_src->block_id + offset), size);
+    sim_busy_us(1 + size / 16);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pstorage_clear(pstorage_handle_t * p_base_id, pstorage_size_t size)
+{
+    uint32_t err_code = ps_check(p_base_id, size, 0);
+    return (err_code != NRF_SUCCESS) ? err_code : ps_enqueue(PSTORAGE_CLEAR_OP_CODE, p_base_id, NULL, size, 0);
+}
+
+
+uint32_t pstorage_access_status_get(uint32_t * p_count)
+{
+    *p_count = m_ps.queue_count;
+    return NRF_SUCCESS;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Device manager                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define DM_BOND_BLOCK_SIZE  64              /**< Rounded size of one bond record in SDK v9.0.0. */
+
+static pstorage_handle_t m_dm_storage;
+
+static void dm_pstorage_cb(pstorage_handle_t * p_handle, uint8_t op_code, uint32_t result,
+                           uint8_t * p_data, uint32_t data_len)
+{
+    (void)p_handle;
+    (void)op_code;
+    (void)p_data;
+    (void)data_len;
+    if (result != NRF_SUCCESS)
+    {
+        sim_fatal("device manager flash operation failed");
+    }
+}
+
+
+/**@brief Like the real device manager, the bond area is registered with pstorage (taking its
+ *        only application slot) and erased on every boot when clear_persistent_data is set. */
+ret_code_t dm_init(dm_init_param_t const * p_init_param)
+{
+    pstorage_module_param_t param;
+    uint32_t                err_code;
+
+    param.cb          = dm_pstorage_cb;
+    param.block_size  = DM_BOND_BLOCK_SIZE;
+    param.block_count = DEVICE_MANAGER_MAX_BONDS;
+    err_code = pstorage_register(&param, &m_dm_storage);
+    if ((err_code == NRF_SUCCESS) && p_init_param->clear_persistent_data)
+    {
+        err_code = pstorage_clear(&m_dm_storage, DM_BOND_BLOCK_SIZE * DEVICE_MANAGER_MAX_BONDS);
+    }
+    return err_code;
+}
+
+
+ret_code_t dm_register(dm_application_instance_t    * p_appl_instance,
+                       dm_application_param_t const * p_appl_param)
+{
+    (void)p_appl_param;
+    *p_appl_instance = 0;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t dm_ble_evt_handler(ble_evt_t * p_ble_evt)
+{
+    if (p_ble_evt->header.evt_id == BLE_GATTS_EVT_SYS_ATTR_MISSING)
+    {
+        // No bond, so no stored CCCDs: start from defaults.
+        return sd_ble_gatts_sys_attr_set(p_ble_evt->evt.gatts_evt.conn_handle, NULL, 0, 0);
+    }
+    return NRF_SUCCESS;
+}
+
+
+void sim_sdk_report(void)
+{
+    printf("  app_timer expiries      %10llu\n", (unsigned long long)m_timer_expiries);
+    printf("  scheduler events        %10llu (%.3f ms avg wait, %.3f ms max; longest %.3f ms; %u queued at most)\n",
+           (unsigned long long)m_sched.executed,
+           m_sched.executed ? (double)m_sched.wait_total_us / m_sched.executed / 1000.0 : 0.0,
+           (double)m_sched.wait_max_us / 1000.0, (double)m_sched.run_max_us / 1000.0, m_sched.peak);
+    printf("  pstorage operations     %10llu\n", (unsigned long long)m_ps.ops);
+}
@@ -0,0 +1,503 @@
+/** @file
+ *
+ * @brief RTemp host simulation - SHT21 sensor on the I2C bus.
+ *
+ * The model follows the bus edge by edge: START and STOP conditions, data
+ * bits on rising SCL, ACK on the ninth clock, clock stretching in hold master
+ * mode and NACK of the read header while a no-hold-master conversion is still
+ * running. Conversion times are the typical values from the datasheet for the
+ * resolution selected in the user register.
+ */
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+
+#define SHT2X_ADDR_W            0x80
+#define SHT2X_ADDR_R            0x81
+#define SHT2X_USER_REG_DEFAULT  0x3A        /**< 14/12 bit, heater off, OTP reload disabled. */
+#define SHT2X_RESET_US          15000
+#define SHT2X_TX_MAX            8
+
+typedef enum
+{
+    BUS_IDLE,                               /**< Waiting for a START condition. */
+    BUS_RX,                                 /**< Receiving a byte from the master. */
+    BUS_TX,                                 /**< Sending bytes to the master. */
+    BUS_IGNORE                              /**< Not addressed or NACKed, waiting for START or STOP. */
+} bus_state_t;
+
+static struct
+{
+    bus_state_t state;
+    uint32_t    prev_sda;
+    uint32_t    prev_scl;
+    uint8_t     sda_drive;                  /**< 0 = slave pulls SDA low. */
+    bool        scl_hold;                   /**< Slave stretches the clock (hold master mode). */
+    uint8_t     bit_count;
+    uint8_t     shift;
+    uint8_t     byte_index;                 /**< Bytes received since START, address included. */
+    uint8_t     cmd;
+    uint8_t     cmd_arg_count;
+    uint8_t     tx[SHT2X_TX_MAX];
+    uint8_t     tx_len;
+    uint8_t     tx_pos;
+    bool        tx_acked;
+    bool        converting;
+    bool        hold_master;
+    uint8_t     conv_cmd;
+    sim_time_t  conv_done_at;
+    sim_time_t  reset_done_at;
+    uint8_t     user_reg;
+    uint8_t     serial_a[2];
+    uint8_t     serial_b[4];
+    uint8_t     serial_c[2];
+    double      phase[4];
+} m_sht;
+
+static uint8_t crc8(const uint8_t * p_data, uint8_t len)
+{
+    uint8_t crc = 0;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        crc ^= p_data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+
+double sim_env_temperature(sim_time_t t)
+{
+    double days = (double)t / SIM_US_PER_DAY;
+
+    return 21.0 + 2.5 * sin(2.0 * M_PI * days + m_sht.phase[0])
+                + 1.2 * sin(2.0 * M_PI * days * 6.5 + m_sht.phase[1])
+                + 0.4 * sin(2.0 * M_PI * days * 85.0 + m_sht.phase[2]);
+}
+
+
+double sim_env_humidity(sim_time_t t)
+{
+    double days = (double)t / SIM_US_PER_DAY;
+    double rh   = 45.0 - 8.0 * sin(2.0 * M_PI * days + m_sht.phase[0])
+                       + 3.0 * sin(2.0 * M_PI * days * 4.3 + m_sht.phase[3]);
+
+    return (rh < 0.0) ? 0.0 : (rh > 100.0) ? 100.0 : rh;
+}
+
+
+static uint8_t temperature_bits(void)
+{
+    switch (m_sht.user_reg & 0x81)
+    {
+        case 0x01: return 12;
+        case 0x80: return 13;
+        case 0x81: return 11;
+        default:   return 14;
+    }
+}
+
+
+static uint8_t humidity_bits(void)
+{
+    switch (m_sht.user_reg & 0x81)
+    {
+        case 0x01: return 8;
+        case 0x80: return 10;
+        case 0x81: return 11;
+        default:   return 12;
+    }
+}
+
+
+static sim_time_t conversion_time_us(uint8_t cmd)
+{
+    bool is_temperature = (cmd == 0xE3) || (cmd == 0xF3);
+
+    if (is_temperature)
+    {
+        switch (temperature_bits())
+        {
+            case 11: return 9000;
+            case 12: return 17000;
+            case 13: return 33000;
+            default: return 66000;
+        }
+    }
+    switch (humidity_bits())
+    {
+        case 8:  return 3000;
+        case 10: return 7000;
+        case 11: return 12000;
+        default: return 22000;
+    }
+}
+
+
+/**@brief Prepares the two result bytes and their CRC for a finished conversion. */
+static void load_measurement(void)
+{
+    bool     is_temperature = (m_sht.conv_cmd == 0xE3) || (m_sht.conv_cmd == 0xF3);
+    double   value;
+    uint32_t raw;
+    uint8_t  bits;
+
+    if (is_temperature)
+    {
+        value = sim_env_temperature(m_sht.conv_done_at);
+        if (m_sht.user_reg & 0x04)
+        {
+            value += 1.0;                   // On-chip heater warms the die.
+        }
+        raw  = (uint32_t)((value + 46.85) / 175.72 * 65536.0);
+        bits = temperature_bits();
+    }
+    else
+    {
+        value = sim_env_humidity(m_sht.conv_done_at);
+        raw   = (uint32_t)((value + 6.0) / 125.0 * 65536.0);
+        bits  = humidity_bits();
+    }
+    if (raw > 0xFFFF)
+    {
+        raw = 0xFFFF;
+    }
+    raw &= (0xFFFFu << (16 - bits)) & 0xFFFC;
+    raw |= is_temperature ? 0x0 : 0x2;      // Status bit 1 tells humidity from temperature.
+
+    m_sht.tx[0]      = (uint8_t)(raw >> 8);
+    m_sht.tx[1]      = (uint8_t)raw;
+    m_sht.tx[2]      = crc8(m_sht.tx, 2);
+    m_sht.tx_len     = 3;
+    m_sht.tx_pos     = 0;
+    m_sht.converting = false;
+
+    sim_trace("sht2x: %s %.2f -> 0x%04X", is_temperature ? "T" : "RH", value, raw);
+}
+
+
+static void start_conversion(uint8_t cmd)
+{
+    m_sht.converting   = true;
+    m_sht.hold_master  = (cmd == 0xE3) || (cmd == 0xE5);
+    m_sht.conv_cmd     = cmd;
+    m_sht.conv_done_at = sim_now() + conversion_time_us(cmd);
+    m_sht.tx_len       = 0;
+    g_sim_stats.sensor_conversions++;
+    g_sim_stats.sensor_busy_us += conversion_time_us(cmd);
+}
+
+
+static void drive_tx_bit(void)
+{
+    m_sht.sda_drive = (m_sht.tx[m_sht.tx_pos] >> (7 - m_sht.bit_count)) & 1;
+    m_sht.bit_count++;
+}
+
+
+/**@brief Ends clock stretching once a hold master conversion has finished. */
+static void refresh(void)
+{
+    if (m_sht.scl_hold && (sim_now() >= m_sht.conv_done_at))
+    {
+        load_measurement();
+        m_sht.scl_hold  = false;
+        m_sht.state     = BUS_TX;
+        m_sht.bit_count = 0;
+        drive_tx_bit();
+        m_sht.prev_sda  = sim_gpio_master_level(SIM_SDA_PIN) & m_sht.sda_drive;
+        m_sht.prev_scl  = sim_gpio_master_level(SIM_SCL_PIN);
+    }
+}
+
+
+/**@brief Decides whether to acknowledge a received byte and acts on commands. */
+static bool on_byte_received(uint8_t byte)
+{
+    if (m_sht.byte_index++ == 0)
+    {
+        bool busy = (sim_now() < m_sht.reset_done_at);
+
+        if (byte == SHT2X_ADDR_W)
+        {
+            m_sht.cmd           = 0;
+            m_sht.cmd_arg_count = 0;
+            return !busy && !(m_sht.converting && !m_sht.hold_master);
+        }
+        if (byte == SHT2X_ADDR_R)
+        {
+            if (busy)
+            {
+                return false;
+            }
+            if (m_sht.converting)
+            {
+                if (!m_sht.hold_master && (sim_now() < m_sht.conv_done_at))
+                {
+                    return false;
+                }
+                if (!m_sht.hold_master)
+                {
+                    load_measurement();
+                }
+            }
+            return m_sht.tx_len > 0;
+        }
+        return false;
+    }
+
+    if (m_sht.cmd == 0)
+    {
+        m_sht.cmd = byte;
+        switch (byte)
+        {
+            case 0xE3:
+            case 0xE5:
+            case 0xF3:
+            case 0xF5:
+                start_conversion(byte);
+                return true;
+
+            case 0xE7:
+                // End of battery (bit 6) follows the supply, below 2.25 V.
+                m_sht.user_reg = (uint8_t)((m_sht.user_reg & ~0x40) | ((sim_battery_voltage() < 2.25) ? 0x40 : 0x00));
+                m_sht.tx[0]    = m_sht.user_reg;
+                m_sht.tx[1]    = crc8(&m_sht.user_reg, 1);
+                m_sht.tx_len = 2;
+                m_sht.tx_pos = 0;
+                return true;
+
+            case 0xFE:
+                m_sht.user_reg      = SHT2X_USER_REG_DEFAULT;
+                m_sht.converting    = false;
+                m_sht.tx_len        = 0;
+                m_sht.reset_done_at = sim_now() + SHT2X_RESET_US;
+                return true;
+
+            case 0xE6:
+            case 0xFA:
+            case 0xFC:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    m_sht.cmd_arg_count++;
+    switch (m_sht.cmd)
+    {
+        case 0xE6:
+            // Reserved bits 3..5 keep their value.
+            m_sht.user_reg = (uint8_t)((byte & 0xC7) | (m_sht.user_reg & 0x38));
+            return true;
+
+        case 0xFA:
+            if (byte != 0x0F)
+            {
+                return false;
+            }
+            for (uint8_t i = 0; i < 4; i++)
+            {
+                m_sht.tx[2 * i]     = m_sht.serial_b[i];
+                m_sht.tx[2 * i + 1] = crc8(&m_sht.serial_b[i], 1);
+            }
+            m_sht.tx_len = 8;
+            m_sht.tx_pos = 0;
+            return true;
+
+        case 0xFC:
+            if (byte != 0xC9)
+            {
+                return false;
+            }
+            m_sht.tx[0]  = m_sht.serial_c[0];
+            m_sht.tx[1]  = m_sht.serial_c[1];
+            m_sht.tx[2]  = crc8(m_sht.serial_c, 2);
+            m_sht.tx[3]  = m_sht.serial_a[0];
+            m_sht.tx[4]  = m_sht.serial_a[1];
+            m_sht.tx[5]  = crc8(m_sht.serial_a, 2);
+            m_sht.tx_len = 6;
+            m_sht.tx_pos = 0;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+static void on_scl_rising(uint32_t sda)
+{
+    if (m_sht.state == BUS_RX)
+    {
+        if (m_sht.bit_count < 8)
+        {
+            m_sht.shift = (uint8_t)((m_sht.shift << 1) | sda);
+            m_sht.bit_count++;
+        }
+    }
+    else if ((m_sht.state == BUS_TX) && (m_sht.bit_count == 9))
+    {
+        m_sht.tx_acked = (sda == 0);
+    }
+}
+
+
+static void on_scl_falling(void)
+{
+    if (m_sht.state == BUS_RX)
+    {
+        if (m_sht.bit_count == 8)
+        {
+            bool was_address = (m_sht.byte_index == 0);
+            bool ack         = on_byte_received(m_sht.shift);
+
+            m_sht.sda_drive = ack ? 0 : 1;
+            m_sht.bit_count = 9;
+            if (!ack)
+            {
+                m_sht.state = BUS_IGNORE;
+            }
+            else if (was_address && (m_sht.shift == SHT2X_ADDR_R))
+            {
+                m_sht.bit_count = 10;       // Marks the read header, see below.
+            }
+        }
+        else if (m_sht.bit_count == 9)
+        {
+            m_sht.sda_drive = 1;
+            m_sht.bit_count = 0;
+            m_sht.shift     = 0;
+        }
+        else if (m_sht.bit_count == 10)
+        {
+            m_sht.sda_drive = 1;
+            m_sht.bit_count = 0;
+            if (m_sht.converting && m_sht.hold_master)
+            {
+                m_sht.scl_hold = true;
+                refresh();
+            }
+            else
+            {
+                m_sht.state = BUS_TX;
+                drive_tx_bit();
+            }
+        }
+    }
+    else if (m_sht.state == BUS_TX)
+    {
+        if (m_sht.bit_count < 8)
+        {
+            drive_tx_bit();
+        }
+        else if (m_sht.bit_count == 8)
+        {
+            m_sht.sda_drive = 1;            // Release SDA for the master's ACK.
+            m_sht.bit_count = 9;
+            m_sht.tx_acked  = false;
+        }
+        else
+        {
+            m_sht.tx_pos++;
+            m_sht.bit_count = 0;
+            if (m_sht.tx_acked && (m_sht.tx_pos < m_sht.tx_len))
+            {
+                drive_tx_bit();
+            }
+            else
+            {
+                m_sht.tx_len = 0;
+                m_sht.state  = BUS_IGNORE;
+            }
+        }
+    }
+}
+
+
+void sim_sht2x_bus_changed(void)
+{
+    uint32_t sda;
+    uint32_t scl;
+
+    refresh();
+    sda = sim_gpio_master_level(SIM_SDA_PIN) & m_sht.sda_drive;
+    scl = sim_gpio_master_level(SIM_SCL_PIN) & (m_sht.scl_hold ? 0 : 1);
+
+    if (scl && m_sht.prev_scl && (sda != m_sht.prev_sda))
+    {
+        if (!sda)
+        {
+            // START or repeated START.
+            m_sht.state      = BUS_RX;
+            m_sht.bit_count  = 0;
+            m_sht.shift      = 0;
+            m_sht.byte_index = 0;
+            m_sht.sda_drive  = 1;
+            g_sim_stats.i2c_transactions++;
+        }
+        else
+        {
+            m_sht.state     = BUS_IDLE;
+            m_sht.sda_drive = 1;
+        }
+    }
+    else if (scl && !m_sht.prev_scl)
+    {
+        on_scl_rising(sda);
+    }
+    else if (!scl && m_sht.prev_scl)
+    {
+        on_scl_falling();
+    }
+
+    m_sht.prev_sda = sim_gpio_master_level(SIM_SDA_PIN) & m_sht.sda_drive;
+    m_sht.prev_scl = sim_gpio_master_level(SIM_SCL_PIN) & (m_sht.scl_hold ? 0 : 1);
+}
+
+
+uint32_t sim_sht2x_sda_level(void)
+{
+    refresh();
+    return m_sht.sda_drive;
+}
+
+
+uint32_t sim_sht2x_scl_level(void)
+{
+    refresh();
+    return m_sht.scl_hold ? 0 : 1;
+}
+
+
+void sim_sht2x_init(void)
+{
+    uint32_t serial = 0x2C1A5F37UL ^ (g_sim_options.seed * 0x9E3779B9UL);
+
+    memset(&m_sht, 0, sizeof(m_sht));
+    m_sht.state       = BUS_IDLE;
+    m_sht.prev_sda    = 1;
+    m_sht.prev_scl    = 1;
+    m_sht.sda_drive   = 1;
+    m_sht.user_reg    = SHT2X_USER_REG_DEFAULT;
+    m_sht.serial_a[0] = 0x00;
+    m_sht.serial_a[1] = 0x80;
+    m_sht.serial_c[0] = 0x32;
+    m_sht.serial_c[1] = 0x01;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        m_sht.serial_b[i] = (uint8_t)(serial >> (24 - 8 * i));
+    }
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        m_sht.phase[i] = (double)(sim_random() % 6283) / 1000.0;
+    }
+
+    sim_gpio_attach(SIM_SDA_PIN, sim_sht2x_bus_changed);
+    sim_gpio_attach(SIM_SCL_PIN, sim_sht2x_bus_changed);
+}
@@ -0,0 +1,1438 @@
+/** @file
+ *
+ * @brief RTemp host simulation - S110 SoftDevice model (GAP, GATT server, radio accounting).
+ *
+ * The attribute table is kept as a flat array like the real stack does. Radio
+ * activity is accounted analytically: advertising and idle connection events
+ * are counted from elapsed time, while connection events that carry data
+ * (notifications, ATT requests and responses) are simulated one by one on the
+ * connection anchor grid. All ATT traffic from the simulated central goes
+ * through the same anchors, so one ATT round trip costs one connection
+ * interval, as on air.
+ */
+#include <string.h>
+#include "sim.h"
+#include "ble.h"
+#include "ble_hci.h"
+#include "ble_srv_common.h"
+#include "softdevice_handler.h"
+#include "nrf_soc.h"
+
+#define SIM_MAX_ATTRS           64
+#define SIM_MAX_VS_UUIDS        10
+#define SIM_TX_BUFFERS          7           /**< Application TX buffers of S110 v8.0.0. */
+#define SIM_PACKETS_PER_EVENT   6           /**< Data packets the peripheral may send in one connection event. */
+#define SIM_ATT_PAYLOAD         (GATT_MTU_SIZE_DEFAULT - 1)
+#define SIM_NOTIFY_PAYLOAD      (GATT_MTU_SIZE_DEFAULT - 3)
+#define SIM_FIRST_APP_HANDLE    0x000C      /**< Handles below this belong to the GAP and GATT services. */
+#define SIM_ADV_DELAY_AVG_US    5000        /**< Mean of the 0..10 ms random advDelay added to every advertising event. */
+#define SIM_ADV_EVENT_US        1500        /**< Radio time of one advertising event on 3 channels. */
+#define SIM_CONN_EVENT_US       1000        /**< Radio time of one connection event, ramp-up included. */
+#define SIM_CONN_UPDATE_EVENTS  6           /**< Connection events between an update request and its instant. */
+#define SIM_CONN_HANDLE         0
+
+typedef enum
+{
+    ATTR_SERVICE,
+    ATTR_CHAR_DECL,
+    ATTR_VALUE,
+    ATTR_CCCD,
+    ATTR_DESC
+} attr_kind_t;
+
+typedef struct
+{
+    attr_kind_t kind;
+    uint16_t    uuid;
+    uint8_t     uuid_type;
+    uint16_t    value_handle;               /**< For CCCDs, the characteristic value they belong to. */
+    uint16_t    cccd_handle;                /**< For values, their CCCD or 0. */
+    bool        notify;
+    bool        write;
+    uint8_t     vloc;
+    bool        vlen;
+    bool        rd_auth;
+    bool        wr_auth;
+    uint16_t    max_len;
+    uint16_t    len;
+    uint8_t   * p_user;                     /**< Value storage for BLE_GATTS_VLOC_USER. */
+    uint8_t     value[BLE_GATTS_VAR_ATTR_LEN_MAX];
+} sim_attr_t;
+
+typedef struct
+{
+    uint16_t handle;
+    uint16_t len;
+    uint8_t  data[SIM_NOTIFY_PAYLOAD];
+} sim_tx_packet_t;
+
+static sim_attr_t         m_attrs[SIM_MAX_ATTRS];
+static uint16_t           m_attr_count;
+static ble_uuid128_t      m_vs_uuids[SIM_MAX_VS_UUIDS];
+static uint8_t            m_vs_count;
+static ble_evt_handler_t  m_ble_handler;
+static sys_evt_handler_t  m_sys_handler;
+static bool               m_enabled;
+static ble_evt_t          m_evt;
+static uint8_t            m_radio_notification;   /**< NRF_RADIO_NOTIFICATION_TYPE_ */
+
+static struct
+{
+    uint8_t               name[32];
+    uint16_t              name_len;
+    uint16_t              appearance;
+    ble_gap_conn_params_t ppcp;
+    int8_t                tx_power;
+    uint8_t               adv_data[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t               adv_len;
+    uint8_t               sr_data[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t               sr_len;
+    bool                  advertising;
+    ble_gap_adv_params_t  adv_params;
+    sim_time_t            adv_started;
+    int                   adv_timeout_event;
+    uint64_t              adv_data_updates;
+} m_gap;
+
+static struct
+{
+    bool            connected;
+    bool            connecting;
+    uint16_t        interval;               /**< 1.25 ms units. */
+    uint16_t        latency;
+    uint16_t        timeout;
+    sim_time_t      anchor_base;
+    sim_time_t      segment_start;
+    uint64_t        busy_anchors;
+    uint64_t        last_busy_anchor;
+    bool            sys_attr_set;
+    bool            update_pending;
+    sim_tx_packet_t tx[SIM_TX_BUFFERS];
+    uint8_t         tx_count;
+    int             tx_event;
+    uint64_t        connections;
+    sim_time_t      connected_us;
+    sim_time_t      connected_at;
+    uint64_t        no_tx_buffers;
+    uint64_t        att_requests;
+    uint64_t        att_rsp_bytes;
+} m_conn;
+
+static struct
+{
+    bool             active;
+    bool             is_write;
+    bool             waiting_auth;
+    uint16_t         handle;
+    uint16_t         offset;
+    uint16_t         len;
+    uint8_t          data[BLE_GATTS_VAR_ATTR_LEN_MAX];
+    uint16_t         rsp_status;
+    uint16_t         rsp_len;
+    uint8_t          rsp_data[SIM_ATT_PAYLOAD];
+    sim_att_rsp_fn_t rsp;
+} m_att;
+
+static sim_attr_t * attr_get(uint16_t handle)
+{
+    if ((handle < SIM_FIRST_APP_HANDLE) || (handle >= SIM_FIRST_APP_HANDLE + m_attr_count))
+    {
+        return NULL;
+    }
+    return &m_attrs[handle - SIM_FIRST_APP_HANDLE];
+}
+
+
+static uint8_t * attr_value(sim_attr_t * p_attr)
+{
+    return (p_attr->vloc == BLE_GATTS_VLOC_USER) ? p_attr->p_user : p_attr->value;
+}
+
+
+static sim_attr_t * attr_new(attr_kind_t kind, uint16_t * p_handle)
+{
+    if (m_attr_count >= SIM_MAX_ATTRS)
+    {
+        return NULL;
+    }
+    sim_attr_t * p_attr = &m_attrs[m_attr_count];
+    memset(p_attr, 0, sizeof(*p_attr));
+    p_attr->kind = kind;
+    p_attr->vloc = BLE_GATTS_VLOC_STACK;
+    *p_handle    = SIM_FIRST_APP_HANDLE + m_attr_count;
+    m_attr_count++;
+    return p_attr;
+}
+
+
+static sim_time_t interval_us(void)
+{
+    return (sim_time_t)m_conn.interval * 1250;
+}
+
+
+/**@brief Time of the first connection anchor strictly after now. */
+static sim_time_t next_anchor(void)
+{
+    sim_time_t now = sim_now();
+    sim_time_t iv  = interval_us();
+
+    if (now < m_conn.anchor_base)
+    {
+        return m_conn.anchor_base;
+    }
+    return m_conn.anchor_base + ((now - m_conn.anchor_base) / iv + 1) * iv;
+}
+
+
+/**@brief Marks the current anchor as one the peripheral had to attend because of data. */
+static void busy_anchor(void)
+{
+    uint64_t index = (sim_now() - m_conn.anchor_base) / interval_us() + 1;
+
+    if (index != m_conn.last_busy_anchor)
+    {
+        m_conn.last_busy_anchor = index;
+        m_conn.busy_anchors++;
+    }
+}
+
+
+/**@brief Closes the current connection parameter segment and adds its connection events. */
+static void conn_account(void)
+{
+    if (!m_conn.connected)
+    {
+        return;
+    }
+    sim_time_t now     = sim_now();
+    uint64_t   anchors = (now - m_conn.segment_start) / interval_us();
+    uint64_t   busy    = (m_conn.busy_anchors < anchors) ? m_conn.busy_anchors : anchors;
+
+    g_sim_stats.conn_events += busy + (anchors - busy) / (1 + m_conn.latency);
+    m_conn.segment_start     = now;
+    m_conn.busy_anchors      = 0;
+    m_conn.last_busy_anchor  = 0;
+}
+
+
+static void adv_account(void)
+{
+    if (m_gap.advertising)
+    {
+        sim_time_t period = (sim_time_t)m_gap.adv_params.interval * 625 + SIM_ADV_DELAY_AVG_US;
+        uint64_t   events = (sim_now() - m_gap.adv_started) / period;
+
+        g_sim_stats.adv_events += events;
+        m_gap.adv_started      += events * period;
+    }
+}
+
+
+void sim_ble_dispatch(ble_evt_t * p_ble_evt)
+{
+    if (m_ble_handler != NULL)
+    {
+        m_ble_handler(p_ble_evt);
+    }
+}
+
+
+void sim_sys_dispatch(uint32_t sys_evt)
+{
+    if (m_sys_handler != NULL)
+    {
+        m_sys_handler(sys_evt);
+    }
+}
+
+
+static ble_evt_t * evt_new(uint16_t evt_id)
+{
+    memset(&m_evt, 0, sizeof(m_evt));
+    m_evt.header.evt_id  = evt_id;
+    m_evt.header.evt_len = sizeof(m_evt);
+    return &m_evt;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* SoftDevice handler and common API                                                              */
+/* ---------------------------------------------------------------------------------------------- */
+
+uint32_t softdevice_handler_init(nrf_clock_lfclksrc_t           clock_source,
+                                 void *                         p_ble_evt_buffer,
+                                 uint16_t                       ble_evt_buffer_size,
+                                 softdevice_evt_schedule_func_t evt_schedule_func)
+{
+    (void)clock_source;
+    (void)p_ble_evt_buffer;
+    (void)ble_evt_buffer_size;
+    (void)evt_schedule_func;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler)
+{
+    m_ble_handler = ble_evt_handler;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler)
+{
+    m_sys_handler = sys_evt_handler;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_enable(ble_enable_params_t * p_ble_enable_params)
+{
+    (void)p_ble_enable_params;
+    if (m_enabled)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    m_enabled = true;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * p_vs_uuid, uint8_t * p_uuid_type)
+{
+    for (uint8_t i = 0; i < m_vs_count; i++)
+    {
+        if (memcmp(&m_vs_uuids[i], p_vs_uuid, sizeof(ble_uuid128_t)) == 0)
+        {
+            *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN + i;
+            return NRF_SUCCESS;
+        }
+    }
+    if (m_vs_count >= SIM_MAX_VS_UUIDS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_vs_uuids[m_vs_count] = *p_vs_uuid;
+    *p_uuid_type           = BLE_UUID_TYPE_VENDOR_BEGIN + m_vs_count;
+    m_vs_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_uuid_encode(ble_uuid_t const * p_uuid, uint8_t * p_uuid_le_len, uint8_t * p_uuid_le)
+{
+    if (p_uuid->type == BLE_UUID_TYPE_BLE)
+    {
+        *p_uuid_le_len = 2;
+        if (p_uuid_le != NULL)
+        {
+            (void)uint16_encode(p_uuid->uuid, p_uuid_le);
+        }
+        return NRF_SUCCESS;
+    }
+    if ((p_uuid->type < BLE_UUID_TYPE_VENDOR_BEGIN) || (p_uuid->type >= BLE_UUID_TYPE_VENDOR_BEGIN + m_vs_count))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    *p_uuid_le_len = 16;
+    if (p_uuid_le != NULL)
+    {
+        memcpy(p_uuid_le, m_vs_uuids[p_uuid->type - BLE_UUID_TYPE_VENDOR_BEGIN].uuid128, 16);
+        (void)uint16_encode(p_uuid->uuid, &p_uuid_le[12]);
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_tx_buffer_count_get(uint8_t * p_count)
+{
+    *p_count = SIM_TX_BUFFERS;
+    return NRF_SUCCESS;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* GATT server                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const * p_uuid, uint16_t * p_handle)
+{
+    if ((type != BLE_GATTS_SRVC_TYPE_PRIMARY) && (type != BLE_GATTS_SRVC_TYPE_SECONDARY))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    sim_attr_t * p_attr = attr_new(ATTR_SERVICE, p_handle);
+    if (p_attr == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_attr->uuid      = p_uuid->uuid;
+    p_attr->uuid_type = p_uuid->type;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t                   service_handle,
+                                         ble_gatts_char_md_t const * p_char_md,
+                                         ble_gatts_attr_t const    * p_attr_char_value,
+                                         ble_gatts_char_handles_t  * p_handles)
+{
+    uint16_t                    decl_handle;
+    ble_gatts_attr_md_t const * p_md = p_attr_char_value->p_attr_md;
+
+    (void)service_handle;
+    if ((p_attr_char_value->max_len > BLE_GATTS_VAR_ATTR_LEN_MAX) ||
+        (p_attr_char_value->init_len > p_attr_char_value->max_len))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if ((p_md->vloc == BLE_GATTS_VLOC_USER) && (p_attr_char_value->p_value == NULL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (attr_new(ATTR_CHAR_DECL, &decl_handle) == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    memset(p_handles, 0, sizeof(*p_handles));
+    sim_attr_t * p_value = attr_new(ATTR_VALUE, &p_handles->value_handle);
+    if (p_value == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_value->uuid      = p_attr_char_value->p_uuid->uuid;
+    p_value->uuid_type = p_attr_char_value->p_uuid->type;
+    p_value->vloc      = p_md->vloc;
+    p_value->vlen      = p_md->vlen;
+    p_value->rd_auth   = p_md->rd_auth;
+    p_value->wr_auth   = p_md->wr_auth;
+    p_value->max_len   = p_attr_char_value->max_len;
+    p_value->len       = p_attr_char_value->init_len;
+    p_value->notify    = p_char_md->char_props.notify || p_char_md->char_props.indicate;
+    p_value->write     = p_char_md->char_props.write || p_char_md->char_props.write_wo_resp;
+
+    if (p_md->vloc == BLE_GATTS_VLOC_USER)
+    {
+        p_value->p_user = p_attr_char_value->p_value;
+    }
+    else if (p_attr_char_value->p_value != NULL)
+    {
+        memcpy(p_value->value + p_attr_char_value->init_offs,
+               p_attr_char_value->p_value,
+               p_attr_char_value->init_len);
+    }
+
+    if (p_value->notify)
+    {
+        uint16_t     value_handle = p_handles->value_handle;
+        sim_attr_t * p_cccd       = attr_new(ATTR_CCCD, &p_handles->cccd_handle);
+        if (p_cccd == NULL)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        p_cccd->uuid          = 0x2902;
+        p_cccd->uuid_type     = BLE_UUID_TYPE_BLE;
+        p_cccd->value_handle  = value_handle;
+        p_cccd->max_len       = BLE_CCCD_VALUE_LEN;
+        p_cccd->len           = BLE_CCCD_VALUE_LEN;
+        attr_get(value_handle)->cccd_handle = p_handles->cccd_handle;
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_descriptor_add(uint16_t char_handle, ble_gatts_attr_t const * p_attr, uint16_t * p_handle)
+{
+    (void)char_handle;
+    sim_attr_t * p_desc = attr_new(ATTR_DESC, p_handle);
+    if (p_desc == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_desc->uuid      = p_attr->p_uuid->uuid;
+    p_desc->uuid_type = p_attr->p_uuid->type;
+    p_desc->max_len   = p_attr->max_len;
+    p_desc->len       = p_attr->init_len;
+    if (p_attr->p_value != NULL)
+    {
+        memcpy(p_desc->value, p_attr->p_value, p_attr->init_len);
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t * p_value)
+{
+    sim_attr_t * p_attr = attr_get(handle);
+
+    (void)conn_handle;
+    sim_busy_us(1);
+    if (p_attr == NULL)
+    {
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    }
+    if ((uint32_t)p_value->offset + p_value->len > p_attr->max_len)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_value->p_value != NULL)
+    {
+        memcpy(attr_value(p_attr) + p_value->offset, p_value->p_value, p_value->len);
+    }
+    if (p_attr->vlen || (p_value->offset + p_value->len > p_attr->len))
+    {
+        p_attr->len = p_value->offset + p_value->len;
+    }
+    g_sim_stats.value_sets++;
+    g_sim_stats.value_set_bytes += p_value->len;
+    // The SoftDevice copies the value with the CPU: roughly 4 cycles per byte at 16 MHz.
+    sim_busy_us(p_value->len / 4);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_value_get(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t * p_value)
+{
+    sim_attr_t * p_attr = attr_get(handle);
+
+    (void)conn_handle;
+    if (p_attr == NULL)
+    {
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    }
+    if (p_value->offset > p_attr->len)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    uint16_t avail = p_attr->len - p_value->offset;
+    if ((p_value->p_value != NULL) && (p_value->len > avail))
+    {
+        p_value->len = avail;
+    }
+    if (p_value->p_value == NULL)
+    {
+        p_value->len = avail;
+    }
+    else
+    {
+        memcpy(p_value->p_value, attr_value(p_attr) + p_value->offset, p_value->len);
+    }
+    return NRF_SUCCESS;
+}
+
+
+static void conn_event_tx(void * p_context);
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+    sim_attr_t * p_attr = attr_get(p_hvx_params->handle);
+
+    sim_busy_us(1);
+    if (!m_conn.connected || (conn_handle != SIM_CONN_HANDLE))
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if ((p_attr == NULL) || (p_attr->kind != ATTR_VALUE) || !p_attr->notify)
+    {
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    }
+    if (!m_conn.sys_attr_set)
+    {
+        return BLE_ERROR_GATTS_SYS_ATTR_MISSING;
+    }
+    if ((attr_get(p_attr->cccd_handle)->value[0] & BLE_GATT_HVX_NOTIFICATION) == 0)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_conn.tx_count >= SIM_TX_BUFFERS)
+    {
+        m_conn.no_tx_buffers++;
+        return BLE_ERROR_NO_TX_BUFFERS;
+    }
+
+    uint16_t len = (p_hvx_params->p_len != NULL) ? *p_hvx_params->p_len : p_attr->len;
+    if (p_hvx_params->p_data != NULL)
+    {
+        ble_gatts_value_t value = {len, p_hvx_params->offset, (uint8_t *)p_hvx_params->p_data};
+        uint32_t          err   = sd_ble_gatts_value_set(conn_handle, p_hvx_params->handle, &value);
+        if (err != NRF_SUCCESS)
+        {
+            return err;
+        }
+    }
+    if (len > p_attr->len)
+    {
+        len = p_attr->len;
+    }
+    if (len > SIM_NOTIFY_PAYLOAD)
+    {
+        len = SIM_NOTIFY_PAYLOAD;
+    }
+    if (p_hvx_params->p_len != NULL)
+    {
+        *p_hvx_params->p_len = len;
+    }
+
+    sim_tx_packet_t * p_packet = &m_conn.tx[m_conn.tx_count++];
+    p_packet->handle = p_hvx_params->handle;
+    p_packet->len    = len;
+    memcpy(p_packet->data, attr_value(p_attr), len);
+    g_sim_stats.notifications++;
+
+    if (m_conn.tx_event == 0)
+    {
+        m_conn.tx_event = sim_schedule(next_anchor(), conn_event_tx, NULL, true);
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t                                      conn_handle,
+                                         ble_gatts_rw_authorize_reply_params_t const * p_reply);
+
+
+uint32_t sd_ble_gatts_sys_attr_set(uint16_t conn_handle, uint8_t const * p_sys_attr_data, uint16_t len, uint32_t flags)
+{
+    (void)flags;
+    if (!m_conn.connected || (conn_handle != SIM_CONN_HANDLE))
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if ((p_sys_attr_data != NULL) && (len > 0))
+    {
+        return NRF_ERROR_INVALID_DATA;      // RTemp never stores system attributes.
+    }
+    for (uint16_t i = 0; i < m_attr_count; i++)
+    {
+        if (m_attrs[i].kind == ATTR_CCCD)
+        {
+            memset(m_attrs[i].value, 0, BLE_CCCD_VALUE_LEN);
+        }
+    }
+    m_conn.sys_attr_set = true;
+    return NRF_SUCCESS;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Connection events and ATT                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+static void conn_event_tx(void * p_context)
+{
+    uint8_t sent = 0;
+
+    (void)p_context;
+    m_conn.tx_event = 0;
+    if (!m_conn.connected)
+    {
+        return;
+    }
+    busy_anchor();
+
+    while ((sent < SIM_PACKETS_PER_EVENT) && (sent < m_conn.tx_count))
+    {
+        sim_central_on_notification(m_conn.tx[sent].handle, m_conn.tx[sent].data, m_conn.tx[sent].len);
+        sent++;
+    }
+    g_sim_stats.tx_packets += sent;
+    memmove(&m_conn.tx[0], &m_conn.tx[sent], (m_conn.tx_count - sent) * sizeof(sim_tx_packet_t));
+    m_conn.tx_count -= sent;
+
+    if (m_conn.tx_count > 0)
+    {
+        m_conn.tx_event = sim_schedule(next_anchor(), conn_event_tx, NULL, true);
+    }
+
+    ble_evt_t * p_evt = evt_new(BLE_EVT_TX_COMPLETE);
+    p_evt->evt.common_evt.conn_handle       = SIM_CONN_HANDLE;
+    p_evt->evt.common_evt.params.tx_complete.count = sent;
+    sim_ble_dispatch(p_evt);
+}
+
+
+static void att_response(void * p_context)
+{
+    sim_att_rsp_fn_t rsp = m_att.rsp;
+
+    (void)p_context;
+    if (!m_conn.connected || !m_att.active)
+    {
+        return;
+    }
+    busy_anchor();
+    g_sim_stats.tx_packets++;
+    m_conn.att_rsp_bytes += m_att.rsp_len;
+    m_att.active          = false;
+    rsp(m_att.rsp_status, m_att.rsp_data, m_att.rsp_len);
+}
+
+
+static void att_read_value(sim_attr_t * p_attr, const uint8_t * p_data, uint16_t len)
+{
+    if (m_att.offset > len)
+    {
+        m_att.rsp_status = BLE_GATT_STATUS_ATTERR_INVALID_OFFSET;
+        m_att.rsp_len    = 0;
+        return;
+    }
+    (void)p_attr;
+    m_att.rsp_status = BLE_GATT_STATUS_SUCCESS;
+    m_att.rsp_len    = MIN(len - m_att.offset, SIM_ATT_PAYLOAD);
+    memcpy(m_att.rsp_data, p_data + m_att.offset, m_att.rsp_len);
+}
+
+
+/**@brief Stores written data. Authorized writes get no WRITE event: the reply already told the
+ *        application everything. */
+static void att_apply_write(sim_attr_t * p_attr, uint16_t handle, bool notify_app)
+{
+    ble_evt_t * p_evt;
+
+    if ((uint32_t)m_att.offset + m_att.len > p_attr->max_len)
+    {
+        m_att.rsp_status = BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+        return;
+    }
+    memcpy(attr_value(p_attr) + m_att.offset, m_att.data, m_att.len);
+    if (p_attr->vlen || (p_attr->kind == ATTR_CCCD))
+    {
+        p_attr->len = m_att.offset + m_att.len;
+    }
+    m_att.rsp_status = BLE_GATT_STATUS_SUCCESS;
+    if (!notify_app)
+    {
+        return;
+    }
+
+    p_evt = evt_new(BLE_GATTS_EVT_WRITE);
+    p_evt->evt.gatts_evt.conn_handle         = SIM_CONN_HANDLE;
+    p_evt->evt.gatts_evt.params.write.handle = handle;
+    p_evt->evt.gatts_evt.params.write.op     = BLE_GATTS_OP_WRITE_REQ;
+    p_evt->evt.gatts_evt.params.write.offset = m_att.offset;
+    p_evt->evt.gatts_evt.params.write.len    = m_att.len;
+    p_evt->evt.gatts_evt.params.write.context.value_handle =
+        (p_attr->kind == ATTR_CCCD) ? p_attr->value_handle : handle;
+    p_evt->evt.gatts_evt.params.write.context.char_uuid.uuid =
+        (p_attr->kind == ATTR_CCCD) ? attr_get(p_attr->value_handle)->uuid : p_attr->uuid;
+    memcpy(p_evt->evt.gatts_evt.params.write.data, m_att.data, m_att.len);
+    sim_ble_dispatch(p_evt);
+}
+
+
+/**@brief The request reaches the peripheral at a connection anchor. */
+static void att_request(void * p_context)
+{
+    sim_attr_t * p_attr = attr_get(m_att.handle);
+    ble_evt_t  * p_evt;
+
+    (void)p_context;
+    if (!m_conn.connected || !m_att.active)
+    {
+        return;
+    }
+    busy_anchor();
+    m_conn.att_requests++;
+
+    if (p_attr == NULL)
+    {
+        m_att.rsp_status = BLE_GATT_STATUS_ATTERR_INVALID_HANDLE;
+        m_att.rsp_len    = 0;
+        sim_schedule(next_anchor(), att_response, NULL, false);
+        return;
+    }
+
+    if (p_attr->kind == ATTR_CCCD)
+    {
+        if (!m_conn.sys_attr_set)
+        {
+            p_evt = evt_new(BLE_GATTS_EVT_SYS_ATTR_MISSING);
+            p_evt->evt.gatts_evt.conn_handle = SIM_CONN_HANDLE;
+            sim_ble_dispatch(p_evt);
+        }
+        if (m_att.is_write)
+        {
+            att_apply_write(p_attr, m_att.handle, true);
+        }
+        else
+        {
+            att_read_value(p_attr, p_attr->value, p_attr->len);
+        }
+        sim_schedule(next_anchor(), att_response, NULL, false);
+        return;
+    }
+
+    if ((m_att.is_write && p_attr->wr_auth) || (!m_att.is_write && p_attr->rd_auth))
+    {
+        m_att.waiting_auth = true;
+        p_evt = evt_new(BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST);
+        p_evt->evt.gatts_evt.conn_handle = SIM_CONN_HANDLE;
+        if (m_att.is_write)
+        {
+            ble_gatts_evt_write_t * p_write = &p_evt->evt.gatts_evt.params.authorize_request.request.write;
+
+            p_evt->evt.gatts_evt.params.authorize_request.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+            p_write->handle                 = m_att.handle;
+            p_write->op                     = BLE_GATTS_OP_WRITE_REQ;
+            p_write->offset                 = m_att.offset;
+            p_write->len                    = m_att.len;
+            p_write->context.value_handle   = m_att.handle;
+            p_write->context.char_uuid.uuid = p_attr->uuid;
+            memcpy(p_write->data, m_att.data, m_att.len);
+        }
+        else
+        {
+            ble_gatts_evt_read_t * p_read = &p_evt->evt.gatts_evt.params.authorize_request.request.read;
+
+            p_evt->evt.gatts_evt.params.authorize_request.type = BLE_GATTS_AUTHORIZE_TYPE_READ;
+            p_read->handle                 = m_att.handle;
+            p_read->offset                 = m_att.offset;
+            p_read->context.value_handle   = m_att.handle;
+            p_read->context.char_uuid.uuid = p_attr->uuid;
+        }
+        sim_ble_dispatch(p_evt);
+        return;
+    }
+
+    if (m_att.is_write)
+    {
+        if (!p_attr->write)
+        {
+            m_att.rsp_status = BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED;
+        }
+        else
+        {
+            att_apply_write(p_attr, m_att.handle, true);
+        }
+    }
+    else
+    {
+        att_read_value(p_attr, attr_value(p_attr), p_attr->len);
+    }
+    sim_schedule(next_anchor(), att_response, NULL, false);
+}
+
+
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t                                      conn_handle,
+                                         ble_gatts_rw_authorize_reply_params_t const * p_reply)
+{
+    sim_attr_t * p_attr = attr_get(m_att.handle);
+
+    sim_busy_us(1);
+    if (!m_conn.connected || (conn_handle != SIM_CONN_HANDLE))
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (!m_att.active || !m_att.waiting_auth)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    m_att.waiting_auth = false;
+
+    if (p_reply->type == BLE_GATTS_AUTHORIZE_TYPE_READ)
+    {
+        ble_gatts_read_authorize_params_t const * p_read = &p_reply->params.read;
+
+        if (p_read->gatt_status != BLE_GATT_STATUS_SUCCESS)
+        {
+            m_att.rsp_status = p_read->gatt_status;
+            m_att.rsp_len    = 0;
+        }
+        else
+        {
+            if (p_read->update)
+            {
+                ble_gatts_value_t value = {p_read->len, p_read->offset, (uint8_t *)p_read->p_data};
+                uint32_t          err   = sd_ble_gatts_value_set(conn_handle, m_att.handle, &value);
+                if (err != NRF_SUCCESS)
+                {
+                    return err;
+                }
+            }
+            att_read_value(p_attr, attr_value(p_attr), p_attr->len);
+        }
+    }
+    else
+    {
+        if (p_reply->params.write.gatt_status != BLE_GATT_STATUS_SUCCESS)
+        {
+            m_att.rsp_status = p_reply->params.write.gatt_status;
+        }
+        else
+        {
+            att_apply_write(p_attr, m_att.handle, false);
+        }
+        m_att.rsp_len = 0;
+    }
+    sim_schedule(next_anchor(), att_response, NULL, false);
+    return NRF_SUCCESS;
+}
+
+
+void sim_att_read(uint16_t handle, uint16_t offset, sim_att_rsp_fn_t rsp)
+{
+    if (!m_conn.connected || m_att.active)
+    {
+        sim_fatal("central issued an ATT read with %s", m_att.active ? "a request outstanding" : "no link");
+    }
+    memset(&m_att, 0, sizeof(m_att));
+    m_att.active = true;
+    m_att.handle = handle;
+    m_att.offset = offset;
+    m_att.rsp    = rsp;
+    sim_schedule(next_anchor(), att_request, NULL, true);
+}
+
+
+void sim_att_write(uint16_t handle, const uint8_t * p_data, uint16_t len, sim_att_rsp_fn_t rsp)
+{
+    if (!m_conn.connected || m_att.active)
+    {
+        sim_fatal("central issued an ATT write with %s", m_att.active ? "a request outstanding" : "no link");
+    }
+    if (len > SIM_NOTIFY_PAYLOAD)
+    {
+        sim_fatal("central issued an ATT write of %u bytes, a Write Request holds %u", len, SIM_NOTIFY_PAYLOAD);
+    }
+    memset(&m_att, 0, sizeof(m_att));
+    m_att.active   = true;
+    m_att.is_write = true;
+    m_att.handle   = handle;
+    m_att.len      = len;
+    m_att.rsp      = rsp;
+    memcpy(m_att.data, p_data, len);
+    sim_schedule(next_anchor(), att_request, NULL, true);
+}
+
+
+uint16_t sim_gatts_find(uint16_t uuid, uint16_t after_handle)
+{
+    for (uint16_t i = 0; i < m_attr_count; i++)
+    {
+        uint16_t handle = SIM_FIRST_APP_HANDLE + i;
+
+        if ((handle > after_handle) && (m_attrs[i].kind == ATTR_VALUE) && (m_attrs[i].uuid == uuid))
+        {
+            return handle;
+        }
+    }
+    return BLE_GATT_HANDLE_INVALID;
+}
+
+
+uint16_t sim_gatts_cccd_handle(uint16_t value_handle)
+{
+    sim_attr_t * p_attr = attr_get(value_handle);
+
+    return (p_attr != NULL) ? p_attr->cccd_handle : BLE_GATT_HANDLE_INVALID;
+}
+
+
+uint16_t sim_gatts_value_len(uint16_t handle)
+{
+    sim_attr_t * p_attr = attr_get(handle);
+
+    return (p_attr != NULL) ? p_attr->len : 0;
+}
+
+
+const uint8_t * sim_gatts_value(uint16_t handle)
+{
+    sim_attr_t * p_attr = attr_get(handle);
+
+    return (p_attr != NULL) ? attr_value(p_attr) : NULL;
+}
+
+
+/* ---------------------------------------------------------------------------------------------- */
+/* GAP                                                                                            */
+/* ---------------------------------------------------------------------------------------------- */
+
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const * p_write_perm, uint8_t const * p_dev_name, uint16_t len)
+{
+    (void)p_write_perm;
+    if (len > sizeof(m_gap.name))
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    memcpy(m_gap.name, p_dev_name, len);
+    m_gap.name_len = len;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_device_name_get(uint8_t * p_dev_name, uint16_t * p_len)
+{
+    if (p_dev_name != NULL)
+    {
+        if (*p_len < m_gap.name_len)
+        {
+            return NRF_ERROR_DATA_SIZE;
+        }
+        memcpy(p_dev_name, m_gap.name, m_gap.name_len);
+    }
+    *p_len = m_gap.name_len;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_appearance_set(uint16_t appearance)
+{
+    m_gap.appearance = appearance;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_appearance_get(uint16_t * p_appearance)
+{
+    *p_appearance = m_gap.appearance;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const * p_conn_params)
+{
+    m_gap.ppcp = *p_conn_params;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_ppcp_get(ble_gap_conn_params_t * p_conn_params)
+{
+    *p_conn_params = m_gap.ppcp;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_tx_power_set(int8_t tx_power)
+{
+    m_gap.tx_power = tx_power;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_adv_data_set(uint8_t const * p_data, uint8_t dlen, uint8_t const * p_sr_data, uint8_t srdlen)
+{
+    sim_busy_us(1);
+    if ((dlen > BLE_GAP_ADV_MAX_SIZE) || (srdlen > BLE_GAP_ADV_MAX_SIZE))
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_data != NULL)
+    {
+        memcpy(m_gap.adv_data, p_data, dlen);
+        m_gap.adv_len = dlen;
+    }
+    if (p_sr_data != NULL)
+    {
+        memcpy(m_gap.sr_data, p_sr_data, srdlen);
+        m_gap.sr_len = srdlen;
+    }
+    m_gap.adv_data_updates++;
+    return NRF_SUCCESS;
+}
+
+
+static void adv_timeout(void * p_context)
+{
+    (void)p_context;
+    m_gap.adv_timeout_event = 0;
+    if (!m_gap.advertising)
+    {
+        return;
+    }
+    adv_account();
+    m_gap.advertising = false;
+
+    ble_evt_t * p_evt = evt_new(BLE_GAP_EVT_TIMEOUT);
+    p_evt->evt.gap_evt.conn_handle        = BLE_CONN_HANDLE_INVALID;
+    p_evt->evt.gap_evt.params.timeout.src = BLE_GAP_TIMEOUT_SRC_ADVERTISING;
+    sim_ble_dispatch(p_evt);
+}
+
+
+uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const * p_adv_params)
+{
+    sim_busy_us(1);
+    // A central waiting for an advertising event to connect on (m_conn.connecting) is no business
+    // of the peripheral: it connects on the first event of the restarted advertising.
+    if (m_gap.advertising || m_conn.connected)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_adv_params->interval < BLE_GAP_ADV_INTERVAL_MIN) || (p_adv_params->interval > BLE_GAP_ADV_INTERVAL_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    m_gap.adv_params  = *p_adv_params;
+    m_gap.advertising = true;
+    m_gap.adv_started = sim_now();
+    if (p_adv_params->timeout != 0)
+    {
+        m_gap.adv_timeout_event = sim_schedule(sim_now() + (sim_time_t)p_adv_params->timeout * SIM_US_PER_S,
+                                               adv_timeout, NULL, true);
+    }
+    sim_trace("gap: advertising every %.1f ms, timeout %u s",
+              p_adv_params->interval * 0.625, p_adv_params->timeout);
+    return NRF_SUCCESS;
+}
+
+
+static void adv_stop(void)
+{
+    adv_account();
+    m_gap.advertising = false;
+    if (m_gap.adv_timeout_event != 0)
+    {
+        sim_cancel(m_gap.adv_timeout_event);
+        m_gap.adv_timeout_event = 0;
+    }
+}
+
+
+uint32_t sd_ble_gap_adv_stop(void)
+{
+    sim_busy_us(1);
+    if (!m_gap.advertising)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    adv_stop();
+    return NRF_SUCCESS;
+}
+
+
+static void conn_established(void * p_context)
+{
+    (void)p_context;
+    m_conn.connecting = false;
+    if (!m_gap.advertising)
+    {
+        return;                             // Advertising was stopped before the CONNECT_REQ.
+    }
+    adv_stop();
+    g_sim_stats.adv_events++;
+
+    m_conn.connected        = true;
+    m_conn.anchor_base      = sim_now() + 1250 + interval_us();
+    m_conn.segment_start    = sim_now();
+    m_conn.busy_anchors     = 0;
+    m_conn.last_busy_anchor = 0;
+    m_conn.sys_attr_set     = false;
+    m_conn.update_pending   = false;
+    m_conn.tx_count         = 0;
+    m_conn.connections++;
+    m_conn.connected_at     = sim_now();
+    memset(&m_att, 0, sizeof(m_att));
+    for (uint16_t i = 0; i < m_attr_count; i++)
+    {
+        if (m_attrs[i].kind == ATTR_CCCD)
+        {
+            memset(m_attrs[i].value, 0, BLE_CCCD_VALUE_LEN);
+        }
+    }
+    sim_trace("gap: connected, interval %.2f ms, latency %u", m_conn.interval * 1.25, m_conn.latency);
+
+    ble_evt_t * p_evt = evt_new(BLE_GAP_EVT_CONNECTED);
+    p_evt->evt.gap_evt.conn_handle                                    = SIM_CONN_HANDLE;
+    p_evt->evt.gap_evt.params.connected.conn_params.min_conn_interval = m_conn.interval;
+    p_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval = m_conn.interval;
+    p_evt->evt.gap_evt.params.connected.conn_params.slave_latency     = m_conn.latency;
+    p_evt->evt.gap_evt.params.connected.conn_params.conn_sup_timeout  = m_conn.timeout;
+    sim_ble_dispatch(p_evt);
+    sim_central_on_connected();
+}
+
+
+/**@brief The next advertising event is anywhere in the current interval. */
+sim_time_t sim_adv_wait_us(void)
+{
+    sim_time_t period = (sim_time_t)m_gap.adv_params.interval * 625 + SIM_ADV_DELAY_AVG_US;
+
+    return sim_random() % period;
+}
+
+
+/**@brief End of a radio event on a grid of events period apart, the first one starting at first.
+ *
+ * @param[in]   next    The first end after now if set, the last end up to now otherwise.
+ *
+ * @return      The end, 0 if there is none.
+ */
+static sim_time_t radio_event_end(sim_time_t first, sim_time_t period, sim_time_t duration, bool next)
+{
+    sim_time_t now = sim_now();
+    sim_time_t end = first + duration;
+
+    if (now < end)
+    {
+        return next ? end : 0;
+    }
+    return end + ((now - end) / period + (next ? 1 : 0)) * period;
+}
+
+
+/**@brief End of the radio event after now, or before it: the attended connection events, or the
+ *        advertising events at their mean spacing. */
+static sim_time_t radio_inactive(bool next)
+{
+    if (m_conn.connected)
+    {
+        return radio_event_end(m_conn.anchor_base, interval_us() * (1 + m_conn.latency), SIM_CONN_EVENT_US, next);
+    }
+    if (m_gap.advertising)
+    {
+        return radio_event_end(m_gap.adv_started, (sim_time_t)m_gap.adv_params.interval * 625 + SIM_ADV_DELAY_AVG_US,
+                               SIM_ADV_EVENT_US, next);
+    }
+    return 0;
+}
+
+
+/**@brief When the radio notification signals the end of the next radio event, 0 for never. */
+sim_time_t sim_radio_next_inactive(void)
+{
+    if ((m_radio_notification != NRF_RADIO_NOTIFICATION_TYPE_INT_ON_INACTIVE) &&
+        (m_radio_notification != NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH))
+    {
+        return 0;
+    }
+    return radio_inactive(true);
+}
+
+
+/**@brief End of the last radio event, 0 for none. */
+sim_time_t sim_radio_last_inactive(void)
+{
+    return radio_inactive(false);
+}
+
+
+uint32_t sd_radio_notification_cfg_set(uint8_t type, uint8_t distance)
+{
+    (void)distance;
+    if (m_gap.advertising || m_conn.connected || m_conn.connecting)
+    {
+        return NRF_ERROR_INVALID_STATE; // The radio must be unused
+    }
+    m_radio_notification = type;
+    return NRF_SUCCESS;
+}
+
+
+bool sim_ble_connect(uint16_t interval, uint16_t latency)
+{
+    if (!m_gap.advertising || m_conn.connecting ||
+        (m_gap.adv_params.type != BLE_GAP_ADV_TYPE_ADV_IND))
+    {
+        return false;
+    }
+    m_conn.connecting = true;
+    m_conn.interval   = interval;
+    m_conn.latency    = latency;
+    m_conn.timeout    = 400;                // 4 s, in 10 ms units.
+    sim_schedule(sim_now() + sim_adv_wait_us(), conn_established, NULL, true);
+    return true;
+}
+
+
+static void conn_lost(uint8_t reason)
+{
+    conn_account();
+    m_conn.connected     = false;
+    m_conn.connected_us += sim_now() - m_conn.connected_at;
+    m_conn.tx_count      = 0;
+    if (m_conn.tx_event != 0)
+    {
+        sim_cancel(m_conn.tx_event);
+        m_conn.tx_event = 0;
+    }
+    memset(&m_att, 0, sizeof(m_att));
+    sim_trace("gap: disconnected, reason 0x%02X", reason);
+
+    ble_evt_t * p_evt = evt_new(BLE_GAP_EVT_DISCONNECTED);
+    p_evt->evt.gap_evt.conn_handle                = SIM_CONN_HANDLE;
+    p_evt->evt.gap_evt.params.disconnected.reason = reason;
+    sim_ble_dispatch(p_evt);
+    sim_central_on_disconnected(reason);
+}
+
+
+static void disconnect_evt(void * p_context)
+{
+    if (m_conn.connected)
+    {
+        conn_lost((uint8_t)(uintptr_t)p_context);
+    }
+}
+
+
+void sim_ble_disconnect(uint8_t reason)
+{
+    if (m_conn.connected)
+    {
+        sim_schedule(next_anchor(), disconnect_evt, (void *)(uintptr_t)reason, true);
+    }
+}
+
+
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code)
+{
+    sim_busy_us(1);
+    if (!m_conn.connected || (conn_handle != SIM_CONN_HANDLE))
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    (void)hci_status_code;
+    sim_schedule(next_anchor(), disconnect_evt, (void *)(uintptr_t)BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION, true);
+    return NRF_SUCCESS;
+}
+
+
+static void conn_param_instant(void * p_context)
+{
+    ble_gap_conn_params_t * p_params = (ble_gap_conn_params_t *)p_context;
+
+    if (!m_conn.connected)
+    {
+        return;
+    }
+    conn_account();
+    m_conn.update_pending = false;
+    m_conn.interval       = p_params->min_conn_interval;
+    m_conn.latency        = p_params->slave_latency;
+    m_conn.timeout        = p_params->conn_sup_timeout;
+    m_conn.anchor_base    = sim_now() + interval_us();
+    sim_trace("gap: connection parameters now %.2f ms, latency %u", m_conn.interval * 1.25, m_conn.latency);
+
+    ble_evt_t * p_evt = evt_new(BLE_GAP_EVT_CONN_PARAM_UPDATE);
+    p_evt->evt.gap_evt.conn_handle                       = SIM_CONN_HANDLE;
+    p_evt->evt.gap_evt.params.conn_param_update.conn_params = *p_params;
+    p_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval = p_params->min_conn_interval;
+    sim_ble_dispatch(p_evt);
+}
+
+
+/**@brief The central accepts any request inside the iOS limits and picks the lowest multiple
+ *        of 15 ms inside the requested range, like an iPhone does. */
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const * p_conn_params)
+{
+    static ble_gap_conn_params_t accepted;
+    ble_gap_conn_params_t        requested = (p_conn_params != NULL) ? *p_conn_params : m_gap.ppcp;
+    uint16_t                     interval;
+
+    sim_busy_us(1);
+    if (!m_conn.connected || (conn_handle != SIM_CONN_HANDLE))
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (m_conn.update_pending)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if ((requested.min_conn_interval < BLE_GAP_CP_MIN_CONN_INTVL_MIN) ||
+        (requested.max_conn_interval > BLE_GAP_CP_MAX_CONN_INTVL_MAX) ||
+        (requested.min_conn_interval > requested.max_conn_interval))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    interval = (uint16_t)(CEIL_DIV(requested.min_conn_interval, 12) * 12);
+    if (interval > requested.max_conn_interval)
+    {
+        interval = requested.max_conn_interval;
+    }
+    accepted                   = requested;
+    accepted.min_conn_interval = interval;
+    accepted.max_conn_interval = interval;
+    m_conn.update_pending      = true;
+    sim_schedule(next_anchor() + SIM_CONN_UPDATE_EVENTS * interval_us(), conn_param_instant, &accepted, true);
+    return NRF_SUCCESS;
+}
+
+
+bool sim_ble_is_connected(void)
+{
+    return m_conn.connected;
+}
+
+
+bool sim_ble_is_advertising(void)
+{
+    return m_gap.advertising;
+}
+
+
+uint16_t sim_ble_conn_interval(void)
+{
+    return m_conn.interval;
+}
+
+
+void sim_adv_pdu(uint8_t * p_data, uint8_t * p_len, bool * p_connectable)
+{
+    memcpy(p_data, m_gap.adv_data, m_gap.adv_len);
+    *p_len         = m_gap.adv_len;
+    *p_connectable = m_gap.advertising && (m_gap.adv_params.type == BLE_GAP_ADV_TYPE_ADV_IND);
+}
+
+
+void sim_softdevice_init(void)
+{
+    memset(m_attrs, 0, sizeof(m_attrs));
+    memset(&m_gap, 0, sizeof(m_gap));
+    memset(&m_conn, 0, sizeof(m_conn));
+    memset(&m_att, 0, sizeof(m_att));
+    m_attr_count         = 0;
+    m_vs_count           = 0;
+    m_ble_handler        = NULL;
+    m_sys_handler        = NULL;
+    m_enabled            = false;
+    m_radio_notification = NRF_RADIO_NOTIFICATION_TYPE_NONE;
+}
+
+
+/**@brief Brings the analytic radio counters up to the current time, before they are reported. */
+void sim_softdevice_account(void)
+{
+    adv_account();
+    if (m_conn.connected)
+    {
+        conn_account();
+        m_conn.connected_us += sim_now() - m_conn.connected_at;
+        m_conn.connected_at  = sim_now();
+    }
+}
+
+
+void sim_softdevice_report(void)
+{
+    uint32_t stack_bytes = 0;
+    uint32_t user_bytes  = 0;
+
+    for (uint16_t i = 0; i < m_attr_count; i++)
+    {
+        if (m_attrs[i].vloc == BLE_GATTS_VLOC_USER)
+        {
+            user_bytes += m_attrs[i].max_len;
+        }
+        else if (m_attrs[i].kind != ATTR_CHAR_DECL)
+        {
+            stack_bytes += m_attrs[i].max_len;
+        }
+    }
+
+    printf("  connections             %10llu (%.1f s connected, %llu ATT requests, %llu response bytes)\n",
+           (unsigned long long)m_conn.connections,
+           (double)m_conn.connected_us / SIM_US_PER_S,
+           (unsigned long long)m_conn.att_requests,
+           (unsigned long long)m_conn.att_rsp_bytes);
+    printf("  notifications dropped   %10llu (no tx buffers)\n", (unsigned long long)m_conn.no_tx_buffers);
+    printf("  advertising data sets   %10llu\n", (unsigned long long)m_gap.adv_data_updates);
+    printf("  attribute table         %10u handles, %u value bytes in the stack, %u in application RAM\n",
+           (unsigned)(SIM_FIRST_APP_HANDLE + m_attr_count - 1), (unsigned)stack_bytes, (unsigned)user_bytes);
+}
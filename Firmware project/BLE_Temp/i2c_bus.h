@@ -0,0 +1,71 @@
+#ifndef I2C_BUS_H__
+#define I2C_BUS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "I2C_HAL.h"
+
+/**@brief I2C bus backends. Both use the SDA_Pin and SCL_Pin from I2C_HAL.h. */
+#define I2C_BUS_BACKEND_BITBANG    0        /**< Sensirion I2C_HAL.c, every bit clocked by the CPU. */
+#define I2C_BUS_BACKEND_TWI        1        /**< TWI1 peripheral, interrupt driven, the CPU sleeps during transfers. */
+
+#ifndef I2C_BUS_BACKEND
+#define I2C_BUS_BACKEND            I2C_BUS_BACKEND_TWI
+#endif
+
+/**@brief TWI bus frequencies. The bit-banged bus runs at roughly 50 kHz regardless. */
+#define I2C_BUS_FREQ_100K          0
+#define I2C_BUS_FREQ_400K          1
+
+#ifndef I2C_BUS_FREQUENCY
+#define I2C_BUS_FREQUENCY          I2C_BUS_FREQ_100K
+#endif
+
+/**@brief One bus transaction: START, write p_tx, repeated START, read into p_rx, STOP.
+ *
+ * @details Either part may be empty. The buffers must stay valid until the transfer completes.
+ */
+typedef struct
+{
+	uint8_t         address;                /**< 7 bit slave address. */
+	const uint8_t * p_tx;
+	uint8_t         tx_length;
+	uint8_t *       p_rx;
+	uint8_t         rx_length;
+} i2c_bus_xfer_t;
+
+/**@brief Transfer completion handler.
+ *
+ * @param[in]   error      0, or etError bits: ACK_ERROR if the slave did not acknowledge (for
+ *                         example an SHT2x still converting), TIME_OUT_ERROR if it stretched the
+ *                         clock for too long.
+ * @param[in]   p_context  Context passed to @ref i2c_bus_xfer.
+ */
+typedef void (*i2c_bus_handler_t)(uint8_t error, void * p_context);
+
+/**@brief Function for configuring the bus pins and the selected backend. */
+void i2c_bus_init(void);
+
+/**@brief Function for starting a transfer.
+ *
+ * @details With the bit-banged backend the transfer is done, and the handler called, before this
+ *          function returns. With the TWI backend the handler is called from the TWI interrupt.
+ *
+ * @return      NRF_SUCCESS, or NRF_ERROR_BUSY if a transfer is in progress.
+ */
+uint32_t i2c_bus_xfer(const i2c_bus_xfer_t * p_xfer, i2c_bus_handler_t handler, void * p_context);
+
+/**@brief Function for doing a transfer and waiting for it to complete.
+ *
+ * @warning With the TWI backend this sleeps until the TWI interrupt, so it must only be called from
+ *          thread mode (main), never from an interrupt or event handler.
+ *
+ * @return      Same as the error passed to @ref i2c_bus_handler_t, or TIME_OUT_ERROR if busy.
+ */
+uint8_t i2c_bus_xfer_sync(const i2c_bus_xfer_t * p_xfer);
+
+/**@brief Function for checking if a transfer is in progress. */
+bool i2c_bus_busy(void);
+
+#endif // I2C_BUS_H__
@@ -0,0 +1,77 @@
+#include "i2c_bus.h"
+
+#if I2C_BUS_BACKEND == I2C_BUS_BACKEND_BITBANG
+
+#include "nrf_error.h"
+
+#define I2C_BUS_STRETCH_POLL_US     1000    /**< Clock stretching poll period. */
+#define I2C_BUS_STRETCH_POLLS       1000    /**< Give up after about one second, like SHT2x_MeasureHM did. */
+
+/**@brief Releases SCL and waits while the slave holds it low (hold master measurements). */
+static uint8_t clock_stretch_wait(void)
+{
+	uint16_t i;
+
+	nrf_gpio_cfg_input(SCL_Pin, NRF_GPIO_PIN_NOPULL);
+	for (i = 0; i < I2C_BUS_STRETCH_POLLS; i++)
+	{
+		if (nrf_gpio_pin_read(SCL_Pin) == 1)
+		{
+			return 0;
+		}
+		DelayMicroSeconds(I2C_BUS_STRETCH_POLL_US);
+	}
+	return TIME_OUT_ERROR;
+}
+
+void i2c_bus_init(void)
+{
+	I2c_Init();
+}
+
+uint8_t i2c_bus_xfer_sync(const i2c_bus_xfer_t * p_xfer)
+{
+	uint8_t error = 0;
+	uint8_t i;
+
+	I2c_StartCondition();
+	if (p_xfer->tx_length > 0)
+	{
+		error |= I2c_WriteByte(p_xfer->address << 1);
+		for (i = 0; (i < p_xfer->tx_length) && !error; i++)
+		{
+			error |= I2c_WriteByte(p_xfer->p_tx[i]);
+		}
+		if (!error && (p_xfer->rx_length > 0))
+		{
+			I2c_StartCondition();
+		}
+	}
+	if (!error && (p_xfer->rx_length > 0))
+	{
+		error |= I2c_WriteByte((p_xfer->address << 1) | 1);
+		if (!error)
+		{
+			error |= clock_stretch_wait();
+		}
+		for (i = 0; (i < p_xfer->rx_length) && !error; i++)
+		{
+			p_xfer->p_rx[i] = I2c_ReadByte((i + 1 < p_xfer->rx_length) ? ACK : NO_ACK);
+		}
+	}
+	I2c_StopCondition();
+	return error;
+}
+
+uint32_t i2c_bus_xfer(const i2c_bus_xfer_t * p_xfer, i2c_bus_handler_t handler, void * p_context)
+{
+	handler(i2c_bus_xfer_sync(p_xfer), p_context);
+	return NRF_SUCCESS;
+}
+
+bool i2c_bus_busy(void)
+{
+	return false;
+}
+
+#endif // I2C_BUS_BACKEND == I2C_BUS_BACKEND_BITBANG
@@ -0,0 +1,195 @@
+#include "i2c_bus.h"
+
+#if I2C_BUS_BACKEND == I2C_BUS_BACKEND_TWI
+
+#include "nrf.h"
+#include "nrf51_bitfields.h"
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "power_profile.h"
+
+#define I2C_BUS_TWI                 NRF_TWI1
+#define I2C_BUS_TWI_IRQn            SPI1_TWI1_IRQn
+
+#if I2C_BUS_FREQUENCY == I2C_BUS_FREQ_400K
+#define I2C_BUS_TWI_FREQUENCY       TWI_FREQUENCY_FREQUENCY_K400
+#define I2C_BUS_BIT_NS              2500
+#else
+#define I2C_BUS_TWI_FREQUENCY       TWI_FREQUENCY_FREQUENCY_K100
+#define I2C_BUS_BIT_NS              10000
+#endif
+
+/**@brief Open drain pins with the input buffer connected, as the TWI peripheral requires. */
+#define I2C_BUS_PIN_CNF  ((GPIO_PIN_CNF_SENSE_Disabled << GPIO_PIN_CNF_SENSE_Pos) | \
+                          (GPIO_PIN_CNF_DRIVE_S0D1     << GPIO_PIN_CNF_DRIVE_Pos) | \
+                          (GPIO_PIN_CNF_PULL_Disabled  << GPIO_PIN_CNF_PULL_Pos)  | \
+                          (GPIO_PIN_CNF_INPUT_Connect  << GPIO_PIN_CNF_INPUT_Pos) | \
+                          (GPIO_PIN_CNF_DIR_Input      << GPIO_PIN_CNF_DIR_Pos))
+
+static struct
+{
+	volatile bool     busy;
+	i2c_bus_xfer_t    xfer;
+	i2c_bus_handler_t handler;
+	void *            p_context;
+	uint8_t           tx_index;
+	uint8_t           rx_index;
+	uint8_t           bytes;                /**< Bytes clocked so far, address bytes included. */
+	uint8_t           error;
+} m_twi;
+
+static volatile bool    m_sync_done;
+static volatile uint8_t m_sync_error;
+
+/**@brief Starts the read part. A STARTRX right after TXDSENT gives a repeated START. */
+static void rx_start(void)
+{
+	// Suspend after each byte so RXD can be read, and stop after the last one (it is then NACKed).
+	I2C_BUS_TWI->SHORTS      = (m_twi.xfer.rx_length == 1) ? TWI_SHORTS_BB_STOP_Msk : TWI_SHORTS_BB_SUSPEND_Msk;
+	I2C_BUS_TWI->TASKS_STARTRX = 1;
+	m_twi.bytes++;
+}
+
+static void xfer_done(void)
+{
+	i2c_bus_handler_t handler = m_twi.handler;
+
+	power_profile_i2c_add((uint32_t)m_twi.bytes * 9 * I2C_BUS_BIT_NS / 1000);
+	I2C_BUS_TWI->SHORTS = 0;
+	m_twi.busy          = false;
+	handler(m_twi.error, m_twi.p_context);
+}
+
+void SPI1_TWI1_IRQHandler(void)
+{
+	if (I2C_BUS_TWI->EVENTS_ERROR)
+	{
+		I2C_BUS_TWI->EVENTS_ERROR = 0;
+		m_twi.error |= ACK_ERROR;
+		I2C_BUS_TWI->ERRORSRC     = I2C_BUS_TWI->ERRORSRC;
+		I2C_BUS_TWI->SHORTS       = 0;
+		I2C_BUS_TWI->TASKS_STOP   = 1; // The TWI has to be stopped after an error, STOPPED follows
+	}
+	if (I2C_BUS_TWI->EVENTS_TXDSENT)
+	{
+		I2C_BUS_TWI->EVENTS_TXDSENT = 0;
+		m_twi.bytes++;
+		if (m_twi.error)
+		{
+			// STOP already requested
+		}
+		else if (m_twi.tx_index < m_twi.xfer.tx_length)
+		{
+			I2C_BUS_TWI->TXD = m_twi.xfer.p_tx[m_twi.tx_index++];
+		}
+		else if (m_twi.xfer.rx_length > 0)
+		{
+			rx_start();
+		}
+		else
+		{
+			I2C_BUS_TWI->TASKS_STOP = 1;
+		}
+	}
+	if (I2C_BUS_TWI->EVENTS_RXDREADY)
+	{
+		I2C_BUS_TWI->EVENTS_RXDREADY = 0;
+		m_twi.bytes++;
+		m_twi.xfer.p_rx[m_twi.rx_index++] = (uint8_t)I2C_BUS_TWI->RXD;
+		if (!m_twi.error && (m_twi.rx_index < m_twi.xfer.rx_length))
+		{
+			if (m_twi.rx_index + 1 == m_twi.xfer.rx_length)
+			{
+				I2C_BUS_TWI->SHORTS = TWI_SHORTS_BB_STOP_Msk;
+			}
+			I2C_BUS_TWI->TASKS_RESUME = 1;
+		}
+	}
+	if (I2C_BUS_TWI->EVENTS_STOPPED)
+	{
+		I2C_BUS_TWI->EVENTS_STOPPED = 0;
+		xfer_done();
+	}
+}
+
+void i2c_bus_init(void)
+{
+	NRF_GPIO->PIN_CNF[SCL_Pin] = I2C_BUS_PIN_CNF;
+	NRF_GPIO->PIN_CNF[SDA_Pin] = I2C_BUS_PIN_CNF;
+
+	I2C_BUS_TWI->PSELSCL   = SCL_Pin;
+	I2C_BUS_TWI->PSELSDA   = SDA_Pin;
+	I2C_BUS_TWI->FREQUENCY = I2C_BUS_TWI_FREQUENCY << TWI_FREQUENCY_FREQUENCY_Pos;
+	I2C_BUS_TWI->SHORTS    = 0;
+	I2C_BUS_TWI->INTENSET  = TWI_INTENSET_TXDSENT_Msk | TWI_INTENSET_RXDREADY_Msk |
+	                         TWI_INTENSET_ERROR_Msk | TWI_INTENSET_STOPPED_Msk;
+
+	sd_nvic_SetPriority(I2C_BUS_TWI_IRQn, NRF_APP_PRIORITY_LOW);
+	sd_nvic_ClearPendingIRQ(I2C_BUS_TWI_IRQn);
+	sd_nvic_EnableIRQ(I2C_BUS_TWI_IRQn);
+
+	I2C_BUS_TWI->ENABLE = TWI_ENABLE_ENABLE_Enabled << TWI_ENABLE_ENABLE_Pos;
+}
+
+uint32_t i2c_bus_xfer(const i2c_bus_xfer_t * p_xfer, i2c_bus_handler_t handler, void * p_context)
+{
+	if (m_twi.busy)
+	{
+		return NRF_ERROR_BUSY;
+	}
+	m_twi.busy      = true;
+	m_twi.xfer      = *p_xfer;
+	m_twi.handler   = handler;
+	m_twi.p_context = p_context;
+	m_twi.tx_index  = 0;
+	m_twi.rx_index  = 0;
+	m_twi.bytes     = 1;
+	m_twi.error     = 0;
+
+	I2C_BUS_TWI->ADDRESS         = p_xfer->address;
+	I2C_BUS_TWI->EVENTS_TXDSENT  = 0;
+	I2C_BUS_TWI->EVENTS_RXDREADY = 0;
+	I2C_BUS_TWI->EVENTS_ERROR    = 0;
+	I2C_BUS_TWI->EVENTS_STOPPED  = 0;
+	I2C_BUS_TWI->ERRORSRC        = I2C_BUS_TWI->ERRORSRC;
+
+	if (p_xfer->tx_length > 0)
+	{
+		I2C_BUS_TWI->SHORTS        = 0;
+		I2C_BUS_TWI->TXD           = p_xfer->p_tx[m_twi.tx_index++];
+		I2C_BUS_TWI->TASKS_STARTTX = 1;
+	}
+	else
+	{
+		m_twi.bytes = 0;
+		rx_start();
+	}
+	return NRF_SUCCESS;
+}
+
+static void sync_handler(uint8_t error, void * p_context)
+{
+	m_sync_error = error;
+	m_sync_done  = true;
+}
+
+uint8_t i2c_bus_xfer_sync(const i2c_bus_xfer_t * p_xfer)
+{
+	m_sync_done = false;
+	if (i2c_bus_xfer(p_xfer, sync_handler, NULL) != NRF_SUCCESS)
+	{
+		return TIME_OUT_ERROR;
+	}
+	while (!m_sync_done)
+	{
+		(void)sd_app_evt_wait();
+	}
+	return m_sync_error;
+}
+
+bool i2c_bus_busy(void)
+{
+	return m_twi.busy;
+}
+
+#endif // I2C_BUS_BACKEND == I2C_BUS_BACKEND_TWI
@@ -0,0 +1,66 @@
+#include <string.h>
+#include "log_slot.h"
+
+/**@brief Running aggregate of one value. */
+typedef struct
+{
+	int32_t  sum;                           /**< Readings times their weight. */
+	int16_t  min;
+	int16_t  max;
+} channel_t;
+
+static channel_t m_temperature;
+static channel_t m_humidity;
+static uint32_t  m_weight;                  /**< Sum of the weights, in seconds. */
+static uint16_t  m_readings;
+
+static void channel_add(channel_t * p_channel, int16_t value, uint16_t weight)
+{
+	if ((m_readings == 0) || (value < p_channel->min))
+	{
+		p_channel->min = value;
+	}
+	if ((m_readings == 0) || (value > p_channel->max))
+	{
+		p_channel->max = value;
+	}
+	p_channel->sum += (int32_t)value * weight;
+}
+
+/**@brief Mean, rounded half away from zero. It lies between min and max, rounding included. */
+static void channel_close(const channel_t * p_channel, log_slot_value_t * p_value)
+{
+	int32_t half = (int32_t)(m_weight / 2);
+
+	p_value->mean = (int16_t)((p_channel->sum >= 0) ? (p_channel->sum + half) / (int32_t)m_weight
+	                                                : -((-p_channel->sum + half) / (int32_t)m_weight));
+	p_value->min  = p_channel->min;
+	p_value->max  = p_channel->max;
+}
+
+void log_slot_add(int16_t temperature, int16_t humidity, uint16_t seconds)
+{
+	// The weights of a slot add up to its log period, at most 65535 s: the sums stay within
+	// int32_t (32767 * 65535 < 2^31).
+	uint16_t weight = (seconds > 0) ? seconds : 1;
+
+	channel_add(&m_temperature, temperature, weight);
+	channel_add(&m_humidity, humidity, weight);
+	m_weight += weight;
+	m_readings++;
+}
+
+void log_slot_close(log_slot_t * p_slot)
+{
+	memset(p_slot, 0, sizeof(*p_slot));
+	if (m_readings > 0)
+	{
+		channel_close(&m_temperature, &p_slot->temperature);
+		channel_close(&m_humidity, &p_slot->humidity);
+		p_slot->readings = m_readings;
+	}
+	memset(&m_temperature, 0, sizeof(m_temperature));
+	memset(&m_humidity, 0, sizeof(m_humidity));
+	m_weight   = 0;
+	m_readings = 0;
+}
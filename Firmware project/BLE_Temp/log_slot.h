@@ -0,0 +1,46 @@
+#ifndef LOG_SLOT_H__
+#define LOG_SLOT_H__
+
+#include <stdint.h>
+
+/**@brief Aggregation of the readings between two log entries.
+ *
+ * @details Every reading is added as it is taken; the log entry gets the mean of the slot and its
+ *          lowest and highest readings instead of the last reading alone, so a spike between two
+ *          entries still shows in the history. The measurement interval changes with the readings,
+ *          so the mean is weighted by the time each reading stands for: the seconds since the
+ *          reading before it.
+ */
+
+/**@brief One value over a slot, in the units of the readings. */
+typedef struct
+{
+	int16_t mean;
+	int16_t min;
+	int16_t max;
+} log_slot_value_t;
+
+/**@brief A closed slot. */
+typedef struct
+{
+	log_slot_value_t temperature;           /**< 0.01 C */
+	log_slot_value_t humidity;              /**< 0.01 %RH */
+	uint16_t         readings;
+} log_slot_t;
+
+/**@brief Function for adding a reading to the slot.
+ *
+ * @param[in]   temperature   0.01 C
+ * @param[in]   humidity      0.01 %RH
+ * @param[in]   seconds       Seconds since the reading before, 0 for the first one after reset.
+ */
+void log_slot_add(int16_t temperature, int16_t humidity, uint16_t seconds);
+
+/**@brief Function for closing the slot, after adding the reading that is due in the logs. The
+ *        next reading starts a new slot.
+ *
+ * @param[out]  p_slot        The slot. No readings leave it at zero.
+ */
+void log_slot_close(log_slot_t * p_slot);
+
+#endif // LOG_SLOT_H__
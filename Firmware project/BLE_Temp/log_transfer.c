@@ -0,0 +1,288 @@
+#include <string.h>
+#include "log_transfer.h"
+#include "compressed_log.h"
+#include "nrf_error.h"
+#include "app_timer.h"
+#include "ble_srv_common.h"
+#include "power_profile.h"
+
+static ble_os_t *                 mp_service;
+static log_transfer_evt_handler_t m_evt_handler;
+static app_timer_id_t             m_start_timer;
+static uint32_t                   m_prescaler;
+static bool                       m_busy;               /**< Last state reported to the application. */
+static uint16_t                   m_conn_handle = BLE_CONN_HANDLE_INVALID;
+static bool                       m_active;
+static bool                       m_done_pending;       /**< All data queued, the DONE notification is not. */
+static uint8_t                    m_status;
+static uint16_t                   m_first_seq;
+static uint16_t                   m_next_seq;           /**< Block being sent. */
+static uint8_t                    m_offset;             /**< Bytes of it already sent. */
+static uint16_t                   m_blocks_sent;
+
+/**@brief Reports a state change to the application. */
+static void busy_set(bool busy)
+{
+	log_transfer_evt_t evt;
+
+	if (busy == m_busy)
+	{
+		return;
+	}
+	m_busy = busy;
+	if (m_evt_handler != NULL)
+	{
+		evt.evt_type = busy ? LOG_TRANSFER_EVT_BUSY : LOG_TRANSFER_EVT_IDLE;
+		m_evt_handler(&evt);
+	}
+}
+
+/**@brief The client subscribed to log data but did not ask for anything. */
+static void start_timeout_handler(void * p_context)
+{
+	if (!m_active)
+	{
+		busy_set(false);
+	}
+}
+
+/**@brief Gets a block by sequence number, NULL if it is not (or no longer) in the log. */
+static const compressed_log_block_t * block_by_seq(uint16_t seq)
+{
+	const compressed_log_block_t * p_oldest = compressed_log_block_get(0);
+
+	return (p_oldest != NULL) ? compressed_log_block_get((uint16_t)(seq - p_oldest->seq)) : NULL;
+}
+
+/**@brief Copies the next bytes of the stream, across block boundaries, without moving on.
+ *
+ * @return      Bytes in the chunk, 0 at the end of the log.
+ */
+static uint8_t chunk_fill(uint8_t * p_chunk, uint16_t * p_seq, uint8_t * p_offset)
+{
+	uint8_t len = 0;
+
+	while (len < LOG_TRANSFER_CHUNK_SIZE)
+	{
+		const compressed_log_block_t * p_block = block_by_seq(*p_seq);
+		uint8_t                        n       = COMPRESSED_LOG_BLOCK_SIZE - *p_offset;
+
+		if (p_block == NULL)
+		{
+			break;
+		}
+		if (n > LOG_TRANSFER_CHUNK_SIZE - len)
+		{
+			n = LOG_TRANSFER_CHUNK_SIZE - len;
+		}
+		memcpy(&p_chunk[len], (const uint8_t *)p_block + *p_offset, n);
+		len       += n;
+		*p_offset += n;
+		if (*p_offset == COMPRESSED_LOG_BLOCK_SIZE)
+		{
+			*p_offset = 0;
+			(*p_seq)++;
+		}
+	}
+	return len;
+}
+
+static uint32_t notify(ble_gatts_char_handles_t * p_handle, const uint8_t * p_data, uint16_t len)
+{
+	ble_gatts_hvx_params_t hvx_params;
+	uint16_t               hvx_len = len;
+	uint32_t               err_code;
+
+	memset(&hvx_params, 0, sizeof(hvx_params));
+	hvx_params.handle = p_handle->value_handle;
+	hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+	hvx_params.p_len  = &hvx_len;
+	hvx_params.p_data = (uint8_t *)p_data;
+
+	err_code = sd_ble_gatts_hvx(m_conn_handle, &hvx_params);
+	if (err_code == NRF_SUCCESS)
+	{
+		power_profile_notification(hvx_len);
+	}
+	return err_code;
+}
+
+/**@brief Queues notifications until the SoftDevice runs out of buffers; TX_COMPLETE continues. */
+static void transfer_pump(void)
+{
+	uint8_t  chunk[LOG_TRANSFER_CHUNK_SIZE];
+	uint32_t err_code;
+
+	while (m_active && !m_done_pending)
+	{
+		uint16_t seq    = m_next_seq;
+		uint8_t  offset = m_offset;
+		uint8_t  len    = chunk_fill(chunk, &seq, &offset);
+
+		if (len == 0)
+		{
+			m_done_pending = true;
+			break;
+		}
+		err_code = notify(&mp_service->log_data_characteristic_handle, chunk, len);
+		if (err_code == BLE_ERROR_NO_TX_BUFFERS)
+		{
+			return;
+		}
+		if (err_code != NRF_SUCCESS)
+		{
+			// Notifications disabled, or the link is going down
+			m_status       = LOG_TRANSFER_STATUS_ABORTED;
+			m_done_pending = true;
+			break;
+		}
+		m_blocks_sent += (uint16_t)(seq - m_next_seq);
+		m_next_seq     = seq;
+		m_offset       = offset;
+	}
+
+	if (m_done_pending)
+	{
+		uint8_t done[LOG_TRANSFER_CONTROL_LEN];
+
+		done[0] = LOG_TRANSFER_OP_DONE;
+		done[1] = m_status;
+		done[2] = (uint8_t)m_first_seq;
+		done[3] = (uint8_t)(m_first_seq >> 8);
+		done[4] = (uint8_t)m_blocks_sent;
+		done[5] = (uint8_t)(m_blocks_sent >> 8);
+		err_code = notify(&mp_service->log_control_characteristic_handle, done, sizeof(done));
+		if (err_code == BLE_ERROR_NO_TX_BUFFERS)
+		{
+			return;
+		}
+		// Delivered, or the client does not listen on the control point: either way it is over.
+		m_active       = false;
+		m_done_pending = false;
+		busy_set(false);
+	}
+}
+
+static void transfer_start(uint16_t seq)
+{
+	const compressed_log_block_t * p_oldest = compressed_log_block_get(0);
+
+	if ((block_by_seq(seq) == NULL) && (p_oldest != NULL))
+	{
+		seq = p_oldest->seq;
+	}
+	(void)app_timer_stop(m_start_timer);
+	busy_set(true);
+	m_active       = true;
+	m_done_pending = false;
+	m_status       = LOG_TRANSFER_STATUS_SUCCESS;
+	m_first_seq    = seq;
+	m_next_seq     = seq;
+	m_offset       = 0;
+	m_blocks_sent  = 0;
+	transfer_pump();
+}
+
+/**@brief Ends the transfer with a status, as soon as the DONE notification can be queued. */
+static void transfer_end(uint8_t status)
+{
+	m_active       = true;
+	m_done_pending = true;
+	m_status       = status;
+	transfer_pump();
+}
+
+static void on_log_data_cccd_write(const ble_gatts_evt_write_t * p_write)
+{
+	if (p_write->len != 2)
+	{
+		return;
+	}
+	if (ble_srv_is_notification_enabled(p_write->data))
+	{
+		if (!m_active && (app_timer_start(m_start_timer, APP_TIMER_TICKS(LOG_TRANSFER_START_TIMEOUT_MS, m_prescaler), NULL) == NRF_SUCCESS))
+		{
+			busy_set(true);
+		}
+	}
+	else if (!m_active)
+	{
+		// A running transfer notices on its next notification and ends with DONE.
+		(void)app_timer_stop(m_start_timer);
+		busy_set(false);
+	}
+}
+
+static void on_control_point_write(const ble_gatts_evt_write_t * p_write)
+{
+	if ((p_write->len == 3) && (p_write->data[0] == LOG_TRANSFER_OP_START))
+	{
+		transfer_start((uint16_t)(p_write->data[1] | (p_write->data[2] << 8)));
+	}
+	else if ((p_write->len == 1) && (p_write->data[0] == LOG_TRANSFER_OP_ABORT))
+	{
+		transfer_end(LOG_TRANSFER_STATUS_ABORTED);
+	}
+	else
+	{
+		if (!m_active)
+		{
+			m_first_seq   = 0;
+			m_blocks_sent = 0;
+		}
+		transfer_end(LOG_TRANSFER_STATUS_INVALID);
+	}
+}
+
+uint32_t log_transfer_init(ble_os_t * p_our_service, uint32_t app_timer_prescaler, log_transfer_evt_handler_t evt_handler)
+{
+	mp_service     = p_our_service;
+	m_evt_handler  = evt_handler;
+	m_prescaler    = app_timer_prescaler;
+	m_busy         = false;
+	m_conn_handle  = BLE_CONN_HANDLE_INVALID;
+	m_active       = false;
+	m_done_pending = false;
+	return app_timer_create(&m_start_timer, APP_TIMER_MODE_SINGLE_SHOT, start_timeout_handler);
+}
+
+void log_transfer_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+	switch (p_ble_evt->header.evt_id)
+	{
+		case BLE_GAP_EVT_CONNECTED:
+			m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+			break;
+
+		case BLE_GAP_EVT_DISCONNECTED:
+			m_conn_handle  = BLE_CONN_HANDLE_INVALID;
+			m_active       = false;
+			m_done_pending = false;
+			(void)app_timer_stop(m_start_timer);
+			busy_set(false);
+			break;
+
+		case BLE_GATTS_EVT_WRITE:
+			if (p_ble_evt->evt.gatts_evt.params.write.handle == mp_service->log_control_characteristic_handle.value_handle)
+			{
+				on_control_point_write(&p_ble_evt->evt.gatts_evt.params.write);
+			}
+			else if (p_ble_evt->evt.gatts_evt.params.write.handle == mp_service->log_data_characteristic_handle.cccd_handle)
+			{
+				on_log_data_cccd_write(&p_ble_evt->evt.gatts_evt.params.write);
+			}
+			break;
+
+		case BLE_EVT_TX_COMPLETE:
+			transfer_pump();
+			break;
+
+		default:
+			break;
+	}
+}
+
+bool log_transfer_active(void)
+{
+	return m_active;
+}
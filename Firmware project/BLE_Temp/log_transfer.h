@@ -0,0 +1,75 @@
+#ifndef LOG_TRANSFER_H__
+#define LOG_TRANSFER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "our_service.h"
+
+/**@brief Bulk transfer of the compressed log.
+ *
+ * @details The client enables notifications on the log control point and the log data
+ *          characteristics, then writes LOG_TRANSFER_OP_START with the sequence number of the first
+ *          block it wants. The blocks from there to the newest one (which is usually still filling,
+ *          so the client asks for it again next time) are sent back to back on log data, packed into
+ *          full 20 byte notifications; only the last one can be shorter. LOG_TRANSFER_OP_DONE on the
+ *          control point ends the stream.
+ *
+ *          A sequence number outside the log (older than the oldest block, or from before a reset,
+ *          when the numbering restarted) starts with the oldest block.
+ *
+ *          The module tells the application when the link is about to carry a transfer, so it can
+ *          ask for a short connection interval for it: from the moment the client enables log data
+ *          notifications (the update takes a few connection events, it is in place by the time
+ *          the client writes the control point) until LOG_TRANSFER_OP_DONE is sent. A client that
+ *          subscribes but does not start a transfer within LOG_TRANSFER_START_TIMEOUT_MS gives the
+ *          link back.
+ */
+#define LOG_TRANSFER_OP_START         0x01  /**< Client: opcode, first block sequence number (uint16). */
+#define LOG_TRANSFER_OP_ABORT         0x02  /**< Client: opcode. */
+#define LOG_TRANSFER_OP_DONE          0x81  /**< Server: opcode, status, first block sequence number (uint16), blocks sent (uint16). */
+
+#define LOG_TRANSFER_STATUS_SUCCESS   0x00
+#define LOG_TRANSFER_STATUS_ABORTED   0x01  /**< LOG_TRANSFER_OP_ABORT, or log data notifications were disabled. */
+#define LOG_TRANSFER_STATUS_INVALID   0x02  /**< Unknown opcode or wrong length. */
+
+#define LOG_TRANSFER_CONTROL_LEN      6     /**< Longest control point value. */
+#define LOG_TRANSFER_CHUNK_SIZE       (GATT_MTU_SIZE_DEFAULT - 3)
+
+#define LOG_TRANSFER_START_TIMEOUT_MS 1000  /**< Time from enabling log data notifications to LOG_TRANSFER_OP_START. A later start still asks for the short interval, only later. */
+
+/**@brief Transfer state changes. */
+typedef enum
+{
+	LOG_TRANSFER_EVT_BUSY,                  /**< A transfer is expected or running: a short connection interval pays off. */
+	LOG_TRANSFER_EVT_IDLE                   /**< The transfer is over (or never came, or the link is gone). */
+} log_transfer_evt_type_t;
+
+typedef struct
+{
+	log_transfer_evt_type_t evt_type;
+} log_transfer_evt_t;
+
+/**@brief Transfer event handler. Called from the BLE or the app_timer interrupt context. */
+typedef void (*log_transfer_evt_handler_t)(log_transfer_evt_t * p_evt);
+
+/**@brief Function for initializing the transfer.
+ *
+ * @details Creates the single-shot app_timer that waits for the client to start a transfer.
+ *
+ * @param[in]   p_our_service        Our Service, with the log control point and log data characteristics.
+ * @param[in]   app_timer_prescaler  Value the app_timer module was initialized with.
+ * @param[in]   evt_handler          Handler for the state changes, or NULL.
+ *
+ * @return      NRF_SUCCESS, or an error from app_timer_create().
+ */
+uint32_t log_transfer_init(ble_os_t * p_our_service, uint32_t app_timer_prescaler, log_transfer_evt_handler_t evt_handler);
+
+/**@brief Function for handling the BLE events: control point and log data CCCD writes, TX_COMPLETE
+ *        (more room for notifications) and disconnection. */
+void log_transfer_on_ble_evt(ble_evt_t * p_ble_evt);
+
+/**@brief Function for checking if a transfer is in progress. */
+bool log_transfer_active(void);
+
+#endif // LOG_TRANSFER_H__
@@ -25,6 +25,7 @@
  */
 
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include "nordic_common.h"
 #include "nrf.h"
@@ -40,13 +41,29 @@
 #include "boards.h"
 #include "softdevice_handler.h"
 #include "app_timer.h"
+#include "app_scheduler.h"
+#include "app_util_platform.h"
 #include "device_manager.h"
 #include "pstorage.h"
 #include "app_trace.h"
 #include "our_service.h"
 #include "SHT2x.h"
+#include "i2c_bus.h"
+#include "sht2x_async.h"
 #include "ble_bas.h"
 #include "nrf_delay.h"
+#include "power_profile.h"
+#include "flash_log.h"
+#include "compressed_log.h"
+#include "log_transfer.h"
+#include "broadcast.h"
+#include "adv_scheduler.h"
+#include "device_time.h"
+#include "current_time.h"
+#include "battery.h"
+#include "measurement_scheduler.h"
+#include "device_config.h"
+#include "log_slot.h"
 
 #define LED_Pin 2
 
@@ -56,17 +73,22 @@
 #define FW_REV "1.0"
 #define MODEL_NUMBER "RTemp 1.0"
 #define DEVICE_NAME                      "RTemp"                               	/**< Name of device. Will be included in the advertising data. */
-#define APP_ADV_INTERVAL                 1636                                        /**< The advertising interval (in units of 0.625 ms. This value corresponds to 25 ms). */
-#define APP_ADV_TIMEOUT_IN_SECONDS       0                                        /**< The advertising timeout in units of seconds. */
 
-#define APP_TIMER_PRESCALER              327                                       //Corresponds to about 100ms /**< Value of the RTC1 PRESCALER register. */
+#define APP_TIMER_PRESCALER              31                                        /**< Value of the RTC1 PRESCALER register. 1024 Hz ticks, short enough to time sensor conversions. */
 #define APP_TIMER_MAX_TIMERS             (6)                  /**< Maximum number of simultaneously created timers. */
 #define APP_TIMER_OP_QUEUE_SIZE          4                                          /**< Size of timer operation queues. */
 
-#define MIN_CONN_INTERVAL                MSEC_TO_UNITS(500, UNIT_1_25_MS)           /**< Minimum acceptable connection interval (0.1 seconds). */
-#define MAX_CONN_INTERVAL                MSEC_TO_UNITS(800, UNIT_1_25_MS)           /**< Maximum acceptable connection interval (0.2 second). */
-#define SLAVE_LATENCY                    1                                          /**< Slave latency. */
-#define CONN_SUP_TIMEOUT                 MSEC_TO_UNITS(5000, UNIT_10_MS)            /**< Connection supervisory timeout (5.9 seconds). */
+#define SCHED_MAX_EVENT_DATA_SIZE        MAX(sizeof(sht2x_async_result_t), sizeof(battery_status_t)) /**< Largest event data passed to the main loop. */
+#define SCHED_QUEUE_SIZE                 8                                          /**< Events waiting for the main loop: one of each source, with room to spare. */
+
+#define MIN_CONN_INTERVAL                MSEC_TO_UNITS(500, UNIT_1_25_MS)           /**< Minimum acceptable connection interval when idle (0.5 seconds). The idle parameters and TX_POWER are defaults, see device_config.h. */
+#define MAX_CONN_INTERVAL                MSEC_TO_UNITS(650, UNIT_1_25_MS)           /**< Maximum acceptable connection interval when idle (0.65 seconds). iOS wants MAX_CONN_INTERVAL * (SLAVE_LATENCY + 1) <= 2 s. */
+#define SLAVE_LATENCY                    2                                          /**< Slave latency when idle. */
+#define CONN_SUP_TIMEOUT                 MSEC_TO_UNITS(6000, UNIT_10_MS)            /**< Connection supervisory timeout (6 seconds), more than 3 * MAX_CONN_INTERVAL * (SLAVE_LATENCY + 1). */
+
+#define FAST_MIN_CONN_INTERVAL           MSEC_TO_UNITS(7.5, UNIT_1_25_MS)           /**< Minimum acceptable connection interval during a log transfer (7.5 ms). */
+#define FAST_MAX_CONN_INTERVAL           MSEC_TO_UNITS(15, UNIT_1_25_MS)            /**< Maximum acceptable connection interval during a log transfer (15 ms, the shortest iOS grants). */
+#define FAST_SLAVE_LATENCY               0                                          /**< Slave latency during a log transfer. */
 
 #define FIRST_CONN_PARAMS_UPDATE_DELAY   APP_TIMER_TICKS(5000, APP_TIMER_PRESCALER) /**< Time from initiating event (connect or start of notification) to first time sd_ble_gap_conn_param_update is called (5 seconds). */
 #define NEXT_CONN_PARAMS_UPDATE_DELAY    APP_TIMER_TICKS(30000, APP_TIMER_PRESCALER)/**< Time between each call to sd_ble_gap_conn_param_update after the first call (30 seconds). */
@@ -79,25 +101,34 @@
 #define SEC_PARAM_MIN_KEY_SIZE           7                                          /**< Minimum encryption key size. */
 #define SEC_PARAM_MAX_KEY_SIZE           16                                         /**< Maximum encryption key size. */
 
+#define LOG_PERIOD_S                     ((LOGGING_INTERVAL + 1) * MEASUREMENT_INTERVAL / 1000) /**< Seconds between two log entries, the time step of the compressed log. */
+
 #define TX_POWER (-4) // accepted values are -40, -30, -20, -16, -12, -8, -4, 0, and 4 dBm
 
 #define DEAD_BEEF                        0xDEADBEEF                                 /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 static dm_application_instance_t         m_app_handle;                               /**< Application identifier allocated by device manager */
 
 static uint16_t                          m_conn_handle = BLE_CONN_HANDLE_INVALID;   /**< Handle of the current connection. */
+static bool                              m_conn_params_fast;                        /**< The fast connection parameters are the preferred ones. */
+static bool                              m_conn_params_retry;                       /**< The last change found an update in progress, ask again when it is done. */
 
 static app_timer_id_t                   measurement_timer;
+static uint32_t                         m_measurement_start;                       /**< RTC1 counter when the measurement in progress started. */
+static uint16_t                         m_measurement_interval;                    /**< s from the last measurement to the next one, 0 before the first. */
+static bool                             m_measurement_running;                     /**< From the start of a measurement until its result is processed. */
+static int8_t                           m_tx_power_level;                          /**< Advertised, kept by reference in the advertising data. */
 
 static ble_bas_t                       m_bas;                                      /**< Structure used to identify the battery service. */
-uint32_t battery_value_raw = 254;
+static uint8_t                         m_battery_level = 100;                      /**< Last level given to the Battery Service. */
 
 uint8_t temp_log[LOG_SIZE];
 uint8_t humidity_log[LOG_SIZE];
-uint8_t log_counter = LOGGING_INTERVAL; // We want a log entry in the beginning
 
 ble_os_t m_our_service;
 temperature_struct temp_storage_struct;
 
+static void measurement_reschedule(void);
+
 // OUR_JOB: For advertising, declare a ble_uuid_t variable holding our service UUID 
                                    
 /**@brief Callback function for asserts in the SoftDevice.
@@ -127,10 +158,24 @@ static void timers_init(void)
 }
 
 
+/**@brief Function for the Event Scheduler initialization.
+ *
+ * @details BLE and SoC events, timer timeouts and the peripheral interrupts run at interrupt
+ *          level. Sensor transfers and the processing of measurements are passed to the main loop
+ *          instead, so a radio event never waits behind them; where that work touches state the
+ *          BLE event handlers also use, it does so in short critical regions.
+ */
+static void scheduler_init(void)
+{
+    APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
+}
+
+
 /**@brief Function for the GAP initialization.
  *
  * @details This function sets up all the necessary GAP (Generic Access Profile) parameters of the
  *          device including the device name, appearance, and the preferred connection parameters.
+ *          The connection parameters and the TX power come from the configuration.
  */
 static void gap_params_init(void)
 {
@@ -146,28 +191,145 @@ static void gap_params_init(void)
     err_code = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)name, strlen(name));
     APP_ERROR_CHECK(err_code);
 
-    memset(&gap_conn_params, 0, sizeof(gap_conn_params));
-
-    gap_conn_params.min_conn_interval = MIN_CONN_INTERVAL;
-    gap_conn_params.max_conn_interval = MAX_CONN_INTERVAL;
-    gap_conn_params.slave_latency     = SLAVE_LATENCY;
-    gap_conn_params.conn_sup_timeout  = CONN_SUP_TIMEOUT;
+    gap_conn_params = device_config_get()->connection;
 
     err_code = sd_ble_gap_ppcp_set(&gap_conn_params);
     APP_ERROR_CHECK(err_code);
 																					
-		err_code = sd_ble_gap_tx_power_set(TX_POWER);
+		m_tx_power_level = device_config_get()->tx_power;
+		err_code = sd_ble_gap_tx_power_set(m_tx_power_level);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for switching between the idle and the log transfer connection parameters.
+ *
+ * @details Only the preferred parameters change when not connected; the next connection starts
+ *          the negotiation with them.
+ */
+static void conn_params_select(bool fast)
+{
+    uint32_t              err_code;
+    ble_gap_conn_params_t conn_params = device_config_get()->connection;
+
+    if (fast)
+    {
+        conn_params.min_conn_interval = FAST_MIN_CONN_INTERVAL;
+        conn_params.max_conn_interval = FAST_MAX_CONN_INTERVAL;
+        conn_params.slave_latency     = FAST_SLAVE_LATENCY;
+    }
+
+    m_conn_params_fast  = fast;
+    m_conn_params_retry = false;
+    err_code = ble_conn_params_change_conn_params(&conn_params);
+    if (err_code == NRF_ERROR_BUSY)
+    {
+        // A short transfer can be over before the update for it takes effect.
+        m_conn_params_retry = true;
+    }
+    else if (err_code != BLE_ERROR_INVALID_CONN_HANDLE)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for handling the log transfer state changes.
+ */
+static void on_log_transfer_evt(log_transfer_evt_t * p_evt)
+{
+    conn_params_select(p_evt->evt_type == LOG_TRANSFER_EVT_BUSY);
+}
+
+
+/**@brief Function for handling a client setting the time.
+ *
+ * @details Until the first time the clock counts from reset, and so do the log times taken so far.
+ *          Moving them by the same step makes them absolute. Later steps are drift corrections,
+ *          the log blocks already stamped are left alone.
+ */
+static void on_current_time_evt(current_time_evt_t * p_evt)
+{
+    if (!p_evt->was_set)
+    {
+        compressed_log_time_shift(p_evt->step);
+    }
+}
+
+
+/**@brief Function for getting the compile time configuration, used until a client writes another.
+ */
+static void config_default_get(device_config_t * p_config)
+{
+    memset(p_config, 0, sizeof(*p_config));
+
+    p_config->tx_power                     = TX_POWER;
+    measurement_scheduler_config_default(&p_config->measurement, LOG_PERIOD_S);
+    adv_scheduler_config_default(&p_config->advertising);
+    sht2x_async_config_default(&p_config->sensor);
+    p_config->connection.min_conn_interval = MIN_CONN_INTERVAL;
+    p_config->connection.max_conn_interval = MAX_CONN_INTERVAL;
+    p_config->connection.slave_latency     = SLAVE_LATENCY;
+    p_config->connection.conn_sup_timeout  = CONN_SUP_TIMEOUT;
+}
+
+
+/**@brief Function for applying the measurement and sensor settings of the configuration, in the
+ *        main loop where measurements run.
+ */
+static void measurement_config_apply(void * p_event_data, uint16_t event_size)
+{
+    const device_config_t * p_config = device_config_get();
+    uint32_t err_code;
+
+    CRITICAL_REGION_ENTER();
+    err_code = measurement_scheduler_config_set(&p_config->measurement);
+    if (err_code == NRF_SUCCESS)
+    {
+        measurement_reschedule();
+        err_code = sht2x_async_config_set(&p_config->sensor);
+    }
+    CRITICAL_REGION_EXIT();
     APP_ERROR_CHECK(err_code);
 }
 
+
+/**@brief Function for applying a configuration a client wrote.
+ *
+ * @details The next measurement is brought forward if it is now too far away and takes the new
+ *          sensor resolution, advertising restarts with the new intervals and TX power (the
+ *          advertising data carries the TX power level), and a connection in progress is asked to
+ *          move to the new parameters unless a log transfer is running.
+ */
+static void on_device_config_evt(const device_config_t * p_config)
+{
+    uint32_t err_code;
+
+    err_code = app_sched_event_put(NULL, 0, measurement_config_apply);
+    APP_ERROR_CHECK(err_code);
+
+    m_tx_power_level = p_config->tx_power;
+    err_code = sd_ble_gap_tx_power_set(m_tx_power_level);
+    APP_ERROR_CHECK(err_code);
+    err_code = adv_scheduler_config_set(&p_config->advertising);
+    APP_ERROR_CHECK(err_code);
+
+    conn_params_select(m_conn_params_fast);
+}
+
+
 /**@brief Function for initializing services that will be used by the application.
  */
 static void services_init(void)
 {
 		uint32_t       err_code;
+		device_config_t config_default;
 	
     // OUR_JOB: Add code to initialize the services used by the application.
-		our_service_init(&m_our_service);
+		our_service_init(&m_our_service, temp_log, humidity_log);
+		err_code = log_transfer_init(&m_our_service, APP_TIMER_PRESCALER, on_log_transfer_evt);
+		APP_ERROR_CHECK(err_code);
+		err_code = current_time_init(on_current_time_evt);
+		APP_ERROR_CHECK(err_code);
 	
 	// Initialize Battery Service.
 	ble_bas_init_t bas_init;
@@ -202,6 +364,11 @@ static void services_init(void)
 
     err_code = ble_dis_init(&dis_init);
     APP_ERROR_CHECK(err_code);
+		
+		// Runtime configuration, last so that the handles of the services above stay where they were
+		config_default_get(&config_default);
+		err_code = device_config_init(&config_default, on_device_config_evt);
+		APP_ERROR_CHECK(err_code);
 }
 
 
@@ -219,11 +386,19 @@ static void on_conn_params_evt(ble_conn_params_evt_t * p_evt)
 {
     uint32_t err_code;
 
-    if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED)
+    // The central may refuse the fast parameters, and a change while an update is in progress is
+    // asked for again when it completes; neither is a reason to drop the link.
+    if ((p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED) && !m_conn_params_fast && !m_conn_params_retry)
     {
         err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
         APP_ERROR_CHECK(err_code);
     }
+    else if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_SUCCEEDED)
+    {
+        // The retry timer from the connection could still ask again for what is already in place.
+        err_code = ble_conn_params_stop();
+        APP_ERROR_CHECK(err_code);
+    }
 }
 
 
@@ -233,6 +408,12 @@ static void on_conn_params_evt(ble_conn_params_evt_t * p_evt)
  */
 static void conn_params_error_handler(uint32_t nrf_error)
 {
+    if (nrf_error == NRF_ERROR_BUSY)
+    {
+        // The module's retry timer fired during an update asked for by conn_params_select(); the
+        // module takes over again once that update completes.
+        return;
+    }
     APP_ERROR_HANDLER(nrf_error);
 }
 
@@ -259,32 +440,27 @@ static void conn_params_init(void)
     APP_ERROR_CHECK(err_code);
 }
 
-/**@brief Function for performing battery measurement and updating the Battery Level characteristic
- *        in Battery Service.
+/**@brief Function for publishing a battery measurement: updates the Battery Level characteristic in
+ *        Battery Service when the level changed, and the battery characteristic of Our Service.
  */
-static void battery_level_update(void)
+static void battery_publish(void * p_event_data, uint16_t event_size)
 {
-    uint32_t err_code;
-    uint8_t  battery_level;
-
-		double voltage = 0.01411764706 * battery_value_raw; // (3.6V / 255) * measured_voltage
-		if (voltage >= 2.9)
-			battery_level = 100;
-		else if (voltage >= 2.8)
-			battery_level = 90;
-		else if (voltage >= 2.6)
-			battery_level = 70;
-		else if (voltage >= 2.4)
-			battery_level = 50;
-		else if (voltage >= 2.35)
-			battery_level = 15;
-		else
+    const battery_status_t * p_status = (const battery_status_t *)p_event_data;
+    uint32_t err_code = NRF_SUCCESS;
+
+		if (p_status->level == 0)
 		{
-			battery_level = 0;
 			nrf_gpio_pin_set(LED_Pin);
 		}
+		CRITICAL_REGION_ENTER();
+		set_battery(&m_our_service, p_status, &m_conn_handle);
+		if (p_status->level != m_battery_level)
+		{
+			m_battery_level = p_status->level; // Broadcast with the next reading
+			err_code = ble_bas_battery_level_update(&m_bas, m_battery_level);
+		}
+		CRITICAL_REGION_EXIT();
 
-    err_code = ble_bas_battery_level_update(&m_bas, battery_level);
     if ((err_code != NRF_SUCCESS) &&
         (err_code != NRF_ERROR_INVALID_STATE) &&
         (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
@@ -295,86 +471,250 @@ static void battery_level_update(void)
     }
 }
 
-void measure_temperature_and_humidity()
+/**@brief Function for handling a battery measurement, in the ADC interrupt: it is published from
+ *        the main loop.
+ */
+static void on_battery_evt(const battery_status_t * p_status)
+{
+    uint32_t err_code = app_sched_event_put((void *)p_status, sizeof(*p_status), battery_publish);
+    APP_ERROR_CHECK(err_code);
+}
+
+void store_temperature_and_humidity(const sht2x_async_result_t * p_result)
 {
-		u8t  error = 0;
-		nt16 temperature, humidity;
-	
-		error |= SHT2x_MeasurePoll(TEMP, &temperature);
-		if (!error)
+		if (!p_result->temperature_error)
 		{
-			temp_storage_struct.temperature = SHT2x_CalcTemperatureC(temperature.u16);
+			temp_storage_struct.temperature = SHT2x_CalcTemperatureCentiC(p_result->temperature.u16);
 		}
 		else
 		{
 			nrf_gpio_pin_set(LED_Pin);
-			nrf_delay_ms(200);
+			power_profile_delay_ms(200);
 			nrf_gpio_pin_clear(LED_Pin);
 		}
 		
-		error = 0;
-		error |= SHT2x_MeasurePoll(HUMIDITY, &humidity);
-		if (!error)
+		if (!p_result->humidity_error)
 		{
-			temp_storage_struct.humidity = SHT2x_CalcRH(humidity.u16);
+			temp_storage_struct.humidity = SHT2x_CalcRHCenti(p_result->humidity.u16);
 		}
 		else
 		{
 			nrf_gpio_pin_set(LED_Pin);
-			nrf_delay_ms(200);
+			power_profile_delay_ms(200);
 			nrf_gpio_pin_clear(LED_Pin);
 		}
 }
 
-// ADC timer handler to start ADC sampling
-static void read_battery_status()
+/**@brief Function for copying the newest entry of the RAM logs to the flash log.
+ */
+static void log_to_flash(void)
 {
-	uint32_t p_is_running = 0;
-		
-	sd_clock_hfclk_request();
-	while(! p_is_running) {  							//wait for the hfclk to be available
-		sd_clock_hfclk_is_running((&p_is_running));
-	}               
-	NRF_ADC->TASKS_START = 1;							//Start ADC sampling
+		uint8_t record[FLASH_LOG_RECORD_SIZE];
+		uint32_t err_code;
+	
+		record[0] = temp_log[temp_log[0] - 1];
+		record[1] = humidity_log[humidity_log[0] - 1];
+		err_code = flash_log_append(record);
+		if (err_code != NRF_ERROR_NO_MEM) // Flash far behind (connection events leave it no time), drop the entry
+		{
+			APP_ERROR_CHECK(err_code);
+		}
 }
 
-static void measurement_timer_handler(void * p_context)
+/**@brief Function for converting a temperature in 0.01 C to 0.1 C, rounded, for the compressed log.
+ */
+static int16_t compressed_log_temperature(int16_t t)
+{
+		return (t >= 0) ? (t + 5) / 10 : -((-t + 5) / 10);
+}
+
+/**@brief Function for converting a humidity in 0.01 %RH to %RH, rounded, for the compressed log.
+ */
+static uint8_t compressed_log_humidity(int16_t h)
+{
+		return (h > 0) ? (h + 50) / 100 : 0;
+}
+
+/**@brief Function for adding a closed log slot to the logs.
+ *
+ * @details The RAM and flash logs get the mean of the slot, the compressed log its lowest and
+ *          highest readings as well.
+ */
+static void log_slot_to_logs(const log_slot_t * p_slot)
 {
-    //nrf_gpio_pin_set(LED_Pin);
+		temperature_struct mean;
+		compressed_log_sample_t sample;
 	
-		measure_temperature_and_humidity();
-		set_temperature(&m_our_service, &temp_storage_struct, &m_conn_handle);
-		set_humidity(&m_our_service, &temp_storage_struct, &m_conn_handle);
+		mean.temperature = p_slot->temperature.mean;
+		mean.humidity    = p_slot->humidity.mean;
+		set_temperature_log(&m_our_service, (uint8_t *) &temp_log, &mean, &m_conn_handle);
+		set_humidity_log(&m_our_service, (uint8_t *) &humidity_log, &mean, &m_conn_handle);
+		set_log_head(&m_our_service, temp_log, &m_conn_handle);
+		log_to_flash();
 	
-		if (log_counter >= LOGGING_INTERVAL)
+		sample.temperature     = compressed_log_temperature(p_slot->temperature.mean);
+		sample.temperature_min = compressed_log_temperature(p_slot->temperature.min);
+		sample.temperature_max = compressed_log_temperature(p_slot->temperature.max);
+		sample.humidity        = compressed_log_humidity(p_slot->humidity.mean);
+		sample.humidity_min    = compressed_log_humidity(p_slot->humidity.min);
+		sample.humidity_max    = compressed_log_humidity(p_slot->humidity.max);
+		compressed_log_append(device_time_now(), device_config_get()->measurement.log_period, &sample);
+}
+
+/**@brief Function for putting the new readings in the advertising data.
+ */
+static void broadcast_readings(void)
+{
+#if BROADCAST_ENABLED
+		broadcast_reading_t reading;
+		uint32_t err_code;
+	
+		reading.temperature   = temp_storage_struct.temperature;
+		reading.humidity      = (temp_storage_struct.humidity > 0) ? (uint16_t)temp_storage_struct.humidity : 0;
+		reading.battery_level = m_battery_level;
+		err_code = broadcast_update(&reading);
+		APP_ERROR_CHECK(err_code);
+#endif
+}
+
+/**@brief Function for starting the measurement timer so that the next measurement starts
+ *        interval seconds after the one that just finished did.
+ */
+static void measurement_timer_restart(uint16_t interval)
+{
+		uint32_t ticks;
+		uint32_t elapsed;
+		uint32_t timeout = APP_TIMER_TICKS(interval * 1000UL, APP_TIMER_PRESCALER);
+		uint32_t err_code;
+	
+		(void)app_timer_cnt_get(&ticks);
+		(void)app_timer_cnt_diff_compute(ticks, m_measurement_start, &elapsed);
+		timeout = (timeout > elapsed + APP_TIMER_MIN_TIMEOUT_TICKS) ? timeout - elapsed : APP_TIMER_MIN_TIMEOUT_TICKS;
+		err_code = app_timer_start(measurement_timer, timeout, NULL);
+		APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for processing a finished temperature and humidity measurement, in the main loop.
+ *
+ * @details Publishes the new values, notifying those that moved past their deadband, updates the
+ *          logs when an entry is due and lets the advertising scheduler decide if the news are
+ *          worth a burst. The measurement scheduler picks when
+ *          to measure next.
+ *
+ *          Each of the three steps shares state with the BLE event handlers and runs in a
+ *          critical region of its own, so a BLE event waits for one step at most.
+ */
+static void measurement_process(void * p_event_data, uint16_t event_size)
+{
+		measurement_scheduler_decision_t decision;
+		log_slot_t slot;
+		uint32_t err_code = NRF_SUCCESS;
+	
+		store_temperature_and_humidity((const sht2x_async_result_t *)p_event_data);
+		power_profile_measurement_end();
+	
+		CRITICAL_REGION_ENTER();
+		log_slot_add(temp_storage_struct.temperature, temp_storage_struct.humidity, m_measurement_interval);
+		measurement_scheduler_on_reading(temp_storage_struct.temperature, temp_storage_struct.humidity, &decision);
+		m_measurement_interval = decision.interval;
+		measurement_timer_restart(decision.interval);
+		set_temperature(&m_our_service, &temp_storage_struct, &m_conn_handle, decision.notify_temperature);
+		set_humidity(&m_our_service, &temp_storage_struct, &m_conn_handle, decision.notify_humidity);
+		CRITICAL_REGION_EXIT();
+	
+		if (decision.log)
 		{
-			set_temperature_log(&m_our_service, (uint8_t *) &temp_log, &temp_storage_struct, &m_conn_handle);
-			set_humidity_log(&m_our_service, (uint8_t *) &humidity_log, &temp_storage_struct, &m_conn_handle);
-			log_counter = 0;
+			CRITICAL_REGION_ENTER();
+			log_slot_close(&slot);
+			log_slot_to_logs(&slot);
+			err_code = adv_scheduler_burst(); // A new log entry for anyone in range to collect
+			CRITICAL_REGION_EXIT();
+			APP_ERROR_CHECK(err_code);
 		}
-		else
+	
+		CRITICAL_REGION_ENTER();
+		broadcast_readings();
+		err_code = adv_scheduler_on_reading(temp_storage_struct.temperature, temp_storage_struct.humidity);
+#if POWER_PROFILE_ENABLED
+		set_power_profile(&m_our_service, power_profile_get());
+#endif
+		CRITICAL_REGION_EXIT();
+		APP_ERROR_CHECK(err_code);
+	
+		m_measurement_running = false;
+}
+
+/**@brief Function for handling a finished temperature and humidity measurement: it is processed
+ *        from the main loop. Called in the main loop, or in the TWI interrupt.
+ */
+static void measurement_done(const sht2x_async_result_t * p_result)
+{
+		uint32_t err_code = app_sched_event_put((void *)p_result, sizeof(*p_result), measurement_process);
+		APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for starting a measurement, in the main loop. The sensor converts while the CPU
+ *        sleeps and measurement_done() is called when the result has been read.
+ */
+static void measurement_start(void * p_event_data, uint16_t event_size)
+{
+		uint32_t err_code;
+	
+		if (m_measurement_running)
 		{
-			log_counter++;
+			return; // The previous measurement is still running, it starts the timer again when done
 		}
 	
-		read_battery_status();
-		battery_level_update(); 
+		m_measurement_running = true;
+		(void)app_timer_cnt_get(&m_measurement_start);
+		power_profile_measurement_begin();
+		err_code = sht2x_async_start();
+		APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for handling the measurement timer: the sensor transfers are left to the main loop.
+ */
+static void measurement_timer_handler(void * p_context)
+{
+		uint32_t err_code = app_sched_event_put(NULL, 0, measurement_start);
+		APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for moving the next measurement after the measurement configuration changed.
+ */
+static void measurement_reschedule(void)
+{
+		uint32_t ticks;
+		uint32_t elapsed;
+		uint32_t err_code;
 	
-		//nrf_gpio_pin_clear(LED_Pin);
+		if (m_measurement_running)
+		{
+			return; // measurement_process() schedules the next one with the new configuration
+		}
+		(void)app_timer_cnt_get(&ticks);
+		(void)app_timer_cnt_diff_compute(ticks, m_measurement_start, &elapsed);
+		err_code = app_timer_stop(measurement_timer);
+		APP_ERROR_CHECK(err_code);
+		m_measurement_interval = measurement_scheduler_reschedule(elapsed / APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER));
+		measurement_timer_restart(m_measurement_interval);
 }
 
 
 /**@brief Function for starting timers.
-*/
+ *
+ * @details The measurement timer is single shot: measurement_process() starts it again with the
+ *          interval the measurement scheduler picked.
+ */
 static void application_timers_start(void)
 {
 	  uint32_t err_code;
 
     // Create timers
-    err_code = app_timer_create(&measurement_timer, APP_TIMER_MODE_REPEATED, measurement_timer_handler);
+    err_code = app_timer_create(&measurement_timer, APP_TIMER_MODE_SINGLE_SHOT, measurement_timer_handler);
     APP_ERROR_CHECK(err_code);
 	
-		err_code = app_timer_start(measurement_timer, APP_TIMER_TICKS(MEASUREMENT_INTERVAL, APP_TIMER_PRESCALER), NULL);
+		err_code = measurement_scheduler_init(&device_config_get()->measurement, MEASUREMENT_INTERVAL / 1000);
 	  APP_ERROR_CHECK(err_code);
 }
 
@@ -433,6 +773,13 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
             m_conn_handle = BLE_CONN_HANDLE_INVALID; // Set connection handle to 0xFFFF
             break;
 
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            if (m_conn_params_retry)
+            {
+                conn_params_select(m_conn_params_fast);
+            }
+            break;
+
         default:
             // No implementation needed.
             break;
@@ -452,8 +799,14 @@ static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
     dm_ble_evt_handler(p_ble_evt);
     ble_conn_params_on_ble_evt(p_ble_evt);
     on_ble_evt(p_ble_evt);
+    our_service_on_ble_evt(&m_our_service, p_ble_evt);
     ble_advertising_on_ble_evt(p_ble_evt);
+    adv_scheduler_on_ble_evt(p_ble_evt);
+    measurement_scheduler_on_ble_evt(p_ble_evt);
+    device_config_on_ble_evt(p_ble_evt);
 	  ble_bas_on_ble_evt(&m_bas, p_ble_evt);
+    log_transfer_on_ble_evt(p_ble_evt);
+    current_time_on_ble_evt(p_ble_evt);
 }
 
 
@@ -559,37 +912,68 @@ static void device_manager_init(bool erase_bonds)
 }
 
 
+/**@brief Function for initializing the flash log and refilling the RAM logs from it.
+ *
+ * @details The flash log has its own pstorage pages, so erasing the bonds at boot does not touch it.
+ *          The newest LOG_SIZE - 1 entries are copied back and published, as if the device had not
+ *          been reset.
+ */
+static void flash_log_restore(void)
+{
+    uint32_t err_code;
+    uint32_t count;
+    uint32_t first;
+    uint32_t i;
+    uint8_t  record[FLASH_LOG_RECORD_SIZE];
+
+    err_code = flash_log_init();
+    APP_ERROR_CHECK(err_code);
+
+    count = flash_log_count();
+    first = (count > LOG_SIZE - 1) ? count - (LOG_SIZE - 1) : 0;
+    for (i = first; i < count; i++)
+    {
+        err_code = flash_log_read(i, record);
+        APP_ERROR_CHECK(err_code);
+        temp_log[1 + i - first]     = record[0];
+        humidity_log[1 + i - first] = record[1];
+    }
+    temp_log[0]     = 1 + count - first;
+    humidity_log[0] = 1 + count - first;
+    set_log_head(&m_our_service, temp_log, &m_conn_handle);
+}
+
+
 /**@brief Function for initializing the Advertising functionality.
  */
 static void advertising_init(void)
 {
     uint32_t      err_code;
-    ble_advdata_t advdata;
-		int8_t        tx_power_level = TX_POWER;
+    // Static: the advertising scheduler and broadcast.c set the same data again later.
+    static ble_advdata_t advdata;
+    static ble_advdata_t srdata;
+    static ble_uuid_t m_adv_uuids[] = {{BLE_UUID_BATTERY_SERVICE, BLE_UUID_TYPE_BLE}, {BLE_UUID_OUR_SERVICE, BLE_UUID_TYPE_VENDOR_BEGIN}}; 
 
     // Build advertising data struct to pass into ble_advertising_init().
     memset(&advdata, 0, sizeof(advdata));
 
     advdata.name_type               = BLE_ADVDATA_FULL_NAME;
-		advdata.include_appearance      = true;
     advdata.flags                   = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
-		advdata.p_tx_power_level        = &tx_power_level;
-
-    ble_adv_modes_config_t options = {0};
-    options.ble_adv_fast_enabled  = BLE_ADV_FAST_ENABLED;
-    options.ble_adv_fast_interval = APP_ADV_INTERVAL;
-    options.ble_adv_fast_timeout  = APP_ADV_TIMEOUT_IN_SECONDS;
+		advdata.p_tx_power_level        = &m_tx_power_level;
 
     // OUR_JOB: Create a scan response packet and include the list of UUIDs 
-    ble_uuid_t m_adv_uuids[] = {{BLE_UUID_BATTERY_SERVICE, BLE_UUID_TYPE_BLE}, {BLE_UUID_OUR_SERVICE, BLE_UUID_TYPE_VENDOR_BEGIN}}; 
-
-    ble_advdata_t srdata;
     memset(&srdata, 0, sizeof(srdata));
     srdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
     srdata.uuids_complete.p_uuids = m_adv_uuids;
+		srdata.include_appearance     = true;       // Moved from the advertising data to leave room for the readings
 
-    err_code = ble_advertising_init(&advdata, &srdata, &options, on_adv_evt, NULL);
+		// Fast bursts after news, a slow interval in between
+    err_code = adv_scheduler_init(&advdata, &srdata, &device_config_get()->advertising, on_adv_evt);
     APP_ERROR_CHECK(err_code);
+		
+#if BROADCAST_ENABLED
+		broadcast_init(&advdata);
+#endif
 }
 
 /**@brief Function for the Power manager.
@@ -601,41 +985,6 @@ static void power_manage(void)
 }
 
 
-//ADC initialization
-static void adc_init(void)
-{		
-	/* Enable interrupt on ADC sample ready event*/		
-	NRF_ADC->INTENSET = ADC_INTENSET_END_Msk;
-		sd_nvic_SetPriority(ADC_IRQn, NRF_APP_PRIORITY_LOW);  
-
-	NVIC_EnableIRQ(ADC_IRQn);	
-	
-	/* Configure ADC - set reference input source to internal 1.2V bandgap */
-	NRF_ADC->CONFIG = (ADC_CONFIG_REFSEL_VBG << ADC_CONFIG_REFSEL_Pos);
-	/* Configure ADC - set input source to VDD/3 */
-	NRF_ADC->CONFIG |= (ADC_CONFIG_INPSEL_SupplyOneThirdPrescaling << ADC_CONFIG_INPSEL_Pos);
-	/* Configure ADC - select 8 bit resolution */
-	NRF_ADC->CONFIG |= (ADC_CONFIG_RES_8bit << ADC_CONFIG_RES_Pos);
-	
-	/* Enable ADC*/
-	NRF_ADC->ENABLE = ADC_ENABLE_ENABLE_Enabled;	
-}
-
-/* Interrupt handler for ADC data ready event */
-void ADC_IRQHandler(void)
-{
-	/* Clear dataready event */
-  NRF_ADC->EVENTS_END = 0;	
-	
-	battery_value_raw = NRF_ADC->RESULT;
-	
-	//Use the STOP task to save current. Workaround for PAN_028 rev1.5 anomaly 1.
-  NRF_ADC->TASKS_STOP = 1;
-	
-	//Release the external crystal
-	sd_clock_hfclk_release();
-}	
-
 void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
 {
 	for (int i=0; i < 10; i ++)
@@ -665,25 +1014,35 @@ int main(void)
 	
 		memset(&humidity_log, 0xFF, sizeof(humidity_log));
 		humidity_log[0] = 1;
+		compressed_log_init();
 
     // Initialize.
     timers_init();
+    scheduler_init();
+    err_code = device_time_init(APP_TIMER_PRESCALER);
+    APP_ERROR_CHECK(err_code);
     ble_stack_init();
     device_manager_init(erase_bonds);
-    gap_params_init();
     services_init();
+    gap_params_init();
+    flash_log_restore();
     advertising_init();
     conn_params_init();
-		adc_init();
+		err_code = battery_init(APP_TIMER_PRESCALER, on_battery_evt); // Before advertising, see battery.h
+		APP_ERROR_CHECK(err_code);
 	
 		// Init temperature sensor
-		I2c_Init();
+		i2c_bus_init();
 		DelayMicroSeconds(15000);
 		SHT2x_SoftReset();
+		err_code = sht2x_async_init(APP_TIMER_PRESCALER, measurement_done);
+		APP_ERROR_CHECK(err_code);
+		err_code = sht2x_async_config_set(&device_config_get()->sensor);
+		APP_ERROR_CHECK(err_code);
 		
 		// Start execution.
     application_timers_start();
-    err_code = ble_advertising_start(BLE_ADV_MODE_FAST);
+    err_code = adv_scheduler_start();
     APP_ERROR_CHECK(err_code);
 
 		nrf_gpio_pin_clear(LED_Pin);
@@ -693,6 +1052,7 @@ int main(void)
     // Enter main loop.
     for (;;)
     {
+        app_sched_execute();
         power_manage();
     }
 }
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include "measurement_scheduler.h"
+#include "nrf_error.h"
+
+#define MEASUREMENT_SCHEDULER_INTERVAL_MIN    2         /**< s, leaves time for the conversions. */
+#define MEASUREMENT_SCHEDULER_INTERVAL_MAX    3600      /**< s */
+
+/**@brief Deadband state of one notified value. */
+typedef struct
+{
+	int16_t  notified;                      /**< Value last notified. */
+	int16_t  last;                          /**< Last reading. */
+	uint32_t silence;                       /**< Seconds since the last notification. */
+} channel_t;
+
+static measurement_scheduler_config_t m_config;
+static uint16_t                       m_interval;          /**< Interval the trend asked for last, before landing on a log entry. */
+static uint16_t                       m_elapsed;           /**< Interval of the last decision. */
+static uint16_t                       m_until_log;         /**< Seconds from the last reading to the next log entry. */
+static bool                           m_have_reading;
+static channel_t                      m_temperature;
+static channel_t                      m_humidity;
+
+/**@brief Decides whether to notify a new reading of one channel, and records the reading. */
+static bool channel_update(channel_t * p_channel, int16_t value, uint16_t deadband, uint16_t elapsed)
+{
+	bool notify;
+
+	p_channel->silence += elapsed;
+	notify = !m_have_reading ||
+	         (abs(value - p_channel->notified) >= deadband) ||
+	         ((m_config.max_silence > 0) && (p_channel->silence >= m_config.max_silence));
+	if (notify)
+	{
+		p_channel->notified = value;
+		p_channel->silence  = 0;
+	}
+	return notify;
+}
+
+/**@brief How a channel moved since the last reading: 1 by a deadband or more, -1 by less than a
+ *        quarter of it, 0 in between. Channels with no deadband are always stable. */
+static int8_t channel_trend(const channel_t * p_channel, int16_t value, uint16_t deadband)
+{
+	int32_t change = abs(value - p_channel->last);
+
+	if ((deadband == 0) || (4 * change < deadband))
+	{
+		return -1;
+	}
+	return (change >= deadband) ? 1 : 0;
+}
+
+/**@brief Next interval from the trend of both channels. */
+static uint16_t next_interval(int16_t temperature, int16_t humidity)
+{
+	int8_t   temperature_trend = channel_trend(&m_temperature, temperature, m_config.temperature_deadband);
+	int8_t   humidity_trend    = channel_trend(&m_humidity, humidity, m_config.humidity_deadband);
+	uint32_t interval          = m_interval;
+
+	if (m_have_reading)
+	{
+		if ((temperature_trend > 0) || (humidity_trend > 0))
+		{
+			interval /= 2;
+		}
+		else if ((temperature_trend < 0) && (humidity_trend < 0))
+		{
+			interval *= 2;
+		}
+	}
+	if (interval < m_config.min_interval)
+	{
+		interval = m_config.min_interval;
+	}
+	if (interval > m_config.max_interval)
+	{
+		interval = m_config.max_interval;
+	}
+	return (uint16_t)interval;
+}
+
+void measurement_scheduler_config_default(measurement_scheduler_config_t * p_config, uint16_t log_period)
+{
+	p_config->min_interval         = MEASUREMENT_SCHEDULER_MIN_INTERVAL;
+	p_config->max_interval         = MEASUREMENT_SCHEDULER_MAX_INTERVAL;
+	p_config->temperature_deadband = MEASUREMENT_SCHEDULER_TEMPERATURE_DEADBAND;
+	p_config->humidity_deadband    = MEASUREMENT_SCHEDULER_HUMIDITY_DEADBAND;
+	p_config->max_silence          = MEASUREMENT_SCHEDULER_MAX_SILENCE;
+	p_config->log_period           = log_period;
+}
+
+bool measurement_scheduler_config_valid(const measurement_scheduler_config_t * p_config)
+{
+	return (p_config->min_interval >= MEASUREMENT_SCHEDULER_INTERVAL_MIN) &&
+	       (p_config->max_interval <= MEASUREMENT_SCHEDULER_INTERVAL_MAX) &&
+	       (p_config->min_interval <= p_config->max_interval) &&
+	       (p_config->log_period >= p_config->min_interval);
+}
+
+uint32_t measurement_scheduler_init(const measurement_scheduler_config_t * p_config, uint16_t start_interval)
+{
+	if (!measurement_scheduler_config_valid(p_config))
+	{
+		return NRF_ERROR_INVALID_PARAM;
+	}
+	m_config       = *p_config;
+	m_interval     = start_interval;
+	m_elapsed      = 0;
+	m_until_log    = 0;
+	m_have_reading = false;
+	return NRF_SUCCESS;
+}
+
+uint32_t measurement_scheduler_config_set(const measurement_scheduler_config_t * p_config)
+{
+	if (!measurement_scheduler_config_valid(p_config))
+	{
+		return NRF_ERROR_INVALID_PARAM;
+	}
+	m_config = *p_config;
+	return NRF_SUCCESS;
+}
+
+uint16_t measurement_scheduler_reschedule(uint16_t elapsed)
+{
+	uint32_t log_at   = (uint32_t)m_until_log + m_elapsed;   // From the last measurement
+	uint16_t interval = m_elapsed;
+
+	if (log_at > m_config.log_period)
+	{
+		log_at = m_config.log_period;
+	}
+	if (interval > m_config.max_interval)
+	{
+		interval = m_config.max_interval;
+	}
+	if (interval > log_at)
+	{
+		interval = (uint16_t)log_at;
+	}
+	if (interval <= elapsed)
+	{
+		interval = elapsed + 1;
+	}
+	if (log_at < interval)
+	{
+		log_at = interval;
+	}
+	m_until_log = (uint16_t)(log_at - interval);
+	m_elapsed   = interval;
+	if (m_interval > m_config.max_interval)
+	{
+		m_interval = m_config.max_interval;
+	}
+	return interval;
+}
+
+void measurement_scheduler_config_get(measurement_scheduler_config_t * p_config)
+{
+	*p_config = m_config;
+}
+
+void measurement_scheduler_on_reading(int16_t temperature, int16_t humidity, measurement_scheduler_decision_t * p_decision)
+{
+	uint16_t interval = next_interval(temperature, humidity);
+	uint16_t elapsed  = m_have_reading ? m_elapsed : 0;
+
+	p_decision->notify_temperature = channel_update(&m_temperature, temperature, m_config.temperature_deadband, elapsed);
+	p_decision->notify_humidity    = channel_update(&m_humidity, humidity, m_config.humidity_deadband, elapsed);
+	m_temperature.last = temperature;
+	m_humidity.last    = humidity;
+	m_have_reading     = true;
+	m_interval         = interval;
+
+	p_decision->log = (m_until_log == 0);
+	if (p_decision->log)
+	{
+		m_until_log = m_config.log_period;
+	}
+	else if (m_until_log > m_config.log_period)
+	{
+		m_until_log = m_config.log_period; // The period was shortened
+	}
+
+	// Land on the next log entry rather than leave a gap shorter than min_interval before it.
+	if (m_until_log < interval + m_config.min_interval)
+	{
+		interval = (m_until_log <= m_config.max_interval) ? m_until_log : m_until_log / 2;
+	}
+	m_until_log -= interval;
+	m_elapsed    = interval;
+
+	p_decision->interval = interval;
+}
+
+void measurement_scheduler_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+	if (p_ble_evt->header.evt_id == BLE_GAP_EVT_CONNECTED)
+	{
+		m_temperature.notified = m_temperature.last;
+		m_temperature.silence  = 0;
+		m_humidity.notified    = m_humidity.last;
+		m_humidity.silence     = 0;
+	}
+}
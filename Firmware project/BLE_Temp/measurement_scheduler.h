@@ -0,0 +1,103 @@
+#ifndef MEASUREMENT_SCHEDULER_H__
+#define MEASUREMENT_SCHEDULER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
+/**@brief Measurement intervals and notifications that follow the readings.
+ *
+ * @details A reading is notified only when it moved by at least the deadband since the value
+ *          last notified on that characteristic, or when nothing was notified on it for
+ *          max_silence seconds. The value of the characteristic is updated on every reading, so
+ *          reads always get the latest one.
+ *
+ *          The interval to the next measurement doubles while a reading moved by less than a
+ *          quarter of the deadband since the one before, up to max_interval, and halves when it
+ *          moved by a whole deadband or more, down to min_interval. A stable room is then measured
+ *          every max_interval, and a reading that changes fast never moves by much more than a
+ *          deadband before it is notified.
+ *
+ *          Log entries stay log_period apart whatever the interval: the intervals are shortened
+ *          so that a measurement falls on every log entry, and the decision for such a reading
+ *          says so.
+ */
+#define MEASUREMENT_SCHEDULER_MIN_INTERVAL          15      /**< s */
+#define MEASUREMENT_SCHEDULER_MAX_INTERVAL          120     /**< s */
+#define MEASUREMENT_SCHEDULER_TEMPERATURE_DEADBAND  20      /**< 0.2 C */
+#define MEASUREMENT_SCHEDULER_HUMIDITY_DEADBAND     100     /**< 1 %RH, the resolution of the humidity characteristic. */
+#define MEASUREMENT_SCHEDULER_MAX_SILENCE           600     /**< s */
+
+/**@brief Scheduler configuration. */
+typedef struct
+{
+	uint16_t min_interval;                  /**< s */
+	uint16_t max_interval;                  /**< s, min_interval for a fixed interval. */
+	uint16_t temperature_deadband;          /**< 0.01 C, 0 notifies every reading. */
+	uint16_t humidity_deadband;             /**< 0.01 %RH, 0 notifies every reading. */
+	uint16_t max_silence;                   /**< s, 0 for no limit. */
+	uint16_t log_period;                    /**< s between two log entries, at least min_interval. */
+} measurement_scheduler_config_t;
+
+/**@brief What to do with a reading. */
+typedef struct
+{
+	uint16_t interval;                      /**< Seconds from this measurement to the next one. */
+	bool     log;                           /**< The reading is due in the logs. */
+	bool     notify_temperature;
+	bool     notify_humidity;
+} measurement_scheduler_decision_t;
+
+/**@brief Function for getting the default configuration, from the MEASUREMENT_SCHEDULER_ constants
+ *        and the log period of the application. */
+void measurement_scheduler_config_default(measurement_scheduler_config_t * p_config, uint16_t log_period);
+
+/**@brief Function for checking a configuration. */
+bool measurement_scheduler_config_valid(const measurement_scheduler_config_t * p_config);
+
+/**@brief Function for initializing the scheduler. The first reading is logged and notified.
+ *
+ * @param[in]   p_config          Configuration.
+ * @param[in]   start_interval    Interval to start from, in seconds.
+ *
+ * @return      NRF_SUCCESS, or NRF_ERROR_INVALID_PARAM for a bad configuration.
+ */
+uint32_t measurement_scheduler_init(const measurement_scheduler_config_t * p_config, uint16_t start_interval);
+
+/**@brief Function for changing the configuration at run time. It applies from the next reading;
+ *        measurement_scheduler_reschedule() fits the measurement already scheduled in.
+ *
+ * @return      NRF_SUCCESS, or NRF_ERROR_INVALID_PARAM for a bad configuration.
+ */
+uint32_t measurement_scheduler_config_set(const measurement_scheduler_config_t * p_config);
+
+/**@brief Function for fitting the next measurement into the configuration after it changed.
+ *
+ * @details The interval of the last decision is shortened to max_interval if it is longer, and
+ *          the next log entry is brought forward to log_period after the last one if it is further
+ *          away.
+ *
+ * @param[in]   elapsed   Seconds since the last measurement.
+ *
+ * @return      Seconds from the last measurement to the next one, more than elapsed.
+ */
+uint16_t measurement_scheduler_reschedule(uint16_t elapsed);
+
+/**@brief Function for getting the configuration in use. */
+void measurement_scheduler_config_get(measurement_scheduler_config_t * p_config);
+
+/**@brief Function for passing a new reading, taken the interval of the last decision after the
+ *        one before.
+ *
+ * @param[in]   temperature   0.01 C
+ * @param[in]   humidity      0.01 %RH
+ * @param[out]  p_decision    What to do with it and when to measure next.
+ */
+void measurement_scheduler_on_reading(int16_t temperature, int16_t humidity, measurement_scheduler_decision_t * p_decision);
+
+/**@brief Function for handling the BLE events: a new client reads the values when it connects,
+ *        the deadbands start again from them.
+ */
+void measurement_scheduler_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif // MEASUREMENT_SCHEDULER_H__
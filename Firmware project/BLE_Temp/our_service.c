@@ -38,13 +38,23 @@
 #include "our_service.h"
 #include "ble_srv_common.h"
 #include "app_error.h"
+#include "log_transfer.h"
+
+#define OUR_VALUE_TEMPERATURE     (1 << 0)
+#define OUR_VALUE_HUMIDITY        (1 << 1)
+#define OUR_VALUE_BATTERY         (1 << 2)
+#define OUR_VALUE_LOG_HEAD        (1 << 3)
+
+static void characteristic_add(ble_os_t * p_our_service, uint16_t characteristic_uuid, ble_gatts_char_handles_t * handle, uint8_t len_in_bytes, uint8_t notify, uint8_t write, uint8_t * p_user_value);
 
 /**@brief Function for initiating our new service.
  *
  * @param[in]   p_our_service        Our Service structure.
+ * @param[in]   temp_log             Temperature log, LOG_SIZE bytes, published from where it is.
+ * @param[in]   humidity_log         Humidity log, LOG_SIZE bytes, published from where it is.
  *
  */
-void our_service_init(ble_os_t * p_our_service)
+void our_service_init(ble_os_t * p_our_service, uint8_t *temp_log, uint8_t *humidity_log)
 {
     uint32_t   err_code; // Variable to hold return codes from library and softdevice functions
     
@@ -61,11 +71,21 @@ void our_service_init(ble_os_t * p_our_service)
 
 		add_characteristic_to_service(p_our_service, BLE_UUID_CHAR_TEMPERATURE, &p_our_service->temperature_characteristic_handle, 4, 1);
 		add_characteristic_to_service(p_our_service, BLE_UUID_CHAR_HUMIDITY, &p_our_service->humidity_characteristic_handle, 1, 1);
-		add_characteristic_to_service(p_our_service, BLE_UUID_CHAR_TEMP_LOG, &p_our_service->temp_log_characteristic_handle, LOG_SIZE, 0);
-		add_characteristic_to_service(p_our_service, BLE_UUID_CHAR_HUMIDITY_LOG, &p_our_service->humidity_log_characteristic_handle, LOG_SIZE, 0);
+		characteristic_add(p_our_service, BLE_UUID_CHAR_TEMP_LOG, &p_our_service->temp_log_characteristic_handle, LOG_SIZE, 0, 0, temp_log);
+		characteristic_add(p_our_service, BLE_UUID_CHAR_HUMIDITY_LOG, &p_our_service->humidity_log_characteristic_handle, LOG_SIZE, 0, 0, humidity_log);
+		add_control_point_to_service(p_our_service, BLE_UUID_CHAR_LOG_CONTROL, &p_our_service->log_control_characteristic_handle, LOG_TRANSFER_CONTROL_LEN);
+		add_characteristic_to_service(p_our_service, BLE_UUID_CHAR_LOG_DATA, &p_our_service->log_data_characteristic_handle, LOG_TRANSFER_CHUNK_SIZE, 1);
+		add_characteristic_to_service(p_our_service, BLE_UUID_CHAR_BATTERY, &p_our_service->battery_characteristic_handle, sizeof(p_our_service->battery_value), 0);
+		add_characteristic_to_service(p_our_service, BLE_UUID_CHAR_LOG_HEAD, &p_our_service->log_head_characteristic_handle, sizeof(p_our_service->log_head_value), 0);
+#if POWER_PROFILE_ENABLED
+		add_characteristic_to_service(p_our_service, BLE_UUID_CHAR_POWER_PROFILE, &p_our_service->power_profile_characteristic_handle, sizeof(power_profile_t), 0);
+#endif
 }
 
-void add_characteristic_to_service(ble_os_t * p_our_service, uint16_t characteristic_uuid, ble_gatts_char_handles_t * handle, uint8_t len_in_bytes, uint8_t notify)
+/**@brief Adds a characteristic. Its value is kept by the stack, or where p_user_value points if not
+ *        NULL: the stack then reads it from there and updating it needs no copy.
+ */
+static void characteristic_add(ble_os_t * p_our_service, uint16_t characteristic_uuid, ble_gatts_char_handles_t * handle, uint8_t len_in_bytes, uint8_t notify, uint8_t write, uint8_t * p_user_value)
 {
 		uint32_t err_code;
 
@@ -79,6 +99,7 @@ void add_characteristic_to_service(ble_os_t * p_our_service, uint16_t characteri
     memset(&char_md, 0, sizeof(char_md));
     char_md.char_props.read = 1;
     char_md.char_props.notify = notify;
+    char_md.char_props.write = write;
     char_md.char_props.indicate = 0;
     char_md.p_char_user_desc = NULL;
     char_md.p_char_pf = NULL;
@@ -98,7 +119,7 @@ void add_characteristic_to_service(ble_os_t * p_our_service, uint16_t characteri
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
 
-    attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+    attr_md.vloc    = (p_user_value != NULL) ? BLE_GATTS_VLOC_USER : BLE_GATTS_VLOC_STACK;
     attr_md.rd_auth = 0;
     attr_md.wr_auth = 0;
     attr_md.vlen    = 1;
@@ -111,12 +132,22 @@ void add_characteristic_to_service(ble_os_t * p_our_service, uint16_t characteri
     attr_char_value.init_len  = len_in_bytes;
     attr_char_value.init_offs = 0;
     attr_char_value.max_len   = len_in_bytes;
-    attr_char_value.p_value   = NULL;
+    attr_char_value.p_value   = p_user_value;
 
     err_code = sd_ble_gatts_characteristic_add(p_our_service->service_handle, &char_md, &attr_char_value, handle);
 		APP_ERROR_CHECK(err_code);
 }
 
+void add_characteristic_to_service(ble_os_t * p_our_service, uint16_t characteristic_uuid, ble_gatts_char_handles_t * handle, uint8_t len_in_bytes, uint8_t notify)
+{
+		characteristic_add(p_our_service, characteristic_uuid, handle, len_in_bytes, notify, 0, NULL);
+}
+
+void add_control_point_to_service(ble_os_t * p_our_service, uint16_t characteristic_uuid, ble_gatts_char_handles_t * handle, uint8_t len_in_bytes)
+{
+		characteristic_add(p_our_service, characteristic_uuid, handle, len_in_bytes, 1, 1, NULL);
+}
+
 void set_characteristic_value(uint8_t *p_value, ble_gatts_char_handles_t * handle, uint8_t length)
 {
 		uint32_t error_code;
@@ -150,6 +181,10 @@ void notify_characteristic_value(ble_gatts_char_handles_t * handle, uint8_t leng
         hvx_params.p_data = NULL; // NULL means "Use current value".
 
         err_code = sd_ble_gatts_hvx(*connection_handle, &hvx_params);
+        if (err_code == NRF_SUCCESS)
+        {
+            power_profile_notification(hvx_len);
+        }
         if ((err_code == NRF_SUCCESS) && (hvx_len != length))
         {
             err_code = NRF_ERROR_DATA_SIZE;
@@ -161,27 +196,134 @@ void notify_characteristic_value(ble_gatts_char_handles_t * handle, uint8_t leng
     }
 }
 
-void set_temperature(ble_os_t * service, temperature_struct *temp, uint16_t * connection_handle)
+/**@brief Finds a value kept in Our Service structure.
+ *
+ * @return      Its characteristic.
+ */
+static ble_gatts_char_handles_t * value_get(ble_os_t * service, uint8_t value, const uint8_t ** pp_data, uint8_t * p_length)
+{
+		switch (value)
+		{
+			case OUR_VALUE_TEMPERATURE:
+				*pp_data  = service->temperature_value;
+				*p_length = sizeof(service->temperature_value);
+				return &service->temperature_characteristic_handle;
+
+			case OUR_VALUE_HUMIDITY:
+				*pp_data  = &service->humidity_value;
+				*p_length = sizeof(service->humidity_value);
+				return &service->humidity_characteristic_handle;
+
+			case OUR_VALUE_BATTERY:
+				*pp_data  = service->battery_value;
+				*p_length = sizeof(service->battery_value);
+				return &service->battery_characteristic_handle;
+
+			case OUR_VALUE_LOG_HEAD:
+				*pp_data  = service->log_head_value;
+				*p_length = sizeof(service->log_head_value);
+				return &service->log_head_characteristic_handle;
+
+			default:
+				return NULL;
+		}
+}
+
+/**@brief Copies the values still pending into the attribute table. */
+static void values_flush(ble_os_t * service, uint8_t values)
+{
+		ble_gatts_char_handles_t * handle;
+		const uint8_t * p_data;
+		uint8_t length;
+		uint8_t value;
+	
+		for (value = 1; value != 0; value <<= 1)
+		{
+			if ((values & service->pending & value) == 0)
+			{
+				continue;
+			}
+			service->pending &= ~value;
+			handle = value_get(service, value, &p_data, &length);
+			if (handle != NULL)
+			{
+				set_characteristic_value((uint8_t *)p_data, handle, length);
+			}
+		}
+}
+
+/**@brief Marks a value as changed, and copies it into the attribute table if a client is there to see it. */
+static void value_changed(ble_os_t * service, uint8_t value, uint16_t connection_handle)
 {
-		int8_t temperature_no_decimal = temp->temperature;
-		int8_t temperature_decimal = (temp->temperature-temperature_no_decimal)*10;
+		service->pending |= value;
+		if (connection_handle != BLE_CONN_HANDLE_INVALID)
+		{
+			values_flush(service, value);
+		}
+}
+
+void our_service_on_ble_evt(ble_os_t * p_our_service, ble_evt_t * p_ble_evt)
+{
+		if (p_ble_evt->header.evt_id == BLE_GAP_EVT_CONNECTED)
+		{
+			// Before the client can read anything
+			values_flush(p_our_service, OUR_VALUE_TEMPERATURE | OUR_VALUE_HUMIDITY | OUR_VALUE_BATTERY | OUR_VALUE_LOG_HEAD);
+		}
+}
+
+void set_temperature(ble_os_t * service, temperature_struct *temp, uint16_t * connection_handle, bool notify)
+{
+		// Whole degrees and tenths, both truncated towards zero and carrying the sign
+		int8_t temperature_no_decimal = temp->temperature / 100;
+		int8_t temperature_decimal = (temp->temperature % 100) / 10;
 		int8_t temperature_sign = (temp->temperature >= 0)? 0 : 0xFF;
 	
 		uint32_t temperature_to_write = (uint32_t)temperature_sign << 24;
-		temperature_to_write = temperature_to_write | (uint32_t)temperature_no_decimal << 16;
-		temperature_to_write = temperature_to_write | (uint32_t)temperature_decimal << 8;
+		temperature_to_write = temperature_to_write | (uint32_t)(uint8_t)temperature_no_decimal << 16;
+		temperature_to_write = temperature_to_write | (uint32_t)(uint8_t)temperature_decimal << 8;
 		temperature_to_write = temperature_to_write | (uint32_t)0xAA;
 	
-		set_characteristic_value((uint8_t *)&temperature_to_write, &service->temperature_characteristic_handle, 4);
-		notify_characteristic_value(&service->temperature_characteristic_handle, 4, connection_handle);
+		memcpy(service->temperature_value, &temperature_to_write, sizeof(service->temperature_value));
+		value_changed(service, OUR_VALUE_TEMPERATURE, *connection_handle);
+		if (notify)
+		{
+			notify_characteristic_value(&service->temperature_characteristic_handle, 4, connection_handle);
+		}
 }
 
-void set_humidity(ble_os_t * service, temperature_struct *temp, uint16_t * connection_handle)
+void set_humidity(ble_os_t * service, temperature_struct *temp, uint16_t * connection_handle, bool notify)
 {
-		uint8_t humidity = temp->humidity;
+		service->humidity_value = (temp->humidity > 0) ? temp->humidity / 100 : 0;
+		value_changed(service, OUR_VALUE_HUMIDITY, *connection_handle);
+		if (notify)
+		{
+			notify_characteristic_value(&service->humidity_characteristic_handle, 1, connection_handle);
+		}
+}
+
+void set_battery(ble_os_t * service, const battery_status_t * p_status, uint16_t * connection_handle)
+{
+		uint16_encode(p_status->voltage, &service->battery_value[0]);
+		uint16_encode(p_status->days_left, &service->battery_value[2]);
+		value_changed(service, OUR_VALUE_BATTERY, *connection_handle);
+}
+
+/**@brief Encodes a temperature as a legacy log byte: bit 7 sign, bit 6 +0.5, bits 5..0 whole degrees.
+ *
+ * @details The value is rounded down to half a degree, so it decodes as sign * whole + 0.5 * half
+ *          (-2.3 is logged as -3 + 0.5). The magnitude saturates at 63.
+ */
+static uint8_t temperature_log_entry(int16_t centi_celsius)
+{
+	int16_t half_degrees = (centi_celsius >= 0) ? centi_celsius / 50 : -((-centi_celsius + 49) / 50);
+	int16_t whole = (half_degrees >= 0) ? half_degrees / 2 : -((-half_degrees + 1) / 2);
+	uint8_t magnitude = (whole >= 0) ? whole : -whole;
 	
-		set_characteristic_value((uint8_t *)&humidity, &service->humidity_characteristic_handle, 1);
-		notify_characteristic_value(&service->humidity_characteristic_handle, 1, connection_handle);
+	if (magnitude > 0x3F)
+	{
+		magnitude = 0x3F;
+	}
+	return ((whole < 0) ? (1 << 7) : 0) | ((half_degrees & 1) ? (1 << 6) : 0) | magnitude;
 }
 
 void set_temperature_log(ble_os_t * service, uint8_t *log, temperature_struct *temp, uint16_t * connection_handle)
@@ -192,13 +334,8 @@ void set_temperature_log(ble_os_t * service, uint8_t *log, temperature_struct *t
 		ind = 1;
 	}
 	
-	uint8_t log_entry = temp->temperature;
-	log_entry ^= (-((temp->temperature >0)?0:1) ^ log_entry) & (1 << 7);
-	log_entry ^= (-((temp->temperature-(uint8_t)temp->temperature >=0.5)?1:0) ^ log_entry) & (1 << 6);
-	log[ind] = log_entry;
-	log[0] = ind+1;
-	
-	set_characteristic_value(log, &service->temp_log_characteristic_handle, LOG_SIZE);
+	log[ind] = temperature_log_entry(temp->temperature);
+	log[0] = ind+1; // The characteristic reads the log where it is
 }
 
 void set_humidity_log(ble_os_t * service, uint8_t *log, temperature_struct *temp, uint16_t * connection_handle)
@@ -209,9 +346,25 @@ void set_humidity_log(ble_os_t * service, uint8_t *log, temperature_struct *temp
 		ind = 1;
 	}
 	
-	uint8_t log_entry = temp->humidity;
+	uint8_t log_entry = (temp->humidity > 0) ? temp->humidity / 100 : 0;
 	log[ind] = log_entry;
-	log[0] = ind+1;
-	
-	set_characteristic_value(log, &service->humidity_log_characteristic_handle, LOG_SIZE);
+	log[0] = ind+1; // The characteristic reads the log where it is
+}
+
+void set_log_head(ble_os_t * service, const uint8_t *log, uint16_t * connection_handle)
+{
+		// Every entry moves the index by one, so it only goes down when the logs go round
+		if (log[0] < service->log_head_value[0])
+		{
+			uint16_encode(uint16_decode(&service->log_head_value[1]) + 1, &service->log_head_value[1]);
+		}
+		service->log_head_value[0] = log[0];
+		value_changed(service, OUR_VALUE_LOG_HEAD, *connection_handle);
+}
+
+#if POWER_PROFILE_ENABLED
+void set_power_profile(ble_os_t * service, const power_profile_t * p_profile)
+{
+	set_characteristic_value((uint8_t *)p_profile, &service->power_profile_characteristic_handle, sizeof(power_profile_t));
 }
+#endif
@@ -37,8 +37,11 @@
 #define OUR_SERVICE_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "ble.h"
 #include "ble_srv_common.h"
+#include "power_profile.h"
+#include "battery.h"
 
 
 #define BLE_UUID_OUR_BASE_UUID {0xBB, 0x28, 0x17, 0x60, 0x39, 0xA6, 0x11, 0xE6, 0x87, 0x4B, 0x00, 0x02, 0xA5, 0xD5, 0xC5, 0x1B} // 128-bit base UUID
@@ -47,10 +50,15 @@
 #define BLE_UUID_CHAR_HUMIDITY 0x0002
 #define BLE_UUID_CHAR_TEMP_LOG 0x0003
 #define BLE_UUID_CHAR_HUMIDITY_LOG 0x0004
+#define BLE_UUID_CHAR_POWER_PROFILE 0x0005 // Debug: power_profile_t counters
+#define BLE_UUID_CHAR_LOG_CONTROL 0x0006 // Bulk log transfer control point, see log_transfer.h
+#define BLE_UUID_CHAR_LOG_DATA 0x0007 // Bulk log transfer stream
+#define BLE_UUID_CHAR_BATTERY 0x0008 // Battery voltage (mV) and days left, uint16 each
+#define BLE_UUID_CHAR_LOG_HEAD 0x0009 // Next write index of the logs and the turns they made (uint16), see set_log_head()
 
 #define MEASUREMENT_INTERVAL 30000
 #define LOG_SIZE 255 // Number of log entries + 1
-#define LOGGING_INTERVAL 30 // Every 30 measurements a new log entry is created - every 15 minutes. This gives us 2 day long log
+#define LOGGING_INTERVAL 30 // A new log entry every 31 MEASUREMENT_INTERVALs (15.5 minutes), however often the measurement scheduler measures. This gives us 2 day long log
  
 /**
  * @brief This structure contains various status information for our service. 
@@ -66,32 +74,98 @@ typedef struct
 	ble_gatts_char_handles_t humidity_characteristic_handle;
 	ble_gatts_char_handles_t temp_log_characteristic_handle;
 	ble_gatts_char_handles_t humidity_log_characteristic_handle;
+	ble_gatts_char_handles_t log_control_characteristic_handle;
+	ble_gatts_char_handles_t log_data_characteristic_handle;
+	ble_gatts_char_handles_t battery_characteristic_handle;
+	ble_gatts_char_handles_t log_head_characteristic_handle;
+#if POWER_PROFILE_ENABLED
+	ble_gatts_char_handles_t power_profile_characteristic_handle;
+#endif
+	uint8_t temperature_value[4];     /**< Values kept until a client can see them, see our_service_on_ble_evt(). */
+	uint8_t humidity_value;
+	uint8_t battery_value[4];
+	uint8_t log_head_value[3];
+	uint8_t pending;                  /**< OUR_VALUE_ bits of the values changed since they were last copied to the stack. */
 } ble_os_t;
 
 typedef struct
 {
-	float temperature;
-	float humidity;
+	int16_t temperature;         /**< Temperature in 0.01 degrees Celsius. */
+	int16_t humidity;            /**< Relative humidity in 0.01 %RH. */
 } temperature_struct;
 
 /**@brief Function for initializing our new service.
+ *
+ * @details The set_ functions keep the values in Our Service structure and copy them into the
+ *          attribute table only when a client can see them. Temperature, humidity and battery are copied
+ *          right away while a client is connected and on the next connection otherwise, before the
+ *          client can read them. The logs are never copied: the
+ *          stack reads them from the application's buffers (BLE_GATTS_VLOC_USER), which must stay
+ *          in place for good. The power profile, a debug aid, is copied on every update.
  *
  * @param[in]   p_our_service       Pointer to Our Service structure.
+ * @param[in]   temp_log            Temperature log, LOG_SIZE bytes.
+ * @param[in]   humidity_log        Humidity log, LOG_SIZE bytes.
  */
-void our_service_init(ble_os_t * p_our_service);
+void our_service_init(ble_os_t * p_our_service, uint8_t *temp_log, uint8_t *humidity_log);
+
+/**@brief Function for handling the BLE events: connections.
+ *
+ * @param[in]   p_our_service       Our Service structure.
+ * @param[in]   p_ble_evt           Event received from the BLE stack.
+ */
+void our_service_on_ble_evt(ble_os_t * p_our_service, ble_evt_t * p_ble_evt);
 
 void add_characteristic_to_service(ble_os_t * p_our_service, uint16_t characteristic_uuid, ble_gatts_char_handles_t * handle, uint8_t len_in_bytes, uint8_t notify);
 
+/**@brief Function for adding a characteristic the client writes to (write request) and that notifies back.
+ */
+void add_control_point_to_service(ble_os_t * p_our_service, uint16_t characteristic_uuid, ble_gatts_char_handles_t * handle, uint8_t len_in_bytes);
+
 void set_characteristic_value(uint8_t *p_value, ble_gatts_char_handles_t * handle, uint8_t length);
 
 void notify_characteristic_value(ble_gatts_char_handles_t * handle, uint8_t length, uint16_t * connection_handle);
 
-void set_temperature(ble_os_t * service, temperature_struct *temp, uint16_t * connection_handle);
+/**@brief Function for updating the temperature characteristic, and notifying it if notify is set.
+ */
+void set_temperature(ble_os_t * service, temperature_struct *temp, uint16_t * connection_handle, bool notify);
 
-void set_humidity(ble_os_t * service, temperature_struct *hum, uint16_t * connection_handle);
+/**@brief Function for updating the humidity characteristic, and notifying it if notify is set.
+ */
+void set_humidity(ble_os_t * service, temperature_struct *hum, uint16_t * connection_handle, bool notify);
+
+/**@brief Function for updating the battery characteristic: voltage and days left, little endian.
+ */
+void set_battery(ble_os_t * service, const battery_status_t * p_status, uint16_t * connection_handle);
 
+/**@brief Function for adding an entry to the temperature log, the one given to our_service_init().
+ */
 void set_temperature_log(ble_os_t * service, uint8_t *log, temperature_struct *temp, uint16_t * connection_handle);
 
+/**@brief Function for adding an entry to the humidity log, the one given to our_service_init().
+ */
 void set_humidity_log(ble_os_t * service, uint8_t *log, temperature_struct *temp, uint16_t * connection_handle);
 
+/**@brief Function for updating the log head, after an entry was added to both logs or they were refilled.
+ *
+ * @details The head is the first byte of the logs (the index the next entry goes to) and the number
+ *          of times they went round since the device started, so a client that keeps the head of its
+ *          last read knows which entries are new: turns * (LOG_SIZE - 1) + index - 1 counts the
+ *          entries logged. It reads just those, at their offset in the log characteristics, or nothing
+ *          when the head did not move. A count lower than the client's means the device restarted.
+ *
+ * @param[in]   service             Our Service structure.
+ * @param[in]   log                 The temperature log, whose index both logs share.
+ */
+void set_log_head(ble_os_t * service, const uint8_t *log, uint16_t * connection_handle);
+
+#if POWER_PROFILE_ENABLED
+/**@brief Function for publishing the power profile counters on the debug characteristic.
+ *
+ * @param[in]   service             Our Service structure.
+ * @param[in]   p_profile           Counters to publish.
+ */
+void set_power_profile(ble_os_t * service, const power_profile_t * p_profile);
+#endif
+
 #endif  /* _ OUR_SERVICE_H__ */
@@ -0,0 +1,60 @@
+#include "power_profile.h"
+
+#if POWER_PROFILE_ENABLED
+
+#include "nrf_delay.h"
+
+static power_profile_t m_profile;
+static uint64_t        m_i2c_us_at_begin;
+
+void power_profile_delay_us(uint32_t number_of_us)
+{
+	m_profile.busy_wait_us += number_of_us;
+	nrf_delay_us(number_of_us);
+}
+
+void power_profile_delay_ms(uint32_t number_of_ms)
+{
+	m_profile.busy_wait_us += (uint64_t)number_of_ms * 1000;
+	nrf_delay_ms(number_of_ms);
+}
+
+void power_profile_i2c_delay_us(uint32_t number_of_us)
+{
+	m_profile.i2c_us += number_of_us;
+	power_profile_delay_us(number_of_us);
+}
+
+void power_profile_i2c_add(uint32_t us)
+{
+	m_profile.i2c_us += us;
+}
+
+void power_profile_hfclk_add(uint32_t us)
+{
+	m_profile.hfclk_us += us;
+}
+
+void power_profile_notification(uint16_t length)
+{
+	m_profile.notifications++;
+	m_profile.notification_bytes += length;
+}
+
+void power_profile_measurement_begin(void)
+{
+	m_i2c_us_at_begin = m_profile.i2c_us;
+}
+
+void power_profile_measurement_end(void)
+{
+	m_profile.measurements++;
+	m_profile.i2c_us_last = (uint32_t)(m_profile.i2c_us - m_i2c_us_at_begin);
+}
+
+const power_profile_t * power_profile_get(void)
+{
+	return &m_profile;
+}
+
+#endif // POWER_PROFILE_ENABLED
@@ -0,0 +1,71 @@
+#ifndef POWER_PROFILE_H__
+#define POWER_PROFILE_H__
+
+#include <stdint.h>
+
+/**@brief Set to 0 to compile out the counters and the debug characteristic that exposes them. */
+#ifndef POWER_PROFILE_ENABLED
+#define POWER_PROFILE_ENABLED 1
+#endif
+
+/**@brief Counters describing where the charge goes in the measurement path.
+ *
+ * @details This is also the value of the power profile debug characteristic, little endian and
+ *          without padding. Times are in microseconds since reset.
+ */
+typedef struct
+{
+	uint64_t busy_wait_us;       /**< CPU time spent spinning in DelayMicroSeconds() and nrf_delay_ms(). */
+	uint64_t i2c_us;             /**< SHT2x bus time: busy-waits of the bit-banged bus, or TWI transfer time. */
+	uint64_t hfclk_us;           /**< Time the 16 MHz crystal was kept on for battery measurements. */
+	uint32_t i2c_us_last;        /**< i2c_us of the most recent measurement_start() call. */
+	uint32_t notifications;      /**< Notifications accepted by the SoftDevice. */
+	uint32_t notification_bytes; /**< Payload bytes of those notifications. */
+	uint32_t measurements;       /**< measurement_start() calls. */
+} power_profile_t;
+
+#if POWER_PROFILE_ENABLED
+
+/**@brief Busy-waits like nrf_delay_us() and accounts the time. */
+void power_profile_delay_us(uint32_t number_of_us);
+
+/**@brief Busy-waits like nrf_delay_ms() and accounts the time. */
+void power_profile_delay_ms(uint32_t number_of_ms);
+
+/**@brief Busy-waits on behalf of the I2C driver and accounts the time as bus time. */
+void power_profile_i2c_delay_us(uint32_t number_of_us);
+
+/**@brief Accounts bus time of a transfer done by the TWI peripheral while the CPU slept. */
+void power_profile_i2c_add(uint32_t us);
+
+/**@brief Accounts time the 16 MHz crystal was on. */
+void power_profile_hfclk_add(uint32_t us);
+
+/**@brief Accounts one notification accepted by sd_ble_gatts_hvx(). */
+void power_profile_notification(uint16_t length);
+
+/**@brief Marks the start of a measurement, so its bus time can be reported on its own. */
+void power_profile_measurement_begin(void);
+
+/**@brief Marks the end of a measurement started with @ref power_profile_measurement_begin. */
+void power_profile_measurement_end(void);
+
+/**@brief Returns the current counters. */
+const power_profile_t * power_profile_get(void);
+
+#else
+
+#include "nrf_delay.h"
+
+#define power_profile_delay_us(us)          nrf_delay_us(us)
+#define power_profile_delay_ms(ms)          nrf_delay_ms(ms)
+#define power_profile_i2c_delay_us(us)      nrf_delay_us(us)
+#define power_profile_i2c_add(us)
+#define power_profile_hfclk_add(us)
+#define power_profile_notification(length)
+#define power_profile_measurement_begin()
+#define power_profile_measurement_end()
+
+#endif // POWER_PROFILE_ENABLED
+
+#endif // POWER_PROFILE_H__
@@ -0,0 +1,265 @@
+#include <string.h>
+#include "sht2x_async.h"
+#include "nrf_error.h"
+#include "app_timer.h"
+#include "app_scheduler.h"
+
+typedef enum
+{
+	SHT2X_ASYNC_IDLE,
+	SHT2X_ASYNC_REGISTER,                   /**< User register update running. */
+	SHT2X_ASYNC_TEMPERATURE,                /**< Temperature conversion running. */
+	SHT2X_ASYNC_HUMIDITY                    /**< Humidity conversion running. */
+} sht2x_async_state_t;
+
+static app_timer_id_t        m_timer;
+static uint32_t              m_prescaler;
+static sht2x_async_handler_t m_handler;
+static sht2x_async_state_t   m_state = SHT2X_ASYNC_IDLE;
+static uint8_t               m_retries;
+static sht2x_async_result_t  m_result;
+static uint8_t               m_command[2];  /**< Command, and the value of a user register write. */
+static uint8_t               m_data[3];     /**< Two data bytes and the checksum. */
+static sht2x_async_config_t  m_config;
+static bool                  m_register_pending;    /**< The user register is read, and written if it differs from m_config, before the next measurement. */
+static uint8_t               m_resolution;  /**< Resolution the sensor has, as far as we know. */
+static bool                  m_end_of_battery;
+
+static const i2c_bus_xfer_t  m_trigger_xfer        = { SHT2x_I2C_ADDRESS, m_command, 1, NULL, 0 };
+static const i2c_bus_xfer_t  m_read_xfer           = { SHT2x_I2C_ADDRESS, NULL, 0, m_data, sizeof(m_data) };
+static const i2c_bus_xfer_t  m_register_read_xfer  = { SHT2x_I2C_ADDRESS, m_command, 1, m_data, 2 };
+static const i2c_bus_xfer_t  m_register_write_xfer = { SHT2x_I2C_ADDRESS, m_command, 2, NULL, 0 };
+
+static void trigger_done(uint8_t error, void * p_context);
+static void read_done(uint8_t error, void * p_context);
+static void conversion_start(sht2x_async_state_t state);
+
+static uint32_t timer_start_ms(uint32_t ms)
+{
+	uint32_t ticks = APP_TIMER_TICKS(ms, m_prescaler);
+
+	// The shortest conversions are below what app_timer takes
+	return app_timer_start(m_timer, (ticks < APP_TIMER_MIN_TIMEOUT_TICKS) ? APP_TIMER_MIN_TIMEOUT_TICKS : ticks, NULL);
+}
+
+/**@brief Maximum time of the conversion running with the resolution the sensor has. */
+static uint32_t conversion_ms(void)
+{
+	bool temperature = (m_state == SHT2X_ASYNC_TEMPERATURE);
+
+	switch (m_resolution)
+	{
+		case SHT2x_RES_11_11BIT: return temperature ? 11 : 15;
+		case SHT2x_RES_10_13BIT: return temperature ? 43 : 9;
+		case SHT2x_RES_8_12BIT:  return temperature ? 22 : 4;
+		default:                 return temperature ? 85 : 29;
+	}
+}
+
+static u8t * current_error(void)
+{
+	return (m_state == SHT2X_ASYNC_TEMPERATURE) ? &m_result.temperature_error : &m_result.humidity_error;
+}
+
+/**@brief Reports the result and returns to idle. */
+static void measurement_finish(void)
+{
+	m_state                 = SHT2X_ASYNC_IDLE;
+	m_result.end_of_battery = m_end_of_battery;
+	m_handler(&m_result);
+}
+
+/**@brief Triggers a no hold master conversion. Completion continues in trigger_done(). */
+static void conversion_start(sht2x_async_state_t state)
+{
+	m_state   = state;
+	m_retries = 0;
+	m_command[0] = (state == SHT2X_ASYNC_TEMPERATURE) ? TRIG_T_MEASUREMENT_POLL : TRIG_RH_MEASUREMENT_POLL;
+	if (i2c_bus_xfer(&m_trigger_xfer, trigger_done, NULL) != NRF_SUCCESS)
+	{
+		trigger_done(TIME_OUT_ERROR, NULL);
+	}
+}
+
+/**@brief Moves on to the humidity after the temperature, or finishes. */
+static void conversion_next(void)
+{
+	if (m_state == SHT2X_ASYNC_TEMPERATURE)
+	{
+		// Still try the humidity if the temperature failed, like the blocking driver did.
+		conversion_start(SHT2X_ASYNC_HUMIDITY);
+	}
+	else
+	{
+		measurement_finish();
+	}
+}
+
+static void trigger_done(uint8_t error, void * p_context)
+{
+	if (error == 0)
+	{
+		if (timer_start_ms(conversion_ms()) == NRF_SUCCESS)
+		{
+			return;
+		}
+		error = TIME_OUT_ERROR;
+	}
+	*current_error() = error;
+	conversion_next();
+}
+
+/**@brief Handles the result read. The sensor does not acknowledge its address until the
+ *        conversion is finished, so ACK_ERROR means poll again a bit later. */
+static void read_done(uint8_t error, void * p_context)
+{
+	nt16 * p_value = (m_state == SHT2X_ASYNC_TEMPERATURE) ? &m_result.temperature : &m_result.humidity;
+
+	if ((error == ACK_ERROR) && (m_retries < SHT2X_ASYNC_MAX_RETRIES))
+	{
+		m_retries++;
+		if (timer_start_ms((conversion_ms() + 3) / 4) == NRF_SUCCESS)
+		{
+			return;
+		}
+	}
+	if (error == ACK_ERROR)
+	{
+		error = TIME_OUT_ERROR;
+	}
+	else if (error == 0)
+	{
+		p_value->s16.u8H = m_data[0];
+		p_value->s16.u8L = m_data[1];
+		error = SHT2x_CheckCrc(m_data, 2, m_data[2]);
+	}
+	*current_error() = error;
+	conversion_next();
+}
+
+/**@brief The user register is written, or the update failed: on to the temperature. */
+static void register_write_done(uint8_t error, void * p_context)
+{
+	if (error == 0)
+	{
+		m_resolution       = m_config.resolution;
+		m_register_pending = false;
+	}
+	conversion_start(SHT2X_ASYNC_TEMPERATURE);
+}
+
+/**@brief Writes the settings into the register read, unless it has them already. */
+static void register_read_done(uint8_t error, void * p_context)
+{
+	uint8_t value;
+
+	if ((error != 0) || (SHT2x_CheckCrc(m_data, 1, m_data[1]) != 0))
+	{
+		conversion_start(SHT2X_ASYNC_TEMPERATURE);
+		return;
+	}
+	m_end_of_battery = ((m_data[0] & SHT2x_EOB_MASK) == SHT2x_EOB_ON);
+	m_resolution     = m_data[0] & SHT2x_RES_MASK;
+	value            = (m_data[0] & ~(SHT2x_RES_MASK | SHT2x_HEATER_MASK | SHT2x_EOB_MASK)) |
+	                   m_config.resolution | (m_config.heater ? SHT2x_HEATER_ON : SHT2x_HEATER_OFF);
+	if (value == (m_data[0] & ~SHT2x_EOB_MASK))
+	{
+		m_register_pending = false;
+		conversion_start(SHT2X_ASYNC_TEMPERATURE);
+		return;
+	}
+	m_command[0] = USER_REG_W;
+	m_command[1] = value;
+	if (i2c_bus_xfer(&m_register_write_xfer, register_write_done, NULL) != NRF_SUCCESS)
+	{
+		register_write_done(TIME_OUT_ERROR, NULL);
+	}
+}
+
+/**@brief Fetches a conversion result, in the main loop. */
+static void conversion_read(void * p_event_data, uint16_t event_size)
+{
+	if (m_state == SHT2X_ASYNC_IDLE)
+	{
+		return;
+	}
+	if (i2c_bus_xfer(&m_read_xfer, read_done, NULL) != NRF_SUCCESS)
+	{
+		read_done(TIME_OUT_ERROR, NULL);
+	}
+}
+
+/**@brief The conversion had its time: the bus is left to the main loop, a bit-banged transfer
+ *        would keep the CPU in the timer interrupt for a millisecond. */
+static void conversion_timeout_handler(void * p_context)
+{
+	if (app_sched_event_put(NULL, 0, conversion_read) != NRF_SUCCESS)
+	{
+		read_done(TIME_OUT_ERROR, NULL);
+	}
+}
+
+uint32_t sht2x_async_init(uint32_t app_timer_prescaler, sht2x_async_handler_t handler)
+{
+	m_prescaler        = app_timer_prescaler;
+	m_handler          = handler;
+	m_state            = SHT2X_ASYNC_IDLE;
+	m_resolution       = SHT2x_RES_12_14BIT; // Until read: the slowest, so that no wait is too short
+	m_end_of_battery   = false;
+	m_register_pending = true;
+	sht2x_async_config_default(&m_config);
+	return app_timer_create(&m_timer, APP_TIMER_MODE_SINGLE_SHOT, conversion_timeout_handler);
+}
+
+void sht2x_async_config_default(sht2x_async_config_t * p_config)
+{
+	p_config->resolution = SHT2x_RES_12_14BIT;
+	p_config->heater     = 0;
+}
+
+bool sht2x_async_config_valid(const sht2x_async_config_t * p_config)
+{
+	return ((p_config->resolution & ~SHT2x_RES_MASK) == 0) && (p_config->heater <= 1);
+}
+
+uint32_t sht2x_async_config_set(const sht2x_async_config_t * p_config)
+{
+	if (!sht2x_async_config_valid(p_config))
+	{
+		return NRF_ERROR_INVALID_PARAM;
+	}
+	m_config           = *p_config;
+	m_register_pending = true;
+	return NRF_SUCCESS;
+}
+
+void sht2x_async_status_refresh(void)
+{
+	m_register_pending = true;
+}
+
+uint32_t sht2x_async_start(void)
+{
+	if (m_state != SHT2X_ASYNC_IDLE)
+	{
+		return NRF_ERROR_BUSY;
+	}
+	memset(&m_result, 0, sizeof(m_result));
+	if (!m_register_pending)
+	{
+		conversion_start(SHT2X_ASYNC_TEMPERATURE);
+		return NRF_SUCCESS;
+	}
+	m_state      = SHT2X_ASYNC_REGISTER;
+	m_command[0] = USER_REG_R;
+	if (i2c_bus_xfer(&m_register_read_xfer, register_read_done, NULL) != NRF_SUCCESS)
+	{
+		register_read_done(TIME_OUT_ERROR, NULL);
+	}
+	return NRF_SUCCESS;
+}
+
+bool sht2x_async_busy(void)
+{
+	return (m_state != SHT2X_ASYNC_IDLE);
+}
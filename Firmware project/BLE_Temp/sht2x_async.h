@@ -0,0 +1,93 @@
+#ifndef SHT2X_ASYNC_H__
+#define SHT2X_ASYNC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SHT2x.h"
+
+#define SHT2X_ASYNC_MAX_RETRIES       4     /**< Polls, a quarter of the conversion time apart, before giving up with TIME_OUT_ERROR. */
+
+/**@brief Sensor settings, kept in the SHT2x user register.
+ *
+ * @details The conversions are read after their maximum time for the resolution (SHT21 datasheet):
+ *
+ *          resolution            RH     T      RH + T
+ *          SHT2x_RES_12_14BIT    29     85     114 ms
+ *          SHT2x_RES_11_11BIT    15     11      26 ms
+ *          SHT2x_RES_10_13BIT     9     43      52 ms
+ *          SHT2x_RES_8_12BIT      4     22      26 ms
+ *
+ *          The sensor draws its measuring current for that long, and the readings lose the low bits.
+ *          The temperature characteristic has 0.1 C steps, which 11 bits (0.08 C) still resolve;
+ *          humidity is sent in whole %RH, which 8 bits (0.5 %RH) still resolve.
+ */
+typedef struct
+{
+	uint8_t resolution;                     /**< etSHT2xResolution */
+	uint8_t heater;                         /**< 1 turns the on-chip heater on: a few mA, +0.5 to 1.5 C, for diagnostics only. */
+} sht2x_async_config_t;
+
+/**@brief Result of one temperature and humidity measurement. */
+typedef struct
+{
+	u8t  temperature_error;                 /**< Sensirion etError bits, 0 if temperature is valid. */
+	u8t  humidity_error;                    /**< Sensirion etError bits, 0 if humidity is valid. */
+	nt16 temperature;                       /**< Raw temperature value. */
+	nt16 humidity;                          /**< Raw humidity value. */
+	bool end_of_battery;                    /**< The sensor saw VDD below 2.25 V, as of the last user register read. */
+} sht2x_async_result_t;
+
+/**@brief Called when both conversions of a measurement have finished or failed.
+ *
+ * @details Runs in the main loop (app_scheduler) or the TWI interrupt context, whichever finished
+ *          the last transfer.
+ */
+typedef void (*sht2x_async_handler_t)(const sht2x_async_result_t * p_result);
+
+/**@brief Function for initializing the asynchronous SHT2x driver.
+ *
+ * @details Creates the single-shot app_timer used to wait for conversions, so the I2C bus is only
+ *          touched to trigger a conversion and to fetch its result and the CPU can sleep in between.
+ *          The transfers go through i2c_bus, which must be initialized first, and are started
+ *          from the main loop: sht2x_async_start() is to be called there, and the timeouts pass
+ *          the result reads to it through app_scheduler.
+ *
+ * @param[in]   app_timer_prescaler  Value the app_timer module was initialized with.
+ * @param[in]   handler              Measurement completion handler.
+ *
+ * @return      NRF_SUCCESS, or an error from app_timer_create().
+ */
+uint32_t sht2x_async_init(uint32_t app_timer_prescaler, sht2x_async_handler_t handler);
+
+/**@brief Function for getting the default settings: 12/14 bit, heater off, as the sensor powers up. */
+void sht2x_async_config_default(sht2x_async_config_t * p_config);
+
+/**@brief Function for checking settings. */
+bool sht2x_async_config_valid(const sht2x_async_config_t * p_config);
+
+/**@brief Function for changing the settings.
+ *
+ * @details The user register is read, changed and written back ahead of the next measurement (the
+ *          other bits of the register keep their value). Until then, and when that fails, the
+ *          conversions are waited for as long as the resolution the sensor last had needs; a
+ *          failed update is tried again with the measurement after.
+ *
+ * @return      NRF_SUCCESS, or NRF_ERROR_INVALID_PARAM for bad settings.
+ */
+uint32_t sht2x_async_config_set(const sht2x_async_config_t * p_config);
+
+/**@brief Function for reading the user register again ahead of the next measurement, so that
+ *        end_of_battery in its result is fresh. */
+void sht2x_async_status_refresh(void);
+
+/**@brief Function for starting a temperature and then a humidity conversion.
+ *
+ * @return      NRF_SUCCESS, or NRF_ERROR_BUSY if a measurement is in progress. Bus and timer
+ *              failures are reported in the result.
+ */
+uint32_t sht2x_async_start(void);
+
+/**@brief Function for checking if a measurement is in progress. */
+bool sht2x_async_busy(void);
+
+#endif // SHT2X_ASYNC_H__
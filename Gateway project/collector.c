@@ -0,0 +1,709 @@
+/** @file
+ *
+ * @brief RTemp gateway - collector: connection scheduling and sample decoding.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "collector.h"
+#include "rtemp_log.h"
+#include "store.h"
+
+#define LOG_TEMPERATURE     0
+#define LOG_HUMIDITY        1
+#define BUSY_RETRY_MS       1000            /**< The transport had no link left although the collector had. */
+#define WIND_DOWN_MS        10000           /**< Longest wait for the last disconnections. */
+
+typedef enum
+{
+    SENSOR_IDLE,
+    SENSOR_CONNECTING,
+    SENSOR_SYNCING,
+    SENSOR_LINGERING,
+    SENSOR_DISCONNECTING
+} sensor_state_t;
+
+typedef struct
+{
+    uint8_t            state;               /**< sensor_state_t */
+    uint8_t            pending;             /**< Reads and subscriptions of the sync not done yet. */
+    uint8_t            failures;            /**< Failed syncs in a row. */
+    bool               failed;              /**< Something in the current sync failed. */
+    bool               head_known;          /**< head holds the log head of an earlier sync. */
+    bool               head_read;           /**< The current sync read the log head, into head_now. */
+    rtemp_log_head_t   head;
+    rtemp_log_head_t   head_now;
+    uint16_t           log_new;             /**< Entries of each log the current sync reads. */
+    uint16_t           log_done[2];         /**< Of them, stored so far, empty ones included. */
+    rtemp_log_stream_t logs[2];             /**< Temperature and humidity log, for firmware without the log head. */
+    uint64_t           head_ms;             /**< When the log head was read. */
+    uint64_t           due_ms;
+    uint64_t           connect_ms;          /**< When the connection of the current sync was requested. */
+    uint64_t           linger_until_ms;
+} sensor_t;
+
+typedef struct
+{
+    uint64_t at_ms;
+    uint32_t sensor;
+} deadline_t;
+
+/**@brief Binary heap of deadlines, earliest first; a sensor is at most once in each. */
+typedef struct
+{
+    deadline_t * p_items;
+    uint32_t     count;
+} deadline_heap_t;
+
+static const rtemp_char_t m_sync_reads[] =
+{
+    RTEMP_CHAR_TEMPERATURE,
+    RTEMP_CHAR_HUMIDITY,
+    RTEMP_CHAR_BATTERY_LEVEL,
+    RTEMP_CHAR_LOG_HEAD,
+};
+
+static const rtemp_char_t m_log_chars[2] = {RTEMP_CHAR_TEMP_LOG, RTEMP_CHAR_HUMIDITY_LOG};
+
+static collector_config_t m_config;
+static transport_t      * m_transport;
+static sensor_t         * m_sensors;
+static uint32_t           m_sensor_count;
+static deadline_heap_t    m_due;
+static deadline_heap_t    m_linger;
+static uint32_t           m_links;
+static uint64_t           m_links_changed_ms;
+static collector_stats_t  m_stats;
+
+
+static bool deadline_before(const deadline_t * p_a, const deadline_t * p_b)
+{
+    return (p_a->at_ms < p_b->at_ms) || ((p_a->at_ms == p_b->at_ms) && (p_a->sensor < p_b->sensor));
+}
+
+
+static void heap_push(deadline_heap_t * p_heap, uint64_t at_ms, uint32_t sensor)
+{
+    deadline_t item = {at_ms, sensor};
+    uint32_t   i    = p_heap->count++;
+
+    while ((i > 0) && deadline_before(&item, &p_heap->p_items[(i - 1) / 2]))
+    {
+        p_heap->p_items[i] = p_heap->p_items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    p_heap->p_items[i] = item;
+}
+
+
+static deadline_t heap_pop(deadline_heap_t * p_heap)
+{
+    deadline_t top  = p_heap->p_items[0];
+    deadline_t last = p_heap->p_items[--p_heap->count];
+    uint32_t   i    = 0;
+    uint32_t   child;
+
+    for (;;)
+    {
+        child = 2 * i + 1;
+        if (child >= p_heap->count)
+        {
+            break;
+        }
+        if ((child + 1 < p_heap->count) && deadline_before(&p_heap->p_items[child + 1], &p_heap->p_items[child]))
+        {
+            child++;
+        }
+        if (!deadline_before(&p_heap->p_items[child], &last))
+        {
+            break;
+        }
+        p_heap->p_items[i] = p_heap->p_items[child];
+        i = child;
+    }
+    p_heap->p_items[i] = last;
+    return top;
+}
+
+
+static uint64_t now_ms(void)
+{
+    return m_transport->now_ms(m_transport);
+}
+
+
+static void links_change(int delta)
+{
+    uint64_t now = now_ms();
+
+    m_stats.link_ms    += (uint64_t)m_links * (now - m_links_changed_ms);
+    m_links_changed_ms  = now;
+    m_links             = (uint32_t)((int)m_links + delta);
+    if (m_links > m_stats.links_max)
+    {
+        m_stats.links_max = m_links;
+    }
+}
+
+
+/**@brief Puts a sensor back in line: a period after its sync started, or a backoff after failures. */
+static void sensor_reschedule(uint32_t index)
+{
+    sensor_t * p_sensor = &m_sensors[index];
+    uint64_t   now      = now_ms();
+    uint64_t   delay_ms;
+
+    p_sensor->state = SENSOR_IDLE;
+    if (p_sensor->failures > 0)
+    {
+        delay_ms = (uint64_t)m_config.retry_s * 1000;
+        delay_ms <<= (p_sensor->failures < 16) ? p_sensor->failures - 1 : 15;
+        if (delay_ms > (uint64_t)m_config.period_s * 1000)
+        {
+            delay_ms = (uint64_t)m_config.period_s * 1000;
+        }
+        p_sensor->due_ms = now + delay_ms;
+    }
+    else
+    {
+        p_sensor->due_ms = p_sensor->connect_ms + (uint64_t)m_config.period_s * 1000;
+        if (p_sensor->due_ms < now)
+        {
+            p_sensor->due_ms = now;
+        }
+    }
+    heap_push(&m_due, p_sensor->due_ms, index);
+}
+
+
+static void sensor_disconnect(uint32_t index)
+{
+    m_sensors[index].state = SENSOR_DISCONNECTING;
+    if (m_transport->disconnect(m_transport, index) != TRANSPORT_OK)
+    {
+        // Already gone, no disconnected event will come
+        links_change(-1);
+        sensor_reschedule(index);
+    }
+}
+
+
+static void sync_failed(uint32_t index)
+{
+    m_stats.failures++;
+    if (m_sensors[index].failures < UINT8_MAX)
+    {
+        m_sensors[index].failures++;
+    }
+}
+
+
+/**@brief The last read or subscription of a sync is done. */
+static void sync_end(uint32_t index)
+{
+    sensor_t * p_sensor = &m_sensors[index];
+    uint64_t   sync_ms  = now_ms() - p_sensor->connect_ms;
+
+    if (p_sensor->head_read &&
+        ((p_sensor->log_done[LOG_TEMPERATURE] != p_sensor->log_new) || (p_sensor->log_done[LOG_HUMIDITY] != p_sensor->log_new)))
+    {
+        p_sensor->failed = true; // A part came short
+    }
+    if (p_sensor->failed)
+    {
+        sync_failed(index);
+        sensor_disconnect(index);
+        return;
+    }
+    m_stats.syncs++;
+    m_stats.sync_ms_total += sync_ms;
+    if (sync_ms > m_stats.sync_ms_max)
+    {
+        m_stats.sync_ms_max = sync_ms;
+    }
+    p_sensor->failures = 0;
+    if (p_sensor->head_read)
+    {
+        // The next sync reads from here on
+        p_sensor->head       = p_sensor->head_now;
+        p_sensor->head_known = true;
+    }
+    if (m_config.linger_s > 0)
+    {
+        p_sensor->state           = SENSOR_LINGERING;
+        p_sensor->linger_until_ms = now_ms() + (uint64_t)m_config.linger_s * 1000;
+        heap_push(&m_linger, p_sensor->linger_until_ms, index);
+        return;
+    }
+    sensor_disconnect(index);
+}
+
+
+/**@brief Stores the entries a log gained since it was last read whole. */
+static void log_store(uint32_t index, uint8_t log, const uint8_t * p_data, uint16_t len)
+{
+    uint64_t     now = now_ms();
+    uint8_t      entries[RTEMP_LOG_ENTRIES];
+    int16_t      values[RTEMP_LOG_ENTRIES];
+    uint16_t     count;
+    uint16_t     i;
+    const char * p_name;
+
+    if (len != RTEMP_LOG_SIZE)
+    {
+        m_sensors[index].failed = true;
+        return;
+    }
+    count = rtemp_log_stream_feed(&m_sensors[index].logs[log], p_data, now, entries);
+    if (log == LOG_TEMPERATURE)
+    {
+        p_name = rtemp_char_info(RTEMP_CHAR_TEMP_LOG)->p_name;
+        rtemp_log_decode(RTEMP_LOG_TEMPERATURE, entries, count, values);
+    }
+    else
+    {
+        p_name = rtemp_char_info(RTEMP_CHAR_HUMIDITY_LOG)->p_name;
+        rtemp_log_decode(RTEMP_LOG_HUMIDITY, entries, count, values);
+    }
+    for (i = 0; i < count; i++)
+    {
+        store_sample(now - (uint64_t)(count - 1 - i) * RTEMP_LOG_PERIOD_S * 1000,
+                     m_transport->device_address(m_transport, index), p_name,
+                     (log == LOG_TEMPERATURE) ? values[i] / 2.0 : values[i]);
+    }
+    m_stats.log_entries += count;
+}
+
+
+/**@brief Stores a run of the entries a log gained since the last sync, see logs_read(). */
+static void log_part_store(uint32_t index, uint8_t log, const uint8_t * p_data, uint16_t len)
+{
+    sensor_t   * p_sensor = &m_sensors[index];
+    int16_t      values[RTEMP_LOG_ENTRIES];
+    uint16_t     age;
+    uint16_t     i;
+    const char * p_name   = rtemp_char_info(m_log_chars[log])->p_name;
+
+    if (!p_sensor->head_read || (len > p_sensor->log_new - p_sensor->log_done[log]))
+    {
+        p_sensor->failed = true;
+        return;
+    }
+    rtemp_log_decode((log == LOG_TEMPERATURE) ? RTEMP_LOG_TEMPERATURE : RTEMP_LOG_HUMIDITY, p_data, len, values);
+    for (i = 0; i < len; i++)
+    {
+        // Empty entries are the oldest, of a log that did not go round yet
+        age = (uint16_t)(p_sensor->log_new - 1 - p_sensor->log_done[log] - i);
+        if (values[i] != RTEMP_LOG_NONE)
+        {
+            store_sample(p_sensor->head_ms - (uint64_t)age * RTEMP_LOG_PERIOD_S * 1000,
+                         m_transport->device_address(m_transport, index), p_name,
+                         (log == LOG_TEMPERATURE) ? values[i] / 2.0 : values[i]);
+            m_stats.log_entries++;
+        }
+    }
+    p_sensor->log_done[log] += len;
+}
+
+
+/**@brief Queues the reads of the log entries added since the last sync, from the log head just
+ *        read: none when the head did not move, at most two runs of each log otherwise.
+ */
+static void logs_read(uint32_t index)
+{
+    sensor_t       * p_sensor = &m_sensors[index];
+    rtemp_log_part_t parts[2];
+    uint8_t          count;
+    uint8_t          log;
+    uint8_t          i;
+
+    p_sensor->log_new = rtemp_log_head_new(&p_sensor->head_now, p_sensor->head_known ? &p_sensor->head : NULL);
+    count             = rtemp_log_head_parts(&p_sensor->head_now, p_sensor->log_new, parts);
+    for (log = LOG_TEMPERATURE; log <= LOG_HUMIDITY; log++)
+    {
+        p_sensor->log_done[log] = 0;
+        for (i = 0; i < count; i++)
+        {
+            if (m_transport->read_part(m_transport, index, m_log_chars[log], parts[i].offset, parts[i].len) == TRANSPORT_OK)
+            {
+                p_sensor->pending++;
+            }
+            else
+            {
+                p_sensor->failed = true;
+            }
+        }
+    }
+}
+
+
+/**@brief Queues whole reads of both logs, for firmware without the log head. */
+static void logs_read_whole(uint32_t index)
+{
+    uint8_t log;
+
+    for (log = LOG_TEMPERATURE; log <= LOG_HUMIDITY; log++)
+    {
+        if (m_transport->read(m_transport, index, m_log_chars[log]) == TRANSPORT_OK)
+        {
+            m_sensors[index].pending++;
+        }
+        else
+        {
+            m_sensors[index].failed = true;
+        }
+    }
+}
+
+
+/**@brief Decodes and stores a value. */
+static bool value_store(uint32_t index, rtemp_char_t characteristic, const uint8_t * p_data, uint16_t len)
+{
+    const char * p_address = m_transport->device_address(m_transport, index);
+    const char * p_name    = rtemp_char_info(characteristic)->p_name;
+    int16_t      temperature;
+    uint8_t      humidity;
+
+    switch (characteristic)
+    {
+        case RTEMP_CHAR_TEMPERATURE:
+            if (!rtemp_temperature_decode(p_data, len, &temperature))
+            {
+                return false;
+            }
+            store_sample(now_ms(), p_address, p_name, temperature / 10.0);
+            return true;
+
+        case RTEMP_CHAR_HUMIDITY:
+            if (!rtemp_humidity_decode(p_data, len, &humidity))
+            {
+                return false;
+            }
+            store_sample(now_ms(), p_address, p_name, humidity);
+            return true;
+
+        case RTEMP_CHAR_BATTERY_LEVEL:
+            if (len != 1)
+            {
+                return false;
+            }
+            store_sample(now_ms(), p_address, p_name, p_data[0]);
+            return true;
+
+        case RTEMP_CHAR_TEMP_LOG:
+            log_store(index, LOG_TEMPERATURE, p_data, len);
+            return true;
+
+        case RTEMP_CHAR_HUMIDITY_LOG:
+            log_store(index, LOG_HUMIDITY, p_data, len);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+static void on_connected(void * p_context, uint32_t device, int status)
+{
+    sensor_t * p_sensor = &m_sensors[device];
+    uint32_t   i;
+
+    if (p_sensor->state != SENSOR_CONNECTING)
+    {
+        return;
+    }
+    if (status != TRANSPORT_OK)
+    {
+        links_change(-1);
+        sync_failed(device);
+        sensor_reschedule(device);
+        return;
+    }
+
+    // Everything at once: the transport runs it back to back
+    p_sensor->state     = SENSOR_SYNCING;
+    p_sensor->failed    = false;
+    p_sensor->head_read = false;
+    p_sensor->pending   = 0;
+    for (i = 0; i < sizeof(m_sync_reads) / sizeof(m_sync_reads[0]); i++)
+    {
+        if (m_transport->read(m_transport, device, m_sync_reads[i]) == TRANSPORT_OK)
+        {
+            p_sensor->pending++;
+        }
+        else
+        {
+            p_sensor->failed = true;
+        }
+    }
+    if (m_config.linger_s > 0)
+    {
+        p_sensor->pending += (m_transport->subscribe(m_transport, device, RTEMP_CHAR_TEMPERATURE) == TRANSPORT_OK);
+        p_sensor->pending += (m_transport->subscribe(m_transport, device, RTEMP_CHAR_HUMIDITY) == TRANSPORT_OK);
+    }
+    if (p_sensor->pending == 0)
+    {
+        sync_end(device);
+    }
+}
+
+
+static void on_disconnected(void * p_context, uint32_t device, int reason)
+{
+    sensor_t * p_sensor = &m_sensors[device];
+
+    if (p_sensor->state == SENSOR_IDLE)
+    {
+        return;
+    }
+    if ((p_sensor->state == SENSOR_SYNCING) || (p_sensor->state == SENSOR_CONNECTING))
+    {
+        sync_failed(device); // Lost before the sync was done
+    }
+    links_change(-1);
+    sensor_reschedule(device);
+}
+
+
+static void on_read_done(void * p_context, uint32_t device, rtemp_char_t characteristic, int status,
+                         uint16_t offset, const uint8_t * p_data, uint16_t len)
+{
+    sensor_t * p_sensor = &m_sensors[device];
+
+    if (p_sensor->state != SENSOR_SYNCING)
+    {
+        return;
+    }
+    if (characteristic == RTEMP_CHAR_LOG_HEAD)
+    {
+        // The log reads it queues keep the sync going
+        if ((status == TRANSPORT_OK) && rtemp_log_head_decode(p_data, len, &p_sensor->head_now))
+        {
+            p_sensor->head_read = true;
+            p_sensor->head_ms   = now_ms();
+            logs_read(device);
+        }
+        else if (status == TRANSPORT_ERROR_GATT)
+        {
+            logs_read_whole(device); // Older firmware
+        }
+        else
+        {
+            p_sensor->failed = true;
+        }
+    }
+    else if (status != TRANSPORT_OK)
+    {
+        p_sensor->failed = true;
+    }
+    else if (offset != 0)
+    {
+        log_part_store(device, (characteristic == RTEMP_CHAR_TEMP_LOG) ? LOG_TEMPERATURE : LOG_HUMIDITY, p_data, len);
+    }
+    else if (!value_store(device, characteristic, p_data, len))
+    {
+        p_sensor->failed = true;
+    }
+    if (--p_sensor->pending == 0)
+    {
+        sync_end(device);
+    }
+}
+
+
+static void on_subscribed(void * p_context, uint32_t device, rtemp_char_t characteristic, int status)
+{
+    sensor_t * p_sensor = &m_sensors[device];
+
+    if (p_sensor->state != SENSOR_SYNCING)
+    {
+        return;
+    }
+    if (status != TRANSPORT_OK)
+    {
+        p_sensor->failed = true;
+    }
+    if (--p_sensor->pending == 0)
+    {
+        sync_end(device);
+    }
+}
+
+
+static void on_notification(void * p_context, uint32_t device, rtemp_char_t characteristic,
+                            const uint8_t * p_data, uint16_t len)
+{
+    uint8_t state = m_sensors[device].state;
+
+    if (((state == SENSOR_SYNCING) || (state == SENSOR_LINGERING)) && value_store(device, characteristic, p_data, len))
+    {
+        m_stats.notifications++;
+    }
+}
+
+
+static const transport_handlers_t m_handlers =
+{
+    .connected    = on_connected,
+    .disconnected = on_disconnected,
+    .read_done    = on_read_done,
+    .subscribed   = on_subscribed,
+    .notification = on_notification,
+};
+
+
+const transport_handlers_t * collector_transport_handlers(void)
+{
+    return &m_handlers;
+}
+
+
+bool collector_init(const collector_config_t * p_config, transport_t * p_transport)
+{
+    uint64_t now;
+    uint32_t i;
+
+    if ((p_config->max_links == 0) || (p_config->period_s == 0) || (p_config->retry_s == 0))
+    {
+        return false;
+    }
+    m_config       = *p_config;
+    m_transport    = p_transport;
+    m_sensor_count = p_transport->device_count(p_transport);
+    m_sensors      = calloc(m_sensor_count ? m_sensor_count : 1, sizeof(sensor_t));
+    m_due.p_items    = calloc(m_sensor_count ? m_sensor_count : 1, sizeof(deadline_t));
+    m_linger.p_items = calloc(m_sensor_count ? m_sensor_count : 1, sizeof(deadline_t));
+    m_due.count    = 0;
+    m_linger.count = 0;
+    m_links        = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+    if ((m_sensors == NULL) || (m_due.p_items == NULL) || (m_linger.p_items == NULL))
+    {
+        collector_uninit();
+        return false;
+    }
+
+    now                = now_ms();
+    m_links_changed_ms = now;
+    for (i = 0; i < m_sensor_count; i++)
+    {
+        m_sensors[i].due_ms = now;
+        rtemp_log_stream_init(&m_sensors[i].logs[LOG_TEMPERATURE]);
+        rtemp_log_stream_init(&m_sensors[i].logs[LOG_HUMIDITY]);
+        heap_push(&m_due, now, i);
+    }
+    return true;
+}
+
+
+static void lingers_expire(uint64_t now)
+{
+    deadline_t item;
+
+    while ((m_linger.count > 0) && (m_linger.p_items[0].at_ms <= now))
+    {
+        item = heap_pop(&m_linger);
+        if ((m_sensors[item.sensor].state == SENSOR_LINGERING) && (m_sensors[item.sensor].linger_until_ms == item.at_ms))
+        {
+            sensor_disconnect(item.sensor);
+        }
+    }
+}
+
+
+static void connections_start(uint64_t now)
+{
+    deadline_t item;
+    sensor_t * p_sensor;
+    uint64_t   late_ms;
+    int        err;
+
+    while ((m_links < m_config.max_links) && (m_due.count > 0) && (m_due.p_items[0].at_ms <= now))
+    {
+        item     = heap_pop(&m_due);
+        p_sensor = &m_sensors[item.sensor];
+        err      = m_transport->connect(m_transport, item.sensor);
+        if (err == TRANSPORT_ERROR_BUSY)
+        {
+            heap_push(&m_due, now + BUSY_RETRY_MS, item.sensor);
+            break;
+        }
+        p_sensor->connect_ms = now;
+        if (err != TRANSPORT_OK)
+        {
+            sync_failed(item.sensor);
+            sensor_reschedule(item.sensor);
+            continue;
+        }
+        p_sensor->state = SENSOR_CONNECTING;
+        links_change(1);
+        late_ms               = now - p_sensor->due_ms;
+        m_stats.late_ms_total += late_ms;
+        if (late_ms > m_stats.late_ms_max)
+        {
+            m_stats.late_ms_max = late_ms;
+        }
+    }
+}
+
+
+void collector_run(uint64_t until_ms, volatile bool * p_stop)
+{
+    uint64_t start = now_ms();
+    uint64_t now   = start;
+    uint64_t deadline;
+    uint32_t i;
+
+    while (((p_stop == NULL) || !*p_stop) && (now < until_ms))
+    {
+        lingers_expire(now);
+        connections_start(now);
+
+        deadline = until_ms;
+        if ((m_links < m_config.max_links) && (m_due.count > 0) && (m_due.p_items[0].at_ms < deadline))
+        {
+            deadline = m_due.p_items[0].at_ms;
+        }
+        if ((m_linger.count > 0) && (m_linger.p_items[0].at_ms < deadline))
+        {
+            deadline = m_linger.p_items[0].at_ms;
+        }
+        m_transport->poll(m_transport, deadline);
+        now = now_ms();
+    }
+
+    // Leave no connection behind
+    for (i = 0; i < m_sensor_count; i++)
+    {
+        if ((m_sensors[i].state == SENSOR_CONNECTING) || (m_sensors[i].state == SENSOR_SYNCING) ||
+            (m_sensors[i].state == SENSOR_LINGERING))
+        {
+            sensor_disconnect(i);
+        }
+    }
+    deadline = now_ms() + WIND_DOWN_MS;
+    while ((m_links > 0) && (now_ms() < deadline))
+    {
+        m_transport->poll(m_transport, deadline);
+    }
+    links_change(0);
+    m_stats.elapsed_ms += now_ms() - start;
+}
+
+
+const collector_stats_t * collector_stats(void)
+{
+    return &m_stats;
+}
+
+
+void collector_uninit(void)
+{
+    free(m_sensors);
+    free(m_due.p_items);
+    free(m_linger.p_items);
+    m_sensors        = NULL;
+    m_due.p_items    = NULL;
+    m_linger.p_items = NULL;
+    m_sensor_count   = 0;
+}
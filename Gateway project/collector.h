@@ -0,0 +1,68 @@
+/** @file
+ *
+ * @brief RTemp gateway - collector.
+ *
+ * Keeps every sensor of a transport synced: a sensor is due period_s after its last sync
+ * started, and the due sensors are connected to, most overdue first, on up to max_links
+ * connections at once. A sync queues all its reads at once (current temperature, humidity,
+ * battery level and the log head) and stores what they return. The log head tells how many
+ * entries the logs gained since the previous sync, and only those are read, at their offsets;
+ * sensors without it have both logs read whole and the new entries picked by time. With linger_s set it also enables temperature and humidity
+ * notifications and stays connected that long, storing every notification. A failed sync is
+ * retried after retry_s, doubled with every failure in a row up to period_s.
+ *
+ * Log entries carry no time of their own: the newest is stored at the time of the read, each
+ * older one RTEMP_LOG_PERIOD_S before the next, so their times are right to within a period.
+ */
+#ifndef COLLECTOR_H__
+#define COLLECTOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "transport.h"
+
+typedef struct
+{
+    uint32_t max_links;                     /**< Connections at once. */
+    uint32_t period_s;                      /**< Between two syncs of a sensor. */
+    uint32_t linger_s;                      /**< Stay connected for notifications after a sync, 0 not to. */
+    uint32_t retry_s;                       /**< After a first failure. */
+} collector_config_t;
+
+typedef struct
+{
+    uint64_t syncs;                         /**< Completed. */
+    uint64_t failures;                      /**< Connection attempts that failed, errors and lost links. */
+    uint64_t notifications;
+    uint64_t log_entries;                   /**< New log entries stored. */
+    uint64_t sync_ms_total;                 /**< Connection request to the last read, over all syncs. */
+    uint64_t sync_ms_max;
+    uint64_t late_ms_total;                 /**< Connection request after the sensor was due. */
+    uint64_t late_ms_max;
+    uint64_t link_ms;                       /**< Connections held, times their duration. */
+    uint64_t elapsed_ms;                    /**< Time collector_run() ran. */
+    uint32_t links_max;
+} collector_stats_t;
+
+/**@brief Function for getting the handlers to create the transport with. */
+const transport_handlers_t * collector_transport_handlers(void);
+
+/**@brief Function for initializing the collector: every sensor is due at once.
+ *
+ * @return      false if the configuration is invalid or memory runs out.
+ */
+bool collector_init(const collector_config_t * p_config, transport_t * p_transport);
+
+/**@brief Function for collecting until a time, or until *p_stop is set.
+ *
+ * @details Connections still open at the end are disconnected.
+ */
+void collector_run(uint64_t until_ms, volatile bool * p_stop);
+
+/**@brief Function for getting the statistics. */
+const collector_stats_t * collector_stats(void);
+
+/**@brief Function for freeing the collector. */
+void collector_uninit(void);
+
+#endif // COLLECTOR_H__
@@ -0,0 +1,182 @@
+/** @file
+ *
+ * @brief RTemp gateway - collector daemon.
+ *
+ * Runs the collector over a transport until the given time is over or SIGINT/SIGTERM, then
+ * prints its statistics. Only the simulated transport is built in: --mock N sensors run the
+ * firmware's our_service.c in this process on a virtual clock, which turns days of collecting
+ * into seconds of CPU.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "collector.h"
+#include "store.h"
+#include "transport.h"
+
+static volatile bool m_stop;
+
+
+static void on_signal(int signal)
+{
+    m_stop = true;
+}
+
+
+static void usage(const char * p_name)
+{
+    fprintf(stderr,
+            "usage: %s --mock N [options]\n"
+            "  --mock N            collect from N simulated sensors\n"
+            "  --links N           connections at once (default 8)\n"
+            "  --period N          seconds between two syncs of a sensor (default 3600)\n"
+            "  --linger N          stay connected N seconds for notifications after a sync (default 0)\n"
+            "  --retry N           seconds before the first retry of a failed sync (default 30)\n"
+            "  --hours N           collect for N hours (default 24)\n"
+            "  --store FILE        append the samples to FILE as CSV (default: only count them)\n"
+            "  --interval-ms N     connection interval (default 30)\n"
+            "  --adv-ms N          advertising interval of the sensors (default 1000)\n"
+            "  --fail N            percentage of connection attempts that time out (default 0)\n"
+            "  --seed N            seed of the simulated sensors (default 1)\n",
+            p_name);
+}
+
+
+static void report(const collector_stats_t * p_stats, uint32_t links, double wall_s)
+{
+    double hours = p_stats->elapsed_ms / 3600000.0;
+
+    printf("collected for %.2f h\n", hours);
+    printf("  syncs          %llu (%.1f/h), %llu failures\n", (unsigned long long)p_stats->syncs,
+           hours > 0 ? p_stats->syncs / hours : 0.0, (unsigned long long)p_stats->failures);
+    printf("  samples        %llu, %llu of them log entries, %llu notifications\n",
+           (unsigned long long)store_samples(), (unsigned long long)p_stats->log_entries,
+           (unsigned long long)p_stats->notifications);
+    if (p_stats->syncs > 0)
+    {
+        printf("  sync time      mean %.0f ms, max %llu ms\n", (double)p_stats->sync_ms_total / p_stats->syncs,
+               (unsigned long long)p_stats->sync_ms_max);
+        printf("  lateness       mean %.0f ms, max %llu ms\n",
+               (double)p_stats->late_ms_total / (p_stats->syncs + p_stats->failures),
+               (unsigned long long)p_stats->late_ms_max);
+    }
+    if (p_stats->elapsed_ms > 0)
+    {
+        printf("  links          %.1f%% of %u in use, at most %u\n",
+               100.0 * p_stats->link_ms / ((double)p_stats->elapsed_ms * links), links, p_stats->links_max);
+    }
+    printf("  wall clock     %.2f s\n", wall_s);
+}
+
+
+int main(int argc, char * argv[])
+{
+    collector_config_t       config  = {8, 3600, 0, 30};
+    transport_mock_options_t options = {0, 0, 30, 1000, 4000, 0, 1};
+    const char             * p_store = NULL;
+    double                   hours   = 24;
+    transport_t            * p_transport;
+    clock_t                  wall_start;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char * p_arg   = argv[i];
+        const char * p_value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (p_value == NULL)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+        if (strcmp(p_arg, "--mock") == 0)
+        {
+            options.devices = (uint32_t)strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--links") == 0)
+        {
+            config.max_links = (uint32_t)strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--period") == 0)
+        {
+            config.period_s = (uint32_t)strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--linger") == 0)
+        {
+            config.linger_s = (uint32_t)strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--retry") == 0)
+        {
+            config.retry_s = (uint32_t)strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--hours") == 0)
+        {
+            hours = atof(p_value);
+        }
+        else if (strcmp(p_arg, "--store") == 0)
+        {
+            p_store = p_value;
+        }
+        else if (strcmp(p_arg, "--interval-ms") == 0)
+        {
+            options.conn_interval_ms = (uint32_t)strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--adv-ms") == 0)
+        {
+            options.adv_interval_ms = (uint32_t)strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--fail") == 0)
+        {
+            options.fail_percent = (uint32_t)strtoul(p_value, NULL, 0);
+        }
+        else if (strcmp(p_arg, "--seed") == 0)
+        {
+            options.seed = (uint32_t)strtoul(p_value, NULL, 0);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.devices == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    options.max_links = config.max_links;
+
+    p_transport = transport_mock_create(&options, collector_transport_handlers(), NULL);
+    if (p_transport == NULL)
+    {
+        fprintf(stderr, "cannot create the %u sensors\n", options.devices);
+        return 1;
+    }
+    if (!collector_init(&config, p_transport))
+    {
+        fprintf(stderr, "invalid collector configuration\n");
+        p_transport->destroy(p_transport);
+        return 1;
+    }
+    if (!store_open(p_store))
+    {
+        fprintf(stderr, "cannot open %s\n", p_store);
+        collector_uninit();
+        p_transport->destroy(p_transport);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    wall_start = clock();
+    collector_run(p_transport->now_ms(p_transport) + (uint64_t)(hours * 3600000.0), &m_stop);
+    report(collector_stats(), config.max_links, (double)(clock() - wall_start) / CLOCKS_PER_SEC);
+
+    store_close();
+    collector_uninit();
+    p_transport->destroy(p_transport);
+    return 0;
+}
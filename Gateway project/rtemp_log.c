@@ -0,0 +1,195 @@
+/** @file
+ *
+ * @brief RTemp gateway - decoding of the legacy temperature and humidity logs.
+ */
+#include <stddef.h>
+#include "rtemp_log.h"
+
+#define LOG_PERIOD_MS       ((uint64_t)RTEMP_LOG_PERIOD_S * 1000)
+#define LOG_TURN_MS         (LOG_PERIOD_MS * RTEMP_LOG_ENTRIES)
+
+
+/**@brief Position of a write index in the entries, 0 based. */
+static uint16_t log_position(uint8_t index)
+{
+    return ((index < 1) || (index >= RTEMP_LOG_SIZE)) ? 0 : (uint16_t)(index - 1);
+}
+
+
+/**@brief Temperature entry to 0.5 C without a branch, so that the batch loops vectorize. */
+static inline int16_t temperature_half_degrees(uint8_t entry)
+{
+    int16_t whole = entry & 0x3F;
+    int16_t sign  = -(int16_t)(entry >> 7); // 0 or -1
+
+    return (int16_t)(((whole ^ sign) - sign) * 2 + ((entry >> 6) & 1));
+}
+
+
+/**@brief Decodes a run of entries; the kind is tested once, outside the loops. */
+static void decode_run(rtemp_log_kind_t kind, const uint8_t * restrict p_entries, uint32_t count,
+                       int16_t * restrict p_values)
+{
+    uint32_t i;
+
+    if (kind == RTEMP_LOG_TEMPERATURE)
+    {
+        for (i = 0; i < count; i++)
+        {
+            int16_t value = temperature_half_degrees(p_entries[i]);
+
+            p_values[i] = (p_entries[i] == RTEMP_LOG_EMPTY) ? RTEMP_LOG_NONE : value;
+        }
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
+        {
+            p_values[i] = (p_entries[i] == RTEMP_LOG_EMPTY) ? RTEMP_LOG_NONE : (int16_t)p_entries[i];
+        }
+    }
+}
+
+
+int16_t rtemp_log_temperature_decode(uint8_t entry)
+{
+    return temperature_half_degrees(entry);
+}
+
+
+uint16_t rtemp_log_unroll(const uint8_t * p_log, uint16_t newest, uint8_t * p_entries)
+{
+    uint16_t i     = (uint16_t)((log_position(p_log[0]) + RTEMP_LOG_ENTRIES - newest) % RTEMP_LOG_ENTRIES);
+    uint16_t count = 0;
+    uint16_t n;
+
+    // Empty entries can only be the oldest ones, of a log that did not go round yet
+    for (n = 0; n < newest; n++)
+    {
+        if (p_log[1 + i] != RTEMP_LOG_EMPTY)
+        {
+            p_entries[count++] = p_log[1 + i];
+        }
+        i = (i + 1 == RTEMP_LOG_ENTRIES) ? 0 : i + 1;
+    }
+    return count;
+}
+
+
+void rtemp_log_stream_init(rtemp_log_stream_t * p_stream)
+{
+    p_stream->index   = 0;
+    p_stream->read_ms = 0;
+}
+
+
+uint16_t rtemp_log_stream_feed(rtemp_log_stream_t * p_stream, const uint8_t * p_log, uint64_t read_ms,
+                               uint8_t * p_entries)
+{
+    uint64_t added = RTEMP_LOG_ENTRIES;
+    uint64_t moved_ms;
+    uint64_t elapsed_ms;
+    uint16_t moved;
+
+    if (p_stream->index != 0)
+    {
+        // Entries added: how far the index moved plus the whole turns of the ring closest to
+        // the time that passed
+        moved      = (uint16_t)((log_position(p_log[0]) + RTEMP_LOG_ENTRIES - log_position(p_stream->index))
+                                % RTEMP_LOG_ENTRIES);
+        moved_ms   = moved * LOG_PERIOD_MS;
+        elapsed_ms = (read_ms > p_stream->read_ms) ? read_ms - p_stream->read_ms : 0;
+        added      = moved;
+        if (elapsed_ms > moved_ms)
+        {
+            added += (elapsed_ms - moved_ms + LOG_TURN_MS / 2) / LOG_TURN_MS * RTEMP_LOG_ENTRIES;
+        }
+    }
+    p_stream->index   = p_log[0];
+    p_stream->read_ms = read_ms;
+    return rtemp_log_unroll(p_log, (added > RTEMP_LOG_ENTRIES) ? RTEMP_LOG_ENTRIES : (uint16_t)added, p_entries);
+}
+
+
+bool rtemp_log_head_decode(const uint8_t * p_data, uint16_t len, rtemp_log_head_t * p_head)
+{
+    // Index, then the turns as a little endian uint16
+    if ((len != RTEMP_LOG_HEAD_SIZE) || (p_data[0] < 1))
+    {
+        return false;
+    }
+    p_head->index = p_data[0];
+    p_head->turns = (uint16_t)(p_data[1] | (p_data[2] << 8));
+    return true;
+}
+
+
+uint32_t rtemp_log_head_count(const rtemp_log_head_t * p_head)
+{
+    return (uint32_t)p_head->turns * RTEMP_LOG_ENTRIES + p_head->index - 1;
+}
+
+
+uint16_t rtemp_log_head_new(const rtemp_log_head_t * p_head, const rtemp_log_head_t * p_since)
+{
+    uint32_t count = rtemp_log_head_count(p_head);
+    uint32_t since;
+
+    if (p_since == NULL)
+    {
+        return RTEMP_LOG_ENTRIES;
+    }
+    since = rtemp_log_head_count(p_since);
+    if ((count < since) || (count - since > RTEMP_LOG_ENTRIES))
+    {
+        return RTEMP_LOG_ENTRIES;
+    }
+    return (uint16_t)(count - since);
+}
+
+
+uint8_t rtemp_log_head_parts(const rtemp_log_head_t * p_head, uint16_t newest, rtemp_log_part_t p_parts[2])
+{
+    uint16_t next  = log_position(p_head->index);
+    uint16_t first = (uint16_t)((next + RTEMP_LOG_ENTRIES - newest) % RTEMP_LOG_ENTRIES);
+
+    if (newest == 0)
+    {
+        return 0;
+    }
+    // The entries are at 1 + their position; newest ones that wrap are two runs
+    p_parts[0].offset = (uint16_t)(1 + first);
+    if (first + newest <= RTEMP_LOG_ENTRIES)
+    {
+        p_parts[0].len = newest;
+        return 1;
+    }
+    p_parts[0].len    = (uint16_t)(RTEMP_LOG_ENTRIES - first);
+    p_parts[1].offset = 1;
+    p_parts[1].len    = (uint16_t)(newest - p_parts[0].len);
+    return 2;
+}
+
+
+void rtemp_log_decode(rtemp_log_kind_t kind, const uint8_t * p_entries, uint32_t count, int16_t * p_values)
+{
+    decode_run(kind, p_entries, count, p_values);
+}
+
+
+void rtemp_log_decode_batch(rtemp_log_kind_t kind, const uint8_t * p_logs, uint32_t log_count, int16_t * p_values)
+{
+    uint32_t l;
+    uint16_t next;
+
+    // The ring unrolls into two straight runs: from the next write position to the end, then
+    // from the start to it
+    for (l = 0; l < log_count; l++)
+    {
+        next = log_position(p_logs[0]);
+        decode_run(kind, &p_logs[1 + next], RTEMP_LOG_ENTRIES - next, p_values);
+        decode_run(kind, &p_logs[1], next, &p_values[RTEMP_LOG_ENTRIES - next]);
+        p_logs   += RTEMP_LOG_SIZE;
+        p_values += RTEMP_LOG_ENTRIES;
+    }
+}
@@ -0,0 +1,127 @@
+/** @file
+ *
+ * @brief RTemp gateway - decoding of the legacy temperature and humidity logs.
+ *
+ * A log is RTEMP_LOG_SIZE bytes: the index the next entry goes to (1 to RTEMP_LOG_SIZE, the
+ * last meaning 1) and RTEMP_LOG_ENTRIES entries in a ring, RTEMP_LOG_EMPTY where none was
+ * written yet. A temperature entry is bit 7 sign, bit 6 +0.5 and bits 5..0 whole degrees,
+ * so -2.3 C is -3 + 0.5 and the range is -63.5 to +63.5 C; -62.5 C would read as empty, but
+ * the sensor stops at -40 C. A humidity entry is %RH.
+ *
+ * Nothing here allocates: every function writes to buffers of the caller. A stream follows a
+ * log over successive reads and gives only the entries each read added. The batch functions
+ * decode many logs at once into fixed size rows, in loops a compiler can vectorize.
+ *
+ * Firmware with the log head characteristic tells how many entries it logged, so a client
+ * that kept the head of its last sync reads only the new entries, at their offsets in the
+ * logs, instead of whole logs it then compares by time.
+ */
+#ifndef RTEMP_LOG_H__
+#define RTEMP_LOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtemp_protocol.h"
+
+#define RTEMP_LOG_NONE              INT16_MIN   /**< Batch value of an empty entry. */
+
+typedef enum
+{
+    RTEMP_LOG_TEMPERATURE,                  /**< Decoded in 0.5 C. */
+    RTEMP_LOG_HUMIDITY                      /**< Decoded in %RH. */
+} rtemp_log_kind_t;
+
+/**@brief A client's view of one log of one sensor. */
+typedef struct
+{
+    uint8_t  index;                         /**< First byte of the last read, 0 before the first. */
+    uint64_t read_ms;                       /**< Time of the last read. */
+} rtemp_log_stream_t;
+
+/**@brief The log head characteristic: the write index both logs share and the turns they made. */
+typedef struct
+{
+    uint8_t  index;
+    uint16_t turns;
+} rtemp_log_head_t;
+
+/**@brief A run of entries in a log characteristic. */
+typedef struct
+{
+    uint16_t offset;                        /**< Of the first entry, in bytes from the start of the value. */
+    uint16_t len;
+} rtemp_log_part_t;
+
+/**@brief Function for decoding a temperature log entry, in 0.5 C. */
+int16_t rtemp_log_temperature_decode(uint8_t entry);
+
+/**@brief Function for getting the newest entries of a log, oldest first.
+ *
+ * @param[in]   p_log       The log, RTEMP_LOG_SIZE bytes.
+ * @param[in]   newest      Number of entries wanted, RTEMP_LOG_ENTRIES or less.
+ * @param[out]  p_entries   The entries, room for newest of them. Empty ones are left out.
+ *
+ * @return      Number of entries.
+ */
+uint16_t rtemp_log_unroll(const uint8_t * p_log, uint16_t newest, uint8_t * p_entries);
+
+/**@brief Function for starting a stream, before the first read of its log. */
+void rtemp_log_stream_init(rtemp_log_stream_t * p_stream);
+
+/**@brief Function for taking a new read of the log of a stream.
+ *
+ * @details The index only tells how far the log moved modulo RTEMP_LOG_ENTRIES; the time since
+ *          the last read picks the turn of the ring, so a read after more than a full log
+ *          gives all of it and one after exactly a full log does not give nothing.
+ *
+ * @param[in]   read_ms     Time of the read.
+ * @param[out]  p_entries   The entries added since the last read, oldest first,
+ *                          RTEMP_LOG_ENTRIES bytes. The first read gives the whole log.
+ *
+ * @return      Number of entries. The newest was logged within RTEMP_LOG_PERIOD_S before
+ *              read_ms, each older one RTEMP_LOG_PERIOD_S before the next.
+ */
+uint16_t rtemp_log_stream_feed(rtemp_log_stream_t * p_stream, const uint8_t * p_log, uint64_t read_ms,
+                               uint8_t * p_entries);
+
+/**@brief Function for decoding the log head characteristic.
+ *
+ * @return      false if the value is not a log head.
+ */
+bool rtemp_log_head_decode(const uint8_t * p_data, uint16_t len, rtemp_log_head_t * p_head);
+
+/**@brief Function for getting the number of entries logged since the sensor started. */
+uint32_t rtemp_log_head_count(const rtemp_log_head_t * p_head);
+
+/**@brief Function for getting the number of entries logged since an earlier head.
+ *
+ * @param[in]   p_since     Head of the last sync, NULL if there was none.
+ *
+ * @return      RTEMP_LOG_ENTRIES or less. The whole log when there was no earlier head, the sensor
+ *              restarted since (its count went down) or the log went round since.
+ */
+uint16_t rtemp_log_head_new(const rtemp_log_head_t * p_head, const rtemp_log_head_t * p_since);
+
+/**@brief Function for finding where the newest entries are in the log characteristics.
+ *
+ * @param[in]   newest      Number of entries wanted, RTEMP_LOG_ENTRIES or less.
+ * @param[out]  p_parts     One or two runs, oldest entries first; read one after the other
+ *                          they give the entries in the order they were logged. The newest
+ *                          entry was logged within RTEMP_LOG_PERIOD_S before the head was read.
+ *
+ * @return      Number of runs, 0 when newest is 0.
+ */
+uint8_t rtemp_log_head_parts(const rtemp_log_head_t * p_head, uint16_t newest, rtemp_log_part_t p_parts[2]);
+
+/**@brief Function for decoding entries, empty ones to RTEMP_LOG_NONE. */
+void rtemp_log_decode(rtemp_log_kind_t kind, const uint8_t * p_entries, uint32_t count, int16_t * p_values);
+
+/**@brief Function for decoding whole logs, each to a row of RTEMP_LOG_ENTRIES values.
+ *
+ * @param[in]   p_logs      log_count logs of RTEMP_LOG_SIZE bytes, one after the other.
+ * @param[out]  p_values    log_count rows, each oldest entry first and empty entries (the
+ *                          oldest ones of a log not yet full) RTEMP_LOG_NONE.
+ */
+void rtemp_log_decode_batch(rtemp_log_kind_t kind, const uint8_t * p_logs, uint32_t log_count, int16_t * p_values);
+
+#endif // RTEMP_LOG_H__
@@ -0,0 +1,417 @@
+/** @file
+ *
+ * @brief RTemp gateway bench - log decoding against the firmware's log encoder.
+ *
+ * The logs are written by the firmware's own set_temperature_log() and set_humidity_log(),
+ * linked from our_service.c with the SoftDevice shims of the simulated transport, and read
+ * back through rtemp_log.h: every temperature the sensor can log, random walks followed by a
+ * stream with reads at random times, set_log_head() with reads of only the new entries, and
+ * the batch decoder against the one entry at a time path. Then both paths are timed.
+ *
+ *   make bench
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "rtemp_log.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+static uint64_t bench_clock(void)
+{
+    return __rdtsc();
+}
+#else
+#define BENCH_UNIT "ns"
+static uint64_t bench_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+// After the intrinsics: the register names of the host nrf.h would break them
+#include "our_service.h"
+
+#define FUZZ_RUNS           200
+#define FUZZ_APPENDS        4000            /**< Per run: over 15 turns of the ring. */
+#define FUZZ_PERIOD_MS      ((uint64_t)RTEMP_LOG_PERIOD_S * 1000)
+#define BATCH_LOGS          4096
+#define BENCH_REPEAT        50
+
+static volatile int32_t m_sink;             /**< Keeps the compiler from dropping the timed loops. */
+static bool             m_failed;
+static uint32_t         m_seed = 2016;
+static ble_os_t         m_service;
+static uint16_t         m_conn_handle = BLE_CONN_HANDLE_INVALID; /**< Not connected: values only wait in m_service. */
+
+static int16_t          m_appended_t[FUZZ_APPENDS];
+static uint8_t          m_appended_h[FUZZ_APPENDS];
+static uint8_t          m_logs[BATCH_LOGS][RTEMP_LOG_SIZE];
+static int16_t          m_values[BATCH_LOGS][RTEMP_LOG_ENTRIES];
+
+
+static void check(const char * p_name, bool ok, const char * p_detail)
+{
+    printf("  %-44s %s%s\n", p_name, ok ? "ok" : "FAIL", p_detail);
+    m_failed |= !ok;
+}
+
+
+static uint32_t bench_random(void)
+{
+    m_seed = m_seed * 1103515245UL + 12345UL;
+    return m_seed >> 8;
+}
+
+
+/**@brief What a temperature in 0.01 C should decode to, in 0.5 C: rounded down to half a
+ *        degree, whole degrees saturated at +-63. */
+static int16_t expected_half_degrees(int16_t centi_celsius)
+{
+    int32_t half  = (centi_celsius >= 0) ? centi_celsius / 50 : -((-centi_celsius + 49) / 50);
+    int32_t whole = (half >= 0) ? half / 2 : -((-half + 1) / 2);
+
+    whole = (whole > 63) ? 63 : (whole < -63) ? -63 : whole;
+    return (int16_t)(whole * 2 + (half & 1));
+}
+
+
+static void log_clear(uint8_t * p_log)
+{
+    memset(p_log, RTEMP_LOG_EMPTY, RTEMP_LOG_SIZE);
+    p_log[0] = 1;
+}
+
+
+static void log_append_temperature(uint8_t * p_log, int16_t centi_celsius)
+{
+    temperature_struct reading = { centi_celsius, 0 };
+
+    set_temperature_log(&m_service, p_log, &reading, &m_conn_handle);
+}
+
+
+static void log_append_humidity(uint8_t * p_log, uint8_t percent)
+{
+    temperature_struct reading = { 0, (int16_t)(percent * 100 + (int16_t)(bench_random() % 100)) };
+
+    set_humidity_log(&m_service, p_log, &reading, &m_conn_handle);
+}
+
+
+/**@brief Every entry against the bit layout, done with floats as the iOS app does. */
+static void check_decode(void)
+{
+    unsigned mismatches = 0;
+
+    for (unsigned entry = 0; entry < 256; entry++)
+    {
+        double value = (entry & 0x80) ? -(double)(entry & 0x3F) : (double)(entry & 0x3F);
+
+        value      += (entry & 0x40) ? 0.5 : 0.0;
+        mismatches += (rtemp_log_temperature_decode((uint8_t)entry) != (int16_t)(value * 2.0));
+    }
+    check("temperature entries, all 256", mismatches == 0, "");
+}
+
+
+/**@brief Every temperature from -50 C to 150 C through the encoder. The sensor range must never
+ *        log the empty marker. */
+static void check_encoder(void)
+{
+    static uint8_t log[RTEMP_LOG_SIZE];
+    unsigned       mismatches = 0;
+    unsigned       empty      = 0;
+    uint8_t        entry;
+    char           detail[48];
+
+    log_clear(log);
+    for (int32_t t = -5000; t <= 15000; t++)
+    {
+        log_append_temperature(log, (int16_t)t);
+        entry       = log[log[0] - 1];
+        mismatches += (rtemp_log_temperature_decode(entry) != expected_half_degrees((int16_t)t));
+        empty      += (entry == RTEMP_LOG_EMPTY) && (t >= -4000);
+    }
+    snprintf(detail, sizeof(detail), " (%u mismatches, %u empty)", mismatches, empty);
+    check("set_temperature_log, -50 C to 150 C", (mismatches == 0) && (empty == 0), detail);
+}
+
+
+/**@brief Gap to the next read: mostly short, some long, some around a full turn of the ring. */
+static uint64_t fuzz_read_gap(void)
+{
+    uint32_t r = bench_random();
+
+    switch (r % 4)
+    {
+        case 0:
+        case 1:
+            return (bench_random() % 3000) * FUZZ_PERIOD_MS / 1000;
+
+        case 2:
+            return (bench_random() % 300000) * FUZZ_PERIOD_MS / 1000;
+
+        default:
+            return (RTEMP_LOG_ENTRIES * 1000 + (bench_random() % 4001) - 2000) * FUZZ_PERIOD_MS / 1000;
+    }
+}
+
+
+/**@brief Random walks appended by the firmware and read through streams at random times by a
+ *        clock up to 500 ppm off. Every read must give exactly the entries appended since the
+ *        last one, up to a full log. */
+static void check_stream(void)
+{
+    static uint8_t     temp_log[RTEMP_LOG_SIZE];
+    static uint8_t     humidity_log[RTEMP_LOG_SIZE];
+    static uint8_t     entries[RTEMP_LOG_ENTRIES];
+    rtemp_log_stream_t temp_stream;
+    rtemp_log_stream_t humidity_stream;
+    unsigned           mismatches = 0;
+    unsigned           reads      = 0;
+    char               detail[48];
+
+    for (unsigned r = 0; r < FUZZ_RUNS; r++)
+    {
+        int32_t  t         = (int32_t)(bench_random() % 12000) - 4000;
+        int32_t  h         = (int32_t)(bench_random() % 101);
+        int32_t  drift_ppm = (int32_t)(bench_random() % 1001) - 500;
+        uint64_t now       = 0;
+        uint64_t append_ms = bench_random() % FUZZ_PERIOD_MS;
+        uint32_t appended  = 0;
+        uint32_t read      = 0;
+
+        log_clear(temp_log);
+        log_clear(humidity_log);
+        rtemp_log_stream_init(&temp_stream);
+        rtemp_log_stream_init(&humidity_stream);
+        while (appended < FUZZ_APPENDS)
+        {
+            uint64_t read_ms;
+            uint32_t expected;
+            uint16_t count;
+
+            now += fuzz_read_gap();
+            for (; (append_ms <= now) && (appended < FUZZ_APPENDS); append_ms += FUZZ_PERIOD_MS)
+            {
+                t += (int32_t)(bench_random() % 201) - 100;
+                t  = (t > 12500) ? 12500 : (t < -4000) ? -4000 : t;
+                h += (int32_t)(bench_random() % 5) - 2;
+                h  = (h > 100) ? 100 : (h < 0) ? 0 : h;
+                m_appended_t[appended] = (int16_t)t;
+                m_appended_h[appended] = (uint8_t)h;
+                log_append_temperature(temp_log, (int16_t)t);
+                log_append_humidity(humidity_log, (uint8_t)h);
+                appended++;
+            }
+            if (append_ms <= now)
+            {
+                break; // Ran out of appends, this read would see time pass without entries
+            }
+
+            read_ms  = 1000000 + now + (int64_t)now * drift_ppm / 1000000;
+            expected = appended - read;
+            expected = (expected > RTEMP_LOG_ENTRIES) ? RTEMP_LOG_ENTRIES : expected;
+
+            count       = rtemp_log_stream_feed(&temp_stream, temp_log, read_ms, entries);
+            mismatches += (count != expected);
+            for (uint16_t i = 0; (i < count) && (count == expected); i++)
+            {
+                mismatches += (rtemp_log_temperature_decode(entries[i]) !=
+                               expected_half_degrees(m_appended_t[appended - count + i]));
+            }
+            count       = rtemp_log_stream_feed(&humidity_stream, humidity_log, read_ms, entries);
+            mismatches += (count != expected);
+            for (uint16_t i = 0; (i < count) && (count == expected); i++)
+            {
+                mismatches += (entries[i] != m_appended_h[appended - count + i]);
+            }
+            read = appended;
+            reads++;
+        }
+    }
+    snprintf(detail, sizeof(detail), " (%u reads, %u mismatches)", reads, mismatches);
+    check("streams, random walks and read times", mismatches == 0, detail);
+}
+
+
+/**@brief Log heads from set_log_head() and only the new entries read at their offsets, against
+ *        what was logged: reads after a few entries, many, and about a full turn. */
+static void check_head(void)
+{
+    static uint8_t   temp_log[RTEMP_LOG_SIZE];
+    static uint8_t   entries[RTEMP_LOG_ENTRIES];
+    rtemp_log_head_t head;
+    rtemp_log_head_t since;
+    rtemp_log_part_t parts[2];
+    rtemp_log_head_t restarted = {5, 0};
+    unsigned         mismatches = 0;
+    unsigned         reads      = 0;
+    char             detail[48];
+
+    for (unsigned r = 0; r < FUZZ_RUNS; r++)
+    {
+        uint32_t appended = 0;
+        uint32_t read     = 0;
+        bool     synced   = false;
+
+        log_clear(temp_log);
+        memset(m_service.log_head_value, 0, sizeof(m_service.log_head_value));
+        set_log_head(&m_service, temp_log, &m_conn_handle);
+        while (appended < FUZZ_APPENDS)
+        {
+            uint32_t gap = bench_random();
+            uint32_t expected;
+            uint16_t count;
+            uint16_t len = 0;
+            uint8_t  part_count;
+
+            gap = (gap % 3 == 0) ? bench_random() % 4 : (gap % 3 == 1) ? bench_random() % 300 :
+                                                                        RTEMP_LOG_ENTRIES - 2 + bench_random() % 5;
+            for (; (gap > 0) && (appended < FUZZ_APPENDS); gap--)
+            {
+                m_appended_t[appended] = (int16_t)((int32_t)(bench_random() % 12000) - 4000);
+                log_append_temperature(temp_log, m_appended_t[appended]);
+                set_log_head(&m_service, temp_log, &m_conn_handle);
+                appended++;
+            }
+
+            expected    = synced ? appended - read : RTEMP_LOG_ENTRIES;
+            expected    = (expected > RTEMP_LOG_ENTRIES) ? RTEMP_LOG_ENTRIES : expected;
+            mismatches += !rtemp_log_head_decode(m_service.log_head_value, sizeof(m_service.log_head_value), &head);
+            mismatches += (rtemp_log_head_count(&head) != appended);
+            count       = rtemp_log_head_new(&head, synced ? &since : NULL);
+            mismatches += (count != expected);
+            part_count  = rtemp_log_head_parts(&head, count, parts);
+            for (uint8_t p = 0; p < part_count; p++)
+            {
+                memcpy(&entries[len], &temp_log[parts[p].offset], parts[p].len);
+                len = (uint16_t)(len + parts[p].len);
+            }
+            mismatches += (len != count);
+            for (uint16_t i = 0; (i < len) && (len == count); i++)
+            {
+                // Entries not logged yet, before the first turn, must read empty
+                uint32_t age = (uint32_t)(len - 1 - i);
+
+                mismatches += (age < appended) ? (rtemp_log_temperature_decode(entries[i]) !=
+                                                  expected_half_degrees(m_appended_t[appended - 1 - age]))
+                                               : (entries[i] != RTEMP_LOG_EMPTY);
+            }
+            since  = head;
+            synced = true;
+            read   = appended;
+            reads++;
+        }
+    }
+    mismatches += (rtemp_log_head_new(&restarted, &since) != RTEMP_LOG_ENTRIES);
+    snprintf(detail, sizeof(detail), " (%u reads, %u mismatches)", reads, mismatches);
+    check("log heads and reads at offsets", mismatches == 0, detail);
+}
+
+
+/**@brief Fills the batch logs with random numbers of appends, most of them past a full turn. */
+static void batch_logs_fill(void)
+{
+    for (uint32_t l = 0; l < BATCH_LOGS; l++)
+    {
+        uint32_t appends = bench_random() % (3 * RTEMP_LOG_ENTRIES);
+        int32_t  t       = (int32_t)(bench_random() % 6000) - 1000;
+
+        log_clear(m_logs[l]);
+        for (uint32_t i = 0; i < appends; i++)
+        {
+            t += (int32_t)(bench_random() % 101) - 50;
+            log_append_temperature(m_logs[l], (int16_t)t);
+        }
+    }
+}
+
+
+/**@brief The batch rows against unrolling each log and decoding it an entry at a time. */
+static void check_batch(void)
+{
+    uint8_t  entries[RTEMP_LOG_ENTRIES];
+    unsigned mismatches = 0;
+    char     detail[48];
+
+    batch_logs_fill();
+    rtemp_log_decode_batch(RTEMP_LOG_TEMPERATURE, &m_logs[0][0], BATCH_LOGS, &m_values[0][0]);
+    for (uint32_t l = 0; l < BATCH_LOGS; l++)
+    {
+        uint16_t count = rtemp_log_unroll(m_logs[l], RTEMP_LOG_ENTRIES, entries);
+        uint16_t empty = RTEMP_LOG_ENTRIES - count;
+
+        for (uint16_t i = 0; i < RTEMP_LOG_ENTRIES; i++)
+        {
+            int16_t expected = (i < empty) ? RTEMP_LOG_NONE : rtemp_log_temperature_decode(entries[i - empty]);
+
+            mismatches += (m_values[l][i] != expected);
+        }
+    }
+    snprintf(detail, sizeof(detail), " (%u mismatches)", mismatches);
+    check("batch, 4096 logs", mismatches == 0, detail);
+}
+
+
+/**@brief Times decoding the batch logs whole, and an entry at a time. */
+static void bench_decode(void)
+{
+    uint8_t  entries[RTEMP_LOG_ENTRIES];
+    uint64_t start;
+    int32_t  sum = 0;
+
+    start = bench_clock();
+    for (int r = 0; r < BENCH_REPEAT; r++)
+    {
+        rtemp_log_decode_batch(RTEMP_LOG_TEMPERATURE, &m_logs[0][0], BATCH_LOGS, &m_values[0][0]);
+        sum += m_values[r][RTEMP_LOG_ENTRIES - 1];
+    }
+    printf("  %-44s %7.2f %s\n", "rtemp_log_decode_batch, per log",
+           (double)(bench_clock() - start) / ((double)BENCH_REPEAT * BATCH_LOGS), BENCH_UNIT);
+
+    start = bench_clock();
+    for (int r = 0; r < BENCH_REPEAT; r++)
+    {
+        for (uint32_t l = 0; l < BATCH_LOGS; l++)
+        {
+            uint16_t count = rtemp_log_unroll(m_logs[l], RTEMP_LOG_ENTRIES, entries);
+
+            for (uint16_t i = 0; i < count; i++)
+            {
+                sum += rtemp_log_temperature_decode(entries[i]);
+            }
+        }
+    }
+    m_sink = sum;
+    printf("  %-44s %7.2f %s\n", "rtemp_log_unroll + entry decode, per log",
+           (double)(bench_clock() - start) / ((double)BENCH_REPEAT * BATCH_LOGS), BENCH_UNIT);
+}
+
+
+int main(void)
+{
+    printf("Legacy logs, %u entries\n", RTEMP_LOG_ENTRIES);
+    check_decode();
+    check_encoder();
+    check_stream();
+    check_head();
+    check_batch();
+    printf("Decoding time\n");
+    bench_decode();
+
+    if (m_failed)
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,47 @@
+/** @file
+ *
+ * @brief RTemp gateway - decoding of the sensor's characteristic values.
+ */
+#include <stddef.h>
+#include "rtemp_protocol.h"
+
+#define TEMPERATURE_MARKER  0xAA
+
+static const rtemp_char_info_t m_chars[RTEMP_CHAR_COUNT] =
+{
+    [RTEMP_CHAR_TEMPERATURE]   = {0x0001, false, "1bc50001-0200-4b87-e611-a639601728bb", "temperature"},
+    [RTEMP_CHAR_HUMIDITY]      = {0x0002, false, "1bc50002-0200-4b87-e611-a639601728bb", "humidity"},
+    [RTEMP_CHAR_TEMP_LOG]      = {0x0003, false, "1bc50003-0200-4b87-e611-a639601728bb", "temperature_log"},
+    [RTEMP_CHAR_HUMIDITY_LOG]  = {0x0004, false, "1bc50004-0200-4b87-e611-a639601728bb", "humidity_log"},
+    [RTEMP_CHAR_LOG_HEAD]      = {0x0009, false, "1bc50009-0200-4b87-e611-a639601728bb", "log_head"},
+    [RTEMP_CHAR_BATTERY_LEVEL] = {0x2A19, true,  "00002a19-0000-1000-8000-00805f9b34fb", "battery"},
+};
+
+
+const rtemp_char_info_t * rtemp_char_info(rtemp_char_t characteristic)
+{
+    return (characteristic < RTEMP_CHAR_COUNT) ? &m_chars[characteristic] : NULL;
+}
+
+
+bool rtemp_temperature_decode(const uint8_t * p_data, uint16_t len, int16_t * p_deci_celsius)
+{
+    // Marker, tenths and whole degrees (both truncated towards zero and signed), sign byte
+    if ((len != 4) || (p_data[0] != TEMPERATURE_MARKER))
+    {
+        return false;
+    }
+    *p_deci_celsius = (int16_t)((int8_t)p_data[2] * 10 + (int8_t)p_data[1]);
+    return true;
+}
+
+
+bool rtemp_humidity_decode(const uint8_t * p_data, uint16_t len, uint8_t * p_percent)
+{
+    if (len != 1)
+    {
+        return false;
+    }
+    *p_percent = p_data[0];
+    return true;
+}
@@ -0,0 +1,60 @@
+/** @file
+ *
+ * @brief RTemp gateway - the GATT protocol of the sensor, as a client sees it.
+ *
+ * The sensor has one custom service on the base UUID 1BC5xxxx-0200-4B87-E611-A639601728BB
+ * (service 0x0000) and the standard Battery Service. The values are decoded here exactly as
+ * our_service.c encodes them; see the README of the project for the byte layouts.
+ * The logs are decoded by rtemp_log.h.
+ */
+#ifndef RTEMP_PROTOCOL_H__
+#define RTEMP_PROTOCOL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RTEMP_SERVICE_UUID          "1bc50000-0200-4b87-e611-a639601728bb"
+#define RTEMP_BATTERY_SERVICE_UUID  "0000180f-0000-1000-8000-00805f9b34fb"
+
+#define RTEMP_LOG_SIZE              255     /**< Bytes of a legacy log: the write index and 254 entries. */
+#define RTEMP_LOG_ENTRIES           (RTEMP_LOG_SIZE - 1)
+#define RTEMP_LOG_EMPTY             0xFF    /**< Entry not written yet. */
+#define RTEMP_LOG_PERIOD_S          930     /**< Seconds between two log entries: 31 measurements of 30 s. */
+#define RTEMP_LOG_HEAD_SIZE         3       /**< Bytes of the log head: the write index and the turns of the logs. */
+
+/**@brief The characteristics the collector uses. */
+typedef enum
+{
+    RTEMP_CHAR_TEMPERATURE,                 /**< 0x0001, 4 bytes, notifies. */
+    RTEMP_CHAR_HUMIDITY,                    /**< 0x0002, 1 byte, notifies. */
+    RTEMP_CHAR_TEMP_LOG,                    /**< 0x0003, RTEMP_LOG_SIZE bytes. */
+    RTEMP_CHAR_HUMIDITY_LOG,                /**< 0x0004, RTEMP_LOG_SIZE bytes. */
+    RTEMP_CHAR_LOG_HEAD,                    /**< 0x0009, RTEMP_LOG_HEAD_SIZE bytes; missing in older firmware. */
+    RTEMP_CHAR_BATTERY_LEVEL,               /**< 0x2A19 of the Battery Service, 1 byte. */
+    RTEMP_CHAR_COUNT
+} rtemp_char_t;
+
+/**@brief Characteristic description, for the transports. */
+typedef struct
+{
+    uint16_t     uuid16;                    /**< On the RTemp base UUID, or on the Bluetooth base for sig. */
+    bool         sig;                       /**< Adopted by the Bluetooth SIG. */
+    const char * p_uuid;                    /**< 128-bit UUID string. */
+    const char * p_name;                    /**< Name in the sample store. */
+} rtemp_char_info_t;
+
+/**@brief Function for getting the description of a characteristic. */
+const rtemp_char_info_t * rtemp_char_info(rtemp_char_t characteristic);
+
+/**@brief Function for decoding the temperature characteristic.
+ *
+ * @param[out]  p_deci_celsius  Temperature in 0.1 C.
+ *
+ * @return      false if the value is not a temperature (wrong length or marker).
+ */
+bool rtemp_temperature_decode(const uint8_t * p_data, uint16_t len, int16_t * p_deci_celsius);
+
+/**@brief Function for decoding the humidity characteristic, in %RH. */
+bool rtemp_humidity_decode(const uint8_t * p_data, uint16_t len, uint8_t * p_percent);
+
+#endif // RTEMP_PROTOCOL_H__
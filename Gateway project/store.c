@@ -0,0 +1,60 @@
+/** @file
+ *
+ * @brief RTemp gateway - local sample store, as CSV.
+ */
+#include <stdio.h>
+#include "store.h"
+
+#define STORE_BUFFER_SIZE   65536           /**< Samples go out in large writes, the store is not a database. */
+
+static FILE   * m_file;
+static uint64_t m_samples;
+static char     m_buffer[STORE_BUFFER_SIZE];
+
+
+bool store_open(const char * p_path)
+{
+    m_samples = 0;
+    if (p_path == NULL)
+    {
+        return true;
+    }
+    m_file = fopen(p_path, "a");
+    if (m_file == NULL)
+    {
+        return false;
+    }
+    setvbuf(m_file, m_buffer, _IOFBF, sizeof(m_buffer));
+    if (ftell(m_file) == 0)
+    {
+        fprintf(m_file, "time,address,quantity,value\n");
+    }
+    return true;
+}
+
+
+void store_sample(uint64_t time_ms, const char * p_address, const char * p_quantity, double value)
+{
+    m_samples++;
+    if (m_file != NULL)
+    {
+        fprintf(m_file, "%llu.%03u,%s,%s,%g\n", (unsigned long long)(time_ms / 1000), (unsigned)(time_ms % 1000),
+                p_address, p_quantity, value);
+    }
+}
+
+
+void store_close(void)
+{
+    if (m_file != NULL)
+    {
+        fclose(m_file);
+        m_file = NULL;
+    }
+}
+
+
+uint64_t store_samples(void)
+{
+    return m_samples;
+}
@@ -0,0 +1,32 @@
+/** @file
+ *
+ * @brief RTemp gateway - local sample store.
+ *
+ * Samples are appended to a CSV file, one per line: time in seconds since 1970 with
+ * milliseconds, sensor address, quantity (the name of rtemp_char_info_t) and value.
+ * A new file starts with a header line.
+ */
+#ifndef STORE_H__
+#define STORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief Function for opening the store.
+ *
+ * @param[in]   p_path  File to append to, NULL to only count the samples.
+ *
+ * @return      false if the file cannot be opened.
+ */
+bool store_open(const char * p_path);
+
+/**@brief Function for adding a sample. */
+void store_sample(uint64_t time_ms, const char * p_address, const char * p_quantity, double value);
+
+/**@brief Function for writing out what is buffered and closing the store. */
+void store_close(void);
+
+/**@brief Function for getting the number of samples added since the store was opened. */
+uint64_t store_samples(void);
+
+#endif // STORE_H__
@@ -0,0 +1,110 @@
+/** @file
+ *
+ * @brief RTemp gateway - transport interface.
+ *
+ * A transport connects to sensors and runs GATT operations on them. The collector only uses
+ * this interface, so the same scheduling runs over a radio or over the simulated sensors of
+ * transport_mock.c. A transport:
+ *
+ * - owns the clock: the collector asks it for the time and lets it run until a deadline, so
+ *   a simulated transport can run days of virtual time in seconds;
+ * - queues any number of reads and subscriptions on a connection and runs them back to back,
+ *   one ATT request after the other without waiting for the collector in between;
+ * - reads long values whole (Read Blob included) and reports them in one callback, or reads
+ *   part of one from an offset with Read Blob requests alone;
+ * - gives up on a connection attempt by itself, reporting TRANSPORT_ERROR_TIMEOUT.
+ *
+ * All callbacks come from within transport_t::poll.
+ */
+#ifndef TRANSPORT_H__
+#define TRANSPORT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtemp_protocol.h"
+
+#define TRANSPORT_OK                0
+#define TRANSPORT_ERROR_BUSY        1       /**< No link left for another connection. */
+#define TRANSPORT_ERROR_STATE       2       /**< Not connected, or already connected. */
+#define TRANSPORT_ERROR_TIMEOUT     3       /**< The sensor did not answer. */
+#define TRANSPORT_ERROR_GATT        4       /**< The sensor answered with an ATT error. */
+#define TRANSPORT_ERROR_LINK        5       /**< The connection was lost. */
+
+typedef struct transport_s transport_t;
+
+/**@brief Events of a transport. device is the index of the sensor in the transport. */
+typedef struct
+{
+    void (*connected)(void * p_context, uint32_t device, int status);
+    void (*disconnected)(void * p_context, uint32_t device, int reason);
+    void (*read_done)(void * p_context, uint32_t device, rtemp_char_t characteristic, int status,
+                      uint16_t offset, const uint8_t * p_data, uint16_t len);
+    void (*subscribed)(void * p_context, uint32_t device, rtemp_char_t characteristic, int status);
+    void (*notification)(void * p_context, uint32_t device, rtemp_char_t characteristic,
+                         const uint8_t * p_data, uint16_t len);
+} transport_handlers_t;
+
+struct transport_s
+{
+    const char * p_name;
+
+    /**@brief Number of sensors known to the transport. */
+    uint32_t (*device_count)(transport_t * p_transport);
+
+    /**@brief Address of a sensor, for the sample store. */
+    const char * (*device_address)(transport_t * p_transport, uint32_t device);
+
+    /**@brief Starts connecting; completes with transport_handlers_t::connected. */
+    int (*connect)(transport_t * p_transport, uint32_t device);
+
+    /**@brief Drops the queued operations and disconnects; completes with
+     *        transport_handlers_t::disconnected, also while still connecting. */
+    int (*disconnect)(transport_t * p_transport, uint32_t device);
+
+    /**@brief Queues a read; completes with transport_handlers_t::read_done, at offset 0. */
+    int (*read)(transport_t * p_transport, uint32_t device, rtemp_char_t characteristic);
+
+    /**@brief Queues a read of len bytes from offset, or up to the end of the value if it is
+     *        shorter; completes with transport_handlers_t::read_done.
+     */
+    int (*read_part)(transport_t * p_transport, uint32_t device, rtemp_char_t characteristic,
+                     uint16_t offset, uint16_t len);
+
+    /**@brief Queues enabling notifications; completes with transport_handlers_t::subscribed. */
+    int (*subscribe)(transport_t * p_transport, uint32_t device, rtemp_char_t characteristic);
+
+    /**@brief Current time, ms since 1970. */
+    uint64_t (*now_ms)(transport_t * p_transport);
+
+    /**@brief Waits for events until deadline_ms and delivers them. It returns after the first
+     *        events, all of those due at the same time, or at the deadline.
+     *
+     * @return  Number of events delivered.
+     */
+    uint32_t (*poll)(transport_t * p_transport, uint64_t deadline_ms);
+
+    void (*destroy)(transport_t * p_transport);
+
+    const transport_handlers_t * p_handlers;
+    void                       * p_context;
+};
+
+/**@brief Options of the simulated transport. */
+typedef struct
+{
+    uint32_t devices;                       /**< Simulated sensors. */
+    uint32_t max_links;                     /**< Connections the simulated controller can hold. */
+    uint32_t conn_interval_ms;              /**< Interval of every connection: one ATT request each. */
+    uint32_t adv_interval_ms;               /**< The sensors advertise this often while idle. */
+    uint32_t connect_timeout_ms;
+    uint32_t fail_percent;                  /**< Connection attempts that time out. */
+    uint32_t seed;
+} transport_mock_options_t;
+
+/**@brief Function for creating the simulated transport: sensors running the firmware's
+ *        our_service.c in this process, on a virtual clock.
+ */
+transport_t * transport_mock_create(const transport_mock_options_t * p_options,
+                                    const transport_handlers_t * p_handlers, void * p_context);
+
+#endif // TRANSPORT_H__
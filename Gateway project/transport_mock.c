@@ -0,0 +1,884 @@
+/** @file
+ *
+ * @brief RTemp gateway - simulated transport.
+ *
+ * Every simulated sensor runs the firmware's own our_service.c: the values the collector reads
+ * are encoded by set_temperature(), set_humidity(), set_temperature_log(), set_humidity_log()
+ * and set_log_head() into an attribute table kept per sensor by the few SoftDevice calls
+ * our_service.c makes, which are implemented here. The sensors only catch up with the time when they are read, so thousands
+ * of them cost nothing while the collector is not connected to them.
+ *
+ * The radio is accounted like the firmware simulator does: a connection comes up after a random
+ * part of the advertising interval, and one ATT round trip takes one connection interval.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "transport.h"
+#include "our_service.h"
+#include "ble.h"
+#include "nrf_error.h"
+#include "app_error.h"
+#include "app_util.h"
+
+#if (LOG_SIZE != RTEMP_LOG_SIZE) || ((LOGGING_INTERVAL + 1) * MEASUREMENT_INTERVAL / 1000 != RTEMP_LOG_PERIOD_S)
+#error "rtemp_protocol.h does not match our_service.h"
+#endif
+
+#define MOCK_EPOCH_MS           1476748800000ULL    /**< Wall clock at the start, 2016-10-18 00:00 UTC like the firmware simulator. */
+#define MOCK_LOG_PERIOD_MS      ((uint64_t)(LOGGING_INTERVAL + 1) * MEASUREMENT_INTERVAL)
+#define MOCK_DAY_MS             86400000.0
+#define MOCK_MAX_ATTRS          12
+#define MOCK_STACK_VALUES       64          /**< Value bytes the stack keeps for one sensor. */
+#define MOCK_QUEUE_SIZE         16          /**< Operations queued on one connection. */
+#define MOCK_ATT_PAYLOAD        (GATT_MTU_SIZE_DEFAULT - 1)
+#define MOCK_NOTIFY_PAYLOAD     (GATT_MTU_SIZE_DEFAULT - 3)
+#define MOCK_CONNECT_US         1250        /**< CONNECT_IND to the first connection event, before the interval. */
+
+typedef enum
+{
+    LINK_IDLE,
+    LINK_CONNECTING,
+    LINK_CONNECTED,
+    LINK_DISCONNECTING
+} link_state_t;
+
+typedef enum
+{
+    OP_READ,
+    OP_READ_PART,
+    OP_SUBSCRIBE
+} op_kind_t;
+
+typedef struct
+{
+    uint8_t  kind;                          /**< op_kind_t */
+    uint8_t  characteristic;                /**< rtemp_char_t */
+    uint16_t offset;                        /**< Of OP_READ_PART. */
+    uint16_t len;                           /**< Of OP_READ_PART. */
+} mock_op_t;
+
+typedef struct
+{
+    uint16_t  uuid;
+    uint8_t   uuid_type;
+    uint16_t  value_handle;
+    uint16_t  len;
+    uint16_t  max_len;
+    uint8_t * p_value;                      /**< In stack_values, or the application's for BLE_GATTS_VLOC_USER. */
+    bool      notify;
+    bool      notifying;                    /**< CCCD written; not bonded, so only for the connection. */
+} mock_attr_t;
+
+typedef struct
+{
+    char         address[18];
+    ble_os_t     service;
+    uint8_t      temp_log[LOG_SIZE];
+    uint8_t      humidity_log[LOG_SIZE];
+    mock_attr_t  attrs[MOCK_MAX_ATTRS];
+    uint8_t      attr_count;
+    uint8_t      stack_values[MOCK_STACK_VALUES];
+    uint8_t      stack_used;
+    uint8_t      battery_level;             /**< Battery Service, which is not our_service.c. */
+    uint16_t     conn_handle;
+    uint64_t     logged_ms;                 /**< Time of the newest log entry, or of the boot. */
+    double       temperature_offset;        /**< C */
+    double       humidity_offset;           /**< %RH */
+    double       phase;
+    link_state_t link;
+    uint32_t     generation;                /**< Changes with every connection, so stale events are dropped. */
+    uint64_t     anchor_us;                 /**< First connection event. */
+    uint64_t     busy_until_us;             /**< End of the last ATT round trip. */
+    mock_op_t    queue[MOCK_QUEUE_SIZE];
+    uint8_t      queue_first;
+    uint8_t      queue_count;
+    bool         op_running;
+    bool         measuring;                 /**< A measurement is scheduled to notify from. */
+} mock_device_t;
+
+typedef enum
+{
+    EVT_CONNECTED,
+    EVT_CONNECT_FAILED,
+    EVT_DISCONNECTED,
+    EVT_OP_DONE,
+    EVT_MEASUREMENT,
+    EVT_NOTIFICATION
+} mock_evt_kind_t;
+
+typedef struct
+{
+    uint64_t at_us;
+    uint64_t seq;                           /**< Events due at the same time go in the order they were made. */
+    uint32_t device;
+    uint32_t generation;
+    uint8_t  kind;
+    uint8_t  characteristic;
+    uint8_t  len;
+    uint8_t  data[MOCK_NOTIFY_PAYLOAD];
+} mock_evt_t;
+
+typedef struct
+{
+    transport_t              transport;     /**< First, the interface is cast back to this. */
+    transport_mock_options_t options;
+    mock_device_t          * p_devices;
+    uint32_t                 links;
+    uint64_t                 now_us;        /**< Since MOCK_EPOCH_MS. */
+    uint32_t                 rng;
+    mock_evt_t             * p_events;      /**< Binary heap on (at_us, seq). */
+    uint32_t                 event_count;
+    uint32_t                 event_size;
+    uint64_t                 event_seq;
+} mock_t;
+
+static mock_t        * m_mock;              /**< For the SoftDevice calls of our_service.c. */
+static mock_device_t * m_device;            /**< The sensor whose our_service.c is running. */
+
+
+static uint32_t mock_random(mock_t * p_mock)
+{
+    // xorshift32
+    p_mock->rng ^= p_mock->rng << 13;
+    p_mock->rng ^= p_mock->rng >> 17;
+    p_mock->rng ^= p_mock->rng << 5;
+    return p_mock->rng;
+}
+
+
+static bool evt_before(const mock_evt_t * p_a, const mock_evt_t * p_b)
+{
+    return (p_a->at_us < p_b->at_us) || ((p_a->at_us == p_b->at_us) && (p_a->seq < p_b->seq));
+}
+
+
+static mock_evt_t * evt_push(mock_t * p_mock, uint64_t at_us, uint32_t device, mock_evt_kind_t kind)
+{
+    mock_evt_t   evt;
+    uint32_t     i;
+
+    if (p_mock->event_count == p_mock->event_size)
+    {
+        p_mock->event_size = (p_mock->event_size == 0) ? 256 : p_mock->event_size * 2;
+        p_mock->p_events   = realloc(p_mock->p_events, p_mock->event_size * sizeof(mock_evt_t));
+        if (p_mock->p_events == NULL)
+        {
+            fprintf(stderr, "transport_mock: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memset(&evt, 0, sizeof(evt));
+    evt.at_us      = at_us;
+    evt.seq        = p_mock->event_seq++;
+    evt.device     = device;
+    evt.generation = p_mock->p_devices[device].generation;
+    evt.kind       = (uint8_t)kind;
+
+    i = p_mock->event_count++;
+    while ((i > 0) && evt_before(&evt, &p_mock->p_events[(i - 1) / 2]))
+    {
+        p_mock->p_events[i] = p_mock->p_events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    p_mock->p_events[i] = evt;
+    return &p_mock->p_events[i];
+}
+
+
+static void evt_pop(mock_t * p_mock, mock_evt_t * p_evt)
+{
+    mock_evt_t last;
+    uint32_t   i = 0;
+    uint32_t   child;
+
+    *p_evt = p_mock->p_events[0];
+    last   = p_mock->p_events[--p_mock->event_count];
+    for (;;)
+    {
+        child = 2 * i + 1;
+        if (child >= p_mock->event_count)
+        {
+            break;
+        }
+        if ((child + 1 < p_mock->event_count) && evt_before(&p_mock->p_events[child + 1], &p_mock->p_events[child]))
+        {
+            child++;
+        }
+        if (!evt_before(&p_mock->p_events[child], &last))
+        {
+            break;
+        }
+        p_mock->p_events[i] = p_mock->p_events[child];
+        i = child;
+    }
+    p_mock->p_events[i] = last;
+}
+
+
+/**@brief First connection event at or after a time. */
+static uint64_t anchor_at_or_after(const mock_t * p_mock, const mock_device_t * p_device, uint64_t at_us)
+{
+    uint64_t interval = (uint64_t)p_mock->options.conn_interval_ms * 1000;
+
+    if (at_us <= p_device->anchor_us)
+    {
+        return p_device->anchor_us;
+    }
+    return p_device->anchor_us + (at_us - p_device->anchor_us + interval - 1) / interval * interval;
+}
+
+
+static mock_attr_t * attr_find_handle(mock_device_t * p_device, uint16_t value_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < p_device->attr_count; i++)
+    {
+        if (p_device->attrs[i].value_handle == value_handle)
+        {
+            return &p_device->attrs[i];
+        }
+    }
+    return NULL;
+}
+
+
+static mock_attr_t * attr_find(mock_device_t * p_device, rtemp_char_t characteristic)
+{
+    const rtemp_char_info_t * p_info = rtemp_char_info(characteristic);
+    uint8_t                   i;
+
+    if ((p_info == NULL) || p_info->sig)
+    {
+        return NULL; // Not in our_service.c
+    }
+    for (i = 0; i < p_device->attr_count; i++)
+    {
+        if ((p_device->attrs[i].uuid == p_info->uuid16) && (p_device->attrs[i].uuid_type != BLE_UUID_TYPE_BLE))
+        {
+            return &p_device->attrs[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief The room around a sensor: a daily swing around values of its own. */
+static void environment(const mock_device_t * p_device, uint64_t at_ms, temperature_struct * p_reading)
+{
+    double day = 2.0 * M_PI * (double)at_ms / MOCK_DAY_MS + p_device->phase;
+
+    p_reading->temperature = (int16_t)lround((21.0 + p_device->temperature_offset + 2.5 * sin(day)) * 100.0);
+    p_reading->humidity    = (int16_t)lround((45.0 + p_device->humidity_offset - 8.0 * sin(day)) * 100.0);
+}
+
+
+/**@brief Brings a sensor up to now: the log entries it took since it was last seen, through
+ *        the firmware's encoders, and its current reading.
+ */
+static void device_advance(mock_t * p_mock, mock_device_t * p_device, bool notify)
+{
+    uint64_t           now_ms = p_mock->now_us / 1000;
+    uint64_t           periods;
+    uint64_t           t;
+    temperature_struct reading;
+
+    m_device = p_device;
+    periods  = (now_ms > p_device->logged_ms) ? (now_ms - p_device->logged_ms) / MOCK_LOG_PERIOD_MS : 0;
+    if (periods > RTEMP_LOG_ENTRIES)
+    {
+        // Whole turns of the logs that they no longer hold; only the head counts them
+        p_device->logged_ms += (periods - RTEMP_LOG_ENTRIES) / RTEMP_LOG_ENTRIES * RTEMP_LOG_ENTRIES * MOCK_LOG_PERIOD_MS;
+        uint16_encode((uint16_t)(uint16_decode(&p_device->service.log_head_value[1]) +
+                                 (periods - RTEMP_LOG_ENTRIES) / RTEMP_LOG_ENTRIES),
+                      &p_device->service.log_head_value[1]);
+    }
+    for (t = p_device->logged_ms + MOCK_LOG_PERIOD_MS; t <= now_ms; t += MOCK_LOG_PERIOD_MS)
+    {
+        environment(p_device, t, &reading);
+        set_temperature_log(&p_device->service, p_device->temp_log, &reading, &p_device->conn_handle);
+        set_humidity_log(&p_device->service, p_device->humidity_log, &reading, &p_device->conn_handle);
+        set_log_head(&p_device->service, p_device->temp_log, &p_device->conn_handle);
+        p_device->logged_ms = t;
+    }
+
+    environment(p_device, now_ms - now_ms % MEASUREMENT_INTERVAL, &reading);
+    set_temperature(&p_device->service, &reading, &p_device->conn_handle, notify);
+    set_humidity(&p_device->service, &reading, &p_device->conn_handle, notify);
+    m_device = NULL;
+}
+
+
+static uint16_t att_round_trips(uint16_t len, op_kind_t kind)
+{
+    switch (kind)
+    {
+        case OP_READ:
+            // A Read, then Read Blobs until a response is not full
+            return (uint16_t)(len / MOCK_ATT_PAYLOAD + 1);
+
+        case OP_READ_PART:
+            // Read Blobs until the part is in
+            return (len > MOCK_ATT_PAYLOAD) ? (uint16_t)((len + MOCK_ATT_PAYLOAD - 1) / MOCK_ATT_PAYLOAD) : 1;
+
+        default:
+            return 1;
+    }
+}
+
+
+/**@brief Bytes of a value an operation gets. */
+static uint16_t op_len(const mock_op_t * p_op, const mock_attr_t * p_attr)
+{
+    if (p_attr == NULL)
+    {
+        return 1;
+    }
+    if (p_op->kind != OP_READ_PART)
+    {
+        return p_attr->len;
+    }
+    if (p_op->offset >= p_attr->len)
+    {
+        return 0;
+    }
+    return (p_op->len < p_attr->len - p_op->offset) ? p_op->len : (uint16_t)(p_attr->len - p_op->offset);
+}
+
+
+static void op_next(mock_t * p_mock, uint32_t index)
+{
+    mock_device_t * p_device = &p_mock->p_devices[index];
+    mock_op_t     * p_op;
+    uint16_t        len;
+    uint64_t        start;
+    mock_evt_t    * p_evt;
+
+    if (p_device->op_running || (p_device->queue_count == 0) || (p_device->link != LINK_CONNECTED))
+    {
+        return;
+    }
+    p_op  = &p_device->queue[p_device->queue_first];
+    len   = op_len(p_op, attr_find(p_device, (rtemp_char_t)p_op->characteristic));
+    start = anchor_at_or_after(p_mock, p_device, (p_mock->now_us > p_device->busy_until_us) ? p_mock->now_us : p_device->busy_until_us);
+    p_device->busy_until_us = start + (uint64_t)att_round_trips(len, (op_kind_t)p_op->kind) *
+                                      p_mock->options.conn_interval_ms * 1000;
+    p_device->op_running    = true;
+    p_evt = evt_push(p_mock, p_device->busy_until_us, index, EVT_OP_DONE);
+    p_evt->characteristic = p_op->characteristic;
+}
+
+
+static void measurement_schedule(mock_t * p_mock, uint32_t index)
+{
+    uint64_t now_ms = p_mock->now_us / 1000;
+
+    p_mock->p_devices[index].measuring = true;
+    evt_push(p_mock, (now_ms - now_ms % MEASUREMENT_INTERVAL + MEASUREMENT_INTERVAL) * 1000, index, EVT_MEASUREMENT);
+}
+
+
+static void link_closed(mock_t * p_mock, mock_device_t * p_device)
+{
+    uint8_t i;
+
+    p_device->link        = LINK_IDLE;
+    p_device->conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_device->queue_count = 0;
+    p_device->op_running  = false;
+    p_device->measuring   = false;
+    for (i = 0; i < p_device->attr_count; i++)
+    {
+        p_device->attrs[i].notifying = false;
+    }
+    p_mock->links--;
+}
+
+
+static void on_op_done(mock_t * p_mock, uint32_t index, const mock_evt_t * p_evt)
+{
+    const transport_handlers_t * p_handlers = p_mock->transport.p_handlers;
+    void                       * p_context  = p_mock->transport.p_context;
+    mock_device_t              * p_device   = &p_mock->p_devices[index];
+    mock_op_t                    op         = p_device->queue[p_device->queue_first];
+    mock_attr_t                * p_attr;
+
+    p_device->queue_first = (uint8_t)((p_device->queue_first + 1) % MOCK_QUEUE_SIZE);
+    p_device->queue_count--;
+    p_device->op_running  = false;
+
+    if ((op.kind == OP_READ) && (op.characteristic == RTEMP_CHAR_BATTERY_LEVEL))
+    {
+        p_handlers->read_done(p_context, index, RTEMP_CHAR_BATTERY_LEVEL, TRANSPORT_OK, 0, &p_device->battery_level, 1);
+    }
+    else if (op.kind != OP_SUBSCRIBE)
+    {
+        device_advance(p_mock, p_device, false);
+        p_attr = attr_find(p_device, (rtemp_char_t)op.characteristic);
+        if (op.kind == OP_READ)
+        {
+            op.offset = 0;
+        }
+        if ((p_attr == NULL) || (op.offset > p_attr->len))
+        {
+            // Attribute Not Found, or Invalid Offset
+            p_handlers->read_done(p_context, index, (rtemp_char_t)op.characteristic, TRANSPORT_ERROR_GATT, op.offset, NULL, 0);
+        }
+        else
+        {
+            p_handlers->read_done(p_context, index, (rtemp_char_t)op.characteristic, TRANSPORT_OK, op.offset,
+                                  p_attr->p_value + op.offset, op_len(&op, p_attr));
+        }
+    }
+    else
+    {
+        p_attr = attr_find(p_device, (rtemp_char_t)op.characteristic);
+        if ((p_attr != NULL) && p_attr->notify)
+        {
+            p_attr->notifying = true;
+            if (!p_device->measuring)
+            {
+                measurement_schedule(p_mock, index);
+            }
+        }
+        p_handlers->subscribed(p_context, index, (rtemp_char_t)op.characteristic,
+                               ((p_attr != NULL) && p_attr->notify) ? TRANSPORT_OK : TRANSPORT_ERROR_GATT);
+    }
+    // The handler may have disconnected
+    if (p_evt->generation == p_device->generation)
+    {
+        op_next(p_mock, index);
+    }
+}
+
+
+static void evt_dispatch(mock_t * p_mock, const mock_evt_t * p_evt)
+{
+    const transport_handlers_t * p_handlers = p_mock->transport.p_handlers;
+    void                       * p_context  = p_mock->transport.p_context;
+    mock_device_t              * p_device   = &p_mock->p_devices[p_evt->device];
+    ble_evt_t                    ble_evt;
+
+    if (p_evt->generation != p_device->generation)
+    {
+        return; // For a connection that is gone
+    }
+    switch (p_evt->kind)
+    {
+        case EVT_CONNECTED:
+            p_device->link          = LINK_CONNECTED;
+            p_device->anchor_us     = p_mock->now_us;
+            p_device->busy_until_us = p_mock->now_us;
+            p_device->conn_handle   = 0;
+            device_advance(p_mock, p_device, false);
+            memset(&ble_evt, 0, sizeof(ble_evt));
+            ble_evt.header.evt_id = BLE_GAP_EVT_CONNECTED;
+            m_device = p_device;
+            our_service_on_ble_evt(&p_device->service, &ble_evt);
+            m_device = NULL;
+            p_handlers->connected(p_context, p_evt->device, TRANSPORT_OK);
+            break;
+
+        case EVT_CONNECT_FAILED:
+            link_closed(p_mock, p_device);
+            p_handlers->connected(p_context, p_evt->device, TRANSPORT_ERROR_TIMEOUT);
+            break;
+
+        case EVT_DISCONNECTED:
+            link_closed(p_mock, p_device);
+            p_handlers->disconnected(p_context, p_evt->device, TRANSPORT_OK);
+            break;
+
+        case EVT_OP_DONE:
+            on_op_done(p_mock, p_evt->device, p_evt);
+            break;
+
+        case EVT_MEASUREMENT:
+            // Notifies through set_temperature() and set_humidity(), see sd_ble_gatts_hvx()
+            device_advance(p_mock, p_device, true);
+            measurement_schedule(p_mock, p_evt->device);
+            break;
+
+        case EVT_NOTIFICATION:
+            if (p_evt->characteristic < RTEMP_CHAR_COUNT)
+            {
+                p_handlers->notification(p_context, p_evt->device, (rtemp_char_t)p_evt->characteristic, p_evt->data, p_evt->len);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+static mock_t * mock_get(transport_t * p_transport)
+{
+    return (mock_t *)p_transport;
+}
+
+
+static uint32_t mock_device_count(transport_t * p_transport)
+{
+    return mock_get(p_transport)->options.devices;
+}
+
+
+static const char * mock_device_address(transport_t * p_transport, uint32_t device)
+{
+    return mock_get(p_transport)->p_devices[device].address;
+}
+
+
+static int mock_connect(transport_t * p_transport, uint32_t device)
+{
+    mock_t        * p_mock   = mock_get(p_transport);
+    mock_device_t * p_device = &p_mock->p_devices[device];
+    uint64_t        adv_us   = (uint64_t)p_mock->options.adv_interval_ms * 1000;
+
+    if (p_device->link != LINK_IDLE)
+    {
+        return TRANSPORT_ERROR_STATE;
+    }
+    if (p_mock->links >= p_mock->options.max_links)
+    {
+        return TRANSPORT_ERROR_BUSY;
+    }
+    p_mock->links++;
+    p_device->link = LINK_CONNECTING;
+    p_device->generation++;
+    if ((mock_random(p_mock) % 100) < p_mock->options.fail_percent)
+    {
+        evt_push(p_mock, p_mock->now_us + (uint64_t)p_mock->options.connect_timeout_ms * 1000, device, EVT_CONNECT_FAILED);
+    }
+    else
+    {
+        // The next advertising event, then the first connection event
+        evt_push(p_mock, p_mock->now_us + mock_random(p_mock) % (adv_us + 1) + MOCK_CONNECT_US +
+                         (uint64_t)p_mock->options.conn_interval_ms * 1000, device, EVT_CONNECTED);
+    }
+    return TRANSPORT_OK;
+}
+
+
+static int mock_disconnect(transport_t * p_transport, uint32_t device)
+{
+    mock_t        * p_mock   = mock_get(p_transport);
+    mock_device_t * p_device = &p_mock->p_devices[device];
+    uint64_t        at_us    = p_mock->now_us;
+
+    if ((p_device->link == LINK_IDLE) || (p_device->link == LINK_DISCONNECTING))
+    {
+        return TRANSPORT_ERROR_STATE;
+    }
+    if (p_device->link == LINK_CONNECTED)
+    {
+        at_us = anchor_at_or_after(p_mock, p_device, p_mock->now_us + 1); // LL_TERMINATE_IND
+    }
+    p_device->generation++;
+    p_device->link        = LINK_DISCONNECTING;
+    p_device->queue_count = 0;
+    p_device->op_running  = false;
+    evt_push(p_mock, at_us, device, EVT_DISCONNECTED);
+    return TRANSPORT_OK;
+}
+
+
+static int op_queue(transport_t * p_transport, uint32_t device, rtemp_char_t characteristic, op_kind_t kind,
+                    uint16_t offset, uint16_t len)
+{
+    mock_t        * p_mock   = mock_get(p_transport);
+    mock_device_t * p_device = &p_mock->p_devices[device];
+    mock_op_t     * p_op;
+
+    if (p_device->link != LINK_CONNECTED)
+    {
+        return TRANSPORT_ERROR_STATE;
+    }
+    if (p_device->queue_count == MOCK_QUEUE_SIZE)
+    {
+        return TRANSPORT_ERROR_BUSY;
+    }
+    p_op = &p_device->queue[(p_device->queue_first + p_device->queue_count) % MOCK_QUEUE_SIZE];
+    p_op->kind           = (uint8_t)kind;
+    p_op->characteristic = (uint8_t)characteristic;
+    p_op->offset         = offset;
+    p_op->len            = len;
+    p_device->queue_count++;
+    op_next(p_mock, device);
+    return TRANSPORT_OK;
+}
+
+
+static int mock_read(transport_t * p_transport, uint32_t device, rtemp_char_t characteristic)
+{
+    return op_queue(p_transport, device, characteristic, OP_READ, 0, 0);
+}
+
+
+static int mock_read_part(transport_t * p_transport, uint32_t device, rtemp_char_t characteristic,
+                          uint16_t offset, uint16_t len)
+{
+    if (characteristic == RTEMP_CHAR_BATTERY_LEVEL)
+    {
+        return TRANSPORT_ERROR_STATE; // A short value, not worth a Read Blob
+    }
+    return op_queue(p_transport, device, characteristic, OP_READ_PART, offset, len);
+}
+
+
+static int mock_subscribe(transport_t * p_transport, uint32_t device, rtemp_char_t characteristic)
+{
+    return op_queue(p_transport, device, characteristic, OP_SUBSCRIBE, 0, 0);
+}
+
+
+static uint64_t mock_now_ms(transport_t * p_transport)
+{
+    return MOCK_EPOCH_MS + mock_get(p_transport)->now_us / 1000;
+}
+
+
+static uint32_t mock_poll(transport_t * p_transport, uint64_t deadline_ms)
+{
+    mock_t   * p_mock      = mock_get(p_transport);
+    uint64_t   deadline_us = (deadline_ms > MOCK_EPOCH_MS) ? (deadline_ms - MOCK_EPOCH_MS) * 1000 : 0;
+    uint32_t   delivered   = 0;
+    mock_evt_t evt;
+
+    if ((p_mock->event_count == 0) || (p_mock->p_events[0].at_us > deadline_us))
+    {
+        if (deadline_us > p_mock->now_us)
+        {
+            p_mock->now_us = deadline_us;
+        }
+        return 0;
+    }
+    if (p_mock->p_events[0].at_us > p_mock->now_us)
+    {
+        p_mock->now_us = p_mock->p_events[0].at_us;
+    }
+    while ((p_mock->event_count > 0) && (p_mock->p_events[0].at_us <= p_mock->now_us))
+    {
+        evt_pop(p_mock, &evt);
+        evt_dispatch(p_mock, &evt);
+        delivered++;
+    }
+    return delivered;
+}
+
+
+static void mock_destroy(transport_t * p_transport)
+{
+    mock_t * p_mock = mock_get(p_transport);
+
+    free(p_mock->p_events);
+    free(p_mock->p_devices);
+    free(p_mock);
+    m_mock = NULL;
+}
+
+
+static void device_init(mock_t * p_mock, uint32_t index)
+{
+    mock_device_t * p_device = &p_mock->p_devices[index];
+
+    snprintf(p_device->address, sizeof(p_device->address), "C0:DE:00:%02X:%02X:%02X",
+             (unsigned)(index >> 16) & 0xFF, (unsigned)(index >> 8) & 0xFF, (unsigned)index & 0xFF);
+    p_device->conn_handle        = BLE_CONN_HANDLE_INVALID;
+    p_device->temperature_offset = (double)(mock_random(p_mock) % 600) / 100.0 - 3.0;
+    p_device->humidity_offset    = (double)(mock_random(p_mock) % 2000) / 100.0 - 10.0;
+    p_device->phase              = (double)(mock_random(p_mock) % 628) / 100.0;
+    p_device->battery_level      = (uint8_t)(60 + mock_random(p_mock) % 41);
+
+    // Like main(): empty logs, written from index 1. The sensors were switched on at random
+    // times within a log period, so their log entries do not all fall together.
+    memset(p_device->temp_log, RTEMP_LOG_EMPTY, sizeof(p_device->temp_log));
+    memset(p_device->humidity_log, RTEMP_LOG_EMPTY, sizeof(p_device->humidity_log));
+    p_device->temp_log[0]     = 1;
+    p_device->humidity_log[0] = 1;
+    p_device->logged_ms       = mock_random(p_mock) % MOCK_LOG_PERIOD_MS;
+
+    m_device = p_device;
+    our_service_init(&p_device->service, p_device->temp_log, p_device->humidity_log);
+    set_log_head(&p_device->service, p_device->temp_log, &p_device->conn_handle);
+    m_device = NULL;
+}
+
+
+transport_t * transport_mock_create(const transport_mock_options_t * p_options,
+                                    const transport_handlers_t * p_handlers, void * p_context)
+{
+    mock_t * p_mock;
+    uint32_t i;
+
+    if (m_mock != NULL)
+    {
+        return NULL; // our_service.c reaches it through m_mock, there can be one
+    }
+    p_mock = calloc(1, sizeof(mock_t));
+    if (p_mock == NULL)
+    {
+        return NULL;
+    }
+    p_mock->p_devices = calloc(p_options->devices ? p_options->devices : 1, sizeof(mock_device_t));
+    if (p_mock->p_devices == NULL)
+    {
+        free(p_mock);
+        return NULL;
+    }
+    m_mock          = p_mock;
+    p_mock->options = *p_options;
+    p_mock->rng     = p_options->seed ? p_options->seed : 1;
+
+    p_mock->transport.p_name         = "mock";
+    p_mock->transport.device_count   = mock_device_count;
+    p_mock->transport.device_address = mock_device_address;
+    p_mock->transport.connect        = mock_connect;
+    p_mock->transport.disconnect     = mock_disconnect;
+    p_mock->transport.read           = mock_read;
+    p_mock->transport.read_part      = mock_read_part;
+    p_mock->transport.subscribe      = mock_subscribe;
+    p_mock->transport.now_ms         = mock_now_ms;
+    p_mock->transport.poll           = mock_poll;
+    p_mock->transport.destroy        = mock_destroy;
+    p_mock->transport.p_handlers     = p_handlers;
+    p_mock->transport.p_context      = p_context;
+
+    for (i = 0; i < p_options->devices; i++)
+    {
+        device_init(p_mock, i);
+    }
+    return &p_mock->transport;
+}
+
+
+/* The SoftDevice calls of our_service.c, on the attribute table of m_device. */
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * p_vs_uuid, uint8_t * p_uuid_type)
+{
+    *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN; // There is only the RTemp base
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const * p_uuid, uint16_t * p_handle)
+{
+    *p_handle = 1;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle, ble_gatts_char_md_t const * p_char_md,
+                                         ble_gatts_attr_t const * p_attr_char_value, ble_gatts_char_handles_t * p_handles)
+{
+    mock_attr_t * p_attr;
+
+    if ((m_device == NULL) || (m_device->attr_count == MOCK_MAX_ATTRS))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_attr = &m_device->attrs[m_device->attr_count];
+    memset(p_attr, 0, sizeof(*p_attr));
+    p_attr->uuid      = p_attr_char_value->p_uuid->uuid;
+    p_attr->uuid_type = p_attr_char_value->p_uuid->type;
+    p_attr->max_len   = p_attr_char_value->max_len;
+    p_attr->len       = p_attr_char_value->init_len;
+    p_attr->notify    = p_char_md->char_props.notify;
+    if (p_attr_char_value->p_attr_md->vloc == BLE_GATTS_VLOC_USER)
+    {
+        p_attr->p_value = p_attr_char_value->p_value;
+    }
+    else
+    {
+        if (m_device->stack_used + p_attr->max_len > MOCK_STACK_VALUES)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        p_attr->p_value       = &m_device->stack_values[m_device->stack_used];
+        m_device->stack_used += p_attr->max_len;
+        if (p_attr_char_value->p_value != NULL)
+        {
+            memcpy(p_attr->p_value, p_attr_char_value->p_value, p_attr->len);
+        }
+    }
+
+    // Declaration, value and CCCD
+    p_handles->value_handle     = (uint16_t)(service_handle + 1 + 3 * m_device->attr_count + 1);
+    p_handles->cccd_handle      = p_attr->notify ? (uint16_t)(p_handles->value_handle + 1) : 0;
+    p_handles->user_desc_handle = 0;
+    p_handles->sccd_handle      = 0;
+    p_attr->value_handle        = p_handles->value_handle;
+    m_device->attr_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t * p_value)
+{
+    mock_attr_t * p_attr = (m_device != NULL) ? attr_find_handle(m_device, handle) : NULL;
+
+    if (p_attr == NULL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_value->offset + p_value->len > p_attr->max_len)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    memmove(p_attr->p_value + p_value->offset, p_value->p_value, p_value->len);
+    p_attr->len = p_value->offset + p_value->len;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+    mock_attr_t * p_attr = (m_device != NULL) ? attr_find_handle(m_device, p_hvx_params->handle) : NULL;
+    mock_evt_t  * p_evt;
+    uint32_t      index;
+    uint16_t      len;
+    uint8_t       i;
+
+    if ((p_attr == NULL) || (m_device->link != LINK_CONNECTED) || (conn_handle != m_device->conn_handle))
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (!p_attr->notifying)
+    {
+        return BLE_ERROR_GATTS_SYS_ATTR_MISSING;
+    }
+    len = *p_hvx_params->p_len;
+    if (len > MOCK_NOTIFY_PAYLOAD)
+    {
+        len = MOCK_NOTIFY_PAYLOAD;
+    }
+    if (p_hvx_params->p_data != NULL)
+    {
+        sd_ble_gatts_value_set(conn_handle, p_hvx_params->handle,
+                               &(ble_gatts_value_t){len, p_hvx_params->offset, (uint8_t *)p_hvx_params->p_data});
+    }
+    index = (uint32_t)(m_device - m_mock->p_devices);
+    p_evt = evt_push(m_mock, anchor_at_or_after(m_mock, m_device, m_mock->now_us + 1), index, EVT_NOTIFICATION);
+    p_evt->len            = (uint8_t)len;
+    p_evt->characteristic = RTEMP_CHAR_COUNT;
+    memcpy(p_evt->data, p_attr->p_value, len);
+    for (i = 0; i < RTEMP_CHAR_COUNT; i++)
+    {
+        if (attr_find(m_device, (rtemp_char_t)i) == p_attr)
+        {
+            p_evt->characteristic = i;
+        }
+    }
+    *p_hvx_params->p_len = len;
+    return NRF_SUCCESS;
+}
+
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    fprintf(stderr, "transport_mock: error 0x%X at %s:%u\n", (unsigned)error_code, (const char *)p_file_name, (unsigned)line_num);
+    abort();
+}